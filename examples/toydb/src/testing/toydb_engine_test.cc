@@ -47,6 +47,19 @@ TEST_P(EngineTest, test_batch_engine) {
         LOG(INFO) << "Skip mode " << sql_case.mode();
     }
 }
+TEST_P(EngineTest, test_batch_engine_multi_thread) {
+    ParamType sql_case = GetParam();
+    EngineOptions options;
+    options.set_batch_thread_num(4);
+    LOG(INFO) << "ID: " << sql_case.id() << ", DESC: " << sql_case.desc();
+    if (!boost::contains(sql_case.mode(), "batch-unsupport") &&
+        !boost::contains(sql_case.mode(), "rtidb-unsupport") &&
+        !boost::contains(sql_case.mode(), "rtidb-batch-unsupport")) {
+        EngineCheck(sql_case, options, kBatchMode);
+    } else {
+        LOG(INFO) << "Skip mode " << sql_case.mode();
+    }
+}
 TEST_P(EngineTest, test_batch_request_engine_for_last_row) {
     ParamType sql_case = GetParam();
     EngineOptions options;
@@ -144,6 +144,9 @@ class RefCountedSlice : public Slice {
 
     RefCountedSlice() : Slice(nullptr, 0), ref_cnt_(nullptr) {}
 
+    // Return true if the slice owns the buffer
+    inline bool managed() const { return ref_cnt_ != nullptr; }
+
     RefCountedSlice(const RefCountedSlice &slice);
     RefCountedSlice(RefCountedSlice &&);
     RefCountedSlice &operator=(const RefCountedSlice &);
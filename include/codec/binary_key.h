@@ -0,0 +1,224 @@
+/*
+ * Copyright 2021 4Paradigm
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INCLUDE_CODEC_BINARY_KEY_H_
+#define INCLUDE_CODEC_BINARY_KEY_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include "base/fe_hash.h"
+
+namespace hybridse {
+namespace codec {
+
+/// \brief Fixed-width binary encoding of a tuple of key columns.
+///
+/// Keys are built column by column with the Append* methods and must be
+/// sealed with Seal() before they are hashed or compared, the hash is
+/// computed once and cached. Every value is prefixed by a null tag, fixed
+/// width values are stored big-endian with the sign bit flipped so that
+/// numeric keys keep their natural byte order, strings are length-prefixed.
+/// Keys up to kInlineSize bytes live in an inline buffer and never touch the
+/// heap.
+class BinaryKey {
+ public:
+    static const size_t kInlineSize = 32;
+    static const uint32_t kHashSeed = 0xe17a1465;
+
+    BinaryKey()
+        : data_(inline_), size_(0), capacity_(kInlineSize), hash_(0) {}
+    BinaryKey(const BinaryKey& other)
+        : data_(inline_), size_(0), capacity_(kInlineSize), hash_(0) {
+        Assign(other);
+    }
+    BinaryKey(BinaryKey&& other)
+        : data_(inline_), size_(0), capacity_(kInlineSize), hash_(0) {
+        MoveFrom(&other);
+    }
+    ~BinaryKey() {
+        if (data_ != inline_) {
+            delete[] data_;
+        }
+    }
+    BinaryKey& operator=(const BinaryKey& other) {
+        if (this != &other) {
+            Assign(other);
+        }
+        return *this;
+    }
+    BinaryKey& operator=(BinaryKey&& other) {
+        if (this != &other) {
+            size_ = 0;
+            MoveFrom(&other);
+        }
+        return *this;
+    }
+
+    inline void Clear() {
+        size_ = 0;
+        hash_ = 0;
+    }
+    /// Drop everything appended after the first `size` bytes, used to reuse
+    /// a common key prefix across rows
+    inline void Truncate(size_t size) {
+        if (size < size_) {
+            size_ = size;
+        }
+    }
+
+    inline void AppendNull() { AppendTag(kNullTag); }
+    inline void AppendBool(bool v) {
+        AppendTag(kValueTag);
+        AppendByte(v ? 1 : 0);
+    }
+    inline void AppendInt16(int16_t v) {
+        AppendTag(kValueTag);
+        AppendBigEndian(static_cast<uint16_t>(v) ^ 0x8000u, 2);
+    }
+    inline void AppendInt32(int32_t v) {
+        AppendTag(kValueTag);
+        AppendBigEndian(static_cast<uint32_t>(v) ^ 0x80000000u, 4);
+    }
+    inline void AppendInt64(int64_t v) {
+        AppendTag(kValueTag);
+        AppendBigEndian(static_cast<uint64_t>(v) ^ 0x8000000000000000ull, 8);
+    }
+    inline void AppendFloat(float v) {
+        uint32_t bits = 0;
+        memcpy(&bits, &v, sizeof(bits));
+        bits = (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+        AppendTag(kValueTag);
+        AppendBigEndian(bits, 4);
+    }
+    inline void AppendDouble(double v) {
+        uint64_t bits = 0;
+        memcpy(&bits, &v, sizeof(bits));
+        bits = (bits & 0x8000000000000000ull) ? ~bits
+                                              : (bits | 0x8000000000000000ull);
+        AppendTag(kValueTag);
+        AppendBigEndian(bits, 8);
+    }
+    inline void AppendString(const char* buf, uint32_t size) {
+        AppendTag(kValueTag);
+        AppendBigEndian(size, 4);
+        AppendBytes(buf, size);
+    }
+    inline void AppendString(const std::string& str) {
+        AppendString(str.data(), static_cast<uint32_t>(str.size()));
+    }
+
+    /// Compute and cache the hash of the current content
+    inline void Seal() {
+        hash_ = base::MurmurHash64A(data_, static_cast<int>(size_), kHashSeed);
+    }
+
+    inline uint64_t hash() const { return hash_; }
+    inline const char* data() const { return data_; }
+    inline size_t size() const { return size_; }
+    inline bool empty() const { return 0 == size_; }
+    /// Raw key bytes, used as the segment key of in-memory partitions
+    inline std::string ToString() const { return std::string(data_, size_); }
+
+    inline bool operator==(const BinaryKey& other) const {
+        return hash_ == other.hash_ && size_ == other.size_ &&
+               0 == memcmp(data_, other.data_, size_);
+    }
+    inline bool operator!=(const BinaryKey& other) const {
+        return !(*this == other);
+    }
+
+ private:
+    static const char kNullTag = 0;
+    static const char kValueTag = 1;
+
+    inline void AppendTag(char tag) { AppendByte(tag); }
+    inline void AppendByte(char c) {
+        Reserve(size_ + 1);
+        data_[size_++] = c;
+    }
+    inline void AppendBigEndian(uint64_t v, size_t width) {
+        Reserve(size_ + width);
+        for (size_t i = 0; i < width; i++) {
+            data_[size_ + i] =
+                static_cast<char>((v >> (8 * (width - 1 - i))) & 0xff);
+        }
+        size_ += width;
+    }
+    inline void AppendBytes(const char* buf, size_t size) {
+        if (0 == size) {
+            return;
+        }
+        Reserve(size_ + size);
+        memcpy(data_ + size_, buf, size);
+        size_ += size;
+    }
+    inline void Reserve(size_t capacity) {
+        if (capacity <= capacity_) {
+            return;
+        }
+        size_t new_capacity = capacity_ * 2;
+        while (new_capacity < capacity) {
+            new_capacity *= 2;
+        }
+        char* buf = new char[new_capacity];
+        memcpy(buf, data_, size_);
+        if (data_ != inline_) {
+            delete[] data_;
+        }
+        data_ = buf;
+        capacity_ = new_capacity;
+    }
+    void Assign(const BinaryKey& other) {
+        size_ = 0;
+        AppendBytes(other.data_, other.size_);
+        hash_ = other.hash_;
+    }
+    void MoveFrom(BinaryKey* other) {
+        if (other->data_ != other->inline_) {
+            // steal heap buffer
+            if (data_ != inline_) {
+                delete[] data_;
+            }
+            data_ = other->data_;
+            size_ = other->size_;
+            capacity_ = other->capacity_;
+            other->data_ = other->inline_;
+            other->capacity_ = kInlineSize;
+        } else {
+            size_ = 0;
+            AppendBytes(other->data_, other->size_);
+        }
+        hash_ = other->hash_;
+        other->size_ = 0;
+        other->hash_ = 0;
+    }
+
+    char* data_;
+    size_t size_;
+    size_t capacity_;
+    uint64_t hash_;
+    char inline_[kInlineSize];
+};
+
+struct BinaryKeyHash {
+    size_t operator()(const BinaryKey& key) const {
+        return static_cast<size_t>(key.hash());
+    }
+};
+
+}  // namespace codec
+}  // namespace hybridse
+#endif  // INCLUDE_CODEC_BINARY_KEY_H_
@@ -18,6 +18,7 @@
 #define INCLUDE_CODEC_FE_ROW_CODEC_H_
 
 #include <map>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -100,12 +101,19 @@ class RowBuilder {
     std::vector<uint32_t> offset_vec_;
 };
 
+class RowLayout;
+
+/**
+ * View of encoded rows of a schema. The field layout is shared among views
+ * of the same schema, so that a view is cheap to create and copy.
+ */
 class RowView {
  public:
     RowView();
     RowView(const hybridse::codec::Schema& schema, const int8_t* row,
             uint32_t size);
     explicit RowView(const hybridse::codec::Schema& schema);
+    explicit RowView(const std::shared_ptr<const RowLayout>& layout);
     RowView(const RowView& row_view);
     ~RowView() = default;
     bool Reset(const int8_t* row, uint32_t size);
@@ -153,7 +161,10 @@ class RowView {
     std::string GetAsString(uint32_t idx);
     std::string GetRowString();
     int32_t GetPrimaryFieldOffset(uint32_t idx);
-    const Schema* GetSchema() const { return &schema_; }
+    const Schema* GetSchema() const;
+    const std::shared_ptr<const RowLayout>& GetLayout() const {
+        return layout_;
+    }
 
     inline bool IsNULL(const int8_t* row, uint32_t idx) const {
         const int8_t* ptr = row + HEADER_LENGTH + (idx >> 3);
@@ -161,18 +172,14 @@ class RowView {
     }
 
  private:
-    bool Init();
     bool CheckValid(uint32_t idx, ::hybridse::type::Type type);
 
  private:
     uint8_t str_addr_length_;
     bool is_valid_;
-    uint32_t string_field_cnt_;
-    uint32_t str_field_start_offset_;
     uint32_t size_;
     const int8_t* row_;
-    const Schema schema_;
-    std::vector<uint32_t> offset_vec_;
+    std::shared_ptr<const RowLayout> layout_;
 };
 
 struct ColInfo {
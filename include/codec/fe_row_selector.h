@@ -17,14 +17,27 @@
 #ifndef INCLUDE_CODEC_FE_ROW_SELECTOR_H_
 #define INCLUDE_CODEC_FE_ROW_SELECTOR_H_
 
+#include <memory>
 #include <utility>
 #include <vector>
+#include "base/mem_pool.h"
 #include "codec/fe_row_codec.h"
 #include "codec/row.h"
+#include "codec/row_layout.h"
 
 namespace hybridse {
 namespace codec {
 
+/**
+ * Select columns of encoded rows into new encoded rows. A plan is resolved
+ * once per source schemas and indices: fixed-size fields are copied by
+ * memcpy ranges, adjacent fields merged, null bits are moved one by one and
+ * string fields are copied with their offsets rewritten, so that no field is
+ * decoded on select.
+ *
+ * A selector keeps scratch state of the last select, it must not be shared
+ * among threads.
+ */
 class RowSelector {
  public:
     RowSelector(const hybridse::codec::Schema* schema,
@@ -36,15 +49,69 @@ class RowSelector {
                 size_t* out_size);
     bool Select(const Row& row, int8_t** out_slice, size_t* out_size);
 
+    /**
+     * Select into `buf` of `capacity` bytes. If the selected row does not
+     * fit, return false with the required size in `out_size`, so that the
+     * caller can retry with a larger buffer. `out_size` is 0 on error.
+     */
+    bool SelectInto(const Row& row, int8_t* buf, size_t capacity,
+                    size_t* out_size);
+    // Select into memory allocated from `pool`, which owns the result
+    bool Select(const Row& row, base::ByteMemoryPool* pool, int8_t** out_slice,
+                size_t* out_size);
+
+    inline const hybridse::codec::Schema& GetTargetSchema() const {
+        return target_schema_;
+    }
+
  private:
+    // Fixed-size bytes copied from a source slice
+    struct FieldCopy {
+        uint32_t slice;
+        uint32_t src_offset;
+        uint32_t dst_offset;
+        uint32_t size;
+    };
+    // Null bit of a selected column
+    struct NullBit {
+        uint32_t slice;
+        uint32_t src_idx;
+        uint32_t dst_idx;
+    };
+    // String field of a source slice, in target string order
+    struct StringField {
+        uint32_t slice;
+        uint32_t src_idx;
+        uint32_t src_order;
+        uint32_t next_src_order;
+    };
+
     hybridse::codec::Schema CreateTargetSchema();
+    bool BuildPlan();
+    // Resolve selected strings of current slices, return total size of the
+    // selected row or 0 on error
+    uint32_t ResolveStrings();
+    void Encode(int8_t* buf, uint32_t size);
 
     std::vector<const hybridse::codec::Schema*> schemas_;
     std::vector<std::pair<size_t, size_t>> indices_;
 
     hybridse::codec::Schema target_schema_;
-    std::vector<RowView> row_views_;
     RowBuilder target_row_builder_;
+
+    std::vector<std::shared_ptr<const RowLayout>> layouts_;
+    bool is_valid_;
+    std::vector<FieldCopy> field_copies_;
+    std::vector<NullBit> null_bits_;
+    std::vector<StringField> str_fields_;
+    uint32_t str_field_start_offset_;
+    // slices referred to by the plan, 1 + max slice of selected columns
+    uint32_t used_slice_cnt_;
+
+    // scratch of current select
+    std::vector<const int8_t*> slices_;
+    std::vector<uint32_t> slice_sizes_;
+    std::vector<std::pair<const char*, uint32_t>> str_refs_;
 };
 
 }  // namespace codec
@@ -0,0 +1,121 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INCLUDE_CODEC_ROW_LAYOUT_H_
+#define INCLUDE_CODEC_ROW_LAYOUT_H_
+
+#include <memory>
+#include <vector>
+#include "codec/fe_row_codec.h"
+
+namespace hybridse {
+namespace codec {
+
+/**
+ * Field layout of encoded rows of a schema, resolved once. Offsets and
+ * types of fixed-size columns are looked up without type dispatch, and
+ * `Gather*` extract one column of a batch of rows in a single pass, using
+ * avx2 gathers when the host supports them.
+ *
+ * Layouts are immutable, `Get` shares one layout among all RowViews of
+ * the same schema.
+ */
+class RowLayout {
+ public:
+    // Read a non-null fixed-size field at `offset` of `row` into `val`
+    typedef void (*FieldReader)(const int8_t* row, uint32_t offset, void* val);
+
+    explicit RowLayout(const Schema& schema);
+    ~RowLayout() {}
+
+    /**
+     * Shared layout of `schema`. Every thread keeps weak references to
+     * layouts of recently used schemas by fingerprint, so that views of a
+     * schema are built without lock. Otherwise layouts are cached by schema
+     * content, so that equal schemas of different owners share one layout.
+     */
+    static std::shared_ptr<const RowLayout> Get(const Schema& schema);
+
+    // False if any column type is not supported
+    inline bool IsValid() const { return is_valid_; }
+    inline const Schema* GetSchema() const { return &schema_; }
+    inline uint32_t GetColumnCnt() const { return types_.size(); }
+    inline ::hybridse::type::Type GetType(uint32_t idx) const {
+        return types_[idx];
+    }
+    // Byte offset of a fixed-size column, or string field order of a
+    // varchar column
+    inline uint32_t GetOffset(uint32_t idx) const { return offsets_[idx]; }
+    // String field order of the varchar column after `idx`, or 0 if `idx`
+    // is the last one
+    inline uint32_t GetNextStringOffset(uint32_t idx) const {
+        return offsets_[idx] + 1 < str_field_cnt_ ? offsets_[idx] + 1 : 0;
+    }
+    inline uint32_t GetStringFieldCnt() const { return str_field_cnt_; }
+    inline uint32_t GetStringFieldStartOffset() const {
+        return str_field_start_offset_;
+    }
+
+    static inline bool IsNULL(const int8_t* row, uint32_t idx) {
+        const int8_t* ptr = row + HEADER_LENGTH + (idx >> 3);
+        return *(reinterpret_cast<const uint8_t*>(ptr)) & (1 << (idx & 0x07));
+    }
+
+    // Read non-null column `idx` of a valid `row` into `val`, idx is not
+    // checked. Return false if the column is not fixed-size.
+    inline bool ReadField(const int8_t* row, uint32_t idx, void* val) const {
+        FieldReader reader = readers_[idx];
+        if (nullptr == reader) {
+            return false;
+        }
+        reader(row, offsets_[idx], val);
+        return true;
+    }
+
+    /**
+     * Gather integer column `idx` (int16, int32, int64, timestamp or date)
+     * of `cnt` rows into `values`. Null values, null or empty rows yield
+     * `null_value`. Return false if the column is not an integer column.
+     */
+    bool GatherInt64(const int8_t* const* rows, size_t cnt, uint32_t idx,
+                     int64_t null_value, int64_t* values) const;
+
+    /**
+     * Gather numeric column `idx` of `cnt` rows into `values` as double,
+     * with the same null handling as `GatherInt64`. Return false if the
+     * column is not numeric.
+     */
+    bool GatherDouble(const int8_t* const* rows, size_t cnt, uint32_t idx,
+                      double null_value, double* values) const;
+
+ private:
+    // Resolve field address of `cnt` rows, null entries are pointed to a
+    // zero filled dummy field and marked in `nulls`
+    size_t ResolveAddrs(const int8_t* const* rows, size_t cnt, uint32_t idx,
+                        const int8_t** addrs, bool* nulls) const;
+
+    const Schema schema_;
+    bool is_valid_;
+    std::vector<::hybridse::type::Type> types_;
+    std::vector<uint32_t> offsets_;
+    std::vector<FieldReader> readers_;
+    uint32_t str_field_cnt_;
+    uint32_t str_field_start_offset_;
+};
+
+}  // namespace codec
+}  // namespace hybridse
+#endif  // INCLUDE_CODEC_ROW_LAYOUT_H_
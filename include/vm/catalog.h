@@ -386,6 +386,9 @@ class PartitionHandler : public TableHandler {
     /// Return order type of the dataset,
     /// and return kNoneOrder by default.
     const OrderType GetOrderType() const { return kNoneOrder; }
+    /// Return true if segment keys are encoded by codec::BinaryKey instead
+    /// of key strings of storage index, and return `false` by default.
+    virtual bool IsBinaryKey() { return false; }
 };
 
 /// \brief A wrapper of table handler which is used as a asynchronous row
@@ -17,6 +17,7 @@
 #ifndef INCLUDE_VM_ENGINE_H_
 #define INCLUDE_VM_ENGINE_H_
 
+#include <future>  // NOLINT
 #include <map>
 #include <memory>
 #include <mutex>  //NOLINT
@@ -35,6 +36,12 @@
 #include "vm/engine_context.h"
 #include "vm/router.h"
 
+namespace hybridse {
+namespace base {
+class ThreadPool;
+}  // namespace base
+}  // namespace hybridse
+
 namespace hybridse {
 namespace vm {
 
@@ -111,6 +118,76 @@ class EngineOptions {
         return enable_batch_window_parallelization_;
     }
 
+    /// Set the number of worker threads used to execute a single batch query
+    /// in parallel, default `1`.
+    ///
+    /// If greater than `1`, window aggregations in batch mode are computed
+    /// on a shared thread pool with partition keys spread across workers,
+    /// and rows of a request batch in batch request mode are split into
+    /// chunks run on the same pool.
+    inline EngineOptions* set_batch_thread_num(uint32_t num) {
+        batch_thread_num_ = num;
+        return this;
+    }
+    /// Return the number of worker threads used to execute batch query.
+    inline uint32_t batch_thread_num() const { return batch_thread_num_; }
+
+    /// Set the memory budget in bytes of sorting rows for ORDER BY in batch
+    /// mode, default `0` to always sort in memory.
+    ///
+    /// Once sorted rows take more than the budget, they are spilled as
+    /// sorted runs into temporary files and released, and runs are merged
+    /// while the output is iterated. Rows still held by the input of ORDER
+    /// BY, such as rows of a stored table, are not released. Queries with
+    /// LIMIT keep only the first rows and never spill.
+    inline EngineOptions* set_batch_sort_memory_limit(uint64_t bytes) {
+        batch_sort_memory_limit_ = bytes;
+        return this;
+    }
+    /// Return the memory budget of sorting rows in batch mode.
+    inline uint64_t batch_sort_memory_limit() const {
+        return batch_sort_memory_limit_;
+    }
+
+    /// Set the directory of temporary files spilled by ORDER BY in batch
+    /// mode, default `/tmp`.
+    inline EngineOptions* set_batch_sort_spill_dir(const std::string& dir) {
+        batch_sort_spill_dir_ = dir;
+        return this;
+    }
+    /// Return the directory of temporary files spilled by ORDER BY.
+    inline const std::string& batch_sort_spill_dir() const {
+        return batch_sort_spill_dir_;
+    }
+
+    /// Set the number of threads compiling SQL in background for
+    /// `Engine::CompileAsync` and `Engine::GetAsync`, default `1`.
+    inline EngineOptions* set_compile_thread_num(uint32_t num) {
+        compile_thread_num_ = num;
+        return this;
+    }
+    /// Return the number of background compiling threads.
+    inline uint32_t compile_thread_num() const { return compile_thread_num_; }
+
+    /// Set the number of times a compiled sql is fetched from cache before
+    /// it is recompiled with full optimization, default `0` to disable
+    /// tiered compilation.
+    ///
+    /// With a positive threshold, sql is compiled with minimal jit
+    /// optimization first, so that one-off queries start quickly. Once
+    /// fetched `threshold` times by `Engine::Get` or `Engine::GetAsync`,
+    /// the sql is recompiled at -O3 on background compiling threads and
+    /// the result replaces the cached one. Sessions that already hold the
+    /// old result keep running it safely.
+    inline EngineOptions* set_tiered_compile_threshold(uint64_t threshold) {
+        tiered_compile_threshold_ = threshold;
+        return this;
+    }
+    /// Return the fetch count that triggers full optimization.
+    inline uint64_t tiered_compile_threshold() const {
+        return tiered_compile_threshold_;
+    }
+
     /// Set the maximum number of cache entries, default is `50`.
     inline void set_max_sql_cache_size(uint32_t size) {
         max_sql_cache_size_ = size;
@@ -137,6 +214,11 @@ class EngineOptions {
     bool batch_request_optimized_;
     bool enable_expr_optimize_;
     bool enable_batch_window_parallelization_;
+    uint32_t batch_thread_num_;
+    uint64_t batch_sort_memory_limit_;
+    std::string batch_sort_spill_dir_;
+    uint32_t compile_thread_num_;
+    uint64_t tiered_compile_threshold_;
     uint32_t max_sql_cache_size_;
     bool enable_spark_unsaferow_format_;
     JitOptions jit_options_;
@@ -295,6 +377,14 @@ struct ExplainOutput {
 };
 
 
+/// \brief Result of a compilation started by `Engine::CompileAsync`.
+struct CompileResult {
+    /// Compile status, not ok if the compilation failed
+    base::Status status;
+    /// Compile result, null if the compilation failed
+    std::shared_ptr<CompileInfo> info;
+};
+
 /// \brief An engine is responsible to compile SQL on the specific Catalog.
 ///
 /// An engine can be used to `compile sql and explain the compiling result.
@@ -330,6 +420,37 @@ class Engine {
              RunSession& session,    // NOLINT
              base::Status& status);  // NOLINT
 
+    /// \brief Non-blocking version of `Get`.
+    ///
+    /// Return `true` and set the compile result into session if the sql is
+    /// already compiled. Otherwise start compiling it in background and
+    /// return `false` with a running status, so that the caller can serve
+    /// the request with a fallback and retry later. A failed background
+    /// compilation is reported by the next call.
+    bool GetAsync(const std::string& sql, const std::string& db,
+                  RunSession& session,    // NOLINT
+                  base::Status& status);  // NOLINT
+
+    /// \brief Compile sql in db on background compiling threads.
+    ///
+    /// Return the future of compile result, which is ready at once if the
+    /// sql is already compiled. Concurrent compilations of the same sql,
+    /// db, mode and common column indices, including those from `Get`, are
+    /// merged into one.
+    std::shared_future<CompileResult> CompileAsync(
+        const std::string& sql, const std::string& db, EngineMode engine_mode,
+        const std::set<size_t>& common_column_indices = {});
+
+    /// \brief Return the future of running recompilation of hot sql with
+    /// full optimization, see `EngineOptions::set_tiered_compile_threshold`.
+    ///
+    /// The future is invalid if the sql is not being recompiled. Once the
+    /// recompilation is done, its result is cached unless the cache entry of
+    /// the sql has been dropped or replaced meanwhile.
+    std::shared_future<CompileResult> GetHotCompiling(
+        const std::string& sql, const std::string& db, EngineMode engine_mode,
+        const std::set<size_t>& common_column_indices = {});
+
     /// \brief Search all tables related to the specific sql in db.
     ///
     /// The tables' names are returned in tables
@@ -363,24 +484,49 @@ class Engine {
     /// \brief Clear engine's compiling result cache
     void ClearCacheLocked(const std::string& db);
 
+    /// \brief Return hit, miss and eviction counters of compiling result cache
+    EngineCacheStats GetCacheStats() const { return compile_cache_.GetStats(); }
+
  private:
     bool GetDependentTables(node::PlanNode* node, std::set<std::string>* tables,
                             base::Status& status);  // NOLINT
-    std::shared_ptr<CompileInfo> GetCacheLocked(const std::string& db,
-                                                const std::string& sql,
-                                                EngineMode engine_mode);
-    bool SetCacheLocked(const std::string& db, const std::string& sql,
-                        EngineMode engine_mode,
-                        std::shared_ptr<CompileInfo> info);
 
     bool IsCompatibleCache(RunSession& session,  // NOLINT
                            std::shared_ptr<CompileInfo> info,
                            base::Status& status);  // NOLINT
 
+    // Compile sql and cache the result, return null on failure. `is_hot`
+    // compiles with full optimization and leaves caching to caller.
+    std::shared_ptr<CompileInfo> Compile(
+        const std::string& sql, const std::string& db, EngineMode engine_mode,
+        const std::set<size_t>& common_column_indices, bool is_hot,
+        base::Status& status);  // NOLINT
+    // Count a fetch of cached `info`, and recompile it in background once
+    // it turns hot
+    void CountCacheHit(const std::shared_ptr<CompileInfo>& info);
+    std::shared_ptr<base::ThreadPool> GetCompilePool();
+    // Return `true` and set `promise` if caller owns compilation of `key`,
+    // otherwise return `false` with `future` of the running compilation
+    bool StartCompiling(const std::string& key,
+                        std::shared_future<CompileResult>* future,
+                        std::shared_ptr<std::promise<CompileResult>>* promise);
+    void FinishCompiling(const std::string& key,
+                         std::shared_ptr<std::promise<CompileResult>> promise,
+                         const CompileResult& result, bool keep_failure);
+
     std::shared_ptr<Catalog> cl_;
     EngineOptions options_;
-    base::SpinMutex mu_;
-    EngineLRUCache lru_cache_;
+    EngineCompileCache compile_cache_;
+    // null if batch query runs on caller thread only
+    std::shared_ptr<base::ThreadPool> batch_thread_pool_;
+    // running compilations keyed by mode, db, sql and common columns
+    std::mutex compiling_mu_;
+    std::map<std::string, std::shared_future<CompileResult>> compiling_;
+    // running recompilations of hot sql, keyed as `compiling_`
+    std::map<std::string, std::shared_future<CompileResult>> hot_compiling_;
+    // created on first async compilation, destroyed first so that pending
+    // compilations finish while engine is still alive
+    std::shared_ptr<base::ThreadPool> compile_pool_;
 };
 
 /// \brief Local tablet is responsible to run a task locally.
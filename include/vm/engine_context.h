@@ -15,11 +15,16 @@
  */
 #ifndef INCLUDE_VM_ENGINE_CONTEXT_H_
 #define INCLUDE_VM_ENGINE_CONTEXT_H_
+#include <atomic>
 #include <map>
 #include <memory>
+#include <mutex>  // NOLINT
 #include <set>
+#include <shared_mutex>  // NOLINT
 #include <string>
-#include "boost/compute/detail/lru_cache.hpp"
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include "vm/physical_op.h"
 namespace hybridse {
 namespace vm {
@@ -63,11 +68,106 @@ class CompileInfo {
                                 const std::string& tab) = 0;
 };
 
-typedef std::map<
-    EngineMode,
-    std::map<std::string, boost::compute::detail::lru_cache<
-                              std::string, std::shared_ptr<CompileInfo>>>>
-    EngineLRUCache;
+/// \brief Counters of engine compile cache
+struct EngineCacheStats {
+    /// Number of lookups that found a compile result
+    uint64_t hit = 0;
+    /// Number of lookups that found nothing
+    uint64_t miss = 0;
+    /// Number of compile results dropped because the cache was full
+    uint64_t eviction = 0;
+    /// Number of compile results currently cached
+    uint64_t size = 0;
+};
+
+/// \brief Sharded LRU cache of compile results.
+///
+/// Entries are keyed by a hash of (mode, db, sql, common column indices),
+/// which is computed once per call and picks the shard. Lookups take only
+/// a shared lock of their own shard. The LRU order is kept as the access
+/// time of each entry, which a hit stores in a relaxed atomic along with
+/// the hit counter, so lookups never exclude each other. The cache holds at most
+/// `capacity` entries per (mode, db). Insert, evict and clear are
+/// serialized. They only happen after a compile, so they can afford to
+/// scan all shards.
+class EngineCompileCache {
+ public:
+    static const size_t kShardNum = 64;
+
+    explicit EngineCompileCache(uint32_t capacity);
+
+    /// Return cached compile result, or null if there is none.
+    std::shared_ptr<CompileInfo> Get(
+        EngineMode mode, const std::string& db, const std::string& sql,
+        const std::set<size_t>& common_column_indices);
+
+    /// Cache compile result. Return `false` if the key is already cached
+    /// and `overwrite` is `false`.
+    bool Insert(EngineMode mode, const std::string& db, const std::string& sql,
+                const std::set<size_t>& common_column_indices,
+                std::shared_ptr<CompileInfo> info, bool overwrite);
+
+    /// Replace cached `old_info` with `info`. Return `false` if the key is
+    /// no longer cached with `old_info`, e.g. dropped by `Clear`.
+    bool Replace(EngineMode mode, const std::string& db,
+                 const std::string& sql,
+                 const std::set<size_t>& common_column_indices,
+                 const std::shared_ptr<CompileInfo>& old_info,
+                 std::shared_ptr<CompileInfo> info);
+
+    /// Drop every compile result of `db`.
+    void Clear(const std::string& db);
+
+    EngineCacheStats GetStats() const;
+
+ private:
+    struct Entry {
+        Entry(EngineMode mode, const std::string& db, const std::string& sql,
+              const std::set<size_t>& common_column_indices,
+              std::shared_ptr<CompileInfo> info, int64_t last_access)
+            : mode(mode),
+              db(db),
+              sql(sql),
+              common_column_indices(common_column_indices),
+              info(info),
+              last_access(last_access) {}
+        EngineMode mode;
+        std::string db;
+        std::string sql;
+        std::set<size_t> common_column_indices;
+        // written under exclusive lock only
+        std::shared_ptr<CompileInfo> info;
+        std::atomic<int64_t> last_access;
+    };
+    static const size_t kCacheLineSize = 64;
+    // Shards locked by different threads must not share a cache line. The
+    // trailing padding keeps them apart, since std::vector doesn't honor
+    // alignas beyond 16 bytes before c++17 aligned new
+    struct Shard {
+        mutable std::shared_timed_mutex mu;
+        std::unordered_multimap<uint64_t, Entry> entries;
+        std::atomic<uint64_t> hit{0};
+        std::atomic<uint64_t> miss{0};
+        char padding[kCacheLineSize];
+    };
+    typedef std::unordered_multimap<uint64_t, Entry>::iterator EntryIter;
+
+    static uint64_t HashKey(EngineMode mode, const std::string& db,
+                            const std::string& sql,
+                            const std::set<size_t>& common_column_indices);
+    static EntryIter FindLocked(
+        Shard* shard, uint64_t hash, EngineMode mode, const std::string& db,
+        const std::string& sql, const std::set<size_t>& common_column_indices);
+    // Drop least recently used entries of (mode, db) until within capacity
+    void EvictLocked(EngineMode mode, const std::string& db);
+
+    const uint32_t capacity_;
+    std::vector<Shard> shards_;
+    // serialize insert, evict and clear
+    std::mutex write_mu_;
+    std::map<std::pair<EngineMode, std::string>, size_t> counts_;
+    std::atomic<uint64_t> eviction_;
+};
 
 class CompileInfoCache {
  public:
@@ -93,11 +193,34 @@ class JitOptions {
     bool is_enable_perf() const { return enable_perf_; }
     void set_enable_perf(bool flag) { enable_perf_ = flag; }
 
+    // optimization level of compiled code. 0 runs minimal passes and fast
+    // instruction selection to compile quickly, 1 runs a few scalar
+    // passes, 2 and 3 run the full llvm pipeline with inlining and
+    // vectorization
+    uint32_t opt_level() const { return opt_level_; }
+    void set_opt_level(uint32_t level) { opt_level_ = level; }
+
+    // directory to persist compiled objects, empty to disable
+    const std::string& object_cache_dir() const { return object_cache_dir_; }
+    void set_object_cache_dir(const std::string& dir) {
+        object_cache_dir_ = dir;
+    }
+
+    // total bytes of persisted objects, least recently used objects are
+    // removed beyond it
+    uint64_t object_cache_capacity() const { return object_cache_capacity_; }
+    void set_object_cache_capacity(uint64_t bytes) {
+        object_cache_capacity_ = bytes;
+    }
+
  private:
     bool enable_mcjit_ = false;
     bool enable_vtune_ = false;
     bool enable_gdb_ = false;
     bool enable_perf_ = false;
+    uint32_t opt_level_ = 1;
+    std::string object_cache_dir_;
+    uint64_t object_cache_capacity_ = 1ull << 30;
 };
 }  // namespace vm
 }  // namespace hybridse
@@ -22,9 +22,11 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 #include "base/fe_slice.h"
+#include "codec/binary_key.h"
 #include "codec/list_iterator_codec.h"
 #include "glog/logging.h"
 #include "vm/catalog.h"
@@ -167,11 +169,14 @@ class MemTableHandler : public TableHandler {
         const std::string& idx_name);
 
     void AddRow(const Row& row);
+    void Reserve(const size_t size) { table_.reserve(size); }
     void Reverse();
     virtual const uint64_t GetCount() { return table_.size(); }
     virtual Row At(uint64_t pos) {
         return pos < table_.size() ? table_.at(pos) : Row();
     }
+    // Move row at `pos` out of table, an empty row is left in its place
+    Row TakeRow(uint64_t pos);
 
     const OrderType GetOrderType() const { return order_type_; }
     void SetOrderType(const OrderType order_type) { order_type_ = order_type; }
@@ -239,6 +244,19 @@ class MemTimeTableHandler : public TableHandler {
     OrderType order_type_;
 };
 
+/// Observer of rows entering and leaving a window, used to maintain
+/// aggregation states incrementally instead of rescanning the window.
+class WindowUpdateListener {
+ public:
+    virtual ~WindowUpdateListener() {}
+    /// row enters the window as the latest row
+    virtual void OnAddFront(const Row& row) = 0;
+    /// the earliest row slides out of the window
+    virtual void OnPopBack(const Row& row) = 0;
+    /// the latest row is taken out of the window
+    virtual void OnPopFront(const Row& row) = 0;
+};
+
 class Window : public MemTimeTableHandler {
  public:
     enum WindowFrameType {
@@ -249,7 +267,8 @@ class Window : public MemTimeTableHandler {
     Window()
         : MemTimeTableHandler(),
           exclude_current_time_(false),
-          instance_not_in_window_(false) {}
+          instance_not_in_window_(false),
+          update_listener_(nullptr) {}
     virtual ~Window() {}
 
     std::unique_ptr<RowIterator> GetIterator() override {
@@ -285,10 +304,35 @@ class Window : public MemTimeTableHandler {
     void set_exclude_current_time(const bool flag) {
         exclude_current_time_ = flag;
     }
+    void set_update_listener(WindowUpdateListener* listener) {
+        update_listener_ = listener;
+    }
+
+    // Hide MemTimeTableHandler's row updates so that every change of window
+    // rows is reported to update listener
+    void AddFrontRow(const uint64_t key, const Row& row) {
+        MemTimeTableHandler::AddFrontRow(key, row);
+        if (nullptr != update_listener_) {
+            update_listener_->OnAddFront(row);
+        }
+    }
+    void PopBackRow() {
+        if (nullptr != update_listener_ && !table_.empty()) {
+            update_listener_->OnPopBack(table_.back().second);
+        }
+        MemTimeTableHandler::PopBackRow();
+    }
+    void PopFrontRow() {
+        if (nullptr != update_listener_ && !table_.empty()) {
+            update_listener_->OnPopFront(table_.front().second);
+        }
+        MemTimeTableHandler::PopFrontRow();
+    }
 
  protected:
     bool exclude_current_time_;
     bool instance_not_in_window_;
+    WindowUpdateListener* update_listener_;
 };
 class WindowRange {
  public:
@@ -610,6 +654,9 @@ class MemPartitionHandler
     const std::string& GetDatabase() override;
     virtual std::unique_ptr<WindowIterator> GetWindowIterator();
     bool AddRow(const std::string& key, uint64_t ts, const Row& row);
+    /// Add row to the segment of a sealed binary key, segments are looked up
+    /// through a hash index instead of comparing key strings
+    bool AddRow(const codec::BinaryKey& key, uint64_t ts, const Row& row);
     void Sort(const bool is_asc);
     void Reverse();
     void Print();
@@ -623,12 +670,15 @@ class MemPartitionHandler
     const std::string GetHandlerTypeName() override {
         return "MemPartitionHandler";
     }
+    bool IsBinaryKey() override { return !binary_index_.empty(); }
 
  private:
     std::string table_name_;
     std::string db_;
     const Schema* schema_;
     MemSegmentMap partitions_;
+    std::unordered_map<codec::BinaryKey, MemTimeTable*, codec::BinaryKeyHash>
+        binary_index_;
     Types types_;
     IndexHint index_hint_;
     OrderType order_type_;
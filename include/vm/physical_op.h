@@ -141,6 +141,8 @@ class FnInfo {
         frames_.clear();
         schemas_ctx_ = nullptr;
         fn_ptr_ = nullptr;
+        block_fn_name_ = "";
+        block_fn_ptr_ = nullptr;
     }
 
     const node::FrameNode *GetFrame(size_t idx) const {
@@ -156,6 +158,12 @@ class FnInfo {
     const int8_t *fn_ptr() const { return fn_ptr_; }
     void SetFnPtr(const int8_t *fn) { fn_ptr_ = fn; }
 
+    // function running `fn` on a block of rows, empty if not generated
+    const std::string &block_fn_name() const { return block_fn_name_; }
+    void SetBlockFnName(const std::string &name) { block_fn_name_ = name; }
+    const int8_t *block_fn_ptr() const { return block_fn_ptr_; }
+    void SetBlockFnPtr(const int8_t *fn) { block_fn_ptr_ = fn; }
+
  private:
     std::string fn_name_ = "";
     vm::Schema fn_schema_;
@@ -172,6 +180,10 @@ class FnInfo {
 
     // function ptr
     const int8_t *fn_ptr_ = nullptr;
+
+    // block function name and ptr
+    std::string block_fn_name_ = "";
+    const int8_t *block_fn_ptr_ = nullptr;
 };
 
 class FnComponent {
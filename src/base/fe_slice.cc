@@ -22,10 +22,11 @@ namespace base {
 RefCountedSlice::~RefCountedSlice() { Release(); }
 
 void RefCountedSlice::Release() {
+    // slices of one buffer may be copied and released on several threads,
+    // such as window aggregation workers of keys sharing joined rows, or
+    // branches of a job reading a shared input table
     if (this->ref_cnt_ != nullptr) {
-        auto& cnt = *this->ref_cnt_;
-        cnt -= 1;
-        if (cnt == 0) {
+        if (__atomic_sub_fetch(this->ref_cnt_, 1, __ATOMIC_ACQ_REL) == 0) {
             free(buf());
             delete this->ref_cnt_;
         }
@@ -36,7 +37,7 @@ void RefCountedSlice::Update(const RefCountedSlice& slice) {
     reset(slice.data(), slice.size());
     this->ref_cnt_ = slice.ref_cnt_;
     if (this->ref_cnt_ != nullptr) {
-        (*this->ref_cnt_) += 1;
+        __atomic_fetch_add(this->ref_cnt_, 1, __ATOMIC_RELAXED);
     }
 }
 
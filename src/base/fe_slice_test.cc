@@ -15,6 +15,8 @@
  */
 
 #include "base/fe_slice.h"
+#include <thread>  // NOLINT
+#include <vector>
 #include "gtest/gtest.h"
 
 namespace hybridse {
@@ -46,6 +48,31 @@ TEST_F(SliceTest, ref_cnt_slice) {
     ASSERT_EQ(0, strcmp(reinterpret_cast<char*>(ref.buf()), "hello world"));
 }
 
+TEST_F(SliceTest, ref_cnt_slice_concurrent) {
+    auto buf = reinterpret_cast<int8_t*>(malloc(1024));
+    strcpy(reinterpret_cast<char*>(buf), "hello world");  // NOLINT
+    auto slice = RefCountedSlice::CreateManaged(buf, 1024);
+
+    // workers copy and release the shared slice at the same time
+    std::vector<std::thread> workers;
+    for (int i = 0; i < 8; ++i) {
+        workers.push_back(std::thread([&slice]() {
+            for (int j = 0; j < 100000; ++j) {
+                RefCountedSlice copy = slice;
+                RefCountedSlice other;
+                other = copy;
+            }
+        }));
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    RefCountedSlice ref = slice;
+    slice = RefCountedSlice();
+    ASSERT_TRUE(ref.managed());
+    ASSERT_EQ(0, strcmp(reinterpret_cast<char*>(ref.buf()), "hello world"));
+}
+
 }  // namespace base
 }  // namespace hybridse
 
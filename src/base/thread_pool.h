@@ -0,0 +1,171 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_BASE_THREAD_POOL_H_
+#define SRC_BASE_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <functional>
+#include <future>  // NOLINT
+#include <memory>
+#include <mutex>  // NOLINT
+#include <thread>  // NOLINT
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace hybridse {
+namespace base {
+
+/**
+ * Fixed size work-stealing thread pool. Every worker owns a task queue,
+ * tasks submitted by a worker go to its own queue and are run LIFO for
+ * locality, idle workers steal the oldest task of other queues. Tasks
+ * submitted from outside are spread over queues round-robin.
+ */
+class ThreadPool {
+ public:
+    explicit ThreadPool(size_t thread_num)
+        : stop_(false), pending_(0), next_queue_(0) {
+        if (0 == thread_num) {
+            thread_num = 1;
+        }
+        for (size_t i = 0; i < thread_num; i++) {
+            queues_.emplace_back(new WorkQueue());
+        }
+        for (size_t i = 0; i < thread_num; i++) {
+            threads_.emplace_back([this, i]() { WorkerLoop(i); });
+        }
+    }
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (auto& thread : threads_) {
+            thread.join();
+        }
+    }
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t thread_num() const { return threads_.size(); }
+
+    /// Return `true` if current thread is a worker of this pool. Blocking
+    /// on tasks of the same pool from a worker may deadlock, callers should
+    /// run inline instead.
+    bool InWorker() const { return CurrentPool() == this; }
+
+    /// Run `fn` on pool and return the future of its result
+    template <typename F>
+    std::future<typename std::result_of<F()>::type> Submit(F&& fn) {
+        typedef typename std::result_of<F()>::type R;
+        auto task = std::make_shared<std::packaged_task<R()>>(
+            std::forward<F>(fn));
+        std::future<R> res = task->get_future();
+        Push([task]() { (*task)(); });
+        return res;
+    }
+
+ private:
+    struct WorkQueue {
+        std::mutex mu;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    static const ThreadPool*& CurrentPool() {
+        static thread_local const ThreadPool* pool = nullptr;
+        return pool;
+    }
+    static size_t& CurrentIndex() {
+        static thread_local size_t idx = 0;
+        return idx;
+    }
+
+    void Push(std::function<void()>&& task) {
+        size_t idx = InWorker() ? CurrentIndex()
+                                : next_queue_.fetch_add(1) % queues_.size();
+        {
+            std::lock_guard<std::mutex> lock(queues_[idx]->mu);
+            queues_[idx]->tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            pending_++;
+        }
+        cv_.notify_one();
+    }
+
+    // Take newest task of own queue, or steal oldest task of others
+    bool TryPop(size_t idx, std::function<void()>* task) {
+        {
+            WorkQueue* queue = queues_[idx].get();
+            std::lock_guard<std::mutex> lock(queue->mu);
+            if (!queue->tasks.empty()) {
+                *task = std::move(queue->tasks.back());
+                queue->tasks.pop_back();
+                return true;
+            }
+        }
+        for (size_t i = 1; i < queues_.size(); i++) {
+            WorkQueue* queue = queues_[(idx + i) % queues_.size()].get();
+            std::lock_guard<std::mutex> lock(queue->mu);
+            if (!queue->tasks.empty()) {
+                *task = std::move(queue->tasks.front());
+                queue->tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void WorkerLoop(size_t idx) {
+        CurrentPool() = this;
+        CurrentIndex() = idx;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mu_);
+                cv_.wait(lock, [this]() { return stop_ || pending_ > 0; });
+                if (0 == pending_) {
+                    return;
+                }
+                // reserve one task, it stays in some queue until taken
+                pending_--;
+            }
+            std::function<void()> task;
+            while (!TryPop(idx, &task)) {
+                std::this_thread::yield();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::unique_ptr<WorkQueue>> queues_;
+    std::vector<std::thread> threads_;
+    std::mutex mu_;
+    std::condition_variable cv_;
+    bool stop_;
+    // number of queued tasks not yet reserved by a worker
+    size_t pending_;
+    std::atomic<size_t> next_queue_;
+};
+
+}  // namespace base
+}  // namespace hybridse
+#endif  // SRC_BASE_THREAD_POOL_H_
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "base/thread_pool.h"
+#include <atomic>
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace hybridse {
+namespace base {
+
+class ThreadPoolTest : public ::testing::Test {};
+
+TEST_F(ThreadPoolTest, SubmitTest) {
+    ThreadPool pool(4);
+    ASSERT_EQ(4u, pool.thread_num());
+    ASSERT_FALSE(pool.InWorker());
+    std::vector<std::future<int>> results;
+    for (int i = 0; i < 1000; i++) {
+        results.push_back(pool.Submit([i]() { return i * i; }));
+    }
+    for (int i = 0; i < 1000; i++) {
+        ASSERT_EQ(i * i, results[i].get());
+    }
+    auto in_worker = pool.Submit([&pool]() { return pool.InWorker(); });
+    ASSERT_TRUE(in_worker.get());
+}
+
+TEST_F(ThreadPoolTest, SubmitFromWorkerTest) {
+    ThreadPool pool(2);
+    std::atomic<int> cnt(0);
+    auto outer = pool.Submit([&pool, &cnt]() {
+        std::vector<std::future<void>> inner;
+        for (int i = 0; i < 100; i++) {
+            inner.push_back(pool.Submit([&cnt]() { cnt++; }));
+        }
+        return inner;
+    });
+    for (auto& f : outer.get()) {
+        f.get();
+    }
+    ASSERT_EQ(100, cnt.load());
+}
+
+TEST_F(ThreadPoolTest, DrainOnDestructTest) {
+    std::atomic<int> cnt(0);
+    {
+        ThreadPool pool(3);
+        for (int i = 0; i < 500; i++) {
+            pool.Submit([&cnt]() { cnt++; });
+        }
+    }
+    ASSERT_EQ(500, cnt.load());
+}
+
+}  // namespace base
+}  // namespace hybridse
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
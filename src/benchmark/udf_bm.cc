@@ -95,6 +95,18 @@ static void BM_RequestUnionWindowExcludeCurrentTime(
     benchmark::State& state) {  // NOLINT
     RequestUnionWindowExcludeCurrentTime(&state, BENCHMARK, state.range(0));
 }
+static void BM_DistinctCountCol(benchmark::State& state) {  // NOLINT
+    DistinctCountCol(&state, BENCHMARK, state.range(0));
+}
+static void BM_TopNKeySumCateCol(benchmark::State& state) {  // NOLINT
+    TopNKeySumCateCol(&state, BENCHMARK, state.range(0));
+}
+static void BM_RowSelect(benchmark::State& state) {  // NOLINT
+    RowSelect(&state, BENCHMARK, state.range(0));
+}
+static void BM_RowSelectByRowView(benchmark::State& state) {  // NOLINT
+    RowSelectByRowView(&state, BENCHMARK, state.range(0));
+}
 
 BENCHMARK(BM_CopyArrayList)
     ->Args({10})
@@ -191,6 +203,21 @@ BENCHMARK(BM_RequestUnionWindowExcludeCurrentTime)
     ->Args({100})
     ->Args({1000})
     ->Args({10000});
+
+BENCHMARK(BM_DistinctCountCol)
+    ->Args({10})
+    ->Args({100})
+    ->Args({1000})
+    ->Args({10000});
+
+BENCHMARK(BM_TopNKeySumCateCol)
+    ->Args({10})
+    ->Args({100})
+    ->Args({1000})
+    ->Args({10000});
+
+BENCHMARK(BM_RowSelect)->Args({100})->Args({1000})->Args({10000});
+BENCHMARK(BM_RowSelectByRowView)->Args({100})->Args({1000})->Args({10000});
 }  // namespace bm
 }  // namespace hybridse
 
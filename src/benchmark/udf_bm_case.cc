@@ -15,11 +15,14 @@
  */
 
 #include "benchmark/udf_bm_case.h"
+#include <map>
 #include <memory>
+#include <set>
 #include <string>
 #include <vector>
 #include "case/case_data_mock.h"
 #include "codec/fe_row_codec.h"
+#include "codec/fe_row_selector.h"
 #include "codec/type_codec.h"
 #include "codegen/ir_base_builder.h"
 #include "codegen/window_ir_builder.h"
@@ -644,6 +647,7 @@ void RequestUnionWindow(benchmark::State* state, MODE mode, int64_t data_size) {
     uint64_t current_key = data_size + 1;
     switch (mode) {
         case BENCHMARK: {
+            // window is a view of segments, rows are merged while counted
             for (auto _ : *state) {
                 benchmark::DoNotOptimize(
                     vm::RequestUnionRunner::RequestUnionWindow(
@@ -652,7 +656,8 @@ void RequestUnionWindow(benchmark::State* state, MODE mode, int64_t data_size) {
                         current_key,
                         vm::WindowRange(vm::Window::kFrameRowsRange, -100, 0, 0,
                                         0),
-                        true, false));
+                        true, false)
+                        ->GetCount());
             }
             break;
         }
@@ -679,7 +684,8 @@ void RequestUnionWindowExcludeCurrentTime(benchmark::State* state, MODE mode,
                         current_key,
                         vm::WindowRange(vm::Window::kFrameRowsRange, -100, 0, 0,
                                         0),
-                        true, true));
+                        true, true)
+                        ->GetCount());
             }
             break;
         }
@@ -687,5 +693,233 @@ void RequestUnionWindowExcludeCurrentTime(benchmark::State* state, MODE mode,
         }
     }
 }
+
+// Window of `data_size` values over `data_size / 4` distinct keys, keys come
+// unordered
+static std::vector<int32_t> BuildCateKeys(int64_t data_size) {
+    std::vector<int32_t> keys;
+    int32_t key_cnt = static_cast<int32_t>(data_size / 4 + 1);
+    for (int64_t i = 0; i < data_size; ++i) {
+        keys.push_back(static_cast<int32_t>((i * 7919) % key_cnt));
+    }
+    return keys;
+}
+void DistinctCountCol(benchmark::State* state, MODE mode, int64_t data_size) {
+    std::vector<int32_t> values = BuildCateKeys(data_size);
+    codec::ArrayListV<int32_t> list(&values);
+    codec::ListRef<int32_t> list_ref;
+    list_ref.list = reinterpret_cast<int8_t*>(&list);
+    auto distinct_count = udf::UdfFunctionBuilder("distinct_count")
+                              .args<codec::ListRef<int32_t>>()
+                              .returns<int64_t>()
+                              .build();
+    switch (mode) {
+        case BENCHMARK: {
+            for (auto _ : *state) {
+                benchmark::DoNotOptimize(distinct_count(list_ref));
+                vm::JitRuntime::get()->ReleaseRunStep();
+            }
+            break;
+        }
+        case TEST: {
+            std::set<int32_t> expect(values.begin(), values.end());
+            ASSERT_EQ(static_cast<int64_t>(expect.size()),
+                      distinct_count(list_ref));
+            vm::JitRuntime::get()->ReleaseRunStep();
+            break;
+        }
+    }
+}
+void TopNKeySumCateCol(benchmark::State* state, MODE mode, int64_t data_size) {
+    std::vector<int32_t> keys = BuildCateKeys(data_size);
+    std::vector<int32_t> values(data_size, 1);
+    std::vector<int> conds(data_size, 1);
+    std::vector<int32_t> bounds(data_size, 10);
+    codec::ArrayListV<int32_t> value_list(&values);
+    codec::BoolArrayListV cond_list(&conds);
+    codec::ArrayListV<int32_t> key_list(&keys);
+    codec::ArrayListV<int32_t> bound_list(&bounds);
+    codec::ListRef<int32_t> value_ref;
+    codec::ListRef<bool> cond_ref;
+    codec::ListRef<int32_t> key_ref;
+    codec::ListRef<int32_t> bound_ref;
+    value_ref.list = reinterpret_cast<int8_t*>(&value_list);
+    cond_ref.list = reinterpret_cast<int8_t*>(&cond_list);
+    key_ref.list = reinterpret_cast<int8_t*>(&key_list);
+    bound_ref.list = reinterpret_cast<int8_t*>(&bound_list);
+    auto sum_cate =
+        udf::UdfFunctionBuilder("top_n_key_sum_cate_where")
+            .args<codec::ListRef<int32_t>, codec::ListRef<bool>,
+                  codec::ListRef<int32_t>, codec::ListRef<int32_t>>()
+            .returns<codec::StringRef>()
+            .build();
+    switch (mode) {
+        case BENCHMARK: {
+            for (auto _ : *state) {
+                benchmark::DoNotOptimize(
+                    sum_cate(value_ref, cond_ref, key_ref, bound_ref));
+                vm::JitRuntime::get()->ReleaseRunStep();
+            }
+            break;
+        }
+        case TEST: {
+            std::map<int32_t, int32_t> sums;
+            for (int64_t i = 0; i < data_size; ++i) {
+                sums[keys[i]] += values[i];
+            }
+            std::string expect;
+            size_t cnt = 0;
+            for (auto iter = sums.rbegin(); iter != sums.rend() && cnt < 10;
+                 ++iter, ++cnt) {
+                expect += (cnt > 0 ? "," : "") + std::to_string(iter->first) +
+                          ":" + std::to_string(iter->second);
+            }
+            ASSERT_EQ(codec::StringRef(expect),
+                      sum_cate(value_ref, cond_ref, key_ref, bound_ref));
+            vm::JitRuntime::get()->ReleaseRunStep();
+            break;
+        }
+    }
+}
+
+// Select by decoding and encoding every field, as RowSelector did before
+// its plan of copies. View and builder are reused among rows.
+static bool SelectByRowView(const codec::Schema& schema,
+                            const std::vector<size_t>& indices,
+                            codec::RowView* view, codec::RowBuilder* builder,
+                            const Row& row, int8_t** out_slice,
+                            size_t* out_size) {
+    codec::RowView& row_view = *view;
+    row_view.Reset(row.buf(), row.size());
+    uint32_t str_size = 0;
+    for (size_t idx : indices) {
+        if (schema.Get(idx).type() == type::kVarchar &&
+            !row_view.IsNULL(idx)) {
+            str_size += row_view.GetStringUnsafe(idx).size();
+        }
+    }
+    *out_size = builder->CalTotalLength(str_size);
+    *out_slice = reinterpret_cast<int8_t*>(malloc(*out_size));
+    builder->SetBuffer(*out_slice, *out_size);
+    for (size_t idx : indices) {
+        if (row_view.IsNULL(idx)) {
+            builder->AppendNULL();
+            continue;
+        }
+        switch (schema.Get(idx).type()) {
+            case type::kInt16:
+                builder->AppendInt16(row_view.GetInt16Unsafe(idx));
+                break;
+            case type::kInt32:
+                builder->AppendInt32(row_view.GetInt32Unsafe(idx));
+                break;
+            case type::kInt64:
+                builder->AppendInt64(row_view.GetInt64Unsafe(idx));
+                break;
+            case type::kFloat:
+                builder->AppendFloat(row_view.GetFloatUnsafe(idx));
+                break;
+            case type::kDouble:
+                builder->AppendDouble(row_view.GetDoubleUnsafe(idx));
+                break;
+            case type::kVarchar: {
+                std::string str = row_view.GetStringUnsafe(idx);
+                builder->AppendString(str.data(), str.size());
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+// Prune rows of `data_size` to string and numeric columns in another order
+static const std::vector<size_t>& SelectIndices() {
+    static const std::vector<size_t> indices = {6, 1, 3, 4, 5, 0};
+    return indices;
+}
+static codec::Schema SelectSchema(const codec::Schema& schema) {
+    codec::Schema target_schema;
+    for (size_t idx : SelectIndices()) {
+        *target_schema.Add() = schema.Get(idx);
+    }
+    return target_schema;
+}
+void RowSelect(benchmark::State* state, MODE mode, int64_t data_size) {
+    type::TableDef table_def;
+    std::vector<Row> rows;
+    CaseDataMock::BuildOnePkTableData(table_def, rows, data_size);
+    codec::RowSelector selector(&table_def.columns(), SelectIndices());
+    codec::RowView row_view(table_def.columns());
+    codec::RowBuilder builder(SelectSchema(table_def.columns()));
+    switch (mode) {
+        case BENCHMARK: {
+            for (auto _ : *state) {
+                for (auto& row : rows) {
+                    int8_t* buf = nullptr;
+                    size_t size = 0;
+                    benchmark::DoNotOptimize(
+                        selector.Select(row, &buf, &size));
+                    free(buf);
+                }
+            }
+            break;
+        }
+        case TEST: {
+            for (auto& row : rows) {
+                int8_t* buf = nullptr;
+                size_t size = 0;
+                ASSERT_TRUE(selector.Select(row, &buf, &size));
+                int8_t* expect_buf = nullptr;
+                size_t expect_size = 0;
+                ASSERT_TRUE(SelectByRowView(table_def.columns(),
+                                            SelectIndices(), &row_view,
+                                            &builder, row, &expect_buf,
+                                            &expect_size));
+                ASSERT_EQ(
+                    std::string(reinterpret_cast<char*>(expect_buf),
+                                expect_size),
+                    std::string(reinterpret_cast<char*>(buf), size));
+                free(buf);
+                free(expect_buf);
+            }
+            break;
+        }
+    }
+}
+void RowSelectByRowView(benchmark::State* state, MODE mode,
+                        int64_t data_size) {
+    type::TableDef table_def;
+    std::vector<Row> rows;
+    CaseDataMock::BuildOnePkTableData(table_def, rows, data_size);
+    codec::RowView row_view(table_def.columns());
+    codec::RowBuilder builder(SelectSchema(table_def.columns()));
+    switch (mode) {
+        case BENCHMARK: {
+            for (auto _ : *state) {
+                for (auto& row : rows) {
+                    int8_t* buf = nullptr;
+                    size_t size = 0;
+                    benchmark::DoNotOptimize(SelectByRowView(
+                        table_def.columns(), SelectIndices(), &row_view,
+                        &builder, row, &buf, &size));
+                    free(buf);
+                }
+            }
+            break;
+        }
+        case TEST: {
+            for (auto& row : rows) {
+                int8_t* buf = nullptr;
+                size_t size = 0;
+                ASSERT_TRUE(SelectByRowView(table_def.columns(),
+                                            SelectIndices(), &row_view,
+                                            &builder, row, &buf, &size));
+                free(buf);
+            }
+            break;
+        }
+    }
+}
 }  // namespace bm
 }  // namespace hybridse
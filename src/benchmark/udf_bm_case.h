@@ -53,6 +53,13 @@ void HistoryWindowBufferExcludeCurrentTime(benchmark::State* state, MODE mode,
 void RequestUnionWindow(benchmark::State* state, MODE mode, int64_t data_size);
 void RequestUnionWindowExcludeCurrentTime(benchmark::State* state, MODE mode,
                                           int64_t data_size);
+// Opaque Udaf
+void DistinctCountCol(benchmark::State* state, MODE mode, int64_t data_size);
+void TopNKeySumCateCol(benchmark::State* state, MODE mode, int64_t data_size);
+// Row Selector
+void RowSelect(benchmark::State* state, MODE mode, int64_t data_size);
+void RowSelectByRowView(benchmark::State* state, MODE mode,
+                        int64_t data_size);
 }  // namespace bm
 }  // namespace hybridse
 #endif  // SRC_BENCHMARK_UDF_BM_CASE_H_
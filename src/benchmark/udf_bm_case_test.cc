@@ -80,6 +80,20 @@ TEST_F(UdfBMCaseTest, TimestampFormat_TEST) { TimestampFormat(nullptr, TEST); }
 TEST_F(UdfBMCaseTest, DateToString_TEST) { DateToString(nullptr, TEST); }
 TEST_F(UdfBMCaseTest, DateFormat_TEST) { DateFormat(nullptr, TEST); }
 
+TEST_F(UdfBMCaseTest, DistinctCountCol_TEST) {
+    DistinctCountCol(nullptr, TEST, 10L);
+    DistinctCountCol(nullptr, TEST, 1000L);
+}
+TEST_F(UdfBMCaseTest, TopNKeySumCateCol_TEST) {
+    TopNKeySumCateCol(nullptr, TEST, 10L);
+    TopNKeySumCateCol(nullptr, TEST, 1000L);
+}
+TEST_F(UdfBMCaseTest, RowSelect_TEST) {
+    RowSelect(nullptr, TEST, 10L);
+    RowSelect(nullptr, TEST, 1000L);
+    RowSelectByRowView(nullptr, TEST, 10L);
+}
+
 }  // namespace bm
 }  // namespace hybridse
 int main(int argc, char** argv) {
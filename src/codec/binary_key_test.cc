@@ -0,0 +1,123 @@
+/*
+ * Copyright 2021 4Paradigm
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "codec/binary_key.h"
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include "gtest/gtest.h"
+
+namespace hybridse {
+namespace codec {
+
+class BinaryKeyTest : public ::testing::Test {};
+
+TEST_F(BinaryKeyTest, EqualAndHashTest) {
+    BinaryKey k1;
+    k1.AppendInt32(1);
+    k1.AppendString("abc");
+    k1.Seal();
+    BinaryKey k2;
+    k2.AppendInt32(1);
+    k2.AppendString("abc");
+    k2.Seal();
+    ASSERT_EQ(k1, k2);
+    ASSERT_EQ(k1.hash(), k2.hash());
+
+    // null, empty string and "NA" are different keys
+    BinaryKey null_key;
+    null_key.AppendNull();
+    null_key.Seal();
+    BinaryKey empty_key;
+    empty_key.AppendString("");
+    empty_key.Seal();
+    BinaryKey na_key;
+    na_key.AppendString("NA");
+    na_key.Seal();
+    ASSERT_NE(null_key, empty_key);
+    ASSERT_NE(empty_key, na_key);
+    ASSERT_NE(null_key, na_key);
+
+    // "a|b" and ("a", "b") are different keys
+    BinaryKey k3;
+    k3.AppendString("a|b");
+    k3.Seal();
+    BinaryKey k4;
+    k4.AppendString("a");
+    k4.AppendString("b");
+    k4.Seal();
+    ASSERT_NE(k3, k4);
+}
+
+TEST_F(BinaryKeyTest, OrderTest) {
+    BinaryKey k1;
+    k1.AppendInt64(-5);
+    BinaryKey k2;
+    k2.AppendInt64(3);
+    BinaryKey k3;
+    k3.AppendInt64(1024);
+    ASSERT_LT(k1.ToString(), k2.ToString());
+    ASSERT_LT(k2.ToString(), k3.ToString());
+
+    BinaryKey d1;
+    d1.AppendDouble(-1.5);
+    BinaryKey d2;
+    d2.AppendDouble(0.0);
+    BinaryKey d3;
+    d3.AppendDouble(2.5);
+    ASSERT_LT(d1.ToString(), d2.ToString());
+    ASSERT_LT(d2.ToString(), d3.ToString());
+}
+
+TEST_F(BinaryKeyTest, TruncateAndGrowTest) {
+    BinaryKey key;
+    key.AppendString("segment");
+    size_t prefix = key.size();
+    key.AppendInt32(1);
+    key.Seal();
+    std::string first = key.ToString();
+
+    key.Truncate(prefix);
+    key.AppendInt32(2);
+    key.Seal();
+    ASSERT_EQ(first.size(), key.size());
+    ASSERT_NE(first, key.ToString());
+
+    // grow beyond inline buffer
+    std::string long_str(BinaryKey::kInlineSize * 4, 'x');
+    BinaryKey long_key;
+    long_key.AppendString(long_str);
+    long_key.AppendInt16(7);
+    long_key.Seal();
+    BinaryKey copied(long_key);
+    ASSERT_EQ(long_key, copied);
+    BinaryKey moved(std::move(copied));
+    ASSERT_EQ(long_key, moved);
+    ASSERT_TRUE(copied.empty());
+
+    std::unordered_set<BinaryKey, BinaryKeyHash> keys;
+    keys.insert(long_key);
+    keys.insert(moved);
+    keys.insert(key);
+    ASSERT_EQ(2u, keys.size());
+}
+
+}  // namespace codec
+}  // namespace hybridse
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
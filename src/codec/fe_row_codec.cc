@@ -15,8 +15,10 @@
  */
 
 #include "codec/fe_row_codec.h"
+#include <memory>
 #include <string>
 #include <utility>
+#include "codec/row_layout.h"
 #include "codec/type_codec.h"
 #include "glog/logging.h"
 
@@ -277,80 +279,60 @@ bool RowBuilder::AppendString(const char* val, uint32_t length) {
     return true;
 }
 
+// Layout of views without schema
+static const std::shared_ptr<const RowLayout>& EmptyLayout() {
+    static const std::shared_ptr<const RowLayout> layout =
+        std::make_shared<const RowLayout>(Schema());
+    return layout;
+}
+
 RowView::RowView()
     : str_addr_length_(0),
       is_valid_(false),
-      string_field_cnt_(0),
-      str_field_start_offset_(0),
       size_(0),
       row_(NULL),
-      schema_(),
-      offset_vec_() {
-}
+      layout_(EmptyLayout()) {}
 RowView::RowView(const Schema& schema)
     : str_addr_length_(0),
       is_valid_(true),
-      string_field_cnt_(0),
-      str_field_start_offset_(0),
       size_(0),
       row_(NULL),
-      schema_(schema),
-      offset_vec_() {
-    Init();
+      layout_(RowLayout::Get(schema)) {
+    is_valid_ = layout_->IsValid();
 }
+RowView::RowView(const std::shared_ptr<const RowLayout>& layout)
+    : str_addr_length_(0),
+      is_valid_(layout->IsValid()),
+      size_(0),
+      row_(NULL),
+      layout_(layout) {}
 RowView::RowView(const Schema& schema, const int8_t* row, uint32_t size)
     : str_addr_length_(0),
       is_valid_(true),
-      string_field_cnt_(0),
-      str_field_start_offset_(0),
       size_(size),
       row_(row),
-      schema_(schema),
-      offset_vec_() {
-    if (schema_.size() == 0) {
+      layout_(RowLayout::Get(schema)) {
+    if (schema.size() == 0) {
         is_valid_ = false;
         return;
     }
-    if (Init()) {
+    if (layout_->IsValid()) {
         Reset(row, size);
+    } else {
+        is_valid_ = false;
     }
 }
 RowView::RowView(const RowView& copy)
     : str_addr_length_(copy.str_addr_length_),
       is_valid_(copy.is_valid_),
-      string_field_cnt_(copy.string_field_cnt_),
-      str_field_start_offset_(copy.str_field_start_offset_),
       size_(copy.size_),
       row_(copy.row_),
-      schema_(copy.schema_),
-      offset_vec_(copy.offset_vec_) {}
-bool RowView::Init() {
-    uint32_t offset = HEADER_LENGTH + BitMapSize(schema_.size());
-    for (int idx = 0; idx < schema_.size(); idx++) {
-        const ::hybridse::type::ColumnDef& column = schema_.Get(idx);
-        if (column.type() == ::hybridse::type::kVarchar) {
-            offset_vec_.push_back(string_field_cnt_);
-            string_field_cnt_++;
-        } else {
-            auto TYPE_SIZE_MAP = GetTypeSizeMap();
-            auto iter = TYPE_SIZE_MAP.find(column.type());
-            if (iter == TYPE_SIZE_MAP.end()) {
-                LOG(WARNING) << ::hybridse::type::Type_Name(column.type())
-                             << " is not supported";
-                is_valid_ = false;
-                return false;
-            } else {
-                offset_vec_.push_back(offset);
-                offset += iter->second;
-            }
-        }
-    }
-    str_field_start_offset_ = offset;
-    return true;
-}
+      layout_(copy.layout_) {}
+
+const Schema* RowView::GetSchema() const { return layout_->GetSchema(); }
 
 bool RowView::Reset(const int8_t* row, uint32_t size) {
-    if (schema_.size() == 0 || row == NULL || size <= HEADER_LENGTH ||
+    if (layout_->GetColumnCnt() == 0 || row == NULL || size <= HEADER_LENGTH ||
         *(reinterpret_cast<const uint32_t*>(row + VERSION_LENGTH)) != size) {
         is_valid_ = false;
         return false;
@@ -363,7 +345,7 @@ bool RowView::Reset(const int8_t* row, uint32_t size) {
 }
 
 bool RowView::Reset(const int8_t* row) {
-    if (schema_.size() == 0 || row == NULL) {
+    if (layout_->GetColumnCnt() == 0 || row == NULL) {
         is_valid_ = false;
         return false;
     }
@@ -387,69 +369,66 @@ bool RowView::CheckValid(uint32_t idx, ::hybridse::type::Type type) {
         LOG(WARNING) << "row is invalid";
         return false;
     }
-    if ((int32_t)idx >= schema_.size()) {
+    if (idx >= layout_->GetColumnCnt()) {
         LOG(WARNING) << "idx out of index";
         return false;
     }
-    const ::hybridse::type::ColumnDef& column = schema_.Get(idx);
-    if (column.type() != type) {
+    ::hybridse::type::Type column_type = layout_->GetType(idx);
+    if (column_type != type) {
         LOG(WARNING) << "type mismatch required is "
                      << ::hybridse::type::Type_Name(type) << " but is "
-                     << hybridse::type::Type_Name(column.type());
+                     << hybridse::type::Type_Name(column_type);
         return false;
     }
     return true;
 }
 
 bool RowView::GetBoolUnsafe(uint32_t idx) {
-    uint32_t offset = offset_vec_.at(idx);
+    uint32_t offset = layout_->GetOffset(idx);
     int8_t v = v1::GetBoolFieldUnsafe(row_, offset);
     return v == 1 ? true : false;
 }
 
 int32_t RowView::GetInt32Unsafe(uint32_t idx) {
-    uint32_t offset = offset_vec_.at(idx);
+    uint32_t offset = layout_->GetOffset(idx);
     return v1::GetInt32FieldUnsafe(row_, offset);
 }
 
 int64_t RowView::GetInt64Unsafe(uint32_t idx) {
-    uint32_t offset = offset_vec_.at(idx);
+    uint32_t offset = layout_->GetOffset(idx);
     return v1::GetInt64FieldUnsafe(row_, offset);
 }
 int32_t RowView::GetDateUnsafe(uint32_t idx) {
-    uint32_t offset = offset_vec_.at(idx);
+    uint32_t offset = layout_->GetOffset(idx);
     return static_cast<int32_t>(v1::GetInt32FieldUnsafe(row_, offset));
 }
 int64_t RowView::GetTimestampUnsafe(uint32_t idx) {
-    uint32_t offset = offset_vec_.at(idx);
+    uint32_t offset = layout_->GetOffset(idx);
     return v1::GetInt64FieldUnsafe(row_, offset);
 }
 
 int16_t RowView::GetInt16Unsafe(uint32_t idx) {
-    uint32_t offset = offset_vec_.at(idx);
+    uint32_t offset = layout_->GetOffset(idx);
     return v1::GetInt16FieldUnsafe(row_, offset);
 }
 
 float RowView::GetFloatUnsafe(uint32_t idx) {
-    uint32_t offset = offset_vec_.at(idx);
+    uint32_t offset = layout_->GetOffset(idx);
     return v1::GetFloatFieldUnsafe(row_, offset);
 }
 
 double RowView::GetDoubleUnsafe(uint32_t idx) {
-    uint32_t offset = offset_vec_.at(idx);
+    uint32_t offset = layout_->GetOffset(idx);
     return v1::GetDoubleFieldUnsafe(row_, offset);
 }
 
 std::string RowView::GetStringUnsafe(uint32_t idx) {
-    uint32_t field_offset = offset_vec_.at(idx);
-    uint32_t next_str_field_offset = 0;
-    if (offset_vec_.at(idx) < string_field_cnt_ - 1) {
-        next_str_field_offset = field_offset + 1;
-    }
+    uint32_t field_offset = layout_->GetOffset(idx);
+    uint32_t next_str_field_offset = layout_->GetNextStringOffset(idx);
     const char* val;
     uint32_t length;
     v1::GetStrFieldUnsafe(row_, field_offset, next_str_field_offset,
-                          str_field_start_offset_, str_addr_length_, &val,
+                          layout_->GetStringFieldStartOffset(), str_addr_length_, &val,
                           &length);
     return std::string(val, length);
 }
@@ -626,22 +605,22 @@ int32_t RowView::GetInteger(const int8_t* row, uint32_t idx,
 }
 
 int32_t RowView::GetPrimaryFieldOffset(uint32_t idx) {
-    return offset_vec_.at(idx);
+    return layout_->GetOffset(idx);
 }
 int32_t RowView::GetValue(const int8_t* row, uint32_t idx,
                           ::hybridse::type::Type type, void* val) const {
-    if (schema_.size() == 0 || row == NULL) {
+    if (layout_->GetColumnCnt() == 0 || row == NULL) {
         return -1;
     }
-    if ((int32_t)idx >= schema_.size()) {
+    if (idx >= layout_->GetColumnCnt()) {
         LOG(WARNING) << "idx out of index";
         return -1;
     }
-    const ::hybridse::type::ColumnDef& column = schema_.Get(idx);
-    if (column.type() != type) {
+    ::hybridse::type::Type column_type = layout_->GetType(idx);
+    if (column_type != type) {
         LOG(WARNING) << "type mismatch required is "
                      << ::hybridse::type::Type_Name(type) << " but is "
-                     << hybridse::type::Type_Name(column.type());
+                     << hybridse::type::Type_Name(column_type);
         return -1;
     }
     if (GetSize(row) <= HEADER_LENGTH) {
@@ -650,60 +629,24 @@ int32_t RowView::GetValue(const int8_t* row, uint32_t idx,
     if (IsNULL(row, idx)) {
         return 1;
     }
-    uint32_t offset = offset_vec_.at(idx);
-    switch (type) {
-        case ::hybridse::type::kBool: {
-            int8_t v = v1::GetBoolFieldUnsafe(row, offset);
-            if (v == 1) {
-                *(reinterpret_cast<bool*>(val)) = true;
-            } else {
-                *(reinterpret_cast<bool*>(val)) = false;
-            }
-            break;
-        }
-        case ::hybridse::type::kInt16:
-            *(reinterpret_cast<int16_t*>(val)) =
-                v1::GetInt16FieldUnsafe(row, offset);
-            break;
-        case ::hybridse::type::kDate:
-        case ::hybridse::type::kInt32:
-            *(reinterpret_cast<int32_t*>(val)) =
-                v1::GetInt32FieldUnsafe(row, offset);
-            break;
-        case ::hybridse::type::kTimestamp:
-        case ::hybridse::type::kInt64:
-            *(reinterpret_cast<int64_t*>(val)) =
-                v1::GetInt64FieldUnsafe(row, offset);
-            break;
-        case ::hybridse::type::kFloat:
-            *(reinterpret_cast<float*>(val)) =
-                v1::GetFloatFieldUnsafe(row, offset);
-            break;
-        case ::hybridse::type::kDouble:
-            *(reinterpret_cast<double*>(val)) =
-                v1::GetDoubleFieldUnsafe(row, offset);
-            break;
-        default:
-            return -1;
-    }
-    return 0;
+    return layout_->ReadField(row, idx, val) ? 0 : -1;
 }
 std::string RowView::GetRowString() {
-    if (schema_.size() == 0) {
+    if (layout_->GetColumnCnt() == 0) {
         return "NA";
     }
     std::string row_str = "";
 
-    for (int i = 0; i < schema_.size(); i++) {
+    for (uint32_t i = 0; i < layout_->GetColumnCnt(); i++) {
         row_str.append(GetAsString(i));
-        if (i != schema_.size() - 1) {
+        if (i != layout_->GetColumnCnt() - 1) {
             row_str.append(", ");
         }
     }
     return row_str;
 }
 std::string RowView::GetAsString(uint32_t idx) {
-    if (schema_.size() == 0) {
+    if (layout_->GetColumnCnt() == 0) {
         return "NA";
     }
 
@@ -711,7 +654,7 @@ std::string RowView::GetAsString(uint32_t idx) {
         return "NA";
     }
 
-    if ((int32_t)idx >= schema_.size()) {
+    if (idx >= layout_->GetColumnCnt()) {
         LOG(WARNING) << "idx out of index";
         return "NA";
     }
@@ -719,8 +662,7 @@ std::string RowView::GetAsString(uint32_t idx) {
     if (IsNULL(idx)) {
         return "NULL";
     }
-    const ::hybridse::type::ColumnDef& column = schema_.Get(idx);
-    switch (column.type()) {
+    switch (layout_->GetType(idx)) {
         case hybridse::type::kInt32: {
             int32_t value;
             if (0 == GetInt32(idx, &value)) {
@@ -819,18 +761,18 @@ std::string RowView::GetAsString(uint32_t idx) {
 
 int32_t RowView::GetValue(const int8_t* row, uint32_t idx, const char** val,
                           uint32_t* length) const {
-    if (schema_.size() == 0 || row == NULL || length == NULL) {
+    if (layout_->GetColumnCnt() == 0 || row == NULL || length == NULL) {
         return -1;
     }
-    if ((int32_t)idx >= schema_.size()) {
+    if (idx >= layout_->GetColumnCnt()) {
         LOG(WARNING) << "idx out of index";
         return -1;
     }
-    const ::hybridse::type::ColumnDef& column = schema_.Get(idx);
-    if (column.type() != ::hybridse::type::kVarchar) {
+    ::hybridse::type::Type column_type = layout_->GetType(idx);
+    if (column_type != ::hybridse::type::kVarchar) {
         LOG(WARNING) << "type mismatch required is "
                      << ::hybridse::type::Type_Name(::hybridse::type::kVarchar)
-                     << " but is " << hybridse::type::Type_Name(column.type());
+                     << " but is " << hybridse::type::Type_Name(column_type);
         return -1;
     }
     uint32_t size = GetSize(row);
@@ -840,13 +782,10 @@ int32_t RowView::GetValue(const int8_t* row, uint32_t idx, const char** val,
     if (IsNULL(row, idx)) {
         return 1;
     }
-    uint32_t field_offset = offset_vec_.at(idx);
-    uint32_t next_str_field_offset = 0;
-    if (offset_vec_.at(idx) < string_field_cnt_ - 1) {
-        next_str_field_offset = field_offset + 1;
-    }
+    uint32_t field_offset = layout_->GetOffset(idx);
+    uint32_t next_str_field_offset = layout_->GetNextStringOffset(idx);
     return v1::GetStrFieldUnsafe(row, field_offset, next_str_field_offset,
-                                 str_field_start_offset_, GetAddrLength(size),
+                                 layout_->GetStringFieldStartOffset(), GetAddrLength(size),
                                  val, length);
 }
 
@@ -866,13 +805,10 @@ int32_t RowView::GetString(uint32_t idx, const char** val, uint32_t* length) {
     if (IsNULL(row_, idx)) {
         return 1;
     }
-    uint32_t field_offset = offset_vec_.at(idx);
-    uint32_t next_str_field_offset = 0;
-    if (offset_vec_.at(idx) < string_field_cnt_ - 1) {
-        next_str_field_offset = field_offset + 1;
-    }
+    uint32_t field_offset = layout_->GetOffset(idx);
+    uint32_t next_str_field_offset = layout_->GetNextStringOffset(idx);
     return v1::GetStrFieldUnsafe(row_, field_offset, next_str_field_offset,
-                                 str_field_start_offset_, str_addr_length_, val,
+                                 layout_->GetStringFieldStartOffset(), str_addr_length_, val,
                                  length);
 }
 
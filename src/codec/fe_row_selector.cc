@@ -15,6 +15,8 @@
  */
 
 #include "codec/fe_row_selector.h"
+#include <string.h>
+#include <algorithm>
 #include <string>
 #include <utility>
 #include "codec/type_codec.h"
@@ -49,8 +51,11 @@ RowSelector::RowSelector(const hybridse::codec::Schema* schema,
     : schemas_({schema}),
       indices_(RowSelectorMakeIndices(indices)),
       target_schema_(CreateTargetSchema()),
-      target_row_builder_(target_schema_) {
-    row_views_.push_back(RowView(*schema));
+      target_row_builder_(target_schema_),
+      is_valid_(false),
+      str_field_start_offset_(0),
+      used_slice_cnt_(0) {
+    is_valid_ = BuildPlan();
 }
 
 RowSelector::RowSelector(
@@ -59,200 +64,194 @@ RowSelector::RowSelector(
     : schemas_(schemas),
       indices_(indices),
       target_schema_(CreateTargetSchema()),
-      target_row_builder_(target_schema_) {
-    for (auto schema : schemas) {
-        row_views_.push_back(RowView(*schema));
-    }
+      target_row_builder_(target_schema_),
+      is_valid_(false),
+      str_field_start_offset_(0),
+      used_slice_cnt_(0) {
+    is_valid_ = BuildPlan();
 }
 
-bool RowSelector::Select(const Row& row, int8_t** out_slice, size_t* out_size) {
-    if (static_cast<size_t>(row.GetRowPtrCnt()) != row_views_.size()) {
-        LOG(WARNING) << "Illegal row slices, expect " << row_views_.size()
-                     << ", get " << row.GetRowPtrCnt();
-        return false;
+bool RowSelector::BuildPlan() {
+    for (auto schema : schemas_) {
+        layouts_.push_back(RowLayout::Get(*schema));
+        if (!layouts_.back()->IsValid()) {
+            LOG(WARNING) << "Fail to select from schema of unsupported type";
+            return false;
+        }
     }
-    for (size_t i = 0; i < row_views_.size(); ++i) {
-        row_views_[i].Reset(row.buf(i), row.size(i));
+    auto target_layout = RowLayout::Get(target_schema_);
+    if (!target_layout->IsValid()) {
+        return false;
     }
-    size_t str_size = 0;
+    str_field_start_offset_ = target_layout->GetStringFieldStartOffset();
+    const auto& type_size_map = GetTypeSizeMap();
+    uint32_t dst_idx = 0;
     for (auto& pair : indices_) {
-        size_t schema_idx = pair.first;
-        size_t col_idx = pair.second;
-        if (schema_idx >= row_views_.size()) {
-            LOG(WARNING) << "Schema idx out of bound: " << schema_idx;
-            return false;
+        uint32_t slice = pair.first;
+        uint32_t src_idx = pair.second;
+        // columns out of bound are not in target schema
+        if (slice >= layouts_.size() ||
+            src_idx >= layouts_[slice]->GetColumnCnt()) {
+            continue;
         }
-        auto schema = schemas_[schema_idx];
-        auto& row_view = row_views_[schema_idx];
-        if (col_idx < static_cast<size_t>(schema->size())) {
-            if (schema->Get(col_idx).type() == type::kVarchar &&
-                !row_view.IsNULL(col_idx)) {
-                str_size += row_view.GetStringUnsafe(col_idx).size();
+        const RowLayout& layout = *layouts_[slice];
+        used_slice_cnt_ = std::max(used_slice_cnt_, slice + 1);
+        null_bits_.push_back({slice, src_idx, dst_idx});
+        if (layout.GetType(src_idx) == type::kVarchar) {
+            str_fields_.push_back({slice, src_idx, layout.GetOffset(src_idx),
+                                   layout.GetNextStringOffset(src_idx)});
+        } else {
+            uint32_t src_offset = layout.GetOffset(src_idx);
+            uint32_t dst_offset = target_layout->GetOffset(dst_idx);
+            uint32_t size = type_size_map.at(layout.GetType(src_idx));
+            FieldCopy* last =
+                field_copies_.empty() ? nullptr : &field_copies_.back();
+            // fields adjacent in both rows are copied at once
+            if (last != nullptr && last->slice == slice &&
+                last->src_offset + last->size == src_offset &&
+                last->dst_offset + last->size == dst_offset) {
+                last->size += size;
+            } else {
+                field_copies_.push_back({slice, src_offset, dst_offset, size});
             }
         }
+        dst_idx++;
     }
-    size_t target_size = target_row_builder_.CalTotalLength(str_size);
-    *out_slice = reinterpret_cast<int8_t*>(malloc(target_size));
-    *out_size = target_size;
+    str_refs_.resize(str_fields_.size());
+    return true;
+}
 
-    target_row_builder_.SetBuffer(*out_slice, *out_size);
-    for (auto& pair : indices_) {
-        size_t schema_idx = pair.first;
-        size_t col_idx = pair.second;
-        auto schema = schemas_[schema_idx];
-        auto& row_view = row_views_[schema_idx];
-        if (col_idx >= static_cast<size_t>(schema->size())) {
-            continue;
+uint32_t RowSelector::ResolveStrings() {
+    if (!is_valid_) {
+        LOG(WARNING) << "Invalid row selector";
+        return 0;
+    }
+    if (slices_.size() < used_slice_cnt_) {
+        LOG(WARNING) << "Illegal row slices, expect " << used_slice_cnt_
+                     << ", get " << slices_.size();
+        return 0;
+    }
+    for (size_t i = 0; i < used_slice_cnt_; ++i) {
+        if (nullptr == slices_[i] || slice_sizes_[i] <= HEADER_LENGTH) {
+            LOG(WARNING) << "Fail to select from empty row slice " << i;
+            return 0;
         }
-        if (row_view.IsNULL(col_idx)) {
-            target_row_builder_.AppendNULL();
+    }
+    uint32_t str_size = 0;
+    for (size_t i = 0; i < str_fields_.size(); ++i) {
+        const StringField& field = str_fields_[i];
+        const int8_t* slice = slices_[field.slice];
+        auto& ref = str_refs_[i];
+        if (RowLayout::IsNULL(slice, field.src_idx)) {
+            ref.first = nullptr;
+            ref.second = 0;
             continue;
         }
-        switch (schema->Get(col_idx).type()) {
-            case type::kInt16: {
-                target_row_builder_.AppendInt16(
-                    row_view.GetInt16Unsafe(col_idx));
-                break;
-            }
-            case type::kInt32: {
-                target_row_builder_.AppendInt32(
-                    row_view.GetInt32Unsafe(col_idx));
-                break;
-            }
-            case type::kInt64: {
-                target_row_builder_.AppendInt64(
-                    row_view.GetInt64Unsafe(col_idx));
-                break;
-            }
-            case type::kBool: {
-                target_row_builder_.AppendBool(row_view.GetBoolUnsafe(col_idx));
-                break;
-            }
-            case type::kFloat: {
-                target_row_builder_.AppendFloat(
-                    row_view.GetFloatUnsafe(col_idx));
-                break;
-            }
-            case type::kDouble: {
-                target_row_builder_.AppendDouble(
-                    row_view.GetDoubleUnsafe(col_idx));
-                break;
-            }
-            case type::kDate: {
-                int32_t year;
-                int32_t month;
-                int32_t day;
-                row_view.GetDate(col_idx, &year, &month, &day);
-                target_row_builder_.AppendDate(year, month, day);
-                break;
-            }
-            case type::kTimestamp: {
-                target_row_builder_.AppendTimestamp(
-                    row_view.GetTimestampUnsafe(col_idx));
-                break;
-            }
-            case type::kVarchar: {
-                std::string str = row_view.GetStringUnsafe(col_idx);
-                target_row_builder_.AppendString(str.data(), str.size());
-                break;
-            }
-            default:
-                continue;
+        if (0 != v1::GetStrFieldUnsafe(
+                     slice, field.src_order, field.next_src_order,
+                     layouts_[field.slice]->GetStringFieldStartOffset(),
+                     GetAddrLength(slice_sizes_[field.slice]), &ref.first,
+                     &ref.second)) {
+            LOG(WARNING) << "Fail to get string field " << field.src_idx
+                         << " of row slice " << field.slice;
+            return 0;
+        }
+        str_size += ref.second;
+    }
+    return target_row_builder_.CalTotalLength(str_size);
+}
+
+void RowSelector::Encode(int8_t* buf, uint32_t size) {
+    // header and cleared null bitmap
+    target_row_builder_.SetBuffer(buf, size);
+    uint8_t* bitmap = reinterpret_cast<uint8_t*>(buf + HEADER_LENGTH);
+    for (auto& bit : null_bits_) {
+        if (RowLayout::IsNULL(slices_[bit.slice], bit.src_idx)) {
+            bitmap[bit.dst_idx >> 3] |= 1 << (bit.dst_idx & 0x07);
+        }
+    }
+    for (auto& copy : field_copies_) {
+        memcpy(buf + copy.dst_offset, slices_[copy.slice] + copy.src_offset,
+               copy.size);
+    }
+    // null strings take no space at current offset, as RowBuilder does
+    uint32_t addr_length = GetAddrLength(size);
+    uint32_t str_offset =
+        str_field_start_offset_ + addr_length * str_fields_.size();
+    for (size_t i = 0; i < str_refs_.size(); ++i) {
+        auto& ref = str_refs_[i];
+        FillNullStringOffset(buf, str_field_start_offset_, addr_length, i,
+                             str_offset);
+        if (ref.second > 0) {
+            memcpy(buf + str_offset, ref.first, ref.second);
+            str_offset += ref.second;
         }
     }
+}
+
+bool RowSelector::SelectInto(const Row& row, int8_t* buf, size_t capacity,
+                             size_t* out_size) {
+    *out_size = 0;
+    if (static_cast<size_t>(row.GetRowPtrCnt()) != schemas_.size()) {
+        LOG(WARNING) << "Illegal row slices, expect " << schemas_.size()
+                     << ", get " << row.GetRowPtrCnt();
+        return false;
+    }
+    slices_.clear();
+    slice_sizes_.clear();
+    for (int32_t i = 0; i < row.GetRowPtrCnt(); ++i) {
+        slices_.push_back(row.buf(i));
+        slice_sizes_.push_back(row.size(i));
+    }
+    uint32_t target_size = ResolveStrings();
+    if (0 == target_size) {
+        return false;
+    }
+    *out_size = target_size;
+    if (nullptr == buf || capacity < target_size) {
+        return false;
+    }
+    Encode(buf, target_size);
+    return true;
+}
+
+bool RowSelector::Select(const Row& row, base::ByteMemoryPool* pool,
+                         int8_t** out_slice, size_t* out_size) {
+    if (nullptr == pool) {
+        LOG(WARNING) << "Fail to select into null memory pool";
+        return false;
+    }
+    // select into empty buffer only resolves the target size
+    SelectInto(row, nullptr, 0, out_size);
+    if (0 == *out_size) {
+        return false;
+    }
+    *out_slice = reinterpret_cast<int8_t*>(pool->Alloc(*out_size));
+    Encode(*out_slice, *out_size);
+    return true;
+}
+
+bool RowSelector::Select(const Row& row, int8_t** out_slice, size_t* out_size) {
+    SelectInto(row, nullptr, 0, out_size);
+    if (0 == *out_size) {
+        return false;
+    }
+    *out_slice = reinterpret_cast<int8_t*>(malloc(*out_size));
+    Encode(*out_slice, *out_size);
     return true;
 }
 
 bool RowSelector::Select(const int8_t* slice, size_t size, int8_t** out_slice,
                          size_t* out_size) {
-    if (row_views_.size() < 1) {
-        LOG(WARNING) << "Empty row views";
+    slices_.assign(1, slice);
+    slice_sizes_.assign(1, size);
+    uint32_t target_size = ResolveStrings();
+    if (0 == target_size) {
         return false;
     }
-    auto& row_view = row_views_[0];
-    auto& schema = schemas_[0];
-    row_view.Reset(slice, size);
-    size_t str_size = 0;
-    for (auto& pair : indices_) {
-        size_t schema_idx = pair.first;
-        size_t col_idx = pair.second;
-        if (schema_idx > 0) {
-            LOG(WARNING) << "Schema idx out of bound";
-            return false;
-        }
-        if (col_idx < static_cast<size_t>(schema->size())) {
-            if (schema->Get(col_idx).type() == type::kVarchar &&
-                !row_view.IsNULL(col_idx)) {
-                str_size += row_view.GetStringUnsafe(col_idx).size();
-            }
-        }
-    }
-    size_t target_size = target_row_builder_.CalTotalLength(str_size);
     *out_slice = reinterpret_cast<int8_t*>(malloc(target_size));
     *out_size = target_size;
-
-    target_row_builder_.SetBuffer(*out_slice, *out_size);
-    for (auto& pair : indices_) {
-        size_t col_idx = pair.second;
-        if (col_idx >= static_cast<size_t>(schema->size())) {
-            continue;
-        }
-        if (row_view.IsNULL(col_idx)) {
-            target_row_builder_.AppendNULL();
-            continue;
-        }
-        switch (schema->Get(col_idx).type()) {
-            case type::kInt16: {
-                target_row_builder_.AppendInt16(
-                    row_view.GetInt16Unsafe(col_idx));
-                break;
-            }
-            case type::kInt32: {
-                target_row_builder_.AppendInt32(
-                    row_view.GetInt32Unsafe(col_idx));
-                break;
-            }
-            case type::kInt64: {
-                target_row_builder_.AppendInt64(
-                    row_view.GetInt64Unsafe(col_idx));
-                break;
-            }
-            case type::kBool: {
-                target_row_builder_.AppendBool(row_view.GetBoolUnsafe(col_idx));
-                break;
-            }
-            case type::kFloat: {
-                target_row_builder_.AppendFloat(
-                    row_view.GetFloatUnsafe(col_idx));
-                break;
-            }
-            case type::kDouble: {
-                target_row_builder_.AppendDouble(
-                    row_view.GetDoubleUnsafe(col_idx));
-                break;
-            }
-            case type::kDate: {
-                int32_t year;
-                int32_t month;
-                int32_t day;
-                row_view.GetDate(col_idx, &year, &month, &day);
-                target_row_builder_.AppendDate(year, month, day);
-                break;
-            }
-            case type::kTimestamp: {
-                target_row_builder_.AppendTimestamp(
-                    row_view.GetTimestampUnsafe(col_idx));
-                break;
-            }
-            case type::kVarchar: {
-                std::string str = row_view.GetStringUnsafe(col_idx);
-                target_row_builder_.AppendString(str.data(), str.size());
-                break;
-            }
-            default:
-                continue;
-        }
-    }
+    Encode(*out_slice, target_size);
     return true;
 }
 
@@ -0,0 +1,231 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "codec/fe_row_selector.h"
+#include <stdlib.h>
+#include <string>
+#include <utility>
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace hybridse {
+namespace codec {
+
+class RowSelectorTest : public ::testing::Test {
+ public:
+    void SetUp() override {
+        const ::hybridse::type::Type types[] = {
+            ::hybridse::type::kVarchar, ::hybridse::type::kInt16,
+            ::hybridse::type::kInt32,   ::hybridse::type::kInt64,
+            ::hybridse::type::kVarchar, ::hybridse::type::kTimestamp,
+            ::hybridse::type::kFloat,   ::hybridse::type::kDouble,
+            ::hybridse::type::kBool,    ::hybridse::type::kDate,
+            ::hybridse::type::kVarchar};
+        for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); ++i) {
+            ::hybridse::type::ColumnDef* col = schema_.Add();
+            col->set_name("col" + std::to_string(i));
+            col->set_type(types[i]);
+        }
+        RowBuilder builder(schema_);
+        for (int i = 0; i < 50; ++i) {
+            // long strings of some rows take wider string addresses
+            std::string short_str = "s" + std::to_string(i);
+            std::string long_str(i % 5 == 0 ? 300 : i, 'a' + i % 26);
+            uint32_t size = builder.CalTotalLength(
+                short_str.size() * 2 + long_str.size());
+            std::string row(size, '\0');
+            builder.SetBuffer(reinterpret_cast<int8_t*>(&(row[0])), size);
+            // every column is null in some rows
+            auto null_at = [i](int col) { return (i + col) % 7 == 0; };
+            null_at(0) ? builder.AppendNULL()
+                       : builder.AppendString(short_str.data(),
+                                              short_str.size());
+            null_at(1) ? builder.AppendNULL() : builder.AppendInt16(i - 20);
+            null_at(2) ? builder.AppendNULL() : builder.AppendInt32(i * 3);
+            null_at(3) ? builder.AppendNULL()
+                       : builder.AppendInt64(i * 100000000000L);
+            null_at(4) ? builder.AppendNULL()
+                       : builder.AppendString(long_str.data(),
+                                              long_str.size());
+            null_at(5) ? builder.AppendNULL()
+                       : builder.AppendTimestamp(1590738989000L + i);
+            null_at(6) ? builder.AppendNULL() : builder.AppendFloat(i * 0.5f);
+            null_at(7) ? builder.AppendNULL() : builder.AppendDouble(i * 1.5);
+            null_at(8) ? builder.AppendNULL() : builder.AppendBool(i % 2);
+            null_at(9) ? builder.AppendNULL()
+                       : builder.AppendDate(2020, 1 + i % 12, 1 + i % 28);
+            null_at(10) ? builder.AppendNULL()
+                        : builder.AppendString(short_str.data(),
+                                               short_str.size());
+            rows_.push_back(row);
+        }
+    }
+
+    // Select by decoding and encoding every field, into a zeroed buffer
+    static std::string SelectByView(
+        const std::vector<const Schema*>& schemas,
+        const std::vector<std::pair<size_t, size_t>>& indices,
+        const std::vector<const std::string*>& slices) {
+        Schema target_schema;
+        std::vector<RowView> views;
+        for (size_t i = 0; i < schemas.size(); ++i) {
+            views.push_back(RowView(*schemas[i]));
+            views.back().Reset(
+                reinterpret_cast<const int8_t*>(slices[i]->data()),
+                slices[i]->size());
+        }
+        uint32_t str_size = 0;
+        for (auto& pair : indices) {
+            auto& col = schemas[pair.first]->Get(pair.second);
+            *target_schema.Add() = col;
+            if (col.type() == type::kVarchar &&
+                !views[pair.first].IsNULL(pair.second)) {
+                str_size +=
+                    views[pair.first].GetStringUnsafe(pair.second).size();
+            }
+        }
+        RowBuilder builder(target_schema);
+        uint32_t size = builder.CalTotalLength(str_size);
+        std::string row(size, '\0');
+        builder.SetBuffer(reinterpret_cast<int8_t*>(&(row[0])), size);
+        for (auto& pair : indices) {
+            auto& view = views[pair.first];
+            size_t idx = pair.second;
+            if (view.IsNULL(idx)) {
+                builder.AppendNULL();
+                continue;
+            }
+            switch (schemas[pair.first]->Get(idx).type()) {
+                case type::kInt16:
+                    builder.AppendInt16(view.GetInt16Unsafe(idx));
+                    break;
+                case type::kInt32:
+                    builder.AppendInt32(view.GetInt32Unsafe(idx));
+                    break;
+                case type::kInt64:
+                    builder.AppendInt64(view.GetInt64Unsafe(idx));
+                    break;
+                case type::kBool:
+                    builder.AppendBool(view.GetBoolUnsafe(idx));
+                    break;
+                case type::kFloat:
+                    builder.AppendFloat(view.GetFloatUnsafe(idx));
+                    break;
+                case type::kDouble:
+                    builder.AppendDouble(view.GetDoubleUnsafe(idx));
+                    break;
+                case type::kTimestamp:
+                    builder.AppendTimestamp(view.GetTimestampUnsafe(idx));
+                    break;
+                case type::kDate: {
+                    int32_t year, month, day;
+                    view.GetDate(idx, &year, &month, &day);
+                    builder.AppendDate(year, month, day);
+                    break;
+                }
+                case type::kVarchar: {
+                    std::string str = view.GetStringUnsafe(idx);
+                    builder.AppendString(str.data(), str.size());
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+        return row;
+    }
+
+ protected:
+    Schema schema_;
+    std::vector<std::string> rows_;
+};
+
+TEST_F(RowSelectorTest, SelectSliceTest) {
+    std::vector<std::vector<size_t>> cases = {
+        {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10},
+        {10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0},
+        {2, 3, 5},
+        {4},
+        {1, 1, 10, 0, 4, 4},
+        {6, 7, 8, 9}};
+    for (auto& indices : cases) {
+        std::vector<std::pair<size_t, size_t>> pairs;
+        for (size_t idx : indices) {
+            pairs.push_back(std::make_pair(0, idx));
+        }
+        RowSelector selector(&schema_, indices);
+        ASSERT_EQ(static_cast<int>(indices.size()),
+                  selector.GetTargetSchema().size());
+        for (auto& row : rows_) {
+            std::string expect = SelectByView({&schema_}, pairs, {&row});
+            int8_t* buf = nullptr;
+            size_t size = 0;
+            ASSERT_TRUE(selector.Select(
+                reinterpret_cast<const int8_t*>(row.data()), row.size(), &buf,
+                &size));
+            ASSERT_EQ(expect,
+                      std::string(reinterpret_cast<char*>(buf), size));
+            free(buf);
+        }
+    }
+}
+
+TEST_F(RowSelectorTest, SelectMultiSliceTest) {
+    std::vector<const Schema*> schemas = {&schema_, &schema_};
+    std::vector<std::pair<size_t, size_t>> indices = {
+        {1, 4}, {0, 0}, {1, 2}, {1, 3}, {0, 5}, {0, 4}, {1, 10}, {0, 9}};
+    RowSelector selector(schemas, indices);
+    base::ByteMemoryPool pool;
+    std::vector<int8_t> buf(64);
+    for (size_t i = 0; i + 1 < rows_.size(); ++i) {
+        Row row(1, Row(rows_[i]), 1, Row(rows_[i + 1]));
+        std::string expect =
+            SelectByView(schemas, indices, {&rows_[i], &rows_[i + 1]});
+
+        int8_t* out = nullptr;
+        size_t size = 0;
+        ASSERT_TRUE(selector.Select(row, &out, &size));
+        ASSERT_EQ(expect, std::string(reinterpret_cast<char*>(out), size));
+        free(out);
+
+        ASSERT_TRUE(selector.Select(row, &pool, &out, &size));
+        ASSERT_EQ(expect, std::string(reinterpret_cast<char*>(out), size));
+
+        // buffer is grown and reused if the selected row does not fit
+        if (!selector.SelectInto(row, buf.data(), buf.size(), &size)) {
+            ASSERT_GT(size, buf.size());
+            buf.resize(size);
+            ASSERT_TRUE(
+                selector.SelectInto(row, buf.data(), buf.size(), &size));
+        }
+        ASSERT_EQ(expect,
+                  std::string(reinterpret_cast<char*>(buf.data()), size));
+    }
+
+    // slices of row must match schemas
+    int8_t* out = nullptr;
+    size_t size = 0;
+    ASSERT_FALSE(selector.Select(Row(rows_[0]), &out, &size));
+    ASSERT_EQ(0u, size);
+}
+
+}  // namespace codec
+}  // namespace hybridse
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,464 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "codec/row_layout.h"
+#include <algorithm>
+#include <mutex>  // NOLINT
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include "base/fe_hash.h"
+#include "codec/type_codec.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+DECLARE_bool(enable_spark_unsaferow_format);
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define HYBRIDSE_ROW_LAYOUT_AVX2
+#endif
+
+namespace hybridse {
+namespace codec {
+
+// rows are gathered in chunks so that addresses stay on stack
+static const size_t kGatherChunkSize = 256;
+// field read of null values, wide enough for any fixed-size type
+static const int64_t kZeroField = 0;
+
+template <typename T, typename R>
+static void GatherScalar(const int8_t* const* addrs, size_t begin, size_t cnt,
+                         R* values) {
+    for (size_t i = begin; i < cnt; ++i) {
+        values[i] = static_cast<R>(*reinterpret_cast<const T*>(addrs[i]));
+    }
+}
+
+#ifdef HYBRIDSE_ROW_LAYOUT_AVX2
+static bool HasAvx2() {
+    static const bool has_avx2 = []() {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+    }();
+    return has_avx2;
+}
+
+// Addresses are gathered as absolute 64-bit indexes over a null base
+__attribute__((target("avx2"))) static void GatherInt64Avx2(
+    const int8_t* const* addrs, size_t cnt, int64_t* values) {
+    size_t i = 0;
+    for (; i + 4 <= cnt; i += 4) {
+        __m256i idx =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(addrs + i));
+        __m256i v = _mm256_i64gather_epi64(
+            static_cast<const long long*>(nullptr), idx, 1);  // NOLINT
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(values + i), v);
+    }
+    GatherScalar<int64_t, int64_t>(addrs, i, cnt, values);
+}
+
+__attribute__((target("avx2"))) static void GatherInt32Avx2(
+    const int8_t* const* addrs, size_t cnt, int64_t* values) {
+    size_t i = 0;
+    for (; i + 4 <= cnt; i += 4) {
+        __m256i idx =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(addrs + i));
+        __m128i v =
+            _mm256_i64gather_epi32(static_cast<const int*>(nullptr), idx, 1);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(values + i),
+                            _mm256_cvtepi32_epi64(v));
+    }
+    GatherScalar<int32_t, int64_t>(addrs, i, cnt, values);
+}
+
+__attribute__((target("avx2"))) static void GatherDoubleAvx2(
+    const int8_t* const* addrs, size_t cnt, double* values) {
+    size_t i = 0;
+    for (; i + 4 <= cnt; i += 4) {
+        __m256i idx =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(addrs + i));
+        __m256d v =
+            _mm256_i64gather_pd(static_cast<const double*>(nullptr), idx, 1);
+        _mm256_storeu_pd(values + i, v);
+    }
+    GatherScalar<double, double>(addrs, i, cnt, values);
+}
+
+__attribute__((target("avx2"))) static void GatherFloatAvx2(
+    const int8_t* const* addrs, size_t cnt, double* values) {
+    size_t i = 0;
+    for (; i + 4 <= cnt; i += 4) {
+        __m256i idx =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(addrs + i));
+        __m128 v =
+            _mm256_i64gather_ps(static_cast<const float*>(nullptr), idx, 1);
+        _mm256_storeu_pd(values + i, _mm256_cvtps_pd(v));
+    }
+    GatherScalar<float, double>(addrs, i, cnt, values);
+}
+
+__attribute__((target("avx2"))) static void GatherInt32AsDoubleAvx2(
+    const int8_t* const* addrs, size_t cnt, double* values) {
+    size_t i = 0;
+    for (; i + 4 <= cnt; i += 4) {
+        __m256i idx =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(addrs + i));
+        __m128i v =
+            _mm256_i64gather_epi32(static_cast<const int*>(nullptr), idx, 1);
+        _mm256_storeu_pd(values + i, _mm256_cvtepi32_pd(v));
+    }
+    GatherScalar<int32_t, double>(addrs, i, cnt, values);
+}
+#endif
+
+template <typename T, T (*GetField)(const int8_t*, uint32_t)>
+static void ReadFieldOf(const int8_t* row, uint32_t offset, void* val) {
+    *reinterpret_cast<T*>(val) = GetField(row, offset);
+}
+
+static void ReadBoolField(const int8_t* row, uint32_t offset, void* val) {
+    *reinterpret_cast<bool*>(val) = 1 == v1::GetBoolFieldUnsafe(row, offset);
+}
+
+static RowLayout::FieldReader GetFieldReader(::hybridse::type::Type type) {
+    switch (type) {
+        case ::hybridse::type::kBool:
+            return ReadBoolField;
+        case ::hybridse::type::kInt16:
+            return ReadFieldOf<int16_t, v1::GetInt16FieldUnsafe>;
+        case ::hybridse::type::kInt32:
+        case ::hybridse::type::kDate:
+            return ReadFieldOf<int32_t, v1::GetInt32FieldUnsafe>;
+        case ::hybridse::type::kInt64:
+        case ::hybridse::type::kTimestamp:
+            return ReadFieldOf<int64_t, v1::GetInt64FieldUnsafe>;
+        case ::hybridse::type::kFloat:
+            return ReadFieldOf<float, v1::GetFloatFieldUnsafe>;
+        case ::hybridse::type::kDouble:
+            return ReadFieldOf<double, v1::GetDoubleFieldUnsafe>;
+        default:
+            // varchar or not supported
+            return nullptr;
+    }
+}
+
+RowLayout::RowLayout(const Schema& schema)
+    : schema_(schema),
+      is_valid_(true),
+      types_(),
+      offsets_(),
+      readers_(),
+      str_field_cnt_(0),
+      str_field_start_offset_(0) {
+    str_field_start_offset_ = HEADER_LENGTH + BitMapSize(schema.size());
+    const auto& type_size_map = GetTypeSizeMap();
+    for (int idx = 0; idx < schema.size(); idx++) {
+        const ::hybridse::type::ColumnDef& column = schema.Get(idx);
+        types_.push_back(column.type());
+        readers_.push_back(GetFieldReader(column.type()));
+        if (column.type() == ::hybridse::type::kVarchar) {
+            offsets_.push_back(str_field_cnt_);
+            str_field_cnt_++;
+            continue;
+        }
+        auto iter = type_size_map.find(column.type());
+        if (iter == type_size_map.end()) {
+            LOG(WARNING) << ::hybridse::type::Type_Name(column.type())
+                         << " is not supported";
+            is_valid_ = false;
+            offsets_.push_back(0);
+        } else {
+            offsets_.push_back(str_field_start_offset_);
+            str_field_start_offset_ += iter->second;
+        }
+    }
+}
+
+// Cache key of schema, bitmap size depends on row format flag as well
+static std::string LayoutCacheKey(const Schema& schema) {
+    std::string key(1, FLAGS_enable_spark_unsaferow_format ? '1' : '0');
+    for (int idx = 0; idx < schema.size(); idx++) {
+        const std::string column = schema.Get(idx).SerializeAsString();
+        uint32_t size = column.size();
+        key.append(reinterpret_cast<const char*>(&size), sizeof(size));
+        key.append(column);
+    }
+    return key;
+}
+
+// Layout shared among all threads, keyed by schema content
+static std::shared_ptr<const RowLayout> GetSharedLayout(const Schema& schema) {
+    static std::mutex mu;
+    static std::unordered_map<std::string, std::weak_ptr<const RowLayout>>
+        cache;
+    // expired entries are purged when cache doubles
+    static size_t purge_size = 64;
+    std::string key = LayoutCacheKey(schema);
+    std::lock_guard<std::mutex> lock(mu);
+    auto iter = cache.find(key);
+    if (iter != cache.end()) {
+        auto layout = iter->second.lock();
+        if (layout) {
+            return layout;
+        }
+    }
+    auto layout = std::make_shared<const RowLayout>(schema);
+    cache[key] = layout;
+    if (cache.size() >= purge_size) {
+        for (auto it = cache.begin(); it != cache.end();) {
+            if (it->second.expired()) {
+                it = cache.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        purge_size = std::max(static_cast<size_t>(64), cache.size() * 2);
+    }
+    return layout;
+}
+
+static inline uint64_t HashCombine(uint64_t seed, uint64_t hash) {
+    return seed ^ (hash + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+}
+
+// Hash of columns of schema and the row format flag, computed once per
+// lookup. Names are included since RowView exposes schema of its layout.
+static uint64_t SchemaFingerprint(const Schema& schema) {
+    uint64_t hash = FLAGS_enable_spark_unsaferow_format ? 1 : 0;
+    for (int idx = 0; idx < schema.size(); idx++) {
+        const ::hybridse::type::ColumnDef& column = schema.Get(idx);
+        const std::string& name = column.name();
+        uint64_t attrs = static_cast<uint64_t>(column.type()) |
+                         static_cast<uint64_t>(column.offset()) << 16 |
+                         static_cast<uint64_t>(column.is_not_null()) << 48 |
+                         static_cast<uint64_t>(column.is_constant()) << 49;
+        hash = HashCombine(hash, attrs);
+        hash = HashCombine(
+            hash, base::MurmurHash64A(name.data(),
+                                      static_cast<int>(name.size()), 0));
+    }
+    return hash;
+}
+
+// Bound of schemas cached by every thread
+static const size_t kLocalLayoutCacheSize = 256;
+
+std::shared_ptr<const RowLayout> RowLayout::Get(const Schema& schema) {
+    // Schemas are looked up by fingerprint in a cache of current thread
+    // first, without lock or serialization. Entries are weak, so layouts
+    // no view uses any more are not kept alive by idle threads.
+    thread_local std::unordered_map<uint64_t, std::weak_ptr<const RowLayout>>
+        local_cache;
+    uint64_t fingerprint = SchemaFingerprint(schema);
+    auto iter = local_cache.find(fingerprint);
+    if (iter != local_cache.end()) {
+        auto layout = iter->second.lock();
+        // guard against fingerprint collision with column count and types
+        if (layout &&
+            layout->GetColumnCnt() == static_cast<uint32_t>(schema.size())) {
+            bool same_types = true;
+            for (int idx = 0; idx < schema.size(); idx++) {
+                if (layout->GetType(idx) != schema.Get(idx).type()) {
+                    same_types = false;
+                    break;
+                }
+            }
+            if (same_types) {
+                return layout;
+            }
+        }
+    }
+    auto layout = GetSharedLayout(schema);
+    if (iter != local_cache.end()) {
+        iter->second = layout;
+        return layout;
+    }
+    if (local_cache.size() >= kLocalLayoutCacheSize) {
+        for (auto it = local_cache.begin(); it != local_cache.end();) {
+            if (it->second.expired()) {
+                it = local_cache.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        if (local_cache.size() >= kLocalLayoutCacheSize) {
+            local_cache.clear();
+        }
+    }
+    local_cache.emplace(fingerprint, layout);
+    return layout;
+}
+
+size_t RowLayout::ResolveAddrs(const int8_t* const* rows, size_t cnt,
+                               uint32_t idx, const int8_t** addrs,
+                               bool* nulls) const {
+    const int8_t* zero = reinterpret_cast<const int8_t*>(&kZeroField);
+    uint32_t offset = offsets_[idx];
+    size_t null_cnt = 0;
+    for (size_t i = 0; i < cnt; ++i) {
+        const int8_t* row = rows[i];
+        bool is_null = row == nullptr ||
+                       RowView::GetSize(row) <= HEADER_LENGTH ||
+                       IsNULL(row, idx);
+        nulls[i] = is_null;
+        addrs[i] = is_null ? zero : row + offset;
+        null_cnt += is_null;
+    }
+    return null_cnt;
+}
+
+bool RowLayout::GatherInt64(const int8_t* const* rows, size_t cnt,
+                            uint32_t idx, int64_t null_value,
+                            int64_t* values) const {
+    if (idx >= types_.size()) {
+        LOG(WARNING) << "idx out of index";
+        return false;
+    }
+    ::hybridse::type::Type type = types_[idx];
+    switch (type) {
+        case ::hybridse::type::kInt16:
+        case ::hybridse::type::kInt32:
+        case ::hybridse::type::kDate:
+        case ::hybridse::type::kInt64:
+        case ::hybridse::type::kTimestamp:
+            break;
+        default:
+            LOG(WARNING) << "type " << ::hybridse::type::Type_Name(type)
+                         << " is not Integer";
+            return false;
+    }
+#ifdef HYBRIDSE_ROW_LAYOUT_AVX2
+    bool use_avx2 = HasAvx2();
+#endif
+    const int8_t* addrs[kGatherChunkSize];
+    bool nulls[kGatherChunkSize];
+    for (size_t begin = 0; begin < cnt; begin += kGatherChunkSize) {
+        size_t n = std::min(kGatherChunkSize, cnt - begin);
+        int64_t* out = values + begin;
+        size_t null_cnt = ResolveAddrs(rows + begin, n, idx, addrs, nulls);
+        switch (type) {
+            case ::hybridse::type::kInt16:
+                GatherScalar<int16_t, int64_t>(addrs, 0, n, out);
+                break;
+            case ::hybridse::type::kInt32:
+            case ::hybridse::type::kDate:
+#ifdef HYBRIDSE_ROW_LAYOUT_AVX2
+                if (use_avx2) {
+                    GatherInt32Avx2(addrs, n, out);
+                    break;
+                }
+#endif
+                GatherScalar<int32_t, int64_t>(addrs, 0, n, out);
+                break;
+            default:
+#ifdef HYBRIDSE_ROW_LAYOUT_AVX2
+                if (use_avx2) {
+                    GatherInt64Avx2(addrs, n, out);
+                    break;
+                }
+#endif
+                GatherScalar<int64_t, int64_t>(addrs, 0, n, out);
+                break;
+        }
+        for (size_t i = 0; null_cnt > 0 && i < n; ++i) {
+            if (nulls[i]) {
+                out[i] = null_value;
+                null_cnt--;
+            }
+        }
+    }
+    return true;
+}
+
+bool RowLayout::GatherDouble(const int8_t* const* rows, size_t cnt,
+                             uint32_t idx, double null_value,
+                             double* values) const {
+    if (idx >= types_.size()) {
+        LOG(WARNING) << "idx out of index";
+        return false;
+    }
+    ::hybridse::type::Type type = types_[idx];
+    switch (type) {
+        case ::hybridse::type::kInt16:
+        case ::hybridse::type::kInt32:
+        case ::hybridse::type::kInt64:
+        case ::hybridse::type::kTimestamp:
+        case ::hybridse::type::kFloat:
+        case ::hybridse::type::kDouble:
+            break;
+        default:
+            LOG(WARNING) << "type " << ::hybridse::type::Type_Name(type)
+                         << " is not Number";
+            return false;
+    }
+#ifdef HYBRIDSE_ROW_LAYOUT_AVX2
+    bool use_avx2 = HasAvx2();
+#endif
+    const int8_t* addrs[kGatherChunkSize];
+    bool nulls[kGatherChunkSize];
+    for (size_t begin = 0; begin < cnt; begin += kGatherChunkSize) {
+        size_t n = std::min(kGatherChunkSize, cnt - begin);
+        double* out = values + begin;
+        size_t null_cnt = ResolveAddrs(rows + begin, n, idx, addrs, nulls);
+        switch (type) {
+            case ::hybridse::type::kInt16:
+                GatherScalar<int16_t, double>(addrs, 0, n, out);
+                break;
+            case ::hybridse::type::kInt32:
+#ifdef HYBRIDSE_ROW_LAYOUT_AVX2
+                if (use_avx2) {
+                    GatherInt32AsDoubleAvx2(addrs, n, out);
+                    break;
+                }
+#endif
+                GatherScalar<int32_t, double>(addrs, 0, n, out);
+                break;
+            case ::hybridse::type::kFloat:
+#ifdef HYBRIDSE_ROW_LAYOUT_AVX2
+                if (use_avx2) {
+                    GatherFloatAvx2(addrs, n, out);
+                    break;
+                }
+#endif
+                GatherScalar<float, double>(addrs, 0, n, out);
+                break;
+            case ::hybridse::type::kDouble:
+#ifdef HYBRIDSE_ROW_LAYOUT_AVX2
+                if (use_avx2) {
+                    GatherDoubleAvx2(addrs, n, out);
+                    break;
+                }
+#endif
+                GatherScalar<double, double>(addrs, 0, n, out);
+                break;
+            default:
+                // no avx2 conversion of int64 lanes to double
+                GatherScalar<int64_t, double>(addrs, 0, n, out);
+                break;
+        }
+        for (size_t i = 0; null_cnt > 0 && i < n; ++i) {
+            if (nulls[i]) {
+                out[i] = null_value;
+                null_cnt--;
+            }
+        }
+    }
+    return true;
+}
+
+}  // namespace codec
+}  // namespace hybridse
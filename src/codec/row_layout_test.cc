@@ -0,0 +1,247 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "codec/row_layout.h"
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace hybridse {
+namespace codec {
+
+class RowLayoutTest : public ::testing::Test {
+ public:
+    void SetUp() override {
+        const ::hybridse::type::Type types[] = {
+            ::hybridse::type::kInt16,     ::hybridse::type::kInt32,
+            ::hybridse::type::kInt64,     ::hybridse::type::kTimestamp,
+            ::hybridse::type::kFloat,     ::hybridse::type::kDouble,
+            ::hybridse::type::kDate,      ::hybridse::type::kVarchar};
+        for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); ++i) {
+            ::hybridse::type::ColumnDef* col = schema_.Add();
+            col->set_name("col" + std::to_string(i));
+            col->set_type(types[i]);
+        }
+        RowBuilder builder(schema_);
+        std::string str("hello");
+        for (int i = 0; i < 1027; ++i) {
+            uint32_t size = builder.CalTotalLength(str.size());
+            std::string row(size, '\0');
+            builder.SetBuffer(reinterpret_cast<int8_t*>(&(row[0])), size);
+            // every column is null in some rows
+            auto null_at = [i](int col) { return (i + col) % 7 == 0; };
+            null_at(0) ? builder.AppendNULL() : builder.AppendInt16(i - 500);
+            null_at(1) ? builder.AppendNULL() : builder.AppendInt32(i * 3);
+            null_at(2) ? builder.AppendNULL()
+                       : builder.AppendInt64(i * 100000000000L);
+            null_at(3) ? builder.AppendNULL()
+                       : builder.AppendTimestamp(1590738989000L + i);
+            null_at(4) ? builder.AppendNULL() : builder.AppendFloat(i * 0.5f);
+            null_at(5) ? builder.AppendNULL() : builder.AppendDouble(i * 1.5);
+            null_at(6) ? builder.AppendNULL()
+                       : builder.AppendDate(2020, 1 + i % 12, 1 + i % 28);
+            builder.AppendString(str.c_str(), str.size());
+            rows_.push_back(row);
+        }
+        for (auto& row : rows_) {
+            bufs_.push_back(reinterpret_cast<const int8_t*>(row.data()));
+        }
+        // null row in the middle of a gather
+        bufs_[13] = nullptr;
+    }
+
+    // Expect value of RowView, or `null_value` for null
+    template <typename T, typename R>
+    R Expect(const RowView& view, const int8_t* row, uint32_t idx,
+             R null_value) {
+        T value = 0;
+        if (0 != view.GetValue(row, idx, schema_.Get(idx).type(), &value)) {
+            return null_value;
+        }
+        return static_cast<R>(value);
+    }
+
+    Schema schema_;
+    std::vector<std::string> rows_;
+    std::vector<const int8_t*> bufs_;
+};
+
+TEST_F(RowLayoutTest, LayoutTest) {
+    RowLayout layout(schema_);
+    RowView view(schema_);
+    ASSERT_EQ(8u, layout.GetColumnCnt());
+    ASSERT_EQ(1u, layout.GetStringFieldCnt());
+    for (uint32_t i = 0; i < 7; ++i) {
+        ASSERT_EQ(schema_.Get(i).type(), layout.GetType(i));
+        ASSERT_EQ(view.GetPrimaryFieldOffset(i),
+                  static_cast<int32_t>(layout.GetOffset(i)));
+    }
+    ASSERT_EQ(0u, layout.GetOffset(7));
+    ASSERT_TRUE(RowLayout::IsNULL(bufs_[0], 0));
+    ASSERT_FALSE(RowLayout::IsNULL(bufs_[0], 1));
+}
+
+TEST_F(RowLayoutTest, SharedLayoutTest) {
+    auto layout = RowLayout::Get(schema_);
+    Schema same(schema_);
+    ASSERT_EQ(layout, RowLayout::Get(same));
+    ASSERT_TRUE(layout->IsValid());
+    ASSERT_EQ(schema_.size(), layout->GetSchema()->size());
+
+    // layout of views and copies of views is shared
+    RowView view(same);
+    RowView copy(view);
+    ASSERT_EQ(layout, view.GetLayout());
+    ASSERT_EQ(layout, copy.GetLayout());
+    ASSERT_EQ(layout->GetSchema(), copy.GetSchema());
+
+    // layout cached by current thread is shared with other threads
+    std::shared_ptr<const RowLayout> other;
+    std::thread thread([&]() { other = RowLayout::Get(same); });
+    thread.join();
+    ASSERT_EQ(layout, other);
+
+    // schemas differing in name only have their own layouts, even if
+    // changed in place after cached
+    same.Mutable(0)->set_name("renamed");
+    ASSERT_NE(layout, RowLayout::Get(same));
+    ASSERT_EQ("renamed", RowView(same).GetSchema()->Get(0).name());
+
+    // caches don't keep a layout alive once no view uses it
+    std::weak_ptr<const RowLayout> dropped = RowLayout::Get(same);
+    ASSERT_TRUE(dropped.expired());
+
+    Schema unsupported(schema_);
+    unsupported.Mutable(0)->set_type(::hybridse::type::kBlob);
+    ASSERT_FALSE(RowLayout::Get(unsupported)->IsValid());
+    int64_t value = 0;
+    ASSERT_EQ(-1, RowView(unsupported).GetValue(
+                      bufs_[1], 0, ::hybridse::type::kBlob, &value));
+}
+
+TEST_F(RowLayoutTest, ReadFieldTest) {
+    auto layout = RowLayout::Get(schema_);
+    RowView view(layout);
+    for (size_t i = 0; i < rows_.size(); ++i) {
+        if (nullptr == bufs_[i]) {
+            continue;
+        }
+        ASSERT_TRUE(view.Reset(bufs_[i]));
+        if (!view.IsNULL(2)) {
+            int64_t value = 0;
+            ASSERT_TRUE(layout->ReadField(bufs_[i], 2, &value));
+            ASSERT_EQ(view.GetInt64Unsafe(2), value);
+        }
+        if (!view.IsNULL(4)) {
+            float value = 0;
+            ASSERT_TRUE(layout->ReadField(bufs_[i], 4, &value));
+            ASSERT_EQ(view.GetFloatUnsafe(4), value);
+        }
+        ASSERT_EQ("hello", view.GetStringUnsafe(7));
+    }
+    const char* str = nullptr;
+    ASSERT_FALSE(layout->ReadField(bufs_[0], 7, &str));
+}
+
+TEST_F(RowLayoutTest, GatherInt64Test) {
+    RowLayout layout(schema_);
+    RowView view(schema_);
+    // odd counts leave tails for the scalar loop
+    for (size_t cnt : {0ul, 3ul, 17ul, 256ul, bufs_.size()}) {
+        std::vector<int64_t> values(cnt);
+        ASSERT_TRUE(layout.GatherInt64(bufs_.data(), cnt, 0, -1,
+                                       values.data()));
+        for (size_t i = 0; i < cnt; ++i) {
+            ASSERT_EQ((Expect<int16_t, int64_t>(view, bufs_[i], 0, -1)),
+                      values[i]);
+        }
+        ASSERT_TRUE(layout.GatherInt64(bufs_.data(), cnt, 1, -1,
+                                       values.data()));
+        for (size_t i = 0; i < cnt; ++i) {
+            ASSERT_EQ((Expect<int32_t, int64_t>(view, bufs_[i], 1, -1)),
+                      values[i]);
+        }
+        for (uint32_t idx : {2u, 3u}) {
+            ASSERT_TRUE(layout.GatherInt64(bufs_.data(), cnt, idx, -1,
+                                           values.data()));
+            for (size_t i = 0; i < cnt; ++i) {
+                ASSERT_EQ((Expect<int64_t, int64_t>(view, bufs_[i], idx, -1)),
+                          values[i]);
+            }
+        }
+        ASSERT_TRUE(layout.GatherInt64(bufs_.data(), cnt, 6, -1,
+                                       values.data()));
+        for (size_t i = 0; i < cnt; ++i) {
+            ASSERT_EQ((Expect<int32_t, int64_t>(view, bufs_[i], 6, -1)),
+                      values[i]);
+        }
+    }
+    std::vector<int64_t> values(bufs_.size());
+    ASSERT_FALSE(
+        layout.GatherInt64(bufs_.data(), bufs_.size(), 4, -1, values.data()));
+    ASSERT_FALSE(
+        layout.GatherInt64(bufs_.data(), bufs_.size(), 7, -1, values.data()));
+    ASSERT_FALSE(
+        layout.GatherInt64(bufs_.data(), bufs_.size(), 8, -1, values.data()));
+}
+
+TEST_F(RowLayoutTest, GatherDoubleTest) {
+    RowLayout layout(schema_);
+    RowView view(schema_);
+    size_t cnt = bufs_.size();
+    std::vector<double> values(cnt);
+    ASSERT_TRUE(
+        layout.GatherDouble(bufs_.data(), cnt, 0, -1.0, values.data()));
+    for (size_t i = 0; i < cnt; ++i) {
+        ASSERT_EQ((Expect<int16_t, double>(view, bufs_[i], 0, -1.0)),
+                  values[i]);
+    }
+    ASSERT_TRUE(
+        layout.GatherDouble(bufs_.data(), cnt, 1, -1.0, values.data()));
+    for (size_t i = 0; i < cnt; ++i) {
+        ASSERT_EQ((Expect<int32_t, double>(view, bufs_[i], 1, -1.0)),
+                  values[i]);
+    }
+    ASSERT_TRUE(
+        layout.GatherDouble(bufs_.data(), cnt, 2, -1.0, values.data()));
+    for (size_t i = 0; i < cnt; ++i) {
+        ASSERT_EQ((Expect<int64_t, double>(view, bufs_[i], 2, -1.0)),
+                  values[i]);
+    }
+    ASSERT_TRUE(
+        layout.GatherDouble(bufs_.data(), cnt, 4, -1.0, values.data()));
+    for (size_t i = 0; i < cnt; ++i) {
+        ASSERT_EQ((Expect<float, double>(view, bufs_[i], 4, -1.0)),
+                  values[i]);
+    }
+    ASSERT_TRUE(
+        layout.GatherDouble(bufs_.data(), cnt, 5, -1.0, values.data()));
+    for (size_t i = 0; i < cnt; ++i) {
+        ASSERT_EQ((Expect<double, double>(view, bufs_[i], 5, -1.0)),
+                  values[i]);
+    }
+    ASSERT_FALSE(
+        layout.GatherDouble(bufs_.data(), cnt, 6, -1.0, values.data()));
+}
+
+}  // namespace codec
+}  // namespace hybridse
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -299,14 +299,14 @@ bool BufNativeEncoderIRBuilder::BuildEncode(::llvm::Value* output_ptr) {
     }
 
     ::llvm::Type* i8_ptr_ty = builder.getInt8PtrTy();
-    ::llvm::Value* i8_ptr =
-        ::llvm::CallInst::CreateMalloc(block_, row_size->getType(), i8_ptr_ty,
-                                       row_size, nullptr, nullptr, "malloc");
-    block_->getInstList().push_back(::llvm::cast<::llvm::Instruction>(i8_ptr));
-    i8_ptr = builder.CreatePointerCast(i8_ptr, i8_ptr_ty);
+    // allocate from row arena of current execution if any, else malloc
+    ::llvm::FunctionCallee alloc_callee =
+        block_->getModule()->getOrInsertFunction("hybridse_alloc_row",
+                                                 i8_ptr_ty, i32_ty);
+    ::llvm::Value* i8_ptr = builder.CreateCall(alloc_callee, {row_size});
     DLOG(INFO) << "i8_ptr type " << i8_ptr->getType()->getTypeID()
                << " output ptr type " << output_ptr->getType()->getTypeID();
-    // make sure free it in c++ always
+    // make sure wrap it with JitRuntime::CreateRowSlice in c++ always
     builder.CreateStore(i8_ptr, output_ptr, false);
     // encode all field to buf
     // append header
@@ -156,6 +156,66 @@ Status RowFnLetIRBuilder::Build(
     return Status::OK();
 }
 
+Status RowFnLetIRBuilder::BuildBlock(const std::string& name,
+                                     const std::string& row_fn_name) {
+    ::llvm::Module* module = ctx_->GetModule();
+    ::llvm::Function* row_fn = module->getFunction(row_fn_name);
+    CHECK_TRUE(row_fn != nullptr, kCodegenError, "row function ",
+               row_fn_name, " not exists");
+    CHECK_TRUE(module->getFunction(name) == nullptr, kCodegenError,
+               "function ", name, " already exists");
+
+    ::llvm::LLVMContext& llvm_ctx = module->getContext();
+    ::llvm::Type* i32_ty = ::llvm::Type::getInt32Ty(llvm_ctx);
+    ::llvm::PointerType* i8_ptr_ty = ::llvm::Type::getInt8PtrTy(llvm_ctx);
+    std::vector<::llvm::Type*> args_llvm_type = {
+        i8_ptr_ty->getPointerTo(), i32_ty, i8_ptr_ty->getPointerTo()};
+    ::llvm::Function* fn = nullptr;
+    CHECK_TRUE(BuildFnHeader(name, args_llvm_type, i32_ty, &fn) &&
+                   fn != nullptr,
+               kCodegenError, "Fail to build fn header for name ", name);
+    auto arg_iter = fn->arg_begin();
+    ::llvm::Value* rows = &*arg_iter++;
+    ::llvm::Value* cnt = &*arg_iter++;
+    ::llvm::Value* outputs = &*arg_iter;
+
+    auto entry = ::llvm::BasicBlock::Create(llvm_ctx, "entry", fn);
+    auto loop = ::llvm::BasicBlock::Create(llvm_ctx, "loop", fn);
+    auto body = ::llvm::BasicBlock::Create(llvm_ctx, "body", fn);
+    auto next = ::llvm::BasicBlock::Create(llvm_ctx, "next", fn);
+    auto exit = ::llvm::BasicBlock::Create(llvm_ctx, "exit", fn);
+    ::llvm::IRBuilder<> builder(entry);
+    builder.CreateBr(loop);
+
+    // loop: idx < cnt
+    builder.SetInsertPoint(loop);
+    ::llvm::PHINode* idx = builder.CreatePHI(i32_ty, 2, "idx");
+    idx->addIncoming(builder.getInt32(0), entry);
+    builder.CreateCondBr(builder.CreateICmpSLT(idx, cnt), body, exit);
+
+    // body: ret = row_fn(0, rows[idx], null, &outputs[idx])
+    builder.SetInsertPoint(body);
+    ::llvm::Value* row = builder.CreateLoad(
+        i8_ptr_ty, builder.CreateInBoundsGEP(i8_ptr_ty, rows, idx));
+    ::llvm::Value* output = builder.CreateInBoundsGEP(i8_ptr_ty, outputs, idx);
+    ::llvm::CallInst* ret = builder.CreateCall(
+        row_fn, {builder.getInt64(0), row,
+                 ::llvm::ConstantPointerNull::get(i8_ptr_ty), output});
+    ret->addAttribute(::llvm::AttributeList::FunctionIndex,
+                      ::llvm::Attribute::AlwaysInline);
+    builder.CreateCondBr(builder.CreateICmpEQ(ret, builder.getInt32(0)), next,
+                         exit);
+
+    builder.SetInsertPoint(next);
+    idx->addIncoming(builder.CreateAdd(idx, builder.getInt32(1)), next);
+    builder.CreateBr(loop);
+
+    // exit with number of rows done
+    builder.SetInsertPoint(exit);
+    builder.CreateRet(idx);
+    return Status::OK();
+}
+
 bool RowFnLetIRBuilder::EncodeBuf(
     const std::map<uint32_t, NativeValue>* values, const vm::Schema& schema,
     VariableIRBuilder& variable_ir_builder,  // NOLINT (runtime/references)
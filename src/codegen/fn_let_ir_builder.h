@@ -45,6 +45,14 @@ class RowFnLetIRBuilder {
                  const std::vector<const node::FrameNode*>& project_frames,
                  const vm::Schema& output_schema);
 
+    /**
+     * Build `int32_t name(int8_t** rows, int32_t cnt, int8_t** outputs)`
+     * running row function `row_fn_name` on `cnt` rows in one call. Row
+     * function is inlined into the loop, return number of rows done before
+     * the first failed one.
+     */
+    Status BuildBlock(const std::string& name, const std::string& row_fn_name);
+
  private:
     bool BuildFnHeader(const std::string& name,
                        const std::vector<::llvm::Type*>& args_type,
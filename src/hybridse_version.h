@@ -0,0 +1,27 @@
+/*
+ * version.h
+ * Copyright 2017 4paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef HYBRIDSE_VERSION_H_
+#define HYBRIDSE_VERSION_H_
+
+#define HYBRIDSE_VERSION_MAJOR 0
+#define HYBRIDSE_VERSION_MEDIUM 
+#define HYBRIDSE_VERSION_MINOR 1
+#define HYBRIDSE_VERSION_BUG 1
+
+#endif /* !HYBRIDSE_VERSION_H_ */
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -17,15 +17,21 @@
 #ifndef SRC_UDF_CONTAINERS_H_
 #define SRC_UDF_CONTAINERS_H_
 
+#include <stdint.h>
 #include <algorithm>
 #include <functional>
-#include <map>
+#include <iterator>
+#include <memory>
+#include <new>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "base/fe_hash.h"
 #include "codec/type_codec.h"
 #include "udf/literal_traits.h"
 #include "udf/udf.h"
+#include "vm/jit_runtime.h"
 
 namespace hybridse {
 namespace udf {
@@ -64,6 +70,200 @@ struct ContainerStorageTypeTrait<codec::Timestamp> {
     }
 };
 
+/**
+ * Hash and equality of stored keys in hash containers.
+ */
+template <typename T>
+struct ContainerKeyTrait {
+    static const uint32_t kHashSeed = 0xe17a1465;
+    static uint64_t Hash(const T& t) {
+        // +0.0 and -0.0 are the same key
+        T value = t == 0 ? T(0) : t;
+        return base::MurmurHash64A(&value, sizeof(T), kHashSeed);
+    }
+    static bool Equal(const T& l, const T& r) {
+        // all nan values are grouped into one key
+        return l == r || (l != l && r != r);
+    }
+};
+
+template <>
+struct ContainerKeyTrait<codec::StringRef> {
+    static const uint32_t kHashSeed = 0xe17a1465;
+    static uint64_t Hash(const codec::StringRef& t) {
+        return base::MurmurHash64A(t.data_, static_cast<int>(t.size_),
+                                   kHashSeed);
+    }
+    static bool Equal(const codec::StringRef& l, const codec::StringRef& r) {
+        return l == r;
+    }
+};
+
+template <>
+struct ContainerKeyTrait<codec::Date> {
+    static uint64_t Hash(const codec::Date& t) {
+        return ContainerKeyTrait<int32_t>::Hash(t.date_);
+    }
+    static bool Equal(const codec::Date& l, const codec::Date& r) {
+        return l == r;
+    }
+};
+
+template <>
+struct ContainerKeyTrait<codec::Timestamp> {
+    static uint64_t Hash(const codec::Timestamp& t) {
+        return ContainerKeyTrait<int64_t>::Hash(t.ts_);
+    }
+    static bool Equal(const codec::Timestamp& l, const codec::Timestamp& r) {
+        return l == r;
+    }
+};
+
+/**
+ * Allocate array of `cnt` uninitialized elements from JIT runtime memory of
+ * current run step.
+ */
+template <typename T>
+T* AllocArenaArray(size_t cnt) {
+    const size_t align = alignof(T);
+    auto addr = reinterpret_cast<uintptr_t>(
+        vm::JitRuntime::get()->AllocManaged(cnt * sizeof(T) + align - 1));
+    return reinterpret_cast<T*>((addr + align - 1) & ~(align - 1));
+}
+
+/**
+ * Open addressing hash map for states of opaque udafs. Entries are stored
+ * densely in insertion order and probed by linear probing over a slot
+ * array of entry indexes, both allocated from JIT runtime memory. Nothing
+ * is freed on growth or destroy, all memory is released in bulk after the
+ * run step, so a map must not outlive the run step where it is built, and
+ * keys and values must not own any resource since they are never destroyed.
+ *
+ * Iterators are entry pointers, invalidated by insertion, sorting and
+ * truncating.
+ */
+template <typename K, typename V>
+class ArenaHashMap {
+ public:
+    struct Entry {
+        K first;
+        V second;
+    };
+
+    using iterator = Entry*;
+    using reverse_iterator = std::reverse_iterator<Entry*>;
+
+    ArenaHashMap()
+        : entries_(nullptr), slots_(nullptr), size_(0), slot_cnt_(0) {}
+
+    iterator begin() const { return entries_; }
+    iterator end() const { return entries_ + size_; }
+    reverse_iterator rbegin() const { return reverse_iterator(end()); }
+    reverse_iterator rend() const { return reverse_iterator(begin()); }
+    size_t size() const { return size_; }
+    bool empty() const { return 0 == size_; }
+
+    void clear() {
+        size_ = 0;
+        std::fill_n(slots_, slot_cnt_, 0);
+    }
+
+    iterator find(const K& key) const {
+        if (0 == size_) {
+            return end();
+        }
+        uint32_t idx = slots_[FindSlot(key)];
+        return 0 == idx ? end() : entries_ + idx - 1;
+    }
+
+    // Insert if key is absent, return entry of the key and whether inserted
+    std::pair<iterator, bool> insert(const std::pair<K, V>& value) {
+        iterator iter = find(value.first);
+        if (iter != end()) {
+            return std::make_pair(iter, false);
+        }
+        // keep load factor under a half so that probing stays short
+        if ((size_ + 1) * 2 > slot_cnt_) {
+            Grow();
+        }
+        iter = new (entries_ + size_) Entry{value.first, value.second};
+        size_++;
+        slots_[FindSlot(value.first)] = size_;
+        return std::make_pair(iter, true);
+    }
+
+    // Compatible with std::map, `hint` is not used
+    iterator insert(iterator hint, const std::pair<K, V>& value) {
+        return insert(value).first;
+    }
+
+    V& operator[](const K& key) {
+        return insert(std::make_pair(key, V())).first->second;
+    }
+
+    // Sort entries by key in ascending order
+    void SortByKey() {
+        std::sort(begin(), end(), KeyLess);
+        Rebuild();
+    }
+
+    // Keep entries of the largest `n` keys only, sorted by key in ascending
+    // order
+    void KeepLargestKeys(size_t n) {
+        if (size_ <= n) {
+            SortByKey();
+            return;
+        }
+        size_t drop = size_ - n;
+        std::nth_element(begin(), begin() + drop, end(), KeyLess);
+        std::move(begin() + drop, end(), begin());
+        size_ = static_cast<uint32_t>(n);
+        SortByKey();
+    }
+
+ private:
+    static const uint32_t kInitSlotCnt = 16;
+
+    static bool KeyLess(const Entry& l, const Entry& r) {
+        return l.first < r.first;
+    }
+
+    // Slot of the key, or the empty slot to insert it into
+    size_t FindSlot(const K& key) const {
+        size_t mask = slot_cnt_ - 1;
+        size_t pos = ContainerKeyTrait<K>::Hash(key) & mask;
+        while (0 != slots_[pos] &&
+               !ContainerKeyTrait<K>::Equal(entries_[slots_[pos] - 1].first,
+                                            key)) {
+            pos = (pos + 1) & mask;
+        }
+        return pos;
+    }
+
+    void Grow() {
+        uint32_t slot_cnt = 0 == slot_cnt_ ? kInitSlotCnt : slot_cnt_ * 2;
+        Entry* entries = AllocArenaArray<Entry>(slot_cnt / 2);
+        std::uninitialized_copy(begin(), end(), entries);
+        entries_ = entries;
+        slots_ = AllocArenaArray<uint32_t>(slot_cnt);
+        slot_cnt_ = slot_cnt;
+        Rebuild();
+    }
+
+    void Rebuild() {
+        std::fill_n(slots_, slot_cnt_, 0);
+        for (uint32_t i = 0; i < size_; ++i) {
+            slots_[FindSlot(entries_[i].first)] = i + 1;
+        }
+    }
+
+    Entry* entries_;
+    // index of entry plus one, zero for empty slot
+    uint32_t* slots_;
+    uint32_t size_;
+    uint32_t slot_cnt_;
+};
+
 template <typename T, typename BoundT>
 class TopKContainer {
  public:
@@ -97,6 +297,7 @@ class TopKContainer {
     }
 
     static void OutputString(ContainerT* ptr, codec::StringRef* output) {
+        ptr->Trim();
         auto& map = ptr->map_;
         if (map.empty()) {
             output->size_ = 0;
@@ -116,7 +317,7 @@ class TopKContainer {
         char* cur = buffer;
         uint32_t remain_space = str_len;
         for (auto iter = map.rbegin(); iter != map.rend(); ++iter) {
-            for (size_t k = 0; k < iter->second; ++k) {
+            for (int64_t k = 0; k < iter->second; ++k) {
                 uint32_t key_len =
                     v1::format_string(iter->first, cur, remain_space);
                 cur += key_len;
@@ -133,26 +334,34 @@ class TopKContainer {
 
     void Push(InputT t) {
         auto key = ContainerStorageTypeTrait<T>::to_stored_value(t);
-        auto iter = map_.find(key);
-        if (iter == map_.end()) {
-            map_.insert(iter, {key, 1});
-        } else {
-            iter->second += 1;
+        map_[key] += 1;
+        // drop the smallest values lazily once distinct values are far
+        // more than bound, so that memory is bounded and push is amortized
+        // constant time
+        if (map_.size() > 2 * std::max<int64_t>(bound_, 0) + kTrimSlack) {
+            Trim();
         }
-        elem_cnt_ += 1;
-        if (elem_cnt_ > bound_) {
-            auto iter_min = map_.begin();
-            iter_min->second -= 1;
-            if (iter_min->second == 0) {
-                map_.erase(iter_min);
-            }
-            elem_cnt_ -= 1;
+    }
+
+    // Keep the largest `bound` values only, sorted in ascending order
+    void Trim() {
+        map_.SortByKey();
+        int64_t remain = std::max<int64_t>(bound_, 0);
+        size_t kept = 0;
+        for (auto iter = map_.rbegin(); iter != map_.rend() && remain > 0;
+             ++iter) {
+            iter->second = std::min(iter->second, remain);
+            remain -= iter->second;
+            kept++;
         }
+        map_.KeepLargestKeys(kept);
     }
 
  private:
-    std::map<StorageT, size_t, std::less<StorageT>> map_;
-    BoundT elem_cnt_ = 0;
+    static const size_t kTrimSlack = 64;
+
+    // value to its occurrence count
+    ArenaHashMap<StorageT, int64_t> map_;
     BoundT bound_ = -1;  // delayed to be set by first push
 };
 
@@ -205,6 +414,11 @@ class BoundedGroupByDict {
                              codec::StringRef* output,
                              const FormatValueF& format_value) {
         auto& map = ptr->map_;
+        if (ptr->key_bound_ >= 0) {
+            map.KeepLargestKeys(ptr->key_bound_);
+        } else {
+            map.SortByKey();
+        }
         if (map.empty()) {
             output->size_ = 0;
             output->data_ = "";
@@ -293,10 +507,27 @@ class BoundedGroupByDict {
             str_len - 1;  // must leave one '\0' for string format impl
     }
 
-    std::map<StorageK, StorageV>& map() { return map_; }
+    ArenaHashMap<StorageK, StorageV>& map() { return map_; }
+
+    /**
+     * Keep the largest `bound` keys only, no bound if negative. It is the
+     * same as removing the smallest key whenever there are more keys than
+     * `bound`, since a removed key never comes back into the largest keys,
+     * but the removal is delayed until keys are far more than `bound`.
+     */
+    void BoundKeys(int64_t bound) {
+        key_bound_ = bound;
+        if (bound >= 0 &&
+            map_.size() > 2 * static_cast<size_t>(bound) + kTrimSlack) {
+            map_.KeepLargestKeys(bound);
+        }
+    }
 
  private:
-    std::map<StorageK, StorageV> map_;
+    ArenaHashMap<StorageK, StorageV> map_;
+    int64_t key_bound_ = -1;
+
+    static const size_t kTrimSlack = 64;
 
     static const size_t MAX_OUTPUT_STR_SIZE = 4096;
 };
@@ -183,10 +183,7 @@ struct TopKCountCateWhereDef {
             if (cond && !is_cond_null) {
                 AvgCateImpl::Update(ptr, value, is_value_null, key,
                                     is_key_null);
-                auto& map = ptr->map();
-                if (bound >= 0 && map.size() > static_cast<size_t>(bound)) {
-                    map.erase(map.begin());
-                }
+                ptr->BoundKeys(bound);
             }
             return ptr;
         }
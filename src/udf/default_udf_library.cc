@@ -18,7 +18,6 @@
 
 #include <string>
 #include <tuple>
-#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -26,6 +25,7 @@
 #include "codegen/string_ir_builder.h"
 #include "codegen/timestamp_ir_builder.h"
 #include "udf/containers.h"
+#include "udf/sketches.h"
 #include "udf/udf.h"
 #include "udf/udf_registry.h"
 
@@ -256,10 +256,10 @@ struct AvgUdafDef {
 template <typename T>
 struct DistinctCountDef {
     using ArgT = typename DataTypeTrait<T>::CCallArgType;
-    using SetT = std::unordered_set<T>;
+    using SetT = container::ArenaHashMap<T, bool>;
 
     void operator()(UdafRegistryHelper& helper) {  // NOLINT
-        std::string suffix = ".opaque_std_set_" + DataTypeTrait<T>::to_string();
+        std::string suffix = ".opaque_hash_set_" + DataTypeTrait<T>::to_string();
         helper.templates<int64_t, Opaque<SetT>, T>()
             .init("distinct_count_init" + suffix, init_set)
             .update("distinct_count_update" + suffix,
@@ -271,7 +271,6 @@ struct DistinctCountDef {
 
     static int64_t set_size(SetT* set) {
         int64_t size = set->size();
-        set->clear();
         set->~SetT();
         return size;
     }
@@ -279,7 +278,7 @@ struct DistinctCountDef {
     template <typename V>
     struct UpdateImpl {
         static SetT* update_set(SetT* set, V value) {
-            set->insert(value);
+            set->insert(std::make_pair(value, true));
             return set;
         }
     };
@@ -287,12 +286,114 @@ struct DistinctCountDef {
     template <typename V>
     struct UpdateImpl<V*> {
         static SetT* update_set(SetT* set, V* value) {
-            set->insert(*value);
+            set->insert(std::make_pair(*value, true));
             return set;
         }
     };
 };
 
+template <typename T>
+struct ApproxDistinctDef {
+    using InputT = typename DataTypeTrait<T>::CCallArgType;
+    using SketchT = container::HyperLogLog;
+
+    void operator()(UdafRegistryHelper& helper) {  // NOLINT
+        std::string suffix = ".opaque_hll_" + DataTypeTrait<T>::to_string();
+        helper.templates<int64_t, Opaque<SketchT>, Nullable<T>>()
+            .init("approx_distinct_init" + suffix, Init)
+            .update("approx_distinct_update" + suffix, Update)
+            .output("approx_distinct_output" + suffix, Output);
+
+        suffix = ".i32_precision_opaque_hll_" + DataTypeTrait<T>::to_string();
+        helper.templates<int64_t, Opaque<SketchT>, Nullable<T>, int32_t>()
+            .init("approx_distinct_init" + suffix, Init)
+            .update("approx_distinct_update" + suffix, UpdateWithPrecision)
+            .output("approx_distinct_output" + suffix, Output);
+    }
+
+    static void Init(SketchT* addr) { new (addr) SketchT(); }
+
+    static SketchT* Update(SketchT* sketch, InputT value, bool is_null) {
+        return UpdateWithPrecision(sketch, value, is_null,
+                                   SketchT::kDefaultPrecision);
+    }
+
+    static SketchT* UpdateWithPrecision(SketchT* sketch, InputT value,
+                                        bool is_null, int32_t precision) {
+        if (!is_null) {
+            auto key = container::ContainerStorageTypeTrait<T>::to_stored_value(
+                value);
+            sketch->Add(container::ContainerKeyTrait<decltype(key)>::Hash(key),
+                        precision);
+        }
+        return sketch;
+    }
+
+    static int64_t Output(SketchT* sketch) {
+        int64_t estimate = sketch->Estimate();
+        sketch->~SketchT();
+        return estimate;
+    }
+};
+
+template <typename T>
+struct ApproxPercentileDef {
+    using InputT = typename DataTypeTrait<T>::CCallArgType;
+
+    struct State {
+        container::KllSketch sketch;
+        double fraction = 0.5;
+    };
+
+    void operator()(UdafRegistryHelper& helper) {  // NOLINT
+        std::string suffix = ".opaque_kll_" + DataTypeTrait<T>::to_string();
+        helper
+            .templates<Nullable<double>, Opaque<State>, Nullable<T>, double>()
+            .init("approx_percentile_init" + suffix, Init)
+            .update("approx_percentile_update" + suffix, Update)
+            .output("approx_percentile_output" + suffix,
+                    reinterpret_cast<void*>(Output), true);
+    }
+
+    static void Init(State* addr) { new (addr) State(); }
+
+    static State* Update(State* state, InputT value, bool is_null,
+                         double fraction) {
+        state->fraction = fraction;
+        if (!is_null) {
+            state->sketch.Add(static_cast<double>(value));
+        }
+        return state;
+    }
+
+    // Output null if there is no non-null value
+    static void Output(State* state, double* output, bool* is_null) {
+        *is_null = 0 == state->sketch.count();
+        *output = *is_null ? 0.0 : state->sketch.Quantile(state->fraction);
+        state->~State();
+    }
+};
+
+template <typename T>
+struct ApproxMedianDef {
+    using InputT = typename DataTypeTrait<T>::CCallArgType;
+    using PercentileDef = ApproxPercentileDef<T>;
+    using State = typename PercentileDef::State;
+
+    void operator()(UdafRegistryHelper& helper) {  // NOLINT
+        std::string suffix = ".opaque_kll_" + DataTypeTrait<T>::to_string();
+        helper.templates<Nullable<double>, Opaque<State>, Nullable<T>>()
+            .init("approx_median_init" + suffix, PercentileDef::Init)
+            .update("approx_median_update" + suffix, Update)
+            .output("approx_median_output" + suffix,
+                    reinterpret_cast<void*>(PercentileDef::Output), true);
+    }
+
+    static State* Update(State* state, InputT value, bool is_null) {
+        return PercentileDef::Update(state, value, is_null, 0.5);
+    }
+};
+
 template <typename T>
 struct SumWhereDef {
     void operator()(UdafRegistryHelper& helper) {  // NOLINT
@@ -1357,6 +1458,7 @@ void DefaultUdfLibrary::Init() {
 void DefaultUdfLibrary::InitUdaf() {
     RegisterUdafTemplate<SumUdafDef>("sum")
         .doc("Compute sum of values")
+        .incremental(kUdafIncrementalSum)
         .args_in<int16_t, int32_t, int64_t, float, double, Timestamp>();
 
     RegisterExprUdf("minimum").args<AnyArg, AnyArg>(
@@ -1375,21 +1477,25 @@ void DefaultUdfLibrary::InitUdaf() {
 
     RegisterUdafTemplate<MinUdafDef>("min")
         .doc("Compute min of values")
+        .incremental(kUdafIncrementalMin)
         .args_in<int16_t, int32_t, int64_t, float, double, Timestamp, Date,
                  StringRef>();
 
     RegisterUdafTemplate<MaxUdafDef>("max")
         .doc("Compute max of values")
+        .incremental(kUdafIncrementalMax)
         .args_in<int16_t, int32_t, int64_t, float, double, Timestamp, Date,
                  StringRef>();
 
     RegisterUdafTemplate<CountUdafDef>("count")
         .doc("Compute count of values")
+        .incremental(kUdafIncrementalCount)
         .args_in<bool, int16_t, int32_t, int64_t, float, double, Timestamp,
                  Date, StringRef, LiteralTypedRow<>>();
 
     RegisterUdafTemplate<AvgUdafDef>("avg")
         .doc("Compute average of values")
+        .incremental(kUdafIncrementalAvg)
         .args_in<int16_t, int32_t, int64_t, float, double>();
 
     RegisterUdafTemplate<DistinctCountDef>("distinct_count")
@@ -1397,6 +1503,43 @@ void DefaultUdfLibrary::InitUdaf() {
         .args_in<bool, int16_t, int32_t, int64_t, float, double, Timestamp,
                  Date, StringRef>();
 
+    RegisterUdafTemplate<ApproxDistinctDef>("approx_distinct")
+        .doc(R"(
+            Compute approximate distinct number of values by HyperLogLog, in
+            fixed memory of 2^precision bytes. An optional precision in
+            [4, 16], 12 by default, is taken from the first non-null row.
+            Relative standard error is about 1.04 / sqrt(2^precision), 1.6%
+            by default.
+
+            Example:
+            @code{.sql}
+                SELECT approx_distinct(col1) OVER w;
+                SELECT approx_distinct(col1, 14) OVER w;
+            @endcode
+            )")
+        .args_in<int16_t, int32_t, int64_t, float, double, Timestamp, Date,
+                 StringRef>();
+
+    RegisterUdafTemplate<ApproxPercentileDef>("approx_percentile")
+        .doc(R"(
+            Compute approximate percentile of values by KLL sketch in fixed
+            memory. The percentage is a fraction in [0, 1], rank error of
+            output is about 1%. Output NULL if there is no non-null value.
+
+            Example:
+            @code{.sql}
+                SELECT approx_percentile(col1, 0.99) OVER w;
+            @endcode
+            )")
+        .args_in<int16_t, int32_t, int64_t, float, double>();
+
+    RegisterUdafTemplate<ApproxMedianDef>("approx_median")
+        .doc(R"(
+            Compute approximate median of values, same as
+            approx_percentile(value, 0.5).
+            )")
+        .args_in<int16_t, int32_t, int64_t, float, double>();
+
     RegisterUdafTemplate<SumWhereDef>("sum_where")
         .doc("Compute sum of values match specified condition")
         .args_in<int16_t, int32_t, int64_t, float, double>();
@@ -0,0 +1,35 @@
+# Copyright 2021 4Paradigm
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Write udf bitcode file INPUT into c++ source OUTPUT, see udf/udf_bitcode.h.
+# Bitcode is left empty if INPUT is not given.
+set(UDF_BITCODE_BYTES "")
+set(UDF_BITCODE_SIZE 0)
+if (DEFINED INPUT)
+    file(READ ${INPUT} UDF_BITCODE_HEX HEX)
+    string(LENGTH "${UDF_BITCODE_HEX}" UDF_BITCODE_HEX_SIZE)
+    math(EXPR UDF_BITCODE_SIZE "${UDF_BITCODE_HEX_SIZE} / 2")
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," UDF_BITCODE_BYTES
+        "${UDF_BITCODE_HEX}")
+endif()
+file(WRITE ${OUTPUT}
+    "// generated from udf bitcode by embed_bitcode.cmake\n"
+    "#include \"udf/udf_bitcode.h\"\n"
+    "namespace hybridse {\n"
+    "namespace udf {\n"
+    "// bitcode reader requires 4 bytes alignment\n"
+    "alignas(16) const unsigned char kUdfBitcode[] = {${UDF_BITCODE_BYTES}0};\n"
+    "const size_t kUdfBitcodeSize = ${UDF_BITCODE_SIZE};\n"
+    "}  // namespace udf\n"
+    "}  // namespace hybridse\n")
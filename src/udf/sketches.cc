@@ -0,0 +1,272 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "udf/sketches.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include "udf/containers.h"
+
+namespace hybridse {
+namespace udf {
+namespace container {
+
+const int32_t HyperLogLog::kMinPrecision;
+const int32_t HyperLogLog::kMaxPrecision;
+const int32_t HyperLogLog::kDefaultPrecision;
+const uint32_t KllSketch::kK;
+const uint32_t KllSketch::kMaxLevels;
+const uint32_t KllSketch::kMinCapacity;
+const uint32_t KllSketch::kBufferSize;
+
+void HyperLogLog::Allocate(int32_t precision) {
+    precision_ = std::min(std::max(precision, kMinPrecision), kMaxPrecision);
+    registers_ = AllocArenaArray<uint8_t>(1u << precision_);
+    memset(registers_, 0, 1u << precision_);
+}
+
+void HyperLogLog::Add(uint64_t hash, int32_t precision) {
+    if (nullptr == registers_) {
+        Allocate(precision);
+    }
+    uint64_t idx = hash >> (64 - precision_);
+    // guard bit bounds rank of the rest bits by 64 - precision + 1
+    uint64_t rest = (hash << precision_) | (1ULL << (precision_ - 1));
+    uint8_t rank = static_cast<uint8_t>(__builtin_clzll(rest) + 1);
+    if (rank > registers_[idx]) {
+        registers_[idx] = rank;
+    }
+}
+
+bool HyperLogLog::Merge(const HyperLogLog& other) {
+    if (nullptr == other.registers_) {
+        return true;
+    }
+    if (nullptr == registers_) {
+        Allocate(other.precision_);
+    } else if (precision_ != other.precision_) {
+        return false;
+    }
+    for (uint32_t i = 0; i < (1u << precision_); ++i) {
+        registers_[i] = std::max(registers_[i], other.registers_[i]);
+    }
+    return true;
+}
+
+int64_t HyperLogLog::Estimate() const {
+    if (nullptr == registers_) {
+        return 0;
+    }
+    const uint32_t m = 1u << precision_;
+    double sum = 0;
+    uint32_t zeros = 0;
+    for (uint32_t i = 0; i < m; ++i) {
+        sum += ldexp(1.0, -registers_[i]);
+        if (0 == registers_[i]) {
+            zeros++;
+        }
+    }
+    double alpha = 16 == m   ? 0.673
+                   : 32 == m ? 0.697
+                   : 64 == m ? 0.709
+                             : 0.7213 / (1 + 1.079 / m);
+    double estimate = alpha * m * m / sum;
+    // raw estimate is biased for small cardinalities
+    if (zeros > 0 && estimate <= 2.5 * m) {
+        estimate = m * log(static_cast<double>(m) / zeros);
+    }
+    return llround(estimate);
+}
+
+KllSketch::KllSketch()
+    : items_(nullptr),
+      level_cnt_(0),
+      count_(0),
+      min_(0),
+      max_(0),
+      random_(0x9e3779b97f4a7c15ULL) {
+    levels_[0] = kBufferSize;
+}
+
+// Capacity of level at `depth` below the top level
+static uint32_t CapacityOfDepth(uint32_t depth, uint32_t k,
+                                uint32_t min_capacity) {
+    double capacity = k;
+    for (uint32_t i = 0; i < depth && capacity >= min_capacity; ++i) {
+        capacity *= 2.0 / 3.0;
+    }
+    return std::max(min_capacity, static_cast<uint32_t>(capacity));
+}
+
+uint32_t KllSketch::LevelCapacity(uint32_t level) const {
+    static const std::vector<uint32_t> capacities = [] {
+        std::vector<uint32_t> result;
+        for (uint32_t depth = 0; depth < kMaxLevels; ++depth) {
+            result.push_back(CapacityOfDepth(depth, kK, kMinCapacity));
+        }
+        return result;
+    }();
+    return capacities[level_cnt_ - 1 - level];
+}
+
+void KllSketch::AddLevel() {
+    levels_[level_cnt_ + 1] = levels_[level_cnt_];
+    level_cnt_++;
+}
+
+void KllSketch::Insert(uint32_t level, double value) {
+    // levels below move one slot towards the free space
+    uint32_t begin = levels_[0];
+    uint32_t pos = levels_[level];
+    std::copy(items_ + begin, items_ + pos, items_ + begin - 1);
+    for (uint32_t i = 0; i <= level; ++i) {
+        levels_[i]--;
+    }
+    items_[pos - 1] = value;
+}
+
+bool KllSketch::RandomBit() {
+    random_ ^= random_ << 13;
+    random_ ^= random_ >> 7;
+    random_ ^= random_ << 17;
+    return random_ & 1;
+}
+
+void KllSketch::Add(double value) {
+    if (isnan(value)) {
+        return;
+    }
+    if (nullptr == items_) {
+        items_ = AllocArenaArray<double>(kBufferSize);
+        level_cnt_ = 1;
+        levels_[0] = levels_[1] = kBufferSize;
+        min_ = max_ = value;
+    }
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+    count_++;
+    Insert(0, value);
+    if (LevelSize(0) >= LevelCapacity(0)) {
+        Compress();
+    }
+}
+
+void KllSketch::Merge(const KllSketch& other) {
+    if (0 == other.count_) {
+        return;
+    }
+    if (nullptr == items_) {
+        items_ = AllocArenaArray<double>(kBufferSize);
+        level_cnt_ = 1;
+        levels_[0] = levels_[1] = kBufferSize;
+        min_ = other.min_;
+        max_ = other.max_;
+    }
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+    count_ += other.count_;
+    for (uint32_t level = 0; level < other.level_cnt_; ++level) {
+        while (level >= level_cnt_) {
+            AddLevel();
+        }
+        for (uint32_t i = other.levels_[level]; i < other.levels_[level + 1];
+             ++i) {
+            if (0 == levels_[0]) {
+                Compress();
+            }
+            Insert(level, other.items_[i]);
+        }
+    }
+    Compress();
+}
+
+void KllSketch::Compress() {
+    // compact the lowest full level until all levels are under capacity
+    while (true) {
+        uint32_t level = 0;
+        while (level < level_cnt_ && LevelSize(level) < LevelCapacity(level)) {
+            level++;
+        }
+        if (level == level_cnt_) {
+            return;
+        }
+        Compact(level);
+    }
+}
+
+void KllSketch::Compact(uint32_t level) {
+    if (level + 1 == level_cnt_) {
+        AddLevel();
+    }
+    uint32_t begin = levels_[level];
+    uint32_t end = levels_[level + 1];
+    std::sort(items_ + begin, items_ + end);
+    uint32_t odd = (end - begin) & 1;
+    uint32_t half = (end - begin) / 2;
+    uint32_t offset = RandomBit() ? 1 : 0;
+    // promote every other item to the front of next level, from back to
+    // front so that no item is overwritten before it is promoted
+    for (uint32_t i = half; i > 0; --i) {
+        items_[end - half + i - 1] = items_[begin + odd + 2 * (i - 1) + offset];
+    }
+    // the smallest item of odd size stays
+    if (1 == odd) {
+        items_[end - half - 1] = items_[begin];
+    }
+    // levels below move into the freed space
+    std::copy_backward(items_ + levels_[0], items_ + begin,
+                       items_ + begin + half);
+    for (uint32_t i = 0; i < level; ++i) {
+        levels_[i] += half;
+    }
+    levels_[level] = end - half - odd;
+    levels_[level + 1] = end - half;
+}
+
+double KllSketch::Quantile(double fraction) const {
+    if (0 == count_) {
+        return NAN;
+    }
+    if (fraction <= 0) {
+        return min_;
+    }
+    if (fraction >= 1) {
+        return max_;
+    }
+    std::vector<std::pair<double, uint64_t>> items;
+    items.reserve(levels_[level_cnt_] - levels_[0]);
+    for (uint32_t level = 0; level < level_cnt_; ++level) {
+        for (uint32_t i = levels_[level]; i < levels_[level + 1]; ++i) {
+            items.push_back(std::make_pair(items_[i], 1ULL << level));
+        }
+    }
+    std::sort(items.begin(), items.end());
+    double rank = fraction * count_;
+    uint64_t weight = 0;
+    for (auto& item : items) {
+        weight += item.second;
+        if (weight >= rank) {
+            return item.first;
+        }
+    }
+    return max_;
+}
+
+}  // namespace container
+}  // namespace udf
+}  // namespace hybridse
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_UDF_SKETCHES_H_
+#define SRC_UDF_SKETCHES_H_
+
+#include <stdint.h>
+
+namespace hybridse {
+namespace udf {
+namespace container {
+
+/**
+ * HyperLogLog sketch of distinct count with 2^precision one byte registers.
+ * As HyperLogLog++, values are hashed into 64 bits so that no large range
+ * correction is needed, and small cardinalities are estimated by linear
+ * counting. Relative standard error is about 1.04 / sqrt(2^precision).
+ *
+ * Registers are allocated from JIT runtime memory on the first hash, so a
+ * sketch must not outlive the run step where it is built.
+ */
+class HyperLogLog {
+ public:
+    static const int32_t kMinPrecision = 4;
+    static const int32_t kMaxPrecision = 16;
+    static const int32_t kDefaultPrecision = 12;
+
+    HyperLogLog() : registers_(nullptr), precision_(0) {}
+
+    // Add a hashed value, precision is clamped and fixed by the first one
+    void Add(uint64_t hash, int32_t precision = kDefaultPrecision);
+
+    // Merge sketch of the same precision into this one
+    bool Merge(const HyperLogLog& other);
+
+    int64_t Estimate() const;
+
+    int32_t precision() const { return precision_; }
+
+ private:
+    void Allocate(int32_t precision);
+
+    uint8_t* registers_;
+    int32_t precision_;
+};
+
+/**
+ * KLL sketch of quantiles over doubles. Items are kept in compactors of
+ * levels, an item of level h stands for 2^h inputs. Once a level is full,
+ * it is sorted and every other item, from a random offset, is promoted to
+ * the next level. Capacities decay by 2/3 from the top level down, so that
+ * at most about 3k items are kept however many values are added, and the
+ * rank error is about 1.7 / k.
+ *
+ * All levels share one buffer allocated from JIT runtime memory on the
+ * first value, free space in front, level 0 next and higher levels after.
+ * A sketch must not outlive the run step where it is built.
+ */
+class KllSketch {
+ public:
+    static const uint32_t kK = 200;
+
+    KllSketch();
+
+    // Add a value, nan is ignored
+    void Add(double value);
+
+    // Merge another sketch into this one
+    void Merge(const KllSketch& other);
+
+    // Value of the given rank fraction in [0, 1], nan if empty
+    double Quantile(double fraction) const;
+
+    uint64_t count() const { return count_; }
+
+ private:
+    static const uint32_t kMaxLevels = 64;
+    static const uint32_t kMinCapacity = 2;
+    // bound of items of all levels, each below its capacity, plus one
+    static const uint32_t kBufferSize = 3 * kK + kMinCapacity * kMaxLevels + 1;
+
+    uint32_t LevelCapacity(uint32_t level) const;
+    uint32_t LevelSize(uint32_t level) const {
+        return levels_[level + 1] - levels_[level];
+    }
+    void AddLevel();
+    // Insert value into level, space must be available
+    void Insert(uint32_t level, double value);
+    void Compress();
+    void Compact(uint32_t level);
+    bool RandomBit();
+
+    double* items_;
+    // start of levels in buffer, levels_[level_cnt_] is buffer end
+    uint32_t levels_[kMaxLevels + 1];
+    uint32_t level_cnt_;
+    uint64_t count_;
+    double min_;
+    double max_;
+    uint64_t random_;
+};
+
+}  // namespace container
+}  // namespace udf
+}  // namespace hybridse
+#endif  // SRC_UDF_SKETCHES_H_
@@ -0,0 +1,135 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "udf/sketches.h"
+#include <math.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+#include "gtest/gtest.h"
+#include "udf/containers.h"
+#include "vm/jit_runtime.h"
+
+namespace hybridse {
+namespace udf {
+namespace container {
+
+class SketchesTest : public ::testing::Test {
+ public:
+    ~SketchesTest() { vm::JitRuntime::get()->ReleaseRunStep(); }
+
+    static uint64_t Hash(int64_t value) {
+        return ContainerKeyTrait<int64_t>::Hash(value);
+    }
+};
+
+TEST_F(SketchesTest, HyperLogLogTest) {
+    HyperLogLog empty;
+    ASSERT_EQ(0, empty.Estimate());
+
+    for (int32_t precision : {4, 10, 12, 16}) {
+        double error = 1.04 / sqrt(1 << precision);
+        for (int64_t cnt : {1, 10, 1000, 100000}) {
+            HyperLogLog hll;
+            // every value added twice
+            for (int64_t i = 0; i < cnt * 2; ++i) {
+                hll.Add(Hash(i % cnt), precision);
+            }
+            ASSERT_EQ(precision, hll.precision());
+            ASSERT_NEAR(cnt, hll.Estimate(), std::max(cnt * 4 * error, 1.0))
+                << "precision " << precision;
+        }
+    }
+    // precision is clamped
+    HyperLogLog hll;
+    hll.Add(Hash(0), 100);
+    ASSERT_EQ(HyperLogLog::kMaxPrecision, hll.precision());
+}
+
+TEST_F(SketchesTest, HyperLogLogMergeTest) {
+    HyperLogLog left;
+    HyperLogLog right;
+    HyperLogLog all;
+    for (int64_t i = 0; i < 50000; ++i) {
+        left.Add(Hash(i));
+        right.Add(Hash(i + 25000));
+        all.Add(Hash(i));
+        all.Add(Hash(i + 25000));
+    }
+    HyperLogLog merged;
+    ASSERT_TRUE(merged.Merge(left));
+    ASSERT_TRUE(merged.Merge(right));
+    ASSERT_EQ(all.Estimate(), merged.Estimate());
+
+    HyperLogLog other;
+    other.Add(Hash(0), 10);
+    ASSERT_FALSE(merged.Merge(other));
+}
+
+TEST_F(SketchesTest, KllSketchTest) {
+    KllSketch empty;
+    ASSERT_TRUE(isnan(empty.Quantile(0.5)));
+
+    for (int64_t cnt : {1, 10, 1000, 1000000}) {
+        std::vector<double> values;
+        for (int64_t i = 0; i < cnt; ++i) {
+            values.push_back(i);
+        }
+        srand(cnt);
+        std::random_shuffle(values.begin(), values.end());
+        KllSketch kll;
+        for (double value : values) {
+            kll.Add(value);
+        }
+        kll.Add(NAN);
+        ASSERT_EQ(static_cast<uint64_t>(cnt), kll.count());
+        ASSERT_EQ(0, kll.Quantile(0));
+        ASSERT_EQ(cnt - 1, kll.Quantile(1));
+        for (double fraction : {0.01, 0.25, 0.5, 0.75, 0.99}) {
+            // rank error of value i is |i / cnt - fraction|
+            ASSERT_NEAR(fraction * cnt, kll.Quantile(fraction),
+                        std::max(cnt * 0.02, 1.0))
+                << "count " << cnt << " fraction " << fraction;
+        }
+    }
+}
+
+TEST_F(SketchesTest, KllSketchMergeTest) {
+    KllSketch left;
+    KllSketch right;
+    for (int64_t i = 0; i < 100000; ++i) {
+        left.Add(i);
+        right.Add(i + 100000);
+    }
+    KllSketch merged;
+    merged.Merge(left);
+    merged.Merge(right);
+    ASSERT_EQ(200000u, merged.count());
+    ASSERT_EQ(0, merged.Quantile(0));
+    ASSERT_EQ(199999, merged.Quantile(1));
+    for (double fraction : {0.1, 0.5, 0.9}) {
+        ASSERT_NEAR(fraction * 200000, merged.Quantile(fraction), 4000);
+    }
+}
+
+}  // namespace container
+}  // namespace udf
+}  // namespace hybridse
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -52,6 +52,14 @@ void CheckUdfFail(const std::string &name, T expect, Args... args) {
     ASSERT_FALSE(function.valid());
 }
 
+template <class T>
+ListRef<T> MakeListFromVector(const std::vector<T> &vec) {
+    ListRef<T> list_ref;
+    list_ref.list = reinterpret_cast<int8_t *>(
+        new codec::ArrayListV<T>(new std::vector<T>(vec)));
+    return list_ref;
+}
+
 TEST_F(UdafTest, sum_where_test) {
     CheckUdf<int32_t, ListRef<int32_t>, ListRef<bool>>(
         "sum_where", 10, MakeList<int32_t>({4, 5, 6}),
@@ -194,6 +202,107 @@ TEST_F(UdafTest, topk_test) {
         "top", StringRef(""), MakeList<int32_t>({}), MakeList<int32_t>({}));
 }
 
+TEST_F(UdafTest, topk_many_values_test) {
+    // values 0 ~ 99 occur 4 times, others 3 times, smallest values are
+    // dropped during update
+    std::vector<int32_t> values;
+    for (int32_t i = 0; i < 1000; ++i) {
+        values.push_back(i % 300);
+    }
+    CheckUdf<StringRef, ListRef<int32_t>, ListRef<int32_t>>(
+        "top", StringRef("299,299,299,298,298"), MakeListFromVector(values),
+        MakeListFromVector(std::vector<int32_t>(values.size(), 5)));
+    CheckUdf<StringRef, ListRef<int32_t>, ListRef<int32_t>>(
+        "top", StringRef(""), MakeListFromVector(values),
+        MakeListFromVector(std::vector<int32_t>(values.size(), 0)));
+}
+
+TEST_F(UdafTest, distinct_count_test) {
+    CheckUdf<int64_t, ListRef<int32_t>>("distinct_count", 3,
+                                        MakeList<int32_t>({1, 2, 2, 3, 1}));
+    CheckUdf<int64_t, ListRef<double>>("distinct_count", 2,
+                                       MakeList<double>({0.0, -0.0, 1.5}));
+    CheckUdf<int64_t, ListRef<StringRef>>(
+        "distinct_count", 2,
+        MakeList<StringRef>({StringRef("a"), StringRef("b"), StringRef("a")}));
+    CheckUdf<int64_t, ListRef<Timestamp>>(
+        "distinct_count", 2,
+        MakeList<Timestamp>({Timestamp(1), Timestamp(2), Timestamp(1)}));
+    CheckUdf<int64_t, ListRef<int32_t>>("distinct_count", 0,
+                                        MakeList<int32_t>({}));
+
+    std::vector<int64_t> values;
+    for (int64_t i = 0; i < 1000; ++i) {
+        values.push_back(i % 300);
+    }
+    CheckUdf<int64_t, ListRef<int64_t>>("distinct_count", 300,
+                                        MakeListFromVector(values));
+}
+
+TEST_F(UdafTest, approx_distinct_test) {
+    CheckUdf<int64_t, ListRef<int32_t>>("approx_distinct", 3,
+                                        MakeList<int32_t>({1, 2, 2, 3, 1}));
+    CheckUdf<int64_t, ListRef<Nullable<StringRef>>>(
+        "approx_distinct", 2,
+        MakeList<Nullable<StringRef>>(
+            {StringRef("a"), nullptr, StringRef("b"), StringRef("a")}));
+    CheckUdf<int64_t, ListRef<int32_t>>("approx_distinct", 0,
+                                        MakeList<int32_t>({}));
+
+    std::vector<int64_t> values;
+    for (int64_t i = 0; i < 100000; ++i) {
+        values.push_back(i % 20000);
+    }
+    // standard error is 1.04 / sqrt(2^14)
+    auto function = udf::UdfFunctionBuilder("approx_distinct")
+                        .args<ListRef<int64_t>, ListRef<int32_t>>()
+                        .returns<int64_t>()
+                        .build();
+    ASSERT_TRUE(function.valid());
+    ASSERT_NEAR(20000,
+                function(MakeListFromVector(values),
+                         MakeListFromVector(
+                             std::vector<int32_t>(values.size(), 14))),
+                20000 * 0.04);
+}
+
+TEST_F(UdafTest, approx_percentile_test) {
+    CheckUdf<double, ListRef<int32_t>, ListRef<double>>(
+        "approx_percentile", 3, MakeList<int32_t>({5, 1, 4, 2, 3}),
+        MakeList<double>({0.5, 0.5, 0.5, 0.5, 0.5}));
+    CheckUdf<double, ListRef<int32_t>, ListRef<double>>(
+        "approx_percentile", 1, MakeList<int32_t>({5, 1, 4, 2, 3}),
+        MakeList<double>({0, 0, 0, 0, 0}));
+    CheckUdf<double, ListRef<Nullable<int64_t>>, ListRef<double>>(
+        "approx_percentile", 5,
+        MakeList<Nullable<int64_t>>({5, 1, nullptr, 4, 2, 3}),
+        MakeList<double>({0.9, 0.9, 0.9, 0.9, 0.9, 0.9}));
+    CheckUdf<double, ListRef<double>>("approx_median", 2.5,
+                                      MakeList<double>({1.5, 3.5, 2.5}));
+    // empty or all null input
+    CheckUdf<Nullable<double>, ListRef<double>>("approx_median", nullptr,
+                                                MakeList<double>({}));
+    CheckUdf<Nullable<double>, ListRef<Nullable<int32_t>>, ListRef<double>>(
+        "approx_percentile", nullptr,
+        MakeList<Nullable<int32_t>>({nullptr, nullptr}),
+        MakeList<double>({0.5, 0.5}));
+
+    std::vector<int32_t> values;
+    for (int32_t i = 0; i < 100000; ++i) {
+        values.push_back((i * 7919) % 100000);
+    }
+    auto function = udf::UdfFunctionBuilder("approx_percentile")
+                        .args<ListRef<int32_t>, ListRef<double>>()
+                        .returns<double>()
+                        .build();
+    ASSERT_TRUE(function.valid());
+    ASSERT_NEAR(99000,
+                function(MakeListFromVector(values),
+                         MakeListFromVector(
+                             std::vector<double>(values.size(), 0.99))),
+                2000);
+}
+
 TEST_F(UdafTest, sum_cate_test) {
     CheckUdf<StringRef, ListRef<int32_t>, ListRef<int32_t>>(
         "sum_cate", StringRef("1:4,2:6"), MakeList<int32_t>({1, 2, 3, 4}),
@@ -572,6 +681,23 @@ TEST_F(UdafTest, top_n_key_count_cate_where_test) {
                                MakeList<int32_t>({}), MakeList<int32_t>({}));
 }
 
+TEST_F(UdafTest, top_n_key_count_cate_where_many_keys_test) {
+    // keys 0 ~ 99 occur 4 times, others 3 times, smallest keys are dropped
+    // during update
+    std::vector<int32_t> keys;
+    for (int32_t i = 0; i < 1000; ++i) {
+        keys.push_back(i % 300);
+    }
+    ListRef<bool> conds;
+    conds.list = reinterpret_cast<int8_t *>(
+        new codec::BoolArrayListV(new std::vector<int>(keys.size(), 1)));
+    CheckUdf<StringRef, ListRef<int32_t>, ListRef<bool>, ListRef<int32_t>,
+             ListRef<int32_t>>(
+        "top_n_key_count_cate_where", StringRef("299:3,298:3"),
+        MakeListFromVector(keys), conds, MakeListFromVector(keys),
+        MakeListFromVector(std::vector<int32_t>(keys.size(), 2)));
+}
+
 TEST_F(UdafTest, top_n_key_sum_cate_where_test) {
     CheckUdf<StringRef, ListRef<int32_t>, ListRef<bool>, ListRef<int32_t>,
              ListRef<int32_t>>(
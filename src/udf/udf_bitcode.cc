@@ -0,0 +1,263 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "udf/udf_bitcode.h"
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "glog/logging.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/Support/DynamicLibrary.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+namespace hybridse {
+namespace udf {
+
+static ::llvm::MemoryBufferRef UdfBitcodeBuffer() {
+    return ::llvm::MemoryBufferRef(
+        ::llvm::StringRef(reinterpret_cast<const char*>(kUdfBitcode),
+                          kUdfBitcodeSize),
+        "udf_bitcode");
+}
+
+static bool IsResolvedInProcess(const ::llvm::GlobalValue* gv) {
+    return nullptr != ::llvm::sys::DynamicLibrary::SearchForAddressOfSymbol(
+                          gv->getName().str());
+}
+
+/**
+ * Check whether definitions of bitcode can be copied into sql modules.
+ * A global value is copyable if it is a function or a constant, and all
+ * global values it refers to are copyable or resolved in process.
+ */
+class BitcodeChecker {
+ public:
+    bool IsCopyable(const ::llvm::GlobalValue* gv) {
+        auto iter = state_.find(gv);
+        if (iter != state_.end()) {
+            // value on current path is assumed copyable
+            return kNotCopyable != iter->second;
+        }
+        state_[gv] = kChecking;
+        bool copyable = Check(gv);
+        state_[gv] = copyable ? kCopyable : kNotCopyable;
+        return copyable;
+    }
+
+ private:
+    enum State { kChecking, kCopyable, kNotCopyable };
+
+    bool Check(const ::llvm::GlobalValue* gv) {
+        if (gv->isDeclaration()) {
+            auto fn = ::llvm::dyn_cast<::llvm::Function>(gv);
+            return (fn != nullptr && fn->isIntrinsic()) ||
+                   IsResolvedInProcess(gv);
+        }
+        if (gv->isThreadLocal()) {
+            return false;
+        }
+        if (auto alias = ::llvm::dyn_cast<::llvm::GlobalAlias>(gv)) {
+            return CheckConstant(alias->getAliasee());
+        }
+        if (auto var = ::llvm::dyn_cast<::llvm::GlobalVariable>(gv)) {
+            // a copy of mutable state would be separated from the process
+            return var->isConstant() && CheckConstant(var->getInitializer());
+        }
+        auto fn = ::llvm::dyn_cast<::llvm::Function>(gv);
+        if (fn == nullptr) {
+            return false;
+        }
+        if (fn->hasPersonalityFn() &&
+            !CheckConstant(fn->getPersonalityFn())) {
+            return false;
+        }
+        for (auto& block : *fn) {
+            for (auto& inst : block) {
+                for (auto& operand : inst.operands()) {
+                    auto constant = ::llvm::dyn_cast<::llvm::Constant>(operand);
+                    if (constant != nullptr && !CheckConstant(constant)) {
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    bool CheckConstant(const ::llvm::Constant* constant) {
+        if (auto gv = ::llvm::dyn_cast<::llvm::GlobalValue>(constant)) {
+            return IsCopyable(gv);
+        }
+        for (auto& operand : constant->operands()) {
+            auto sub = ::llvm::dyn_cast<::llvm::Constant>(operand);
+            if (sub != nullptr && !CheckConstant(sub)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::map<const ::llvm::GlobalValue*, State> state_;
+};
+
+// Names of copyable udf definitions in bitcode, keyed by their addresses
+// in process
+static std::unordered_map<void*, std::string> BuildBitcodeIndex() {
+    std::unordered_map<void*, std::string> index;
+    if (0 == kUdfBitcodeSize) {
+        return index;
+    }
+    ::llvm::sys::DynamicLibrary::LoadLibraryPermanently(nullptr);
+    ::llvm::LLVMContext llvm_ctx;
+    auto module = ::llvm::parseBitcodeFile(UdfBitcodeBuffer(), llvm_ctx);
+    if (!module) {
+        LOG(WARNING) << "fail to parse udf bitcode: "
+                     << ::llvm::toString(module.takeError());
+        return index;
+    }
+    BitcodeChecker checker;
+    for (auto& fn : **module) {
+        if (fn.isDeclaration() || fn.hasLocalLinkage()) {
+            continue;
+        }
+        void* addr = ::llvm::sys::DynamicLibrary::SearchForAddressOfSymbol(
+            fn.getName().str());
+        if (addr != nullptr && checker.IsCopyable(&fn)) {
+            index.insert(std::make_pair(addr, fn.getName().str()));
+        }
+    }
+    DLOG(INFO) << "udf bitcode index " << index.size() << " functions";
+    return index;
+}
+
+static const std::unordered_map<void*, std::string>& GetBitcodeIndex() {
+    static const std::unordered_map<void*, std::string> index =
+        BuildBitcodeIndex();
+    return index;
+}
+
+// Pointer arguments are compatible whatever they point to, the struct
+// types of codegen and clang are named differently
+static bool IsCompatibleType(::llvm::Type* l, ::llvm::Type* r) {
+    return l == r || (l->isPointerTy() && r->isPointerTy());
+}
+
+static bool IsCompatibleFunction(::llvm::FunctionType* l,
+                                 ::llvm::FunctionType* r) {
+    if (l->isVarArg() || r->isVarArg() ||
+        l->getNumParams() != r->getNumParams() ||
+        !IsCompatibleType(l->getReturnType(), r->getReturnType())) {
+        return false;
+    }
+    for (unsigned i = 0; i < l->getNumParams(); ++i) {
+        if (!IsCompatibleType(l->getParamType(i), r->getParamType(i))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t LinkUdfBitcode(const UdfLibrary& library, ::llvm::Module* m) {
+    const auto& index = GetBitcodeIndex();
+    if (index.empty() || m == nullptr) {
+        return 0;
+    }
+    // called external udfs, with names of their bitcode definitions
+    std::vector<std::pair<::llvm::Function*, std::string>> udfs;
+    for (auto& fn : *m) {
+        if (!fn.isDeclaration() || fn.use_empty()) {
+            continue;
+        }
+        void* addr = library.GetExternalFunction(fn.getName().str());
+        auto iter = addr == nullptr ? index.end() : index.find(addr);
+        if (iter != index.end()) {
+            udfs.push_back(std::make_pair(&fn, iter->second));
+        }
+    }
+    if (udfs.empty()) {
+        return 0;
+    }
+    auto bitcode =
+        ::llvm::getLazyBitcodeModule(UdfBitcodeBuffer(), m->getContext());
+    if (!bitcode) {
+        LOG(WARNING) << "fail to load udf bitcode: "
+                     << ::llvm::toString(bitcode.takeError());
+        return 0;
+    }
+    std::unique_ptr<::llvm::Module> bitcode_module = std::move(*bitcode);
+    // sql module takes data layout of jit later
+    bitcode_module->setDataLayout(m->getDataLayout());
+    bitcode_module->setTargetTriple(m->getTargetTriple());
+
+    std::set<std::string> defined;
+    for (auto& gv : m->global_values()) {
+        if (!gv.isDeclaration()) {
+            defined.insert(gv.getName().str());
+        }
+    }
+    size_t linked = 0;
+    for (auto& udf : udfs) {
+        ::llvm::Function* fn = udf.first;
+        ::llvm::Function* def = bitcode_module->getFunction(udf.second);
+        if (def == nullptr ||
+            !IsCompatibleFunction(fn->getFunctionType(),
+                                  def->getFunctionType())) {
+            continue;
+        }
+        ::llvm::Function* decl = m->getFunction(udf.second);
+        if (decl == nullptr) {
+            decl = ::llvm::Function::Create(def->getFunctionType(),
+                                            ::llvm::Function::ExternalLinkage,
+                                            udf.second, m);
+        }
+        // declaration under bitcode name is resolved in process even if
+        // linking fails
+        fn->replaceAllUsesWith(
+            ::llvm::ConstantExpr::getBitCast(decl, fn->getType()));
+        fn->eraseFromParent();
+        linked++;
+    }
+    if (0 == linked) {
+        return 0;
+    }
+    if (::llvm::Linker::linkModules(*m, std::move(bitcode_module),
+                                    ::llvm::Linker::Flags::LinkOnlyNeeded)) {
+        LOG(WARNING) << "fail to link udf bitcode into module";
+        return 0;
+    }
+    for (auto& gv : m->global_values()) {
+        if (!gv.isDeclaration() && defined.find(gv.getName().str()) ==
+                                       defined.end()) {
+            gv.setLinkage(::llvm::GlobalValue::InternalLinkage);
+            gv.setVisibility(::llvm::GlobalValue::DefaultVisibility);
+            if (auto go = ::llvm::dyn_cast<::llvm::GlobalObject>(&gv)) {
+                go->setComdat(nullptr);
+            }
+        }
+    }
+    DLOG(INFO) << "link " << linked << " udfs from bitcode";
+    return linked;
+}
+
+}  // namespace udf
+}  // namespace hybridse
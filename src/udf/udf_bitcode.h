@@ -0,0 +1,48 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_UDF_UDF_BITCODE_H_
+#define SRC_UDF_UDF_BITCODE_H_
+
+#include <stddef.h>
+#include "llvm/IR/Module.h"
+#include "udf/udf_library.h"
+
+namespace hybridse {
+namespace udf {
+
+// Builtin udfs of udf.cc compiled into llvm bitcode by build, empty if
+// the build has no clang of the same llvm version
+extern const unsigned char kUdfBitcode[];
+extern const size_t kUdfBitcodeSize;
+
+/**
+ * Replace calls of external udfs of `library` in module `m` with their
+ * definitions in udf bitcode, so that llvm is able to inline them into
+ * callers. Copied definitions are internal to `m`.
+ *
+ * A udf is linked only if its definition and everything it refers to is
+ * either copyable or resolved in current process: udfs using mutable
+ * globals, e.g. memory pool of string allocation, stay external calls, so
+ * do all udfs if process symbols are not exported.
+ *
+ * Return the number of udfs linked.
+ */
+size_t LinkUdfBitcode(const UdfLibrary& library, ::llvm::Module* m);
+
+}  // namespace udf
+}  // namespace hybridse
+#endif  // SRC_UDF_UDF_BITCODE_H_
@@ -0,0 +1,93 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "udf/udf_bitcode.h"
+#include <stdint.h>
+#include <memory>
+#include <utility>
+#include "gtest/gtest.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/Support/TargetSelect.h"
+#include "udf/default_udf_library.h"
+#include "udf/udf.h"
+#include "vm/jit_wrapper.h"
+
+namespace hybridse {
+namespace udf {
+
+class UdfBitcodeTest : public ::testing::Test {};
+
+// call_year(ts) = year.int64(ts)
+static std::unique_ptr<::llvm::Module> BuildCallYear(
+    ::llvm::LLVMContext* ctx) {
+    auto m = std::unique_ptr<::llvm::Module>(
+        new ::llvm::Module("udf_bitcode_test", *ctx));
+    ::llvm::IRBuilder<> builder(*ctx);
+    auto fn_ty = ::llvm::FunctionType::get(builder.getInt32Ty(),
+                                           {builder.getInt64Ty()}, false);
+    auto year = ::llvm::Function::Create(
+        fn_ty, ::llvm::Function::ExternalLinkage, "year.int64", m.get());
+    auto fn = ::llvm::Function::Create(
+        fn_ty, ::llvm::Function::ExternalLinkage, "call_year", m.get());
+    builder.SetInsertPoint(::llvm::BasicBlock::Create(*ctx, "entry", fn));
+    builder.CreateRet(builder.CreateCall(year, {&*fn->arg_begin()}));
+    return m;
+}
+
+TEST_F(UdfBitcodeTest, LinkExternalUdfTest) {
+    auto library = DefaultUdfLibrary::get();
+    ASSERT_EQ(reinterpret_cast<void*>(
+                  static_cast<int32_t (*)(int64_t)>(v1::year)),
+              library->GetExternalFunction("year.int64"));
+    ASSERT_EQ(nullptr, library->GetExternalFunction("not_exist.int64"));
+
+    auto ctx = std::unique_ptr<::llvm::LLVMContext>(new ::llvm::LLVMContext());
+    auto m = BuildCallYear(ctx.get());
+    size_t linked = LinkUdfBitcode(*library, m.get());
+    if (kUdfBitcodeSize > 0) {
+        // test binary exports its symbols, year is copyable from bitcode
+        ASSERT_EQ(1u, linked);
+        ASSERT_EQ(nullptr, m->getFunction("year.int64"));
+    } else {
+        ASSERT_EQ(0u, linked);
+    }
+
+    vm::JitOptions jit_options;
+    jit_options.set_opt_level(3);
+    auto jit = std::unique_ptr<vm::HybridSeJitWrapper>(
+        vm::HybridSeJitWrapper::Create(jit_options));
+    ASSERT_TRUE(jit->Init());
+    ASSERT_TRUE(vm::HybridSeJitWrapper::InitJitSymbols(jit.get()));
+    ASSERT_TRUE(jit->OptModule(m.get()));
+    ASSERT_TRUE(jit->AddModule(std::move(m), std::move(ctx)));
+    auto call_year = reinterpret_cast<int32_t (*)(int64_t)>(
+        const_cast<int8_t*>(jit->FindFunction("call_year")));
+    ASSERT_TRUE(call_year != nullptr);
+    for (int64_t ts : {0L, 1590115420000L, 1609459199999L, 1609459200000L}) {
+        ASSERT_EQ(v1::year(ts), call_year(ts));
+    }
+}
+
+}  // namespace udf
+}  // namespace hybridse
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+    return RUN_ALL_TESTS();
+}
@@ -139,6 +139,18 @@ void UdfLibrary::SetIsUdaf(const std::string& name, size_t args) {
     iter->second->udaf_arg_nums.insert(args);
 }
 
+UdafIncrementalKind UdfLibrary::GetUdafIncrementalKind(
+    const std::string& name) const {
+    auto iter = udaf_incremental_.find(GetCanonicalName(name));
+    return iter == udaf_incremental_.end() ? kUdafNonIncremental
+                                           : iter->second;
+}
+
+void UdfLibrary::SetUdafIncrementalKind(const std::string& name,
+                                        UdafIncrementalKind kind) {
+    udaf_incremental_[GetCanonicalName(name)] = kind;
+}
+
 bool UdfLibrary::RequireListAt(const std::string& name, size_t index) const {
     std::string canonical_name = GetCanonicalName(name);
     auto entry_iter = table_.find(canonical_name);
@@ -312,6 +324,11 @@ void UdfLibrary::AddExternalFunction(const std::string& name, void* addr) {
     external_symbols_.insert(std::make_pair(name, addr));
 }
 
+void* UdfLibrary::GetExternalFunction(const std::string& name) const {
+    auto iter = external_symbols_.find(name);
+    return iter == external_symbols_.end() ? nullptr : iter->second;
+}
+
 void UdfLibrary::InitJITSymbols(vm::HybridSeJitWrapper* jit_ptr) {
     for (auto& pair : external_symbols_) {
         jit_ptr->AddExternalFunction(pair.first, pair.second);
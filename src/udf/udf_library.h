@@ -68,6 +68,22 @@ class ExprUdfTemplateRegistryHelper;
 
 struct UdfLibraryEntry;
 
+/**
+ * Add and retract hooks of an udaf over one numeric column, which window
+ * aggregation applies on a state kept outside compiled code as rows enter
+ * and leave the window, instead of rescanning the window. Compiled update
+ * functions can't retract rows, so udafs without hooks are always computed
+ * over the whole window.
+ */
+enum UdafIncrementalKind {
+    kUdafNonIncremental = 0,
+    kUdafIncrementalSum,
+    kUdafIncrementalCount,
+    kUdafIncrementalAvg,
+    kUdafIncrementalMin,
+    kUdafIncrementalMax,
+};
+
 /**
  * Hold global udf registry entries.
  * "fn(arg0, arg1, ...argN)" -> some expression
@@ -101,6 +117,10 @@ class UdfLibrary {
     bool IsUdaf(const std::string& name, size_t args) const;
     void SetIsUdaf(const std::string& name, size_t args);
 
+    UdafIncrementalKind GetUdafIncrementalKind(const std::string& name) const;
+    void SetUdafIncrementalKind(const std::string& name,
+                                UdafIncrementalKind kind);
+
     bool RequireListAt(const std::string& name, size_t index) const;
     bool IsListReturn(const std::string& name) const;
 
@@ -134,6 +154,8 @@ class UdfLibrary {
     }
 
     void AddExternalFunction(const std::string& name, void* addr);
+    // Return address of external function `name`, null if not registered
+    void* GetExternalFunction(const std::string& name) const;
     void InitJITSymbols(vm::HybridSeJitWrapper* jit_ptr);
 
     node::NodeManager* node_manager() { return &nm_; }
@@ -155,6 +177,9 @@ class UdfLibrary {
     // external symbols
     std::unordered_map<std::string, void*> external_symbols_;
 
+    // add and retract hooks of udafs
+    std::unordered_map<std::string, UdafIncrementalKind> udaf_incremental_;
+
     node::NodeManager nm_;
 
     const bool case_sensitive_ = false;
@@ -41,6 +41,24 @@ TEST_F(UdfLibraryTest, test_check_is_udaf_by_name) {
     ASSERT_TRUE(!library.IsUdaf("sum2", 1));
 }
 
+TEST_F(UdfLibraryTest, test_udaf_incremental_kind) {
+    library.RegisterUdaf("sum")
+        .incremental(kUdafIncrementalSum)
+        .templates<int32_t, int32_t, int32_t>()
+        .const_init(0)
+        .update("add", reinterpret_cast<void*>(0))
+        .output("identity", reinterpret_cast<void*>(1));
+    library.RegisterUdaf("first")
+        .templates<int32_t, int32_t, int32_t>()
+        .const_init(0)
+        .update("first", reinterpret_cast<void*>(0))
+        .output("identity", reinterpret_cast<void*>(1));
+
+    ASSERT_EQ(kUdafIncrementalSum, library.GetUdafIncrementalKind("SUM"));
+    ASSERT_EQ(kUdafNonIncremental, library.GetUdafIncrementalKind("first"));
+    ASSERT_EQ(kUdafNonIncremental, library.GetUdafIncrementalKind("sum2"));
+}
+
 TEST_F(UdfLibraryTest, test_check_list_arg) {
     library.RegisterExternal("f1")
         .args<codec::ListRef<int32_t>, int32_t>(reinterpret_cast<void*>(0))
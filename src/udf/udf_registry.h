@@ -1495,6 +1495,13 @@ class UdafRegistryHelper : public UdfRegistryHelper<UdafRegistry> {
         SetAlwaysListAt(index, true);
         return *this;
     }
+
+    // Window aggregation may maintain the udaf by add and retract hooks of
+    // `kind` instead of compiled functions
+    auto& incremental(UdafIncrementalKind kind) {
+        library()->SetUdafIncrementalKind(name(), kind);
+        return *this;
+    }
 };
 
 template <typename OUT, typename ST, typename... IN>
@@ -1862,6 +1869,11 @@ class UdafTemplateRegistryHelper : public UdfRegistryHelper<UdafRegistry> {
         return *this;
     }
 
+    auto& incremental(UdafIncrementalKind kind) {
+        helper_.incremental(kind);
+        return *this;
+    }
+
  private:
     template <typename T>
     int RegisterSingle(UdafRegistryHelper& helper) {  // NOLINT
@@ -16,20 +16,47 @@
 
 #ifndef SRC_VM_CATALOG_WRAPPER_H_
 #define SRC_VM_CATALOG_WRAPPER_H_
+#include <algorithm>
 #include <memory>
 #include <string>
+#include <unordered_set>
 #include <utility>
+#include <vector>
+#include "base/fe_hash.h"
 #include "vm/catalog.h"
 namespace hybridse {
 namespace vm {
 
+// max number of rows computed by one call of block functions
+static const size_t kRowBlockSize = 1024;
+
 class ProjectFun {
  public:
     virtual Row operator()(const Row& row) const = 0;
+    // Project `cnt` rows into `outputs`
+    virtual void operator()(const Row* rows, size_t cnt, Row* outputs) const {
+        for (size_t i = 0; i < cnt; i++) {
+            outputs[i] = operator()(rows[i]);
+        }
+    }
 };
 class PredicateFun {
  public:
     virtual bool operator()(const Row& row) const = 0;
+    // Append position of `rows` satisfying predicate to `sel`
+    virtual void operator()(const Row* rows, size_t cnt,
+                            std::vector<uint32_t>* sel) const {
+        for (size_t i = 0; i < cnt; i++) {
+            if (operator()(rows[i])) {
+                sel->push_back(i);
+            }
+        }
+    }
+};
+class RowKeyFun {
+ public:
+    // Encode `row` into `key`, rows of the same key are duplicates
+    virtual void operator()(const Row& row, std::string* key) const = 0;
 };
 class IteratorProjectWrapper : public RowIterator {
  public:
@@ -85,6 +112,277 @@ class IteratorFilterWrapper : public RowIterator {
     const PredicateFun* predicate_;
 };
 
+/**
+ * Filter rows block by block. Rows of a block are buffered and predicate
+ * computes a selection vector of the whole block in one call. Block size
+ * starts small and doubles up to `kRowBlockSize`, so that a consumer
+ * taking only a few rows does not pay for a large block. Nothing is
+ * filtered before the first seek.
+ */
+class IteratorBlockFilterWrapper : public RowIterator {
+ public:
+    IteratorBlockFilterWrapper(std::unique_ptr<RowIterator> iter,
+                               const PredicateFun* fun)
+        : RowIterator(),
+          iter_(std::move(iter)),
+          predicate_(fun),
+          block_size_(kMinBlockSize),
+          pos_(0) {}
+    virtual ~IteratorBlockFilterWrapper() {}
+    bool Valid() const override { return pos_ < sel_.size(); }
+    void Next() override {
+        if (++pos_ >= sel_.size()) {
+            NextBlock();
+        }
+    }
+    const uint64_t& GetKey() const override { return keys_[sel_[pos_]]; }
+    const Row& GetValue() override { return rows_[sel_[pos_]]; }
+    void Seek(const uint64_t& k) override {
+        iter_->Seek(k);
+        block_size_ = kMinBlockSize;
+        NextBlock();
+    }
+    void SeekToFirst() override {
+        iter_->SeekToFirst();
+        block_size_ = kMinBlockSize;
+        NextBlock();
+    }
+    bool IsSeekable() const override { return iter_->IsSeekable(); }
+
+ private:
+    static const size_t kMinBlockSize = 16;
+
+    // Filter following blocks until some row is selected or input ends
+    void NextBlock() {
+        pos_ = 0;
+        sel_.clear();
+        while (sel_.empty() && iter_->Valid()) {
+            keys_.clear();
+            rows_.clear();
+            while (iter_->Valid() && rows_.size() < block_size_) {
+                keys_.push_back(iter_->GetKey());
+                rows_.push_back(iter_->GetValue());
+                iter_->Next();
+            }
+            predicate_->operator()(rows_.data(), rows_.size(), &sel_);
+            block_size_ = std::min(block_size_ * 2, kRowBlockSize);
+        }
+    }
+
+    std::unique_ptr<RowIterator> iter_;
+    const PredicateFun* predicate_;
+    size_t block_size_;
+    std::vector<uint64_t> keys_;
+    std::vector<Row> rows_;
+    // position of selected rows in current block
+    std::vector<uint32_t> sel_;
+    size_t pos_;
+};
+
+/**
+ * Project rows block by block, so that a block function projects many rows
+ * in one call while only outputs of current block are alive. Block size
+ * grows as `IteratorBlockFilterWrapper` does. Nothing is projected before
+ * the first seek.
+ */
+class IteratorBlockProjectWrapper : public RowIterator {
+ public:
+    IteratorBlockProjectWrapper(std::unique_ptr<RowIterator> iter,
+                                const ProjectFun* fun)
+        : RowIterator(),
+          iter_(std::move(iter)),
+          fun_(fun),
+          block_size_(kMinBlockSize),
+          pos_(0) {}
+    virtual ~IteratorBlockProjectWrapper() {}
+    bool Valid() const override { return pos_ < outputs_.size(); }
+    void Next() override {
+        if (++pos_ >= outputs_.size()) {
+            NextBlock();
+        }
+    }
+    const uint64_t& GetKey() const override { return keys_[pos_]; }
+    const Row& GetValue() override { return outputs_[pos_]; }
+    void Seek(const uint64_t& k) override {
+        iter_->Seek(k);
+        block_size_ = kMinBlockSize;
+        NextBlock();
+    }
+    void SeekToFirst() override {
+        iter_->SeekToFirst();
+        block_size_ = kMinBlockSize;
+        NextBlock();
+    }
+    bool IsSeekable() const override { return iter_->IsSeekable(); }
+
+ private:
+    static const size_t kMinBlockSize = 16;
+
+    void NextBlock() {
+        pos_ = 0;
+        keys_.clear();
+        rows_.clear();
+        while (iter_->Valid() && rows_.size() < block_size_) {
+            keys_.push_back(iter_->GetKey());
+            rows_.push_back(iter_->GetValue());
+            iter_->Next();
+        }
+        outputs_.resize(rows_.size());
+        if (!rows_.empty()) {
+            fun_->operator()(rows_.data(), rows_.size(), outputs_.data());
+        }
+        block_size_ = std::min(block_size_ * 2, kRowBlockSize);
+    }
+
+    std::unique_ptr<RowIterator> iter_;
+    const ProjectFun* fun_;
+    size_t block_size_;
+    std::vector<uint64_t> keys_;
+    std::vector<Row> rows_;
+    std::vector<Row> outputs_;
+    size_t pos_;
+};
+
+/**
+ * Stop after the first `limit` rows, rows behind are never pulled from
+ * input. Limit counts from the first row, so it is not seekable.
+ */
+class IteratorLimitWrapper : public RowIterator {
+ public:
+    IteratorLimitWrapper(std::unique_ptr<RowIterator> iter, uint64_t limit)
+        : RowIterator(), iter_(std::move(iter)), limit_(limit), cnt_(0) {}
+    virtual ~IteratorLimitWrapper() {}
+    bool Valid() const override { return cnt_ < limit_ && iter_->Valid(); }
+    void Next() override {
+        iter_->Next();
+        cnt_++;
+    }
+    const uint64_t& GetKey() const override { return iter_->GetKey(); }
+    const Row& GetValue() override { return iter_->GetValue(); }
+    void Seek(const uint64_t& k) override { SeekToFirst(); }
+    void SeekToFirst() override {
+        iter_->SeekToFirst();
+        cnt_ = 0;
+    }
+    bool IsSeekable() const override { return false; }
+
+ private:
+    std::unique_ptr<RowIterator> iter_;
+    uint64_t limit_;
+    uint64_t cnt_;
+};
+
+/**
+ * Drop rows duplicated with some row before them. Keys of rows met so far
+ * are kept in a hash set, which is cleared once iterator seeks back.
+ * Nothing is read before the first seek.
+ */
+class IteratorDistinctWrapper : public RowIterator {
+ public:
+    IteratorDistinctWrapper(std::unique_ptr<RowIterator> iter,
+                            const RowKeyFun* fun)
+        : RowIterator(),
+          iter_(std::move(iter)),
+          fun_(fun),
+          keys_(),
+          key_(),
+          seeked_(false) {}
+    virtual ~IteratorDistinctWrapper() {}
+    bool Valid() const override { return seeked_ && iter_->Valid(); }
+    void Next() override {
+        iter_->Next();
+        SkipDuplicates();
+    }
+    const uint64_t& GetKey() const override { return iter_->GetKey(); }
+    const Row& GetValue() override { return iter_->GetValue(); }
+    void Seek(const uint64_t& k) override {
+        keys_.clear();
+        iter_->Seek(k);
+        seeked_ = true;
+        SkipDuplicates();
+    }
+    void SeekToFirst() override {
+        keys_.clear();
+        iter_->SeekToFirst();
+        seeked_ = true;
+        SkipDuplicates();
+    }
+    bool IsSeekable() const override { return iter_->IsSeekable(); }
+
+ private:
+    struct KeyHash {
+        size_t operator()(const std::string& key) const {
+            return base::MurmurHash64A(key.data(), static_cast<int>(key.size()),
+                                       0xe17a1465);
+        }
+    };
+
+    // Move to the first row whose key is not met yet and record the key
+    void SkipDuplicates() {
+        while (iter_->Valid()) {
+            key_.clear();
+            fun_->operator()(iter_->GetValue(), &key_);
+            if (keys_.find(key_) == keys_.end()) {
+                keys_.insert(key_);
+                return;
+            }
+            iter_->Next();
+        }
+    }
+
+    std::unique_ptr<RowIterator> iter_;
+    const RowKeyFun* fun_;
+    std::unordered_set<std::string, KeyHash> keys_;
+    std::string key_;
+    bool seeked_;
+};
+
+/**
+ * Iterate rows of several iterators one after another, rows are never
+ * copied.
+ */
+class IteratorConcatWrapper : public RowIterator {
+ public:
+    explicit IteratorConcatWrapper(
+        std::vector<std::unique_ptr<RowIterator>> iters)
+        : RowIterator(), iters_(std::move(iters)), pos_(0) {
+        SeekToFirst();
+    }
+    virtual ~IteratorConcatWrapper() {}
+    bool Valid() const override { return pos_ < iters_.size(); }
+    void Next() override {
+        iters_[pos_]->Next();
+        SkipEnded();
+    }
+    const uint64_t& GetKey() const override { return iters_[pos_]->GetKey(); }
+    const Row& GetValue() override { return iters_[pos_]->GetValue(); }
+    void Seek(const uint64_t& k) override {
+        for (auto& iter : iters_) {
+            iter->Seek(k);
+        }
+        pos_ = 0;
+        SkipEnded();
+    }
+    void SeekToFirst() override {
+        for (auto& iter : iters_) {
+            iter->SeekToFirst();
+        }
+        pos_ = 0;
+        SkipEnded();
+    }
+    bool IsSeekable() const override { return false; }
+
+ private:
+    void SkipEnded() {
+        while (pos_ < iters_.size() && !iters_[pos_]->Valid()) {
+            pos_++;
+        }
+    }
+
+    std::vector<std::unique_ptr<RowIterator>> iters_;
+    size_t pos_;
+};
+
 class WindowIteratorProjectWrapper : public WindowIterator {
  public:
     WindowIteratorProjectWrapper(std::unique_ptr<WindowIterator> iter,
@@ -205,6 +503,7 @@ class PartitionProjectWrapper : public PartitionHandler {
     virtual const OrderType GetOrderType() const {
         return partition_handler_->GetOrderType();
     }
+    bool IsBinaryKey() override { return partition_handler_->IsBinaryKey(); }
     const std::string GetHandlerTypeName() override {
         return "PartitionHandler";
     }
@@ -257,6 +556,7 @@ class PartitionFilterWrapper : public PartitionHandler {
     virtual const OrderType GetOrderType() const {
         return partition_handler_->GetOrderType();
     }
+    bool IsBinaryKey() override { return partition_handler_->IsBinaryKey(); }
     const std::string GetHandlerTypeName() override {
         return "PartitionHandler";
     }
@@ -319,6 +619,33 @@ class TableProjectWrapper : public TableHandler {
     const ProjectFun* fun_;
 };
 
+// Project rows of table block by block while they are iterated
+class TableBlockProjectWrapper : public TableProjectWrapper {
+ public:
+    TableBlockProjectWrapper(std::shared_ptr<TableHandler> table_handler,
+                             const ProjectFun* fun)
+        : TableProjectWrapper(table_handler, fun) {}
+    virtual ~TableBlockProjectWrapper() {}
+
+    std::unique_ptr<RowIterator> GetIterator() override {
+        auto iter = table_hander_->GetIterator();
+        if (!iter) {
+            return std::unique_ptr<RowIterator>();
+        } else {
+            return std::unique_ptr<RowIterator>(
+                new IteratorBlockProjectWrapper(std::move(iter), fun_));
+        }
+    }
+    base::ConstIterator<uint64_t, Row>* GetRawIterator() override {
+        auto iter = table_hander_->GetIterator();
+        if (!iter) {
+            return nullptr;
+        } else {
+            return new IteratorBlockProjectWrapper(std::move(iter), fun_);
+        }
+    }
+};
+
 class TableFilterWrapper : public TableHandler {
  public:
     TableFilterWrapper(std::shared_ptr<TableHandler> table_handler,
@@ -332,8 +659,32 @@ class TableFilterWrapper : public TableHandler {
             return std::unique_ptr<RowIterator>();
         } else {
             return std::unique_ptr<RowIterator>(
-                new IteratorFilterWrapper(std::move(iter), fun_));
+                new IteratorBlockFilterWrapper(std::move(iter), fun_));
+        }
+    }
+    Row At(uint64_t pos) override {
+        auto iter = GetIterator();
+        if (!iter) {
+            return Row();
         }
+        iter->SeekToFirst();
+        while (pos-- > 0 && iter->Valid()) {
+            iter->Next();
+        }
+        return iter->Valid() ? iter->GetValue() : Row();
+    }
+    const uint64_t GetCount() override {
+        auto iter = GetIterator();
+        if (!iter) {
+            return 0;
+        }
+        uint64_t cnt = 0;
+        iter->SeekToFirst();
+        while (iter->Valid()) {
+            cnt++;
+            iter->Next();
+        }
+        return cnt;
     }
     const Types& GetTypes() override { return table_hander_->GetTypes(); }
     const IndexHint& GetIndex() override { return table_hander_->GetIndex(); }
@@ -353,7 +704,7 @@ class TableFilterWrapper : public TableHandler {
         return table_hander_->GetDatabase();
     }
     base::ConstIterator<uint64_t, Row>* GetRawIterator() override {
-        return new IteratorFilterWrapper(
+        return new IteratorBlockFilterWrapper(
             static_cast<std::unique_ptr<RowIterator>>(
                 table_hander_->GetRawIterator()),
             fun_);
@@ -368,6 +719,258 @@ class TableFilterWrapper : public TableHandler {
     const PredicateFun* fun_;
 };
 
+class TableLimitWrapper : public TableHandler {
+ public:
+    TableLimitWrapper(std::shared_ptr<TableHandler> table_handler,
+                      uint64_t limit)
+        : TableHandler(), table_hander_(table_handler), limit_(limit) {}
+    virtual ~TableLimitWrapper() {}
+
+    std::unique_ptr<RowIterator> GetIterator() override {
+        auto iter = table_hander_->GetIterator();
+        if (!iter) {
+            return std::unique_ptr<RowIterator>();
+        } else {
+            return std::unique_ptr<RowIterator>(
+                new IteratorLimitWrapper(std::move(iter), limit_));
+        }
+    }
+    const Types& GetTypes() override { return table_hander_->GetTypes(); }
+    const IndexHint& GetIndex() override { return table_hander_->GetIndex(); }
+    // Rows in limit are not grouped by windows
+    std::unique_ptr<WindowIterator> GetWindowIterator(
+        const std::string& idx_name) override {
+        return std::unique_ptr<WindowIterator>();
+    }
+    const Schema* GetSchema() override { return table_hander_->GetSchema(); }
+    const std::string& GetName() override { return table_hander_->GetName(); }
+    const std::string& GetDatabase() override {
+        return table_hander_->GetDatabase();
+    }
+    base::ConstIterator<uint64_t, Row>* GetRawIterator() override {
+        auto iter = table_hander_->GetIterator();
+        if (!iter) {
+            return nullptr;
+        } else {
+            return new IteratorLimitWrapper(std::move(iter), limit_);
+        }
+    }
+    Row At(uint64_t pos) override {
+        return pos < limit_ ? table_hander_->At(pos) : Row();
+    }
+    const uint64_t GetCount() override {
+        auto iter = GetIterator();
+        if (!iter) {
+            return 0;
+        }
+        uint64_t cnt = 0;
+        iter->SeekToFirst();
+        while (iter->Valid()) {
+            cnt++;
+            iter->Next();
+        }
+        return cnt;
+    }
+    virtual const OrderType GetOrderType() const {
+        return table_hander_->GetOrderType();
+    }
+    std::shared_ptr<TableHandler> table_hander_;
+    uint64_t limit_;
+};
+
+class TableDistinctWrapper : public TableHandler {
+ public:
+    TableDistinctWrapper(std::shared_ptr<TableHandler> table_handler,
+                         const RowKeyFun* fun)
+        : TableHandler(), table_hander_(table_handler), fun_(fun) {}
+    virtual ~TableDistinctWrapper() {}
+
+    std::unique_ptr<RowIterator> GetIterator() {
+        auto iter = table_hander_->GetIterator();
+        if (!iter) {
+            return std::unique_ptr<RowIterator>();
+        } else {
+            return std::unique_ptr<RowIterator>(
+                new IteratorDistinctWrapper(std::move(iter), fun_));
+        }
+    }
+    Row At(uint64_t pos) override {
+        auto iter = GetIterator();
+        if (!iter) {
+            return Row();
+        }
+        iter->SeekToFirst();
+        while (pos-- > 0 && iter->Valid()) {
+            iter->Next();
+        }
+        return iter->Valid() ? iter->GetValue() : Row();
+    }
+    const uint64_t GetCount() override {
+        auto iter = GetIterator();
+        if (!iter) {
+            return 0;
+        }
+        uint64_t cnt = 0;
+        iter->SeekToFirst();
+        while (iter->Valid()) {
+            cnt++;
+            iter->Next();
+        }
+        return cnt;
+    }
+    const Types& GetTypes() override { return table_hander_->GetTypes(); }
+    const IndexHint& GetIndex() override { return table_hander_->GetIndex(); }
+    std::unique_ptr<WindowIterator> GetWindowIterator(
+        const std::string& idx_name) override {
+        return std::unique_ptr<WindowIterator>();
+    }
+    const Schema* GetSchema() override { return table_hander_->GetSchema(); }
+    const std::string& GetName() override { return table_hander_->GetName(); }
+    const std::string& GetDatabase() override {
+        return table_hander_->GetDatabase();
+    }
+    base::ConstIterator<uint64_t, Row>* GetRawIterator() override {
+        auto iter = table_hander_->GetIterator();
+        if (!iter) {
+            return nullptr;
+        }
+        return new IteratorDistinctWrapper(std::move(iter), fun_);
+    }
+    virtual const OrderType GetOrderType() const {
+        return table_hander_->GetOrderType();
+    }
+    std::shared_ptr<TableHandler> table_hander_;
+    const RowKeyFun* fun_;
+};
+
+/**
+ * Rows of several tables of the same schema one after another, as the
+ * result of UNION ALL. Tables are iterated in place without copy.
+ */
+class TableConcatWrapper : public TableHandler {
+ public:
+    explicit TableConcatWrapper(
+        const std::vector<std::shared_ptr<TableHandler>>& tables)
+        : TableHandler(), tables_(tables) {}
+    virtual ~TableConcatWrapper() {}
+
+    std::unique_ptr<RowIterator> GetIterator() {
+        return std::unique_ptr<RowIterator>(GetRawIterator());
+    }
+    const Types& GetTypes() override { return tables_[0]->GetTypes(); }
+    const IndexHint& GetIndex() override { return tables_[0]->GetIndex(); }
+    std::unique_ptr<WindowIterator> GetWindowIterator(
+        const std::string& idx_name) override {
+        return std::unique_ptr<WindowIterator>();
+    }
+    const Schema* GetSchema() override { return tables_[0]->GetSchema(); }
+    const std::string& GetName() override { return tables_[0]->GetName(); }
+    const std::string& GetDatabase() override {
+        return tables_[0]->GetDatabase();
+    }
+    base::ConstIterator<uint64_t, Row>* GetRawIterator() override {
+        std::vector<std::unique_ptr<RowIterator>> iters;
+        for (auto& table : tables_) {
+            auto iter = table->GetIterator();
+            if (iter) {
+                iters.push_back(std::move(iter));
+            }
+        }
+        return new IteratorConcatWrapper(std::move(iters));
+    }
+    const uint64_t GetCount() override {
+        uint64_t cnt = 0;
+        for (auto& table : tables_) {
+            cnt += table->GetCount();
+        }
+        return cnt;
+    }
+    std::vector<std::shared_ptr<TableHandler>> tables_;
+};
+
+/**
+ * Iterate rows of gathered tables in order of `positions`, key of row is
+ * its position as `MemTableIterator` does.
+ */
+class IteratorGatherWrapper : public RowIterator {
+ public:
+    IteratorGatherWrapper(
+        const std::vector<std::shared_ptr<TableHandler>>* tables,
+        const std::vector<std::pair<size_t, uint64_t>>* positions)
+        : RowIterator(), tables_(tables), positions_(positions), key_(0) {}
+    virtual ~IteratorGatherWrapper() {}
+    bool Valid() const override { return key_ < positions_->size(); }
+    void Next() override { key_++; }
+    const uint64_t& GetKey() const override { return key_; }
+    const Row& GetValue() override {
+        auto& position = (*positions_)[key_];
+        value_ = (*tables_)[position.first]->At(position.second);
+        return value_;
+    }
+    void Seek(const uint64_t& k) override { key_ = k; }
+    void SeekToFirst() override { key_ = 0; }
+    bool IsSeekable() const override { return true; }
+
+ private:
+    const std::vector<std::shared_ptr<TableHandler>>* tables_;
+    const std::vector<std::pair<size_t, uint64_t>>* positions_;
+    uint64_t key_;
+    Row value_;
+};
+
+/**
+ * Reassemble rows scattered to several tables, e.g. results of sub queries
+ * on different tablets. The i-th row is row `positions[i].second` of table
+ * `positions[i].first`. Tables are only read when rows are accessed, so
+ * that asynchronous sub queries run concurrently until then.
+ */
+class TableGatherWrapper : public TableHandler {
+ public:
+    TableGatherWrapper(
+        const std::vector<std::shared_ptr<TableHandler>>& tables,
+        const std::vector<std::pair<size_t, uint64_t>>& positions)
+        : TableHandler(), tables_(tables), positions_(positions) {}
+    virtual ~TableGatherWrapper() {}
+
+    std::unique_ptr<RowIterator> GetIterator() override {
+        return std::unique_ptr<RowIterator>(GetRawIterator());
+    }
+    const Types& GetTypes() override { return tables_[0]->GetTypes(); }
+    const IndexHint& GetIndex() override { return tables_[0]->GetIndex(); }
+    std::unique_ptr<WindowIterator> GetWindowIterator(
+        const std::string& idx_name) override {
+        return std::unique_ptr<WindowIterator>();
+    }
+    const Schema* GetSchema() override { return tables_[0]->GetSchema(); }
+    const std::string& GetName() override { return tables_[0]->GetName(); }
+    const std::string& GetDatabase() override {
+        return tables_[0]->GetDatabase();
+    }
+    base::ConstIterator<uint64_t, Row>* GetRawIterator() override {
+        return new IteratorGatherWrapper(&tables_, &positions_);
+    }
+    Row At(uint64_t pos) override {
+        if (pos >= positions_.size()) {
+            return Row();
+        }
+        auto& position = positions_[pos];
+        return tables_[position.first]->At(position.second);
+    }
+    const uint64_t GetCount() override { return positions_.size(); }
+    // Status of the first table not done
+    base::Status GetStatus() override {
+        for (auto& table : tables_) {
+            auto status = table->GetStatus();
+            if (!status.isOK()) {
+                return status;
+            }
+        }
+        return base::Status::OK();
+    }
+    std::vector<std::shared_ptr<TableHandler>> tables_;
+    std::vector<std::pair<size_t, uint64_t>> positions_;
+};
+
 class RowProjectWrapper : public RowHandler {
  public:
     RowProjectWrapper(std::shared_ptr<RowHandler> row_handler,
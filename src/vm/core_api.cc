@@ -203,7 +203,7 @@ hybridse::codec::Row CoreAPI::RowConstProject(const RawPtrHandle fn,
         LOG(WARNING) << "fail to run udf " << ret;
         return hybridse::codec::Row();
     }
-    return Row(base::RefCountedSlice::CreateManaged(
+    return Row(JitRuntime::get()->CreateRowSlice(
         buf, hybridse::codec::RowView::GetSize(buf)));
 }
 
@@ -231,7 +231,7 @@ hybridse::codec::Row CoreAPI::RowProject(const RawPtrHandle fn,
         LOG(WARNING) << "fail to run udf " << ret;
         return hybridse::codec::Row();
     }
-    return Row(base::RefCountedSlice::CreateManaged(
+    return Row(JitRuntime::get()->CreateRowSlice(
         buf, hybridse::codec::RowView::GetSize(buf)));
 }
 
@@ -262,7 +262,7 @@ hybridse::codec::Row CoreAPI::UnsafeRowProject(
         return hybridse::codec::Row();
     }
 
-    return Row(base::RefCountedSlice::CreateManaged(
+    return Row(JitRuntime::get()->CreateRowSlice(
         buf, hybridse::codec::RowView::GetSize(buf)));
 }
 
@@ -302,8 +302,8 @@ hybridse::codec::Row CoreAPI::WindowProject(const RawPtrHandle fn,
         LOG(WARNING) << "fail to run udf " << ret;
         return Row();
     }
-    return Row(base::RefCountedSlice::CreateManaged(out_buf,
-                                                    RowView::GetSize(out_buf)));
+    return Row(JitRuntime::get()->CreateRowSlice(out_buf,
+                                                 RowView::GetSize(out_buf)));
 }
 
 hybridse::codec::Row CoreAPI::WindowProject(const RawPtrHandle fn,
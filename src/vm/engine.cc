@@ -15,20 +15,22 @@
  */
 
 #include "vm/engine.h"
+#include <chrono>  // NOLINT
 #include <string>
 #include <utility>
 #include <vector>
 #include "base/fe_strings.h"
-#include "boost/none.hpp"
-#include "boost/optional.hpp"
+#include "base/thread_pool.h"
 #include "codec/fe_row_codec.h"
 #include "codec/fe_schema_codec.h"
 #include "codec/list_iterator_codec.h"
 #include "codegen/buf_ir_builder.h"
 #include "gflags/gflags.h"
 #include "llvm-c/Target.h"
+#include "vm/jit_runtime.h"
 #include "vm/local_tablet_handler.h"
 #include "vm/mem_catalog.h"
+#include "vm/runner_scheduler.h"
 #include "vm/sql_compiler.h"
 
 DECLARE_bool(logtostderr);
@@ -39,6 +41,9 @@ namespace hybridse {
 namespace vm {
 
 static bool LLVM_IS_INITIALIZED = false;
+// jit optimization levels of tiered compilation
+static const uint32_t kFastJitOptLevel = 0;
+static const uint32_t kHotJitOptLevel = 3;
 
 EngineOptions::EngineOptions()
     : keep_ir_(false),
@@ -49,6 +54,11 @@ EngineOptions::EngineOptions()
       batch_request_optimized_(true),
       enable_expr_optimize_(true),
       enable_batch_window_parallelization_(false),
+      batch_thread_num_(1),
+      batch_sort_memory_limit_(0),
+      batch_sort_spill_dir_("/tmp"),
+      compile_thread_num_(1),
+      tiered_compile_threshold_(0),
       max_sql_cache_size_(50),
       enable_spark_unsaferow_format_(false) {
     // TODO(chendihao): Pass the parameter to avoid global gflag
@@ -61,11 +71,24 @@ EngineOptions* EngineOptions::set_enable_spark_unsaferow_format(bool flag) {
     return this;
 }
 
+static std::shared_ptr<base::ThreadPool> NewBatchThreadPool(
+    const EngineOptions& options) {
+    if (options.batch_thread_num() <= 1) {
+        return std::shared_ptr<base::ThreadPool>();
+    }
+    return std::make_shared<base::ThreadPool>(options.batch_thread_num());
+}
+
 Engine::Engine(const std::shared_ptr<Catalog>& catalog)
-    : cl_(catalog), options_(), mu_(), lru_cache_() {}
+    : cl_(catalog),
+      options_(),
+      compile_cache_(options_.max_sql_cache_size()) {}
 Engine::Engine(const std::shared_ptr<Catalog>& catalog,
                const EngineOptions& options)
-    : cl_(catalog), options_(options), mu_(), lru_cache_() {}
+    : cl_(catalog),
+      options_(options),
+      compile_cache_(options.max_sql_cache_size()),
+      batch_thread_pool_(NewBatchThreadPool(options)) {}
 Engine::~Engine() {}
 void Engine::InitializeGlobalLLVM() {
     if (LLVM_IS_INITIALIZED) return;
@@ -178,13 +201,36 @@ bool Engine::IsCompatibleCache(RunSession& session,  // NOLINT
     return true;
 }
 
+// common column indices take part in compile key of batch request mode
+static const std::set<size_t>& SessionCommonColumnIndices(
+    RunSession& session) {  // NOLINT
+    static const std::set<size_t> kNoCommonColumns;
+    auto batch_req_sess = dynamic_cast<BatchRequestRunSession*>(&session);
+    return batch_req_sess ? batch_req_sess->common_column_indices()
+                          : kNoCommonColumns;
+}
+
+static std::string CompileKey(const std::string& sql, const std::string& db,
+                              EngineMode engine_mode,
+                              const std::set<size_t>& common_column_indices) {
+    std::ostringstream oss;
+    oss << engine_mode << '\0' << db << '\0' << sql << '\0';
+    for (size_t idx : common_column_indices) {
+        oss << idx << ",";
+    }
+    return oss.str();
+}
+
 bool Engine::Get(const std::string& sql, const std::string& db,
                  RunSession& session,
                  base::Status& status) {  // NOLINT (runtime/references)
-    std::shared_ptr<CompileInfo> cached_info =
-        GetCacheLocked(db, sql, session.engine_mode());
+    const std::set<size_t>& common_column_indices =
+        SessionCommonColumnIndices(session);
+    std::shared_ptr<CompileInfo> cached_info = compile_cache_.Get(
+        session.engine_mode(), db, sql, common_column_indices);
     if (cached_info && IsCompatibleCache(session, cached_info, status)) {
         session.SetCompileInfo(cached_info);
+        CountCacheHit(cached_info);
         return true;
     }
     // TODO(baoxinqi): IsCompatibleCache fail, return false, or reset status.
@@ -192,14 +238,209 @@ bool Engine::Get(const std::string& sql, const std::string& db,
         LOG(WARNING) << status;
         status = base::Status::OK();
     }
+
+    // Join running compilation of the same sql, or compile on caller thread
+    std::string key =
+        CompileKey(sql, db, session.engine_mode(), common_column_indices);
+    std::shared_future<CompileResult> future;
+    std::shared_ptr<std::promise<CompileResult>> promise;
+    CompileResult result;
+    if (StartCompiling(key, &future, &promise)) {
+        result.info = Compile(sql, db, session.engine_mode(),
+                              common_column_indices, false, result.status);
+        FinishCompiling(key, promise, result, false);
+    } else {
+        result = future.get();
+    }
+    status = result.status;
+    if (!result.info) {
+        return false;
+    }
+    session.SetCompileInfo(result.info);
+    if (session.is_debug_) {
+        auto& sql_context = std::dynamic_pointer_cast<SqlCompileInfo>(
+                                result.info)->get_sql_context();
+        std::ostringstream plan_oss;
+        if (nullptr != sql_context.physical_plan) {
+            sql_context.physical_plan->Print(plan_oss, "");
+            LOG(INFO) << "physical plan:\n" << plan_oss.str() << std::endl;
+        }
+        std::ostringstream runner_oss;
+        sql_context.cluster_job.Print(runner_oss, "");
+        LOG(INFO) << "cluster job:\n" << runner_oss.str() << std::endl;
+    }
+    return true;
+}
+
+bool Engine::GetAsync(const std::string& sql, const std::string& db,
+                      RunSession& session,
+                      base::Status& status) {  // NOLINT (runtime/references)
+    const std::set<size_t>& common_column_indices =
+        SessionCommonColumnIndices(session);
+    std::shared_ptr<CompileInfo> cached_info = compile_cache_.Get(
+        session.engine_mode(), db, sql, common_column_indices);
+    if (cached_info && IsCompatibleCache(session, cached_info, status)) {
+        session.SetCompileInfo(cached_info);
+        CountCacheHit(cached_info);
+        return true;
+    }
+    auto future =
+        CompileAsync(sql, db, session.engine_mode(), common_column_indices);
+    if (future.wait_for(std::chrono::seconds(0)) !=
+        std::future_status::ready) {
+        status = base::Status::Running();
+        return false;
+    }
+    const CompileResult& result = future.get();
+    status = result.status;
+    if (!result.info) {
+        return false;
+    }
+    session.SetCompileInfo(result.info);
+    return true;
+}
+
+std::shared_future<CompileResult> Engine::CompileAsync(
+    const std::string& sql, const std::string& db, EngineMode engine_mode,
+    const std::set<size_t>& common_column_indices) {
+    std::shared_future<CompileResult> future;
+    std::shared_ptr<std::promise<CompileResult>> promise;
+    auto cached_info =
+        compile_cache_.Get(engine_mode, db, sql, common_column_indices);
+    if (cached_info) {
+        promise = std::make_shared<std::promise<CompileResult>>();
+        CompileResult result;
+        result.info = cached_info;
+        promise->set_value(result);
+        return promise->get_future().share();
+    }
+    std::string key = CompileKey(sql, db, engine_mode, common_column_indices);
+    if (!StartCompiling(key, &future, &promise)) {
+        return future;
+    }
+    GetCompilePool()->Submit([this, sql, db, engine_mode,
+                              common_column_indices, key, promise]() {
+        CompileResult result;
+        result.info = Compile(sql, db, engine_mode, common_column_indices,
+                              false, result.status);
+        FinishCompiling(key, promise, result, true);
+    });
+    return future;
+}
+
+std::shared_ptr<base::ThreadPool> Engine::GetCompilePool() {
+    std::lock_guard<std::mutex> lock(compiling_mu_);
+    if (!compile_pool_) {
+        compile_pool_ =
+            std::make_shared<base::ThreadPool>(options_.compile_thread_num());
+    }
+    return compile_pool_;
+}
+
+void Engine::CountCacheHit(const std::shared_ptr<CompileInfo>& info) {
+    uint64_t threshold = options_.tiered_compile_threshold();
+    if (0 == threshold || options_.is_plan_only()) {
+        return;
+    }
+    auto sql_info = std::dynamic_pointer_cast<SqlCompileInfo>(info);
+    if (!sql_info) {
+        return;
+    }
+    auto& sql_context = sql_info->get_sql_context();
+    // only the hit reaching threshold exactly starts recompilation
+    if (kFastJitOptLevel != sql_context.jit_options.opt_level() ||
+        threshold != sql_info->IncreaseHitCount()) {
+        return;
+    }
+    std::string sql = sql_context.sql;
+    std::string db = sql_context.db;
+    EngineMode engine_mode = sql_context.engine_mode;
+    std::set<size_t> common_column_indices =
+        sql_context.batch_request_info.common_column_indices;
+    std::string key = CompileKey(sql, db, engine_mode, common_column_indices);
+    DLOG(INFO) << "recompile hot sql with full optimization: " << sql;
+    auto promise = std::make_shared<std::promise<CompileResult>>();
+    {
+        std::lock_guard<std::mutex> lock(compiling_mu_);
+        hot_compiling_[key] = promise->get_future().share();
+    }
+    GetCompilePool()->Submit([this, sql, db, engine_mode,
+                              common_column_indices, key, info, promise]() {
+        CompileResult result;
+        result.info = Compile(sql, db, engine_mode, common_column_indices,
+                              true, result.status);
+        if (!result.info) {
+            LOG(WARNING) << "fail to recompile hot sql " << sql << ": "
+                         << result.status;
+        } else if (!compile_cache_.Replace(engine_mode, db, sql,
+                                           common_column_indices, info,
+                                           result.info)) {
+            // cache of db was cleared or sql compiled again meanwhile, the
+            // result may be stale
+            DLOG(INFO) << "drop hot compile result no longer cached: " << sql;
+        }
+        std::lock_guard<std::mutex> lock(compiling_mu_);
+        hot_compiling_.erase(key);
+        promise->set_value(result);
+    });
+}
+
+std::shared_future<CompileResult> Engine::GetHotCompiling(
+    const std::string& sql, const std::string& db, EngineMode engine_mode,
+    const std::set<size_t>& common_column_indices) {
+    std::string key = CompileKey(sql, db, engine_mode, common_column_indices);
+    std::lock_guard<std::mutex> lock(compiling_mu_);
+    auto iter = hot_compiling_.find(key);
+    if (iter == hot_compiling_.end()) {
+        return std::shared_future<CompileResult>();
+    }
+    return iter->second;
+}
+
+bool Engine::StartCompiling(
+    const std::string& key, std::shared_future<CompileResult>* future,
+    std::shared_ptr<std::promise<CompileResult>>* promise) {
+    std::lock_guard<std::mutex> lock(compiling_mu_);
+    auto iter = compiling_.find(key);
+    if (iter != compiling_.end()) {
+        *future = iter->second;
+        // failure of background compilation is reported once, after that
+        // the sql can be compiled again
+        if (future->wait_for(std::chrono::seconds(0)) ==
+            std::future_status::ready) {
+            compiling_.erase(iter);
+        }
+        return false;
+    }
+    *promise = std::make_shared<std::promise<CompileResult>>();
+    *future = (*promise)->get_future().share();
+    compiling_.insert(std::make_pair(key, *future));
+    return true;
+}
+
+void Engine::FinishCompiling(
+    const std::string& key,
+    std::shared_ptr<std::promise<CompileResult>> promise,
+    const CompileResult& result, bool keep_failure) {
+    std::lock_guard<std::mutex> lock(compiling_mu_);
+    // compile result is already cached on success
+    if (result.info || !keep_failure) {
+        compiling_.erase(key);
+    }
+    promise->set_value(result);
+}
+
+std::shared_ptr<CompileInfo> Engine::Compile(
+    const std::string& sql, const std::string& db, EngineMode engine_mode,
+    const std::set<size_t>& common_column_indices, bool is_hot,
+    base::Status& status) {  // NOLINT (runtime/references)
     DLOG(INFO) << "Compile HYBRIDSE ...";
     status = base::Status::OK();
     std::shared_ptr<SqlCompileInfo> info = std::make_shared<SqlCompileInfo>();
-    auto& sql_context =
-        std::dynamic_pointer_cast<SqlCompileInfo>(info)->get_sql_context();
+    auto& sql_context = info->get_sql_context();
     sql_context.sql = sql;
     sql_context.db = db;
-    sql_context.engine_mode = session.engine_mode();
+    sql_context.engine_mode = engine_mode;
     sql_context.is_performance_sensitive = options_.is_performance_sensitive();
     sql_context.is_cluster_optimized = options_.is_cluster_optimzied();
     sql_context.is_batch_request_optimized =
@@ -207,42 +448,45 @@ bool Engine::Get(const std::string& sql, const std::string& db,
     sql_context.enable_batch_window_parallelization =
         options_.is_enable_batch_window_parallelization();
     sql_context.enable_expr_optimize = options_.is_enable_expr_optimize();
+    sql_context.batch_thread_pool = batch_thread_pool_;
+    sql_context.batch_sort_memory_limit = options_.batch_sort_memory_limit();
+    sql_context.batch_sort_spill_dir = options_.batch_sort_spill_dir();
     sql_context.jit_options = options_.jit_options();
-
-    auto batch_req_sess = dynamic_cast<BatchRequestRunSession*>(&session);
-    if (batch_req_sess) {
-        sql_context.batch_request_info.common_column_indices =
-            batch_req_sess->common_column_indices();
+    if (options_.tiered_compile_threshold() > 0) {
+        sql_context.jit_options.set_opt_level(is_hot ? kHotJitOptLevel
+                                                     : kFastJitOptLevel);
     }
+    sql_context.batch_request_info.common_column_indices =
+        common_column_indices;
 
     SqlCompiler compiler(
         std::atomic_load_explicit(&cl_, std::memory_order_acquire),
         options_.is_keep_ir(), false, options_.is_plan_only());
-    bool ok = compiler.Compile(info->get_sql_context(), status);
+    bool ok = compiler.Compile(sql_context, status);
     if (!ok || 0 != status.code) {
-        return false;
+        return nullptr;
     }
     if (!options_.is_compile_only()) {
-        ok = compiler.BuildClusterJob(info->get_sql_context(), status);
+        ok = compiler.BuildClusterJob(sql_context, status);
         if (!ok || 0 != status.code) {
             LOG(WARNING) << "fail to build cluster job: " << status.msg;
-            return false;
+            return nullptr;
         }
     }
 
-    SetCacheLocked(db, sql, session.engine_mode(), info);
-    session.SetCompileInfo(info);
-    if (session.is_debug_) {
-        std::ostringstream plan_oss;
-        if (nullptr != sql_context.physical_plan) {
-            sql_context.physical_plan->Print(plan_oss, "");
-            LOG(INFO) << "physical plan:\n" << plan_oss.str() << std::endl;
-        }
-        std::ostringstream runner_oss;
-        sql_context.cluster_job.Print(runner_oss, "");
-        LOG(INFO) << "cluster job:\n" << runner_oss.str() << std::endl;
+    // hot sql replaces the result it was recompiled from, see CountCacheHit
+    if (is_hot) {
+        return info;
     }
-    return true;
+    // batch request mode always keeps latest compile result
+    if (!compile_cache_.Insert(engine_mode, db, sql, common_column_indices,
+                               info, kBatchRequestMode == engine_mode)) {
+        // TODO(xxx): Ensure compile result is stable
+        DLOG(INFO) << "Engine cache already exists: " << engine_mode << " "
+                   << db << "\n"
+                   << sql;
+    }
+    return info;
 }
 
 bool Engine::Explain(const std::string& sql, const std::string& db,
@@ -325,59 +569,7 @@ bool Engine::Explain(const std::string& sql, const std::string& db,
 }
 
 void Engine::ClearCacheLocked(const std::string& db) {
-    std::lock_guard<base::SpinMutex> lock(mu_);
-    for (auto& cache : lru_cache_) {
-        cache.second.erase(db);
-    }
-}
-
-std::shared_ptr<CompileInfo> Engine::GetCacheLocked(const std::string& db,
-                                                    const std::string& sql,
-                                                    EngineMode engine_mode) {
-    std::lock_guard<base::SpinMutex> lock(mu_);
-    auto mode_iter = lru_cache_.find(engine_mode);
-    if (mode_iter == lru_cache_.end()) {
-        return nullptr;
-    }
-    auto& mode_cache = mode_iter->second;
-    auto db_iter = mode_cache.find(db);
-    if (db_iter == mode_cache.end()) {
-        return nullptr;
-    }
-    auto& lru = db_iter->second;
-    auto value = lru.get(sql);
-    if (value == boost::none) {
-        return nullptr;
-    } else {
-        return value.value();
-    }
-}
-
-bool Engine::SetCacheLocked(const std::string& db, const std::string& sql,
-                            EngineMode engine_mode,
-                            std::shared_ptr<CompileInfo> info) {
-    std::lock_guard<base::SpinMutex> lock(mu_);
-    auto& mode_cache = lru_cache_[engine_mode];
-    using BoostLRU =
-        boost::compute::detail::lru_cache<std::string,
-                                          std::shared_ptr<CompileInfo>>;
-    std::map<std::string, BoostLRU>::iterator db_iter = mode_cache.find(db);
-    if (db_iter == mode_cache.end()) {
-        db_iter = mode_cache.insert(
-            db_iter, {db, BoostLRU(options_.max_sql_cache_size())});
-    }
-    auto& lru = db_iter->second;
-    auto value = lru.get(sql);
-    if (value == boost::none || engine_mode == kBatchRequestMode) {
-        lru.insert(sql, info);
-        return true;
-    } else {
-        // TODO(xxx): Ensure compile result is stable
-        DLOG(INFO) << "Engine cache already exists: " << engine_mode << " "
-                   << db << "\n"
-                   << sql;
-        return false;
-    }
+    compile_cache_.Clear(db);
 }
 
 RunSession::RunSession(EngineMode engine_mode)
@@ -409,17 +601,22 @@ int32_t RequestRunSession::Run(const uint32_t task_id, const Row& in_row,
         return -2;
     }
     DLOG(INFO) << "Request Row Run with task_id " << task_id;
-    RunnerContext ctx(&std::dynamic_pointer_cast<SqlCompileInfo>(compile_info_)
-                           ->get_sql_context()
-                           .cluster_job,
-                      in_row, sp_name_, is_debug_);
-    auto output = task->RunWithCache(ctx);
+    auto ctx = RunnerContextPool::Get(
+        &std::dynamic_pointer_cast<SqlCompileInfo>(compile_info_)
+             ->get_sql_context()
+             .cluster_job,
+        in_row, sp_name_, is_debug_);
+    // Intermediate rows are allocated from context arena, only output row
+    // is copied out of it
+    RowArenaScope arena_scope(ctx->row_arena());
+    auto output = task->RunWithCache(*ctx);
     if (!output) {
         LOG(WARNING) << "run request plan output is null";
         return -1;
     }
     bool ok = Runner::ExtractRow(output, out_row);
     if (ok) {
+        *out_row = Runner::DetachRow(*out_row);
         return 0;
     }
     return -1;
@@ -435,10 +632,11 @@ int32_t BatchRequestRunSession::Run(const std::vector<Row>& request_batch,
 int32_t BatchRequestRunSession::Run(const uint32_t id,
                                     const std::vector<Row>& request_batch,
                                     std::vector<Row>& output) {
-    RunnerContext ctx(&std::dynamic_pointer_cast<SqlCompileInfo>(compile_info_)
-                           ->get_sql_context()
-                           .cluster_job,
-                      request_batch, sp_name_, is_debug_);
+    auto ctx = RunnerContextPool::Get(
+        &std::dynamic_pointer_cast<SqlCompileInfo>(compile_info_)
+             ->get_sql_context()
+             .cluster_job,
+        request_batch, sp_name_, is_debug_);
     auto task = std::dynamic_pointer_cast<SqlCompileInfo>(compile_info_)
                     ->get_sql_context()
                     .cluster_job.GetTask(id)
@@ -448,29 +646,32 @@ int32_t BatchRequestRunSession::Run(const uint32_t id,
                      << " not exist!";
         return -2;
     }
-    auto handler = task->BatchRequestRun(ctx);
+    RowArenaScope arena_scope(ctx->row_arena());
+    auto handler = task->BatchRequestRun(*ctx);
     if (!handler) {
         LOG(WARNING) << "run request plan output is null";
         return -1;
     }
+    size_t output_begin = output.size();
     bool ok = Runner::ExtractRows(handler, output);
     if (!ok) {
         return -1;
     }
-    ctx.ClearCache();
+    for (size_t i = output_begin; i < output.size(); i++) {
+        output[i] = Runner::DetachRow(output[i]);
+    }
+    ctx->ClearCache();
     return 0;
 }
 
 std::shared_ptr<TableHandler> BatchRunSession::Run() {
-    RunnerContext ctx(&std::dynamic_pointer_cast<SqlCompileInfo>(compile_info_)
-                           ->get_sql_context()
-                           .cluster_job,
-                      is_debug_);
-    auto output = std::dynamic_pointer_cast<SqlCompileInfo>(compile_info_)
-                      ->get_sql_context()
-                      .cluster_job.GetMainTask()
-                      .GetRoot()
-                      ->RunWithCache(ctx);
+    auto& cluster_job = std::dynamic_pointer_cast<SqlCompileInfo>(compile_info_)
+                            ->get_sql_context()
+                            .cluster_job;
+    auto ctx = RunnerContextPool::Get(&cluster_job, is_debug_);
+    RunnerScheduler scheduler(cluster_job.thread_pool());
+    auto output =
+        scheduler.RunWithCache(cluster_job.GetMainTask().GetRoot(), *ctx);
     if (!output) {
         LOG(WARNING) << "run batch plan output is null";
         return std::shared_ptr<TableHandler>();
@@ -497,8 +698,10 @@ std::shared_ptr<TableHandler> BatchRunSession::Run() {
 int32_t BatchRunSession::Run(std::vector<Row>& rows, uint64_t limit) {
     auto& sql_ctx = std::dynamic_pointer_cast<SqlCompileInfo>(compile_info_)
                         ->get_sql_context();
-    RunnerContext ctx(&sql_ctx.cluster_job, is_debug_);
-    auto output = sql_ctx.cluster_job.GetTask(0).GetRoot()->RunWithCache(ctx);
+    auto ctx = RunnerContextPool::Get(&sql_ctx.cluster_job, is_debug_);
+    RunnerScheduler scheduler(sql_ctx.cluster_job.thread_pool());
+    auto output = scheduler.RunWithCache(
+        sql_ctx.cluster_job.GetTask(0).GetRoot(), *ctx);
     if (!output) {
         LOG(WARNING) << "run batch plan output is null";
         return -1;
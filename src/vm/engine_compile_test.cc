@@ -18,6 +18,7 @@
 #include "gtest/gtest.h"
 #include "gtest/internal/gtest-param-util.h"
 #include "vm/engine_test_base.h"
+#include "vm/sql_compiler.h"
 
 using namespace llvm;       // NOLINT (build/namespaces)
 using namespace llvm::orc;  // NOLINT (build/namespaces)
@@ -83,6 +84,140 @@ TEST_F(EngineCompileTest, EngineLRUCacheTest) {
         ASSERT_NE(bsession1.GetCompileInfo().get(),
                   bsession2.GetCompileInfo().get());
     }
+    auto stats = engine.GetCacheStats();
+    ASSERT_EQ(1u, stats.hit);
+    ASSERT_EQ(3u, stats.miss);
+    ASSERT_EQ(2u, stats.eviction);
+    ASSERT_EQ(1u, stats.size);
+    engine.ClearCacheLocked("simple_db");
+    ASSERT_EQ(0u, engine.GetCacheStats().size);
+}
+
+TEST_F(EngineCompileTest, EngineCompileAsyncTest) {
+    // Build Simple Catalog
+    auto catalog = BuildSimpleCatalog();
+
+    // database simple_db
+    hybridse::type::Database db;
+    db.set_name("simple_db");
+
+    // table t1
+    hybridse::type::TableDef table_def;
+    sqlcase::CaseSchemaMock::BuildTableDef(table_def);
+    table_def.set_name("t1");
+    AddTable(db, table_def);
+    catalog->AddDatabase(db);
+
+    EngineOptions options;
+    options.set_compile_only(true);
+    options.set_compile_thread_num(2);
+    Engine engine(catalog, options);
+
+    std::string sql = "select col1, col2 from t1;";
+    auto future1 = engine.CompileAsync(sql, "simple_db", kBatchMode);
+    auto future2 = engine.CompileAsync(sql, "simple_db", kBatchMode);
+    ASSERT_TRUE(future1.get().status.isOK()) << future1.get().status;
+    ASSERT_TRUE(future1.get().info != nullptr);
+    ASSERT_EQ(future1.get().info.get(), future2.get().info.get());
+    {
+        base::Status get_status;
+        BatchRunSession session;
+        ASSERT_TRUE(engine.GetAsync(sql, "simple_db", session, get_status));
+        ASSERT_EQ(future1.get().info.get(), session.GetCompileInfo().get());
+        BatchRunSession sync_session;
+        ASSERT_TRUE(engine.Get(sql, "simple_db", sync_session, get_status));
+        ASSERT_EQ(future1.get().info.get(),
+                  sync_session.GetCompileInfo().get());
+    }
+
+    // failure of background compilation is reported by next call
+    std::string bad_sql = "select col1 from t_not_exist;";
+    auto bad_future = engine.CompileAsync(bad_sql, "simple_db", kBatchMode);
+    ASSERT_FALSE(bad_future.get().status.isOK());
+    ASSERT_TRUE(bad_future.get().info == nullptr);
+    {
+        base::Status get_status;
+        BatchRunSession session;
+        ASSERT_FALSE(
+            engine.GetAsync(bad_sql, "simple_db", session, get_status));
+        ASSERT_FALSE(get_status.isOK());
+        ASSERT_FALSE(get_status.isRunning());
+    }
+}
+
+TEST_F(EngineCompileTest, EngineTieredCompileTest) {
+    // Build Simple Catalog
+    auto catalog = BuildSimpleCatalog();
+
+    // database simple_db
+    hybridse::type::Database db;
+    db.set_name("simple_db");
+
+    // table t1
+    hybridse::type::TableDef table_def;
+    sqlcase::CaseSchemaMock::BuildTableDef(table_def);
+    table_def.set_name("t1");
+    AddTable(db, table_def);
+    catalog->AddDatabase(db);
+
+    EngineOptions options;
+    options.set_tiered_compile_threshold(2);
+    Engine engine(catalog, options);
+
+    auto opt_level = [](RunSession& session) {  // NOLINT
+        return SqlCompileInfo::CastFrom(session.GetCompileInfo().get())
+            ->get_sql_context()
+            .jit_options.opt_level();
+    };
+    std::string sql = "select col1, col2 + 1 as c2 from t1;";
+    base::Status get_status;
+    BatchRunSession fast_session;
+    ASSERT_TRUE(engine.Get(sql, "simple_db", fast_session, get_status))
+        << get_status;
+    ASSERT_EQ(0u, opt_level(fast_session));
+    BatchRunSession hit_session;
+    ASSERT_TRUE(engine.Get(sql, "simple_db", hit_session, get_status));
+    ASSERT_EQ(fast_session.GetCompileInfo().get(),
+              hit_session.GetCompileInfo().get());
+
+    // second hit turns sql hot, optimized result replaces cached one once
+    // the recompilation is no longer running
+    BatchRunSession hot_session;
+    ASSERT_TRUE(engine.Get(sql, "simple_db", hot_session, get_status));
+    auto hot_future = engine.GetHotCompiling(sql, "simple_db", kBatchMode);
+    if (hot_future.valid()) {
+        ASSERT_TRUE(hot_future.get().status.isOK()) << hot_future.get().status;
+    }
+    ASSERT_FALSE(
+        engine.GetHotCompiling(sql, "simple_db", kBatchMode).valid());
+    ASSERT_TRUE(engine.Get(sql, "simple_db", hot_session, get_status));
+    ASSERT_NE(fast_session.GetCompileInfo().get(),
+              hot_session.GetCompileInfo().get());
+    ASSERT_EQ(3u, opt_level(hot_session));
+
+    // session of fast compile result is still runnable
+    std::vector<Row> fast_rows;
+    std::vector<Row> hot_rows;
+    ASSERT_EQ(0, fast_session.Run(fast_rows));
+    ASSERT_EQ(0, hot_session.Run(hot_rows));
+    ASSERT_EQ(fast_rows.size(), hot_rows.size());
+
+    // hot result of sql dropped from cache meanwhile is not cached again
+    std::string other_sql = "select col1, col2 + 2 as c2 from t1;";
+    BatchRunSession other_session;
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_TRUE(
+            engine.Get(other_sql, "simple_db", other_session, get_status));
+    }
+    auto other_future =
+        engine.GetHotCompiling(other_sql, "simple_db", kBatchMode);
+    engine.ClearCacheLocked("simple_db");
+    if (other_future.valid()) {
+        other_future.wait();
+    }
+    ASSERT_EQ(0u, engine.GetCacheStats().size);
+    ASSERT_TRUE(engine.Get(other_sql, "simple_db", other_session, get_status));
+    ASSERT_EQ(0u, opt_level(other_session));
 }
 
 TEST_F(EngineCompileTest, EngineCompileOnlyTest) {
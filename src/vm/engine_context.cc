@@ -0,0 +1,208 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "vm/engine_context.h"
+#include <chrono>  // NOLINT
+#include <tuple>
+#include "base/fe_hash.h"
+
+namespace hybridse {
+namespace vm {
+
+static const uint32_t kCacheHashSeed = 0xc3a5c85c;
+
+static inline uint64_t HashCombine(uint64_t seed, uint64_t hash) {
+    return seed ^ (hash + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+}
+
+static int64_t NowNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+EngineCompileCache::EngineCompileCache(uint32_t capacity)
+    : capacity_(capacity), shards_(kShardNum), eviction_(0) {}
+
+uint64_t EngineCompileCache::HashKey(
+    EngineMode mode, const std::string& db, const std::string& sql,
+    const std::set<size_t>& common_column_indices) {
+    uint64_t hash = base::MurmurHash64A(
+        sql.data(), static_cast<int>(sql.size()), kCacheHashSeed);
+    hash = HashCombine(hash, base::MurmurHash64A(db.data(),
+                                                 static_cast<int>(db.size()),
+                                                 kCacheHashSeed));
+    hash = HashCombine(hash, static_cast<uint64_t>(mode));
+    for (size_t idx : common_column_indices) {
+        hash = HashCombine(hash, idx);
+    }
+    return hash;
+}
+
+EngineCompileCache::EntryIter EngineCompileCache::FindLocked(
+    Shard* shard, uint64_t hash, EngineMode mode, const std::string& db,
+    const std::string& sql, const std::set<size_t>& common_column_indices) {
+    auto range = shard->entries.equal_range(hash);
+    for (auto iter = range.first; iter != range.second; ++iter) {
+        const Entry& entry = iter->second;
+        if (entry.mode == mode && entry.sql == sql && entry.db == db &&
+            entry.common_column_indices == common_column_indices) {
+            return iter;
+        }
+    }
+    return shard->entries.end();
+}
+
+std::shared_ptr<CompileInfo> EngineCompileCache::Get(
+    EngineMode mode, const std::string& db, const std::string& sql,
+    const std::set<size_t>& common_column_indices) {
+    uint64_t hash = HashKey(mode, db, sql, common_column_indices);
+    Shard& shard = shards_[hash % kShardNum];
+    std::shared_lock<std::shared_timed_mutex> lock(shard.mu);
+    auto iter = FindLocked(&shard, hash, mode, db, sql, common_column_indices);
+    if (iter == shard.entries.end()) {
+        shard.miss.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    shard.hit.fetch_add(1, std::memory_order_relaxed);
+    iter->second.last_access.store(NowNanos(), std::memory_order_relaxed);
+    return iter->second.info;
+}
+
+bool EngineCompileCache::Insert(EngineMode mode, const std::string& db,
+                                const std::string& sql,
+                                const std::set<size_t>& common_column_indices,
+                                std::shared_ptr<CompileInfo> info,
+                                bool overwrite) {
+    uint64_t hash = HashKey(mode, db, sql, common_column_indices);
+    Shard& shard = shards_[hash % kShardNum];
+    std::lock_guard<std::mutex> write_lock(write_mu_);
+    {
+        std::lock_guard<std::shared_timed_mutex> lock(shard.mu);
+        auto iter =
+            FindLocked(&shard, hash, mode, db, sql, common_column_indices);
+        if (iter != shard.entries.end()) {
+            if (!overwrite) {
+                return false;
+            }
+            iter->second.info = info;
+            iter->second.last_access.store(NowNanos(),
+                                           std::memory_order_relaxed);
+            return true;
+        }
+        shard.entries.emplace(
+            std::piecewise_construct, std::forward_as_tuple(hash),
+            std::forward_as_tuple(mode, db, sql, common_column_indices, info,
+                                  NowNanos()));
+    }
+    counts_[std::make_pair(mode, db)]++;
+    EvictLocked(mode, db);
+    return true;
+}
+
+bool EngineCompileCache::Replace(
+    EngineMode mode, const std::string& db, const std::string& sql,
+    const std::set<size_t>& common_column_indices,
+    const std::shared_ptr<CompileInfo>& old_info,
+    std::shared_ptr<CompileInfo> info) {
+    uint64_t hash = HashKey(mode, db, sql, common_column_indices);
+    Shard& shard = shards_[hash % kShardNum];
+    std::lock_guard<std::mutex> write_lock(write_mu_);
+    std::lock_guard<std::shared_timed_mutex> lock(shard.mu);
+    auto iter = FindLocked(&shard, hash, mode, db, sql, common_column_indices);
+    if (iter == shard.entries.end() || iter->second.info != old_info) {
+        return false;
+    }
+    iter->second.info = info;
+    iter->second.last_access.store(NowNanos(), std::memory_order_relaxed);
+    return true;
+}
+
+void EngineCompileCache::EvictLocked(EngineMode mode, const std::string& db) {
+    auto& count = counts_[std::make_pair(mode, db)];
+    while (count > capacity_) {
+        Shard* victim_shard = nullptr;
+        const Entry* victim = nullptr;
+        int64_t victim_access = 0;
+        for (auto& shard : shards_) {
+            std::shared_lock<std::shared_timed_mutex> lock(shard.mu);
+            for (auto& kv : shard.entries) {
+                const Entry& entry = kv.second;
+                if (entry.mode != mode || entry.db != db) {
+                    continue;
+                }
+                int64_t access =
+                    entry.last_access.load(std::memory_order_relaxed);
+                if (nullptr == victim || access < victim_access) {
+                    victim_shard = &shard;
+                    victim = &entry;
+                    victim_access = access;
+                }
+            }
+        }
+        if (nullptr == victim) {
+            count = 0;
+            return;
+        }
+        // entries are only erased under write lock, so victim is still there
+        std::lock_guard<std::shared_timed_mutex> lock(victim_shard->mu);
+        for (auto iter = victim_shard->entries.begin();
+             iter != victim_shard->entries.end(); ++iter) {
+            if (&iter->second == victim) {
+                victim_shard->entries.erase(iter);
+                break;
+            }
+        }
+        count--;
+        eviction_++;
+    }
+}
+
+void EngineCompileCache::Clear(const std::string& db) {
+    std::lock_guard<std::mutex> write_lock(write_mu_);
+    for (auto& shard : shards_) {
+        std::lock_guard<std::shared_timed_mutex> lock(shard.mu);
+        for (auto iter = shard.entries.begin();
+             iter != shard.entries.end();) {
+            if (iter->second.db == db) {
+                iter = shard.entries.erase(iter);
+            } else {
+                ++iter;
+            }
+        }
+    }
+    for (auto iter = counts_.begin(); iter != counts_.end();) {
+        if (iter->first.second == db) {
+            iter = counts_.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+}
+
+EngineCacheStats EngineCompileCache::GetStats() const {
+    EngineCacheStats stats;
+    for (auto& shard : shards_) {
+        std::shared_lock<std::shared_timed_mutex> lock(shard.mu);
+        stats.hit += shard.hit.load(std::memory_order_relaxed);
+        stats.miss += shard.miss.load(std::memory_order_relaxed);
+        stats.size += shard.entries.size();
+    }
+    stats.eviction = eviction_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+}  // namespace vm
+}  // namespace hybridse
@@ -639,6 +639,9 @@ INSTANTIATE_TEST_CASE_P(EngineTestLast_Join, EngineTest,
 INSTANTIATE_TEST_CASE_P(EngineTestLastJoin, EngineTest,
                         testing::ValuesIn(InitCases(
                             "/cases/integration/v1/join/test_lastjoin.yaml")));
+INSTANTIATE_TEST_CASE_P(EngineTestJoin, EngineTest,
+                        testing::ValuesIn(InitCases(
+                            "/cases/integration/v1/join/test_join.yaml")));
 INSTANTIATE_TEST_CASE_P(
     EngineTestArithmetic, EngineTest,
     testing::ValuesIn(
@@ -692,6 +695,18 @@ INSTANTIATE_TEST_CASE_P(
 INSTANTIATE_TEST_CASE_P(EngineTestWhere, EngineTest,
                         testing::ValuesIn(InitCases(
                             "/cases/integration/v1/select/test_where.yaml")));
+INSTANTIATE_TEST_CASE_P(
+    EngineTestOrderBy, EngineTest,
+    testing::ValuesIn(
+        InitCases("/cases/integration/v1/select/test_order_by.yaml")));
+INSTANTIATE_TEST_CASE_P(
+    EngineTestDistinct, EngineTest,
+    testing::ValuesIn(
+        InitCases("/cases/integration/v1/select/test_distinct.yaml")));
+INSTANTIATE_TEST_CASE_P(
+    EngineTestUnion, EngineTest,
+    testing::ValuesIn(
+        InitCases("/cases/integration/v1/select/test_union.yaml")));
 
 INSTANTIATE_TEST_CASE_P(
     EngineTestFzFunction, EngineTest,
@@ -0,0 +1,747 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "vm/incremental_agg.h"
+#include <string.h>
+#include <algorithm>
+#include <numeric>
+#include "glog/logging.h"
+#include "node/sql_node.h"
+#include "udf/default_udf_library.h"
+#include "vm/jit_runtime.h"
+
+namespace hybridse {
+namespace vm {
+
+static bool IsIntegerType(type::Type type) {
+    return type == type::kInt16 || type == type::kInt32 ||
+           type == type::kInt64;
+}
+static bool IsFloatType(type::Type type) {
+    return type == type::kFloat || type == type::kDouble;
+}
+
+// Append aggregated value as numeric `type`, integers wrap around as the
+// compiled accumulation does
+static void AppendNumber(type::Type type, int64_t int_val, double float_val,
+                         codec::RowBuilder* builder) {
+    switch (type) {
+        case type::kInt16:
+            builder->AppendInt16(static_cast<int16_t>(int_val));
+            break;
+        case type::kInt32:
+            builder->AppendInt32(static_cast<int32_t>(int_val));
+            break;
+        case type::kInt64:
+            builder->AppendInt64(int_val);
+            break;
+        case type::kFloat:
+            builder->AppendFloat(static_cast<float>(float_val));
+            break;
+        default:
+            builder->AppendDouble(float_val);
+            break;
+    }
+}
+
+IncrementalAggPlan::IncrementalAggPlan(
+    const Schema& output_schema,
+    const std::vector<const Schema*>& input_schemas, bool retractable)
+    : output_schema_(output_schema), retractable_(retractable) {
+    for (auto schema : input_schemas) {
+        input_views_.push_back(RowView(*schema));
+    }
+}
+
+std::shared_ptr<IncrementalAggPlan> IncrementalAggPlan::Build(
+    const FnInfo& fn_info, bool retractable) {
+    auto fail_ptr = std::shared_ptr<IncrementalAggPlan>();
+    auto schemas_ctx = fn_info.schemas_ctx();
+    if (fn_info.fn_def() == nullptr || schemas_ctx == nullptr ||
+        fn_info.fn_def()->GetArgSize() < 1) {
+        return fail_ptr;
+    }
+    // outputs on sub frames are computed over a different window
+    auto primary_frame = fn_info.GetPrimaryFrame();
+    for (auto frame : fn_info.GetFrames()) {
+        if (frame != nullptr && frame != primary_frame) {
+            return fail_ptr;
+        }
+    }
+    std::vector<const Schema*> input_schemas;
+    for (size_t i = 0; i < schemas_ctx->GetSchemaSourceSize(); ++i) {
+        input_schemas.push_back(schemas_ctx->GetSchema(i));
+    }
+    auto plan = std::make_shared<IncrementalAggPlan>(
+        *fn_info.fn_schema(), input_schemas, retractable);
+
+    auto library = udf::DefaultUdfLibrary::get();
+    auto body = fn_info.fn_def()->body();
+    auto row_arg = fn_info.fn_def()->GetArg(0);
+    size_t output_size = fn_info.fn_schema()->size();
+    if (body == nullptr || body->GetChildNum() != output_size) {
+        return fail_ptr;
+    }
+    for (size_t i = 0; i < body->GetChildNum(); ++i) {
+        auto expr = body->GetChild(i);
+        IncrementalAggType agg_type = kIncrementalColumn;
+        const node::ExprNode* input_expr = expr;
+        if (expr->GetExprType() == node::kExprCall) {
+            auto call = dynamic_cast<const node::CallExprNode*>(expr);
+            if (call->GetChildNum() != 1) {
+                return fail_ptr;
+            }
+            std::string fn_name;
+            switch (call->GetFnDef()->GetType()) {
+                case node::kExternalFnDef: {
+                    fn_name = dynamic_cast<const node::ExternalFnDefNode*>(
+                                  call->GetFnDef())
+                                  ->function_name();
+                    break;
+                }
+                case node::kUdafDef: {
+                    fn_name = dynamic_cast<const node::UdafDefNode*>(
+                                  call->GetFnDef())
+                                  ->GetName();
+                    break;
+                }
+                default:
+                    return fail_ptr;
+            }
+            // udaf is maintained by the add and retract hooks it is
+            // registered with
+            switch (library->GetUdafIncrementalKind(fn_name)) {
+                case udf::kUdafIncrementalSum:
+                    agg_type = kIncrementalSum;
+                    break;
+                case udf::kUdafIncrementalCount:
+                    agg_type = kIncrementalCount;
+                    break;
+                case udf::kUdafIncrementalAvg:
+                    agg_type = kIncrementalAvg;
+                    break;
+                case udf::kUdafIncrementalMin:
+                    agg_type = kIncrementalMin;
+                    break;
+                case udf::kUdafIncrementalMax:
+                    agg_type = kIncrementalMax;
+                    break;
+                default:
+                    return fail_ptr;
+            }
+            input_expr = call->GetChild(0);
+            if (input_expr->GetExprType() != node::kExprColumnRef) {
+                return fail_ptr;
+            }
+        }
+        size_t schema_idx;
+        size_t col_idx;
+        if (input_expr->GetExprType() == node::kExprColumnRef) {
+            // legacy agg keeps column ref as argument
+            auto status = schemas_ctx->ResolveColumnRefIndex(
+                dynamic_cast<const node::ColumnRefNode*>(input_expr),
+                &schema_idx, &col_idx);
+            if (!status.isOK()) {
+                return fail_ptr;
+            }
+        } else if (input_expr->GetExprType() == node::kExprGetField) {
+            // column of current row is lambdafied to row.c
+            auto get_field =
+                dynamic_cast<const node::GetFieldExpr*>(input_expr);
+            auto row = get_field->GetRow();
+            if (row->GetExprType() != node::kExprId ||
+                dynamic_cast<const node::ExprIdNode*>(row)->GetId() !=
+                    row_arg->GetId()) {
+                return fail_ptr;
+            }
+            auto status = schemas_ctx->ResolveColumnIndexByID(
+                get_field->GetColumnID(), &schema_idx, &col_idx);
+            if (!status.isOK()) {
+                return fail_ptr;
+            }
+        } else {
+            return fail_ptr;
+        }
+        if (!plan->AddColumn(agg_type, schema_idx, col_idx)) {
+            return fail_ptr;
+        }
+    }
+    return plan;
+}
+
+bool IncrementalAggPlan::AddColumn(IncrementalAggType agg_type,
+                                   size_t schema_idx, size_t col_idx) {
+    if (schema_idx >= input_views_.size()) {
+        return false;
+    }
+    const Schema* schema = input_views_[schema_idx].GetSchema();
+    if (col_idx >= static_cast<size_t>(schema->size())) {
+        return false;
+    }
+    size_t output_idx = outputs_.size();
+    if (output_idx >= static_cast<size_t>(output_schema_.size())) {
+        return false;
+    }
+    type::Type input_type = schema->Get(col_idx).type();
+    type::Type output_type = output_schema_.Get(output_idx).type();
+    switch (agg_type) {
+        case kIncrementalColumn: {
+            if (output_type != input_type) {
+                return false;
+            }
+            switch (input_type) {
+                case type::kBool:
+                case type::kInt16:
+                case type::kInt32:
+                case type::kInt64:
+                case type::kTimestamp:
+                case type::kFloat:
+                case type::kDouble:
+                case type::kVarchar:
+                    break;
+                default:
+                    return false;
+            }
+            outputs_.push_back(
+                {agg_type, schema_idx, col_idx, input_type, 0});
+            return true;
+        }
+        // Floating point sum can't be retracted exactly, keep it on the
+        // compiled path to produce the same result as full recompute
+        case kIncrementalSum: {
+            if (output_type != input_type) {
+                return false;
+            }
+            if (!IsIntegerType(input_type) &&
+                (retractable_ || !IsFloatType(input_type))) {
+                return false;
+            }
+            break;
+        }
+        case kIncrementalAvg: {
+            if (!IsIntegerType(input_type) || output_type != type::kDouble) {
+                return false;
+            }
+            break;
+        }
+        case kIncrementalCount: {
+            if (!IsIntegerType(input_type) && !IsFloatType(input_type)) {
+                return false;
+            }
+            if (output_type != type::kInt64) {
+                return false;
+            }
+            break;
+        }
+        case kIncrementalMin:
+        case kIncrementalMax: {
+            if (!IsIntegerType(input_type) && !IsFloatType(input_type)) {
+                return false;
+            }
+            if (output_type != input_type) {
+                return false;
+            }
+            break;
+        }
+        default:
+            return false;
+    }
+
+    // share one state between aggregations on same column
+    size_t state_idx = inputs_.size();
+    for (size_t i = 0; i < inputs_.size(); ++i) {
+        if (inputs_[i].schema_idx == schema_idx &&
+            inputs_[i].col_idx == col_idx) {
+            state_idx = i;
+            break;
+        }
+    }
+    if (state_idx == inputs_.size()) {
+        inputs_.push_back(
+            {schema_idx, col_idx, input_type, false, false, false});
+    }
+    auto& input = inputs_[state_idx];
+    input.need_sum |=
+        agg_type == kIncrementalSum || agg_type == kIncrementalAvg;
+    input.need_min |= agg_type == kIncrementalMin;
+    input.need_max |= agg_type == kIncrementalMax;
+    outputs_.push_back({agg_type, schema_idx, col_idx, input_type, state_idx});
+    return true;
+}
+
+uint32_t IncrementalAggPlan::GetColumnStrLength(const Row& row) const {
+    uint32_t str_length = 0;
+    for (auto& col : outputs_) {
+        if (col.agg_type == kIncrementalColumn &&
+            col.input_type == type::kVarchar && row.buf(col.schema_idx)) {
+            const char* str = nullptr;
+            uint32_t size = 0;
+            if (0 == input_views_[col.schema_idx].GetValue(
+                         row.buf(col.schema_idx), col.col_idx, &str, &size)) {
+                str_length += size;
+            }
+        }
+    }
+    return str_length;
+}
+
+void IncrementalAggPlan::AppendColumn(const Row& row, const OutputColumn& col,
+                                      codec::RowBuilder* builder) const {
+    const int8_t* in_buf = row.buf(col.schema_idx);
+    const RowView& view = input_views_[col.schema_idx];
+    if (in_buf == nullptr || view.IsNULL(in_buf, col.col_idx)) {
+        builder->AppendNULL();
+        return;
+    }
+    switch (col.input_type) {
+        case type::kBool: {
+            bool v = false;
+            view.GetValue(in_buf, col.col_idx, col.input_type, &v);
+            builder->AppendBool(v);
+            break;
+        }
+        case type::kInt16: {
+            int16_t v = 0;
+            view.GetValue(in_buf, col.col_idx, col.input_type, &v);
+            builder->AppendInt16(v);
+            break;
+        }
+        case type::kInt32: {
+            int32_t v = 0;
+            view.GetValue(in_buf, col.col_idx, col.input_type, &v);
+            builder->AppendInt32(v);
+            break;
+        }
+        case type::kInt64: {
+            int64_t v = 0;
+            view.GetValue(in_buf, col.col_idx, col.input_type, &v);
+            builder->AppendInt64(v);
+            break;
+        }
+        case type::kTimestamp: {
+            int64_t v = 0;
+            view.GetValue(in_buf, col.col_idx, col.input_type, &v);
+            builder->AppendTimestamp(v);
+            break;
+        }
+        case type::kFloat: {
+            float v = 0;
+            view.GetValue(in_buf, col.col_idx, col.input_type, &v);
+            builder->AppendFloat(v);
+            break;
+        }
+        case type::kDouble: {
+            double v = 0;
+            view.GetValue(in_buf, col.col_idx, col.input_type, &v);
+            builder->AppendDouble(v);
+            break;
+        }
+        case type::kVarchar: {
+            const char* str = nullptr;
+            uint32_t size = 0;
+            if (0 == view.GetValue(in_buf, col.col_idx, &str, &size)) {
+                builder->AppendString(str, size);
+            } else {
+                builder->AppendNULL();
+            }
+            break;
+        }
+        default:
+            builder->AppendNULL();
+            break;
+    }
+}
+
+bool IncrementalAggPlan::GetInput(const Row& row, const InputColumn& col,
+                                  int64_t* int_val, double* float_val) const {
+    const int8_t* buf = row.buf(col.schema_idx);
+    if (buf == nullptr) {
+        return false;
+    }
+    const RowView& view = input_views_[col.schema_idx];
+    if (view.IsNULL(buf, col.col_idx)) {
+        return false;
+    }
+    switch (col.type) {
+        case type::kInt16: {
+            int16_t v = 0;
+            view.GetValue(buf, col.col_idx, col.type, &v);
+            *int_val = v;
+            return true;
+        }
+        case type::kInt32: {
+            int32_t v = 0;
+            view.GetValue(buf, col.col_idx, col.type, &v);
+            *int_val = v;
+            return true;
+        }
+        case type::kInt64: {
+            int64_t v = 0;
+            view.GetValue(buf, col.col_idx, col.type, &v);
+            *int_val = v;
+            return true;
+        }
+        case type::kFloat: {
+            float v = 0;
+            view.GetValue(buf, col.col_idx, col.type, &v);
+            *float_val = v;
+            return true;
+        }
+        case type::kDouble: {
+            double v = 0;
+            view.GetValue(buf, col.col_idx, col.type, &v);
+            *float_val = v;
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+IncrementalWindowAgg::IncrementalWindowAgg(const IncrementalAggPlan* plan)
+    : plan_(plan),
+      window_(nullptr),
+      states_(plan->inputs().size()),
+      row_builder_(plan->output_schema()),
+      add_seq_(0),
+      pop_seq_(0),
+      extremes_dirty_(false) {}
+
+void IncrementalWindowAgg::Reset(Window* window) {
+    window_ = window;
+    states_.clear();
+    states_.resize(plan_->inputs().size());
+    add_seq_ = 0;
+    pop_seq_ = 0;
+    extremes_dirty_ = false;
+    if (nullptr != window) {
+        window->set_update_listener(this);
+    }
+}
+
+void IncrementalWindowAgg::Update(const Row& row, int64_t sign) {
+    auto& inputs = plan_->inputs();
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        int64_t int_val = 0;
+        double float_val = 0;
+        if (!plan_->GetInput(row, inputs[i], &int_val, &float_val)) {
+            continue;
+        }
+        auto& state = states_[i];
+        state.count += sign;
+        if (inputs[i].need_sum) {
+            state.int_sum += sign * int_val;
+        }
+        if (sign > 0) {
+            if (IsIntegerType(inputs[i].type)) {
+                if (inputs[i].need_min) state.int_min.Push(add_seq_, int_val);
+                if (inputs[i].need_max) state.int_max.Push(add_seq_, int_val);
+            } else {
+                if (inputs[i].need_min) {
+                    state.float_min.Push(add_seq_, float_val);
+                }
+                if (inputs[i].need_max) {
+                    state.float_max.Push(add_seq_, float_val);
+                }
+            }
+        }
+    }
+}
+
+void IncrementalWindowAgg::OnAddFront(const Row& row) {
+    ++add_seq_;
+    Update(row, 1);
+}
+
+void IncrementalWindowAgg::OnPopBack(const Row& row) {
+    ++pop_seq_;
+    Update(row, -1);
+    for (auto& state : states_) {
+        state.int_min.Pop(pop_seq_);
+        state.int_max.Pop(pop_seq_);
+        state.float_min.Pop(pop_seq_);
+        state.float_max.Pop(pop_seq_);
+    }
+}
+
+void IncrementalWindowAgg::OnPopFront(const Row& row) {
+    Update(row, -1);
+    for (auto& state : states_) {
+        // queues are rebuilt only if more than one latest row is taken out
+        // without a row added in between
+        bool kept = state.int_min.PopLatest(add_seq_);
+        kept = state.int_max.PopLatest(add_seq_) && kept;
+        kept = state.float_min.PopLatest(add_seq_) && kept;
+        kept = state.float_max.PopLatest(add_seq_) && kept;
+        if (!kept) {
+            extremes_dirty_ = true;
+        }
+    }
+    --add_seq_;
+}
+
+void IncrementalWindowAgg::RebuildExtremes() {
+    extremes_dirty_ = false;
+    auto& inputs = plan_->inputs();
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        states_[i].int_min.Clear();
+        states_[i].int_max.Clear();
+        states_[i].float_min.Clear();
+        states_[i].float_max.Clear();
+    }
+    if (nullptr == window_) {
+        return;
+    }
+    // window iterates from the latest row to the earliest one
+    auto iter = window_->GetIterator();
+    uint64_t seq = add_seq_;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), --seq) {
+        const Row& row = iter->GetValue();
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            if (!inputs[i].need_min && !inputs[i].need_max) {
+                continue;
+            }
+            int64_t int_val = 0;
+            double float_val = 0;
+            if (!plan_->GetInput(row, inputs[i], &int_val, &float_val)) {
+                continue;
+            }
+            auto& state = states_[i];
+            if (IsIntegerType(inputs[i].type)) {
+                if (inputs[i].need_min) state.int_min.PushEarlier(seq, int_val);
+                if (inputs[i].need_max) state.int_max.PushEarlier(seq, int_val);
+            } else {
+                if (inputs[i].need_min) {
+                    state.float_min.PushEarlier(seq, float_val);
+                }
+                if (inputs[i].need_max) {
+                    state.float_max.PushEarlier(seq, float_val);
+                }
+            }
+        }
+    }
+}
+
+Row IncrementalWindowAgg::Output(const Row& row) {
+    if (extremes_dirty_) {
+        RebuildExtremes();
+    }
+    uint32_t total_length =
+        row_builder_.CalTotalLength(plan_->GetColumnStrLength(row));
+    // allocate from row arena as compiled window project does
+    auto runtime = JitRuntime::get();
+    int8_t* buf = runtime->AllocRow(total_length);
+    auto slice = runtime->CreateRowSlice(buf, total_length);
+    if (!row_builder_.SetBuffer(buf, total_length)) {
+        LOG(WARNING) << "fail to encode incremental window agg output";
+        return Row();
+    }
+    for (auto& col : plan_->outputs()) {
+        if (col.agg_type == kIncrementalColumn) {
+            plan_->AppendColumn(row, col, &row_builder_);
+            continue;
+        }
+        auto& state = states_[col.state_idx];
+        switch (col.agg_type) {
+            case kIncrementalSum: {
+                AppendNumber(col.input_type, state.int_sum, 0, &row_builder_);
+                break;
+            }
+            case kIncrementalCount: {
+                row_builder_.AppendInt64(state.count);
+                break;
+            }
+            case kIncrementalAvg: {
+                row_builder_.AppendDouble(static_cast<double>(state.int_sum) /
+                                          static_cast<double>(state.count));
+                break;
+            }
+            case kIncrementalMin:
+            case kIncrementalMax: {
+                bool is_min = col.agg_type == kIncrementalMin;
+                if (0 == state.count) {
+                    row_builder_.AppendNULL();
+                    break;
+                }
+                if (IsIntegerType(col.input_type)) {
+                    AppendNumber(col.input_type,
+                                 is_min ? state.int_min.Top()
+                                        : state.int_max.Top(),
+                                 0, &row_builder_);
+                } else {
+                    AppendNumber(col.input_type, 0,
+                                 is_min ? state.float_min.Top()
+                                        : state.float_max.Top(),
+                                 &row_builder_);
+                }
+                break;
+            }
+            default:
+                row_builder_.AppendNULL();
+                break;
+        }
+    }
+    return Row(slice);
+}
+
+const size_t HashGroupAgg::kInitSlotCnt;
+
+HashGroupAgg::HashGroupAgg(const IncrementalAggPlan* plan)
+    : plan_(plan),
+      groups_(),
+      states_(),
+      slots_(kInitSlotCnt, 0),
+      row_builder_(plan->output_schema()) {}
+
+void HashGroupAgg::Update(const codec::BinaryKey& key, const Row& row) {
+    auto& inputs = plan_->inputs();
+    // states may be reallocated when a new group is inserted
+    size_t group_idx = FindOrInsert(key, row);
+    State* states = states_.data() + group_idx * inputs.size();
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        int64_t int_val = 0;
+        double float_val = 0;
+        if (!plan_->GetInput(row, inputs[i], &int_val, &float_val)) {
+            continue;
+        }
+        auto& state = states[i];
+        bool first = 0 == state.count;
+        state.count++;
+        if (IsIntegerType(inputs[i].type)) {
+            state.int_sum += int_val;
+            state.int_min = first ? int_val : std::min(state.int_min, int_val);
+            state.int_max = first ? int_val : std::max(state.int_max, int_val);
+        } else {
+            // float sum accumulates in float as the compiled sum does
+            state.float_sum =
+                type::kFloat == inputs[i].type
+                    ? static_cast<float>(state.float_sum) +
+                          static_cast<float>(float_val)
+                    : state.float_sum + float_val;
+            state.float_min =
+                first ? float_val : std::min(state.float_min, float_val);
+            state.float_max =
+                first ? float_val : std::max(state.float_max, float_val);
+        }
+    }
+}
+
+size_t HashGroupAgg::FindOrInsert(const codec::BinaryKey& key,
+                                  const Row& row) {
+    size_t mask = slots_.size() - 1;
+    size_t pos = key.hash() & mask;
+    while (0 != slots_[pos]) {
+        const Group& group = groups_[slots_[pos] - 1];
+        if (group.hash == key.hash() && group.key.size() == key.size() &&
+            0 == memcmp(group.key.data(), key.data(), key.size())) {
+            return slots_[pos] - 1;
+        }
+        pos = (pos + 1) & mask;
+    }
+    size_t group_idx = groups_.size();
+    groups_.push_back({key.ToString(), key.hash(), row});
+    states_.resize(states_.size() + plan_->inputs().size());
+    slots_[pos] = static_cast<uint32_t>(group_idx + 1);
+    // keep load factor under a half so that probing stays short
+    if (groups_.size() * 2 > slots_.size()) {
+        Rehash(slots_.size() * 2);
+    }
+    return group_idx;
+}
+
+void HashGroupAgg::Rehash(size_t slot_cnt) {
+    slots_.assign(slot_cnt, 0);
+    size_t mask = slot_cnt - 1;
+    for (size_t i = 0; i < groups_.size(); ++i) {
+        size_t pos = groups_[i].hash & mask;
+        while (0 != slots_[pos]) {
+            pos = (pos + 1) & mask;
+        }
+        slots_[pos] = static_cast<uint32_t>(i + 1);
+    }
+}
+
+void HashGroupAgg::Output(int32_t limit_cnt, MemTableHandler* output) {
+    std::vector<uint32_t> order(groups_.size());
+    std::iota(order.begin(), order.end(), 0);
+    size_t cnt = order.size();
+    if (limit_cnt > 0 && static_cast<size_t>(limit_cnt) < cnt) {
+        cnt = static_cast<size_t>(limit_cnt);
+    }
+    std::partial_sort(order.begin(), order.begin() + cnt, order.end(),
+                      [this](uint32_t l, uint32_t r) {
+                          return groups_[l].key > groups_[r].key;
+                      });
+    for (size_t i = 0; i < cnt; ++i) {
+        output->AddRow(OutputGroup(order[i]));
+    }
+}
+
+Row HashGroupAgg::OutputGroup(size_t group_idx) {
+    const Row& row = groups_[group_idx].row;
+    const State* states = states_.data() + group_idx * plan_->inputs().size();
+    uint32_t total_length =
+        row_builder_.CalTotalLength(plan_->GetColumnStrLength(row));
+    auto runtime = JitRuntime::get();
+    int8_t* buf = runtime->AllocRow(total_length);
+    auto slice = runtime->CreateRowSlice(buf, total_length);
+    if (!row_builder_.SetBuffer(buf, total_length)) {
+        LOG(WARNING) << "fail to encode hash group agg output";
+        return Row();
+    }
+    for (auto& col : plan_->outputs()) {
+        if (col.agg_type == kIncrementalColumn) {
+            plan_->AppendColumn(row, col, &row_builder_);
+            continue;
+        }
+        auto& state = states[col.state_idx];
+        switch (col.agg_type) {
+            case kIncrementalSum: {
+                AppendNumber(col.input_type, state.int_sum, state.float_sum,
+                             &row_builder_);
+                break;
+            }
+            case kIncrementalCount: {
+                row_builder_.AppendInt64(state.count);
+                break;
+            }
+            case kIncrementalAvg: {
+                row_builder_.AppendDouble(static_cast<double>(state.int_sum) /
+                                          static_cast<double>(state.count));
+                break;
+            }
+            case kIncrementalMin:
+            case kIncrementalMax: {
+                bool is_min = col.agg_type == kIncrementalMin;
+                if (0 == state.count) {
+                    row_builder_.AppendNULL();
+                    break;
+                }
+                AppendNumber(col.input_type,
+                             is_min ? state.int_min : state.int_max,
+                             is_min ? state.float_min : state.float_max,
+                             &row_builder_);
+                break;
+            }
+            default:
+                row_builder_.AppendNULL();
+                break;
+        }
+    }
+    return Row(slice);
+}
+
+}  // namespace vm
+}  // namespace hybridse
@@ -0,0 +1,309 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SRC_VM_INCREMENTAL_AGG_H_
+#define SRC_VM_INCREMENTAL_AGG_H_
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "codec/binary_key.h"
+#include "codec/fe_row_codec.h"
+#include "vm/mem_catalog.h"
+#include "vm/physical_op.h"
+
+namespace hybridse {
+namespace vm {
+
+using codec::Row;
+using codec::RowView;
+
+enum IncrementalAggType {
+    kIncrementalColumn,  // column of current row
+    kIncrementalSum,
+    kIncrementalCount,
+    kIncrementalAvg,
+    kIncrementalMin,
+    kIncrementalMax,
+};
+
+/**
+ * Sliding minimum or maximum of window values. Values enter from the latest
+ * side and leave from the earliest side, each value is pushed and popped at
+ * most once, so updates are amortized O(1).
+ *
+ * The latest value is held apart until the next push, so taking the latest
+ * row out again, as a request row out of window is, costs O(1) and drops no
+ * candidate of earlier rows.
+ */
+template <typename T>
+class MonotonicQueue {
+ public:
+    explicit MonotonicQueue(bool is_min)
+        : is_min_(is_min), has_latest_(false), latest_() {}
+
+    void Push(uint64_t seq, T value) {
+        if (has_latest_) {
+            PushBack(latest_);
+        }
+        latest_ = std::make_pair(seq, value);
+        has_latest_ = true;
+    }
+    // Earliest value with `seq` leaves the window
+    void Pop(uint64_t seq) {
+        if (!queue_.empty()) {
+            if (queue_.front().first == seq) {
+                queue_.pop_front();
+            }
+        } else if (has_latest_ && latest_.first == seq) {
+            has_latest_ = false;
+        }
+    }
+    // Latest value with `seq` is taken out of the window. Return false if
+    // candidates it replaced are lost and the queue must be rebuilt
+    bool PopLatest(uint64_t seq) {
+        if (has_latest_ && latest_.first == seq) {
+            has_latest_ = false;
+            return true;
+        }
+        if (!queue_.empty() && queue_.back().first == seq) {
+            queue_.pop_back();
+            return false;
+        }
+        return true;
+    }
+    // Rebuild from earlier side, values must be pushed from the latest one
+    // to the earliest one
+    void PushEarlier(uint64_t seq, T value) {
+        if (queue_.empty() || Before(value, queue_.front().second)) {
+            queue_.emplace_front(seq, value);
+        }
+    }
+    void Clear() {
+        queue_.clear();
+        has_latest_ = false;
+    }
+    bool empty() const { return queue_.empty() && !has_latest_; }
+    T Top() const {
+        if (queue_.empty()) {
+            return latest_.second;
+        }
+        if (has_latest_ && Before(latest_.second, queue_.front().second)) {
+            return latest_.second;
+        }
+        return queue_.front().second;
+    }
+
+ private:
+    inline bool Before(T l, T r) const { return is_min_ ? l < r : l > r; }
+    void PushBack(const std::pair<uint64_t, T>& entry) {
+        while (!queue_.empty() && !Before(queue_.back().second, entry.second)) {
+            queue_.pop_back();
+        }
+        queue_.push_back(entry);
+    }
+    bool is_min_;
+    std::deque<std::pair<uint64_t, T>> queue_;
+    // latest value not merged into `queue_` yet
+    bool has_latest_;
+    std::pair<uint64_t, T> latest_;
+};
+
+/**
+ * Layout of a window aggregation whose outputs can be maintained
+ * incrementally while the window slides. Every output column is either a
+ * column of the current row or one of sum/count/avg/min/max over a column
+ * of window rows.
+ *
+ * A plan that is not `retractable` only accumulates rows, as GROUP BY
+ * does, so floating point sum is allowed there.
+ */
+class IncrementalAggPlan {
+ public:
+    IncrementalAggPlan(const Schema& output_schema,
+                       const std::vector<const Schema*>& input_schemas,
+                       bool retractable = true);
+
+    /**
+     * Build plan from window or group project function, return null if any
+     * output can not be maintained incrementally.
+     */
+    static std::shared_ptr<IncrementalAggPlan> Build(const FnInfo& fn_info,
+                                                     bool retractable = true);
+
+    /**
+     * Append next output column, return false if the aggregation is not
+     * supported on input column type.
+     */
+    bool AddColumn(IncrementalAggType agg_type, size_t schema_idx,
+                   size_t col_idx);
+
+    struct OutputColumn {
+        IncrementalAggType agg_type;
+        size_t schema_idx;
+        size_t col_idx;
+        type::Type input_type;
+        // index of input column state, only for aggregations
+        size_t state_idx;
+    };
+    struct InputColumn {
+        size_t schema_idx;
+        size_t col_idx;
+        type::Type type;
+        bool need_sum;
+        bool need_min;
+        bool need_max;
+    };
+
+    // Read non-null value of input `col` from `row`
+    bool GetInput(const Row& row, const InputColumn& col, int64_t* int_val,
+                  double* float_val) const;
+    // Total size of string columns taken from `row`
+    uint32_t GetColumnStrLength(const Row& row) const;
+    // Append output `col` taken from `row`, the column must be
+    // `kIncrementalColumn`
+    void AppendColumn(const Row& row, const OutputColumn& col,
+                      codec::RowBuilder* builder) const;
+
+    bool retractable() const { return retractable_; }
+    const Schema& output_schema() const { return output_schema_; }
+    const std::vector<OutputColumn>& outputs() const { return outputs_; }
+    const std::vector<InputColumn>& inputs() const { return inputs_; }
+    const RowView& input_view(size_t schema_idx) const {
+        return input_views_[schema_idx];
+    }
+
+ private:
+    Schema output_schema_;
+    std::vector<RowView> input_views_;
+    std::vector<OutputColumn> outputs_;
+    std::vector<InputColumn> inputs_;
+    bool retractable_;
+};
+
+/**
+ * Aggregation states of a single window. States are updated by window
+ * callbacks when rows enter or leave the window, so output of each row
+ * costs O(1) instead of rescanning the window.
+ */
+class IncrementalWindowAgg : public WindowUpdateListener {
+ public:
+    explicit IncrementalWindowAgg(const IncrementalAggPlan* plan);
+    ~IncrementalWindowAgg() {}
+
+    // Clear states and listen on `window`
+    void Reset(Window* window);
+
+    void OnAddFront(const Row& row) override;
+    void OnPopBack(const Row& row) override;
+    void OnPopFront(const Row& row) override;
+
+    // Encode output row of `row` with current window states
+    Row Output(const Row& row);
+
+ private:
+    struct State {
+        State()
+            : count(0),
+              int_sum(0),
+              int_min(true),
+              int_max(false),
+              float_min(true),
+              float_max(false) {}
+        int64_t count;
+        int64_t int_sum;
+        MonotonicQueue<int64_t> int_min;
+        MonotonicQueue<int64_t> int_max;
+        MonotonicQueue<double> float_min;
+        MonotonicQueue<double> float_max;
+    };
+    void Update(const Row& row, int64_t sign);
+    void RebuildExtremes();
+
+    const IncrementalAggPlan* plan_;
+    Window* window_;
+    std::vector<State> states_;
+    codec::RowBuilder row_builder_;
+    // sequence of latest and earliest rows in window
+    uint64_t add_seq_;
+    uint64_t pop_seq_;
+    // min/max queues lost candidates after latest rows were taken out
+    bool extremes_dirty_;
+};
+
+/**
+ * Streaming GROUP BY aggregation. Groups live in an open addressing table
+ * keyed on binary group key, and each group keeps its first row and one
+ * state per input column, so memory grows with groups instead of rows.
+ */
+class HashGroupAgg {
+ public:
+    explicit HashGroupAgg(const IncrementalAggPlan* plan);
+    ~HashGroupAgg() {}
+
+    // Accumulate `row` into group of sealed `key`
+    void Update(const codec::BinaryKey& key, const Row& row);
+
+    // Encode a row per group into `output`. Groups are ordered by key
+    // descending, the same as segments of MemPartitionHandler. Output at
+    // most `limit_cnt` rows if it is positive.
+    void Output(int32_t limit_cnt, MemTableHandler* output);
+
+    size_t GetGroupCount() const { return groups_.size(); }
+
+ private:
+    struct State {
+        State()
+            : count(0),
+              int_sum(0),
+              float_sum(0),
+              int_min(0),
+              int_max(0),
+              float_min(0),
+              float_max(0) {}
+        int64_t count;
+        int64_t int_sum;
+        double float_sum;
+        int64_t int_min;
+        int64_t int_max;
+        double float_min;
+        double float_max;
+    };
+    struct Group {
+        std::string key;
+        uint64_t hash;
+        // first row of group, provides column outputs
+        Row row;
+    };
+    static const size_t kInitSlotCnt = 64;
+
+    size_t FindOrInsert(const codec::BinaryKey& key, const Row& row);
+    void Rehash(size_t slot_cnt);
+    Row OutputGroup(size_t group_idx);
+
+    const IncrementalAggPlan* plan_;
+    std::vector<Group> groups_;
+    // states of group `i` are [i * inputs, (i + 1) * inputs)
+    std::vector<State> states_;
+    // linear probing slots of group index plus one, zero for empty slot
+    std::vector<uint32_t> slots_;
+    codec::RowBuilder row_builder_;
+};
+
+}  // namespace vm
+}  // namespace hybridse
+#endif  // SRC_VM_INCREMENTAL_AGG_H_
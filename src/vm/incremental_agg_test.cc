@@ -0,0 +1,335 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vm/incremental_agg.h"
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace hybridse {
+namespace vm {
+
+class IncrementalAggTest : public ::testing::Test {
+ public:
+    IncrementalAggTest() {
+        AddColumn(&input_schema_, "c0", type::kInt32);
+        AddColumn(&input_schema_, "c1", type::kInt64);
+        AddColumn(&input_schema_, "c2", type::kDouble);
+
+        AddColumn(&output_schema_, "c0", type::kInt32);
+        AddColumn(&output_schema_, "sum_c1", type::kInt64);
+        AddColumn(&output_schema_, "count_c1", type::kInt64);
+        AddColumn(&output_schema_, "avg_c1", type::kDouble);
+        AddColumn(&output_schema_, "min_c2", type::kDouble);
+        AddColumn(&output_schema_, "max_c2", type::kDouble);
+        AddColumn(&output_schema_, "max_c0", type::kInt32);
+    }
+    ~IncrementalAggTest() {}
+
+    static void AddColumn(Schema* schema, const std::string& name,
+                          type::Type type) {
+        auto col = schema->Add();
+        col->set_name(name);
+        col->set_type(type);
+    }
+
+    std::shared_ptr<IncrementalAggPlan> BuildPlan() {
+        auto plan = std::make_shared<IncrementalAggPlan>(
+            output_schema_, std::vector<const Schema*>({&input_schema_}));
+        EXPECT_TRUE(plan->AddColumn(kIncrementalColumn, 0, 0));
+        EXPECT_TRUE(plan->AddColumn(kIncrementalSum, 0, 1));
+        EXPECT_TRUE(plan->AddColumn(kIncrementalCount, 0, 1));
+        EXPECT_TRUE(plan->AddColumn(kIncrementalAvg, 0, 1));
+        EXPECT_TRUE(plan->AddColumn(kIncrementalMin, 0, 2));
+        EXPECT_TRUE(plan->AddColumn(kIncrementalMax, 0, 2));
+        EXPECT_TRUE(plan->AddColumn(kIncrementalMax, 0, 0));
+        return plan;
+    }
+
+    Row BuildRow(int32_t c0, int64_t c1, bool c1_null, double c2) {
+        codec::RowBuilder builder(input_schema_);
+        uint32_t size = builder.CalTotalLength(0);
+        int8_t* buf = reinterpret_cast<int8_t*>(malloc(size));
+        builder.SetBuffer(buf, size);
+        builder.AppendInt32(c0);
+        if (c1_null) {
+            builder.AppendNULL();
+        } else {
+            builder.AppendInt64(c1);
+        }
+        builder.AppendDouble(c2);
+        return Row(base::RefCountedSlice::CreateManaged(buf, size));
+    }
+
+    // Check output against aggregations recomputed over window rows
+    void CheckOutput(const Row& output, const Row& current, Window* window) {
+        codec::RowView in_view(input_schema_);
+        int64_t sum = 0;
+        int64_t cnt = 0;
+        double min_c2 = 0;
+        double max_c2 = 0;
+        int32_t max_c0 = 0;
+        bool first = true;
+        auto iter = window->GetIterator();
+        for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+            const int8_t* buf = iter->GetValue().buf();
+            if (!in_view.IsNULL(buf, 1)) {
+                int64_t v = 0;
+                in_view.GetValue(buf, 1, type::kInt64, &v);
+                sum += v;
+                cnt++;
+            }
+            double d = 0;
+            in_view.GetValue(buf, 2, type::kDouble, &d);
+            int32_t c0 = 0;
+            in_view.GetValue(buf, 0, type::kInt32, &c0);
+            min_c2 = first ? d : std::min(min_c2, d);
+            max_c2 = first ? d : std::max(max_c2, d);
+            max_c0 = first ? c0 : std::max(max_c0, c0);
+            first = false;
+        }
+        codec::RowView out_view(output_schema_);
+        const int8_t* buf = output.buf();
+        int32_t c0 = 0;
+        int32_t cur_c0 = 0;
+        out_view.GetValue(buf, 0, type::kInt32, &c0);
+        in_view.GetValue(current.buf(), 0, type::kInt32, &cur_c0);
+        ASSERT_EQ(cur_c0, c0);
+        int64_t out_sum = 0;
+        out_view.GetValue(buf, 1, type::kInt64, &out_sum);
+        ASSERT_EQ(sum, out_sum);
+        int64_t out_cnt = 0;
+        out_view.GetValue(buf, 2, type::kInt64, &out_cnt);
+        ASSERT_EQ(cnt, out_cnt);
+        if (cnt > 0) {
+            double out_avg = 0;
+            out_view.GetValue(buf, 3, type::kDouble, &out_avg);
+            ASSERT_DOUBLE_EQ(static_cast<double>(sum) / cnt, out_avg);
+        }
+        double out_min = 0;
+        double out_max = 0;
+        int32_t out_max_c0 = 0;
+        out_view.GetValue(buf, 4, type::kDouble, &out_min);
+        out_view.GetValue(buf, 5, type::kDouble, &out_max);
+        out_view.GetValue(buf, 6, type::kInt32, &out_max_c0);
+        ASSERT_EQ(min_c2, out_min);
+        ASSERT_EQ(max_c2, out_max);
+        ASSERT_EQ(max_c0, out_max_c0);
+    }
+
+    Schema input_schema_;
+    Schema output_schema_;
+};
+
+TEST_F(IncrementalAggTest, MonotonicQueueTest) {
+    MonotonicQueue<int64_t> min_queue(true);
+    MonotonicQueue<int64_t> max_queue(false);
+    std::vector<int64_t> values = {5, 3, 8, 1, 9, 2, 7};
+    // window of 3 rows
+    for (size_t i = 0; i < values.size(); ++i) {
+        min_queue.Push(i + 1, values[i]);
+        max_queue.Push(i + 1, values[i]);
+        if (i >= 3) {
+            min_queue.Pop(i - 2);
+            max_queue.Pop(i - 2);
+        }
+        size_t begin = i >= 3 ? i - 2 : 0;
+        auto first = values.begin() + begin;
+        auto last = values.begin() + i + 1;
+        ASSERT_EQ(*std::min_element(first, last), min_queue.Top());
+        ASSERT_EQ(*std::max_element(first, last), max_queue.Top());
+    }
+}
+
+TEST_F(IncrementalAggTest, MonotonicQueuePopLatestTest) {
+    MonotonicQueue<int64_t> min_queue(true);
+    std::vector<int64_t> values = {5, 3, 8, 6};
+    for (size_t i = 0; i < values.size(); ++i) {
+        min_queue.Push(i + 1, values[i]);
+    }
+    // latest value replacing every candidate is taken out in O(1)
+    min_queue.Push(5, 1);
+    ASSERT_EQ(1, min_queue.Top());
+    ASSERT_TRUE(min_queue.PopLatest(5));
+    ASSERT_EQ(3, min_queue.Top());
+    min_queue.Pop(1);
+    min_queue.Pop(2);
+    ASSERT_EQ(6, min_queue.Top());
+    // latest value not pushed, e.g. null, leaves queue untouched
+    ASSERT_TRUE(min_queue.PopLatest(5));
+    ASSERT_EQ(6, min_queue.Top());
+    // latest value merged by a later push can't be taken out without
+    // rebuild, since candidates it replaced are gone
+    ASSERT_FALSE(min_queue.PopLatest(4));
+    min_queue.Clear();
+    ASSERT_TRUE(min_queue.empty());
+}
+
+TEST_F(IncrementalAggTest, RowsWindowTest) {
+    auto plan = BuildPlan();
+    IncrementalWindowAgg agg(plan.get());
+    HistoryWindow window(WindowRange::CreateRowsWindow(3));
+    agg.Reset(&window);
+    std::vector<double> c2 = {5.5, 3.0, 8.0, 1.0, 9.5, 2.0, 7.0, 7.0, 0.5};
+    for (size_t i = 0; i < c2.size(); ++i) {
+        Row row = BuildRow(static_cast<int32_t>(c2.size() - i),
+                           static_cast<int64_t>(i * 10), i % 3 == 1, c2[i]);
+        ASSERT_TRUE(window.BufferData(i + 1, row));
+        CheckOutput(agg.Output(row), row, &window);
+    }
+}
+
+TEST_F(IncrementalAggTest, RowsRangeWindowTest) {
+    auto plan = BuildPlan();
+    IncrementalWindowAgg agg(plan.get());
+    HistoryWindow window(WindowRange::CreateRowsRangeWindow(-5, 0));
+    agg.Reset(&window);
+    std::vector<uint64_t> ts = {1, 2, 2, 4, 9, 10, 11, 20, 21, 22, 23};
+    for (size_t i = 0; i < ts.size(); ++i) {
+        Row row = BuildRow(static_cast<int32_t>(i % 4), -3 + i, false,
+                           static_cast<double>((i * 7) % 5));
+        ASSERT_TRUE(window.BufferData(ts[i], row));
+        CheckOutput(agg.Output(row), row, &window);
+    }
+}
+
+TEST_F(IncrementalAggTest, InstanceNotInWindowTest) {
+    auto plan = BuildPlan();
+    IncrementalWindowAgg agg(plan.get());
+    HistoryWindow window(WindowRange::CreateRowsRangeWindow(-10, 0));
+    window.set_instance_not_in_window(true);
+    agg.Reset(&window);
+    for (size_t i = 0; i < 12; ++i) {
+        // union row stays in window
+        Row union_row = BuildRow(static_cast<int32_t>(i), i, false,
+                                 static_cast<double>(i % 4));
+        ASSERT_TRUE(window.BufferData(i * 2 + 1, union_row));
+        // instance row is taken out after output
+        Row row = BuildRow(100, 1000, false, -1.0 * i);
+        ASSERT_TRUE(window.BufferData(i * 2 + 2, row));
+        CheckOutput(agg.Output(row), row, &window);
+        window.PopFrontData();
+    }
+    // take out more than one latest row before next output
+    Row last_row = BuildRow(7, 70, false, -100.0);
+    ASSERT_TRUE(window.BufferData(25, last_row));
+    window.PopFrontData();
+    window.PopFrontData();
+    Row row = BuildRow(100, 1000, false, 50.0);
+    ASSERT_TRUE(window.BufferData(26, row));
+    CheckOutput(agg.Output(row), row, &window);
+}
+
+TEST_F(IncrementalAggTest, UnsupportedColumnTest) {
+    Schema output_schema;
+    AddColumn(&output_schema, "sum_c2", type::kDouble);
+    IncrementalAggPlan plan(output_schema,
+                            std::vector<const Schema*>({&input_schema_}));
+    // floating point sum is not retracted
+    ASSERT_FALSE(plan.AddColumn(kIncrementalSum, 0, 2));
+}
+
+TEST_F(IncrementalAggTest, HashGroupAggTest) {
+    Schema output_schema;
+    AddColumn(&output_schema, "c0", type::kInt32);
+    AddColumn(&output_schema, "sum_c1", type::kInt64);
+    AddColumn(&output_schema, "count_c1", type::kInt64);
+    AddColumn(&output_schema, "sum_c2", type::kDouble);
+    AddColumn(&output_schema, "min_c2", type::kDouble);
+    AddColumn(&output_schema, "max_c1", type::kInt64);
+    // group by is never retracted, so floating point sum is allowed
+    IncrementalAggPlan plan(output_schema,
+                            std::vector<const Schema*>({&input_schema_}),
+                            false);
+    ASSERT_TRUE(plan.AddColumn(kIncrementalColumn, 0, 0));
+    ASSERT_TRUE(plan.AddColumn(kIncrementalSum, 0, 1));
+    ASSERT_TRUE(plan.AddColumn(kIncrementalCount, 0, 1));
+    ASSERT_TRUE(plan.AddColumn(kIncrementalSum, 0, 2));
+    ASSERT_TRUE(plan.AddColumn(kIncrementalMin, 0, 2));
+    ASSERT_TRUE(plan.AddColumn(kIncrementalMax, 0, 1));
+
+    // enough groups to rehash the table several times
+    const int64_t group_cnt = 1000;
+    HashGroupAgg agg(&plan);
+    for (int64_t i = 0; i < group_cnt * 3; ++i) {
+        int64_t group = (i * 7) % group_cnt;
+        codec::BinaryKey key;
+        key.AppendInt64(group);
+        key.Seal();
+        agg.Update(key, BuildRow(static_cast<int32_t>(i), i, i % 5 == 0,
+                                 static_cast<double>(i % 11)));
+    }
+    ASSERT_EQ(static_cast<size_t>(group_cnt), agg.GetGroupCount());
+
+    MemTableHandler output;
+    agg.Output(10, &output);
+    ASSERT_EQ(10u, output.GetCount());
+    codec::RowView view(output_schema);
+    auto iter = output.GetIterator();
+    int64_t expect_group = group_cnt - 1;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), --expect_group) {
+        int64_t sum = 0;
+        int64_t cnt = 0;
+        int64_t max_c1 = 0;
+        double sum_c2 = 0;
+        double min_c2 = 0;
+        int32_t first_c0 = -1;
+        for (int64_t i = 0; i < group_cnt * 3; ++i) {
+            if ((i * 7) % group_cnt != expect_group) {
+                continue;
+            }
+            double c2 = static_cast<double>(i % 11);
+            min_c2 = first_c0 < 0 ? c2 : std::min(min_c2, c2);
+            sum_c2 += c2;
+            if (first_c0 < 0) {
+                first_c0 = static_cast<int32_t>(i);
+            }
+            if (i % 5 != 0) {
+                max_c1 = cnt == 0 ? i : std::max(max_c1, i);
+                sum += i;
+                cnt++;
+            }
+        }
+        const int8_t* buf = iter->GetValue().buf();
+        int32_t c0 = 0;
+        view.GetValue(buf, 0, type::kInt32, &c0);
+        ASSERT_EQ(first_c0, c0);
+        int64_t out_sum = 0;
+        view.GetValue(buf, 1, type::kInt64, &out_sum);
+        ASSERT_EQ(sum, out_sum);
+        int64_t out_cnt = 0;
+        view.GetValue(buf, 2, type::kInt64, &out_cnt);
+        ASSERT_EQ(cnt, out_cnt);
+        double out_sum_c2 = 0;
+        view.GetValue(buf, 3, type::kDouble, &out_sum_c2);
+        ASSERT_EQ(sum_c2, out_sum_c2);
+        double out_min_c2 = 0;
+        view.GetValue(buf, 4, type::kDouble, &out_min_c2);
+        ASSERT_EQ(min_c2, out_min_c2);
+        int64_t out_max_c1 = 0;
+        view.GetValue(buf, 5, type::kInt64, &out_max_c1);
+        ASSERT_EQ(max_c1, out_max_c1);
+    }
+}
+
+}  // namespace vm
+}  // namespace hybridse
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
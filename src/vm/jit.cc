@@ -22,6 +22,7 @@ extern "C" {
 #include <cstdlib>
 }
 #include "glog/logging.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
 #include "llvm/ExecutionEngine/JITEventListener.h"
 #include "llvm/ExecutionEngine/JITSymbol.h"
 #include "llvm/ExecutionEngine/Orc/CompileUtils.h"
@@ -36,6 +37,10 @@ extern "C" {
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Verifier.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/IPO/AlwaysInliner.h"
+#include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "llvm/Transforms/InstCombine/InstCombine.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Scalar/GVN.h"
@@ -52,7 +57,24 @@ HybridSeJit::HybridSeJit(::llvm::orc::LLJITBuilderState& s, ::llvm::Error& e)
     : LLJIT(s, e) {}
 HybridSeJit::~HybridSeJit() {}
 
+// inline calls marked always inline, e.g. row functions of block loops
+static void RunAlwaysInlinePass(::llvm::Module* m) {
+    ::llvm::legacy::PassManager mpm;
+    mpm.add(::llvm::createAlwaysInlinerLegacyPass());
+    mpm.run(*m);
+}
+
+static void RunFunctionPasses(::llvm::legacy::FunctionPassManager* fpm,
+                              ::llvm::Module* m) {
+    fpm->doInitialization();
+    for (auto it = m->begin(); it != m->end(); ++it) {
+        fpm->run(*it);
+    }
+    fpm->doFinalization();
+}
+
 static void RunDefaultOptPasses(::llvm::Module* m) {
+    RunAlwaysInlinePass(m);
     ::llvm::legacy::FunctionPassManager fpm(m);
     // Add some optimizations.
     fpm.add(::llvm::createInstructionCombiningPass());
@@ -60,9 +82,80 @@ static void RunDefaultOptPasses(::llvm::Module* m) {
     fpm.add(::llvm::createGVNPass());
     fpm.add(::llvm::createCFGSimplificationPass());
     fpm.add(::llvm::createPromoteMemoryToRegisterPass());
-    fpm.doInitialization();
-    for (auto it = m->begin(); it != m->end(); ++it) {
-        fpm.run(*it);
+    RunFunctionPasses(&fpm, m);
+}
+
+// Cheapest passes for the first compile of a query, registers instead of
+// stack slots is what machine code generation needs most
+static void RunFastOptPasses(::llvm::Module* m) {
+    RunAlwaysInlinePass(m);
+    ::llvm::legacy::FunctionPassManager fpm(m);
+    fpm.add(::llvm::createPromoteMemoryToRegisterPass());
+    fpm.add(::llvm::createCFGSimplificationPass());
+    RunFunctionPasses(&fpm, m);
+}
+
+// Standard -O2/-O3 module pipeline with inliner, loop and SLP vectorizers,
+// costs are taken from host target so that vector width is known
+static void RunFullOptPasses(::llvm::Module* m, uint32_t opt_level) {
+    ::llvm::PassManagerBuilder builder;
+    builder.OptLevel = opt_level;
+    builder.SizeLevel = 0;
+    builder.Inliner = ::llvm::createFunctionInliningPass(opt_level, 0, false);
+    builder.LoopVectorize = true;
+    builder.SLPVectorize = true;
+
+    ::llvm::legacy::FunctionPassManager fpm(m);
+    ::llvm::legacy::PassManager mpm;
+    std::unique_ptr<::llvm::TargetMachine> tm;
+    auto jtmb = ::llvm::orc::JITTargetMachineBuilder::detectHost();
+    if (jtmb) {
+        auto tm_or_err = jtmb->createTargetMachine();
+        if (tm_or_err) {
+            tm = std::move(*tm_or_err);
+        } else {
+            LOG(WARNING) << "fail to create host target machine: "
+                         << ::llvm::toString(tm_or_err.takeError());
+        }
+    } else {
+        LOG(WARNING) << "fail to detect host target: "
+                     << ::llvm::toString(jtmb.takeError());
+    }
+    if (tm != nullptr) {
+        fpm.add(::llvm::createTargetTransformInfoWrapperPass(
+            tm->getTargetIRAnalysis()));
+        mpm.add(::llvm::createTargetTransformInfoWrapperPass(
+            tm->getTargetIRAnalysis()));
+    }
+    builder.populateFunctionPassManager(fpm);
+    builder.populateModulePassManager(mpm);
+    RunFunctionPasses(&fpm, m);
+    mpm.run(*m);
+}
+
+static void RunOptPasses(::llvm::Module* m, uint32_t opt_level) {
+    switch (opt_level) {
+        case 0:
+            RunFastOptPasses(m);
+            break;
+        case 1:
+            RunDefaultOptPasses(m);
+            break;
+        default:
+            RunFullOptPasses(m, opt_level > 3 ? 3 : opt_level);
+            break;
+    }
+}
+
+static ::llvm::CodeGenOpt::Level JitCodeGenOptLevel(uint32_t opt_level) {
+    switch (opt_level) {
+        case 0:
+            return ::llvm::CodeGenOpt::None;
+        case 1:
+        case 2:
+            return ::llvm::CodeGenOpt::Default;
+        default:
+            return ::llvm::CodeGenOpt::Aggressive;
     }
 }
 
@@ -78,12 +171,12 @@ static void RunDefaultOptPasses(::llvm::Module* m) {
     return CompileLayer->add(jd, std::move(tsm), key);
 }
 
-bool HybridSeJit::OptModule(::llvm::Module* m) {
+bool HybridSeJit::OptModule(::llvm::Module* m, uint32_t opt_level) {
     if (auto err = applyDataLayout(*m)) {
         return false;
     }
     DLOG(INFO) << "Module before opt:\n" << LlvmToString(*m);
-    RunDefaultOptPasses(m);
+    RunOptPasses(m, opt_level);
     DLOG(INFO) << "Module after opt:\n" << LlvmToString(*m);
     return true;
 }
@@ -150,8 +243,34 @@ bool HybridSeJit::AddSymbol(::llvm::orc::JITDylib& jd,
 
 bool HybridSeLlvmJitWrapper::Init() {
     DLOG(INFO) << "Start to initialize hybridse jit";
-    auto jit = ::llvm::Expected<std::unique_ptr<HybridSeJit>>(
-        HybridSeJitBuilder().create());
+    HybridSeJitBuilder builder;
+    auto jtmb = ::llvm::orc::JITTargetMachineBuilder::detectHost();
+    if (!jtmb) {
+        LOG(WARNING) << "fail to detect host target: "
+                     << ::llvm::toString(jtmb.takeError());
+        return false;
+    }
+    jtmb->setCodeGenOptLevel(JitCodeGenOptLevel(jit_options_.opt_level()));
+    builder.setJITTargetMachineBuilder(std::move(*jtmb));
+    if (!jit_options_.object_cache_dir().empty()) {
+        object_cache_ = std::unique_ptr<JitObjectCache>(
+            new JitObjectCache(jit_options_.object_cache_dir(),
+                               jit_options_.object_cache_capacity()));
+        // same as default LLJIT compiler except the object cache
+        typedef ::llvm::orc::IRCompileLayer::CompileFunction CompileFunction;
+        JitObjectCache* cache = object_cache_.get();
+        builder.setCompileFunctionCreator(
+            [cache](::llvm::orc::JITTargetMachineBuilder jtmb)
+                -> ::llvm::Expected<CompileFunction> {
+                auto tm = jtmb.createTargetMachine();
+                if (!tm) {
+                    return tm.takeError();
+                }
+                return CompileFunction(::llvm::orc::TMOwningSimpleCompiler(
+                    std::move(*tm), cache));
+            });
+    }
+    auto jit = ::llvm::Expected<std::unique_ptr<HybridSeJit>>(builder.create());
     {
         ::llvm::Error e = jit.takeError();
         if (e) {
@@ -168,8 +287,12 @@ bool HybridSeLlvmJitWrapper::Init() {
     return true;
 }
 
+bool HybridSeLlvmJitWrapper::LoadCachedObject(const std::string& key) {
+    return object_cache_ != nullptr && object_cache_->Load(key);
+}
+
 bool HybridSeLlvmJitWrapper::OptModule(::llvm::Module* module) {
-    return jit_->OptModule(module);
+    return jit_->OptModule(module, jit_options_.opt_level());
 }
 
 bool HybridSeLlvmJitWrapper::AddModule(
@@ -205,11 +328,22 @@ bool HybridSeLlvmJitWrapper::AddExternalFunction(const std::string& name,
 }
 
 #ifdef LLVM_EXT_ENABLE
-bool HybridSeMcJitWrapper::Init() { return true; }
+bool HybridSeMcJitWrapper::Init() {
+    if (!jit_options_.object_cache_dir().empty()) {
+        object_cache_ = std::unique_ptr<JitObjectCache>(
+            new JitObjectCache(jit_options_.object_cache_dir(),
+                               jit_options_.object_cache_capacity()));
+    }
+    return true;
+}
+
+bool HybridSeMcJitWrapper::LoadCachedObject(const std::string& key) {
+    return object_cache_ != nullptr && object_cache_->Load(key);
+}
 
 bool HybridSeMcJitWrapper::OptModule(::llvm::Module* module) {
     DLOG(INFO) << "Module before opt:\n" << LlvmToString(*module);
-    RunDefaultOptPasses(module);
+    RunOptPasses(module, jit_options_.opt_level());
     DLOG(INFO) << "Module after opt:\n" << LlvmToString(*module);
     return true;
 }
@@ -236,7 +370,7 @@ bool HybridSeMcJitWrapper::AddModule(
             engine_builder.setEngineKind(llvm::EngineKind::JIT)
                 .setErrorStr(&err_str_)
                 .setVerifyModules(true)
-                .setOptLevel(::llvm::CodeGenOpt::Level::Default)
+                .setOptLevel(JitCodeGenOptLevel(jit_options_.opt_level()))
                 .setSymbolResolver(
                     std::unique_ptr<::llvm::LegacyJITSymbolResolver>(
                         ::llvm::cast<::llvm::LegacyJITSymbolResolver>(
@@ -250,6 +384,9 @@ bool HybridSeMcJitWrapper::AddModule(
         for (auto& pair : extern_functions_) {
             resolver->addSymbol(pair.first, pair.second);
         }
+        if (object_cache_ != nullptr) {
+            execution_engine_->setObjectCache(object_cache_.get());
+        }
     } else {
         execution_engine_->addModule(std::move(module));
     }
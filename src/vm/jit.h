@@ -22,6 +22,7 @@
 #include <string>
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "vm/jit_object_cache.h"
 #include "vm/jit_wrapper.h"
 
 #ifdef LLVM_EXT_ENABLE
@@ -48,7 +49,8 @@ class HybridSeJit : public ::llvm::orc::LLJIT {
                               ::llvm::orc::ThreadSafeModule tsm,
                               ::llvm::orc::VModuleKey key);
 
-    bool OptModule(::llvm::Module* m);
+    // Optimize `m` with passes of `opt_level`, see `JitOptions::opt_level`
+    bool OptModule(::llvm::Module* m, uint32_t opt_level);
 
     ::llvm::orc::VModuleKey CreateVModule();
 
@@ -88,10 +90,14 @@ std::string LlvmToString(const T& value) {
 class HybridSeLlvmJitWrapper : public HybridSeJitWrapper {
  public:
     HybridSeLlvmJitWrapper() {}
+    explicit HybridSeLlvmJitWrapper(const JitOptions& jit_options)
+        : jit_options_(jit_options) {}
     ~HybridSeLlvmJitWrapper() {}
 
     bool Init() override;
 
+    bool LoadCachedObject(const std::string& key) override;
+
     bool OptModule(::llvm::Module* module) override;
 
     bool AddModule(std::unique_ptr<llvm::Module> module,
@@ -103,6 +109,9 @@ class HybridSeLlvmJitWrapper : public HybridSeJitWrapper {
         const std::string& funcname) override;
 
  private:
+    const JitOptions jit_options_;
+    // must outlive jit_, which compiles through it
+    std::unique_ptr<JitObjectCache> object_cache_;
     std::unique_ptr<HybridSeJit> jit_;
     std::unique_ptr<::llvm::orc::MangleAndInterner> mi_;
 };
@@ -116,6 +125,8 @@ class HybridSeMcJitWrapper : public HybridSeJitWrapper {
 
     bool Init() override;
 
+    bool LoadCachedObject(const std::string& key) override;
+
     bool OptModule(::llvm::Module* module) override;
 
     bool AddModule(std::unique_ptr<llvm::Module> module,
@@ -133,6 +144,7 @@ class HybridSeMcJitWrapper : public HybridSeJitWrapper {
     const JitOptions jit_options_;
     std::string err_str_ = "";
     std::map<std::string, void*> extern_functions_;
+    std::unique_ptr<JitObjectCache> object_cache_;
     llvm::ExecutionEngine* execution_engine_ = nullptr;
 };
 #endif
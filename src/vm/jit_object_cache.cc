@@ -0,0 +1,213 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vm/jit_object_cache.h"
+#include <utime.h>
+#include <algorithm>
+#include <cstdio>
+#include <system_error>  // NOLINT
+#include <utility>
+#include <vector>
+#include "base/fe_hash.h"
+#include "glog/logging.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace hybridse {
+namespace vm {
+
+static const char kObjectKeyPrefix[] = "hybridse_jit_";
+static const uint32_t kObjectKeySeeds[] = {0x5bd1e995, 0x27d4eb2f};
+
+std::string JitObjectCache::ModuleKey(const ::llvm::Module& m,
+                                      const std::string& sql,
+                                      const std::string& db, EngineMode mode,
+                                      const JitOptions& jit_options) {
+    std::string content;
+    ::llvm::raw_string_ostream ss(content);
+    ss << LLVM_VERSION_STRING << "\n"
+       << ::llvm::sys::getProcessTriple() << "\n"
+       << ::llvm::sys::getHostCPUName() << "\n"
+       << (jit_options.is_enable_mcjit() ? "mcjit" : "orc") << "\n"
+       << jit_options.opt_level() << "\n"
+       << static_cast<int>(mode) << "\n"
+       << db << "\n"
+       << sql << "\n"
+       << m;
+    ss.flush();
+    std::string key = kObjectKeyPrefix;
+    char buf[17];
+    for (uint32_t seed : kObjectKeySeeds) {
+        uint64_t hash = base::MurmurHash64A(
+            content.data(), static_cast<int>(content.size()), seed);
+        snprintf(buf, sizeof(buf), "%016llx",
+                 static_cast<unsigned long long>(hash));  // NOLINT
+        key.append(buf);
+    }
+    return key;
+}
+
+bool JitObjectCache::Load(const std::string& key) {
+    std::string path = ObjectPath(key);
+    auto buf = ::llvm::MemoryBuffer::getFile(path);
+    if (!buf) {
+        if (buf.getError() != std::errc::no_such_file_or_directory) {
+            LOG(WARNING) << "Fail to load jit object " << path << ": "
+                         << buf.getError().message();
+        }
+        return false;
+    }
+    // modification time orders objects by last use for trimming
+    utime(path.c_str(), nullptr);
+    DLOG(INFO) << "Load jit object " << path;
+    std::lock_guard<std::mutex> lock(mu_);
+    loaded_[key] = std::move(buf.get());
+    return true;
+}
+
+void JitObjectCache::notifyObjectCompiled(const ::llvm::Module* m,
+                                          ::llvm::MemoryBufferRef obj) {
+    std::string path;
+    if (!GetObjectPath(m, &path)) {
+        return;
+    }
+    std::error_code ec = ::llvm::sys::fs::create_directories(dir_);
+    if (ec) {
+        LOG(WARNING) << "Fail to create jit object cache dir " << dir_ << ": "
+                     << ec.message();
+        return;
+    }
+    // write to a temporary file then rename, so that concurrent readers
+    // never see a partial object
+    int fd = -1;
+    ::llvm::SmallString<128> tmp_path;
+    ec = ::llvm::sys::fs::createUniqueFile(path + ".%%%%%%.tmp", fd, tmp_path);
+    if (ec) {
+        LOG(WARNING) << "Fail to create jit object file " << path << ": "
+                     << ec.message();
+        return;
+    }
+    {
+        ::llvm::raw_fd_ostream os(fd, true);
+        os.write(obj.getBufferStart(), obj.getBufferSize());
+        os.close();
+        if (os.has_error()) {
+            LOG(WARNING) << "Fail to write jit object file " << tmp_path.str()
+                         << ": " << os.error().message();
+            os.clear_error();
+            ::llvm::sys::fs::remove(tmp_path);
+            return;
+        }
+    }
+    ec = ::llvm::sys::fs::rename(tmp_path, path);
+    if (ec) {
+        LOG(WARNING) << "Fail to rename jit object file " << path << ": "
+                     << ec.message();
+        ::llvm::sys::fs::remove(tmp_path);
+        return;
+    }
+    DLOG(INFO) << "Persist jit object " << path << ", size "
+               << obj.getBufferSize();
+    Trim(path);
+}
+
+std::unique_ptr<::llvm::MemoryBuffer> JitObjectCache::getObject(
+    const ::llvm::Module* m) {
+    if (m == nullptr) {
+        return nullptr;
+    }
+    // only objects read by Load are served, the module is unoptimized
+    // exactly when one was
+    std::lock_guard<std::mutex> lock(mu_);
+    auto iter = loaded_.find(m->getModuleIdentifier());
+    if (iter == loaded_.end()) {
+        return nullptr;
+    }
+    auto buf = std::move(iter->second);
+    loaded_.erase(iter);
+    return buf;
+}
+
+bool JitObjectCache::GetObjectPath(const ::llvm::Module* m,
+                                   std::string* path) const {
+    if (m == nullptr) {
+        return false;
+    }
+    const std::string& key = m->getModuleIdentifier();
+    if (key.compare(0, sizeof(kObjectKeyPrefix) - 1, kObjectKeyPrefix) != 0) {
+        return false;
+    }
+    *path = ObjectPath(key);
+    return true;
+}
+
+void JitObjectCache::Trim(const std::string& keep) {
+    struct ObjectFile {
+        std::string path;
+        uint64_t size;
+        ::llvm::sys::TimePoint<> last_use;
+    };
+    std::vector<ObjectFile> files;
+    uint64_t total = 0;
+    std::error_code ec;
+    for (::llvm::sys::fs::directory_iterator iter(dir_, ec), end;
+         !ec && iter != end; iter.increment(ec)) {
+        const std::string& path = iter->path();
+        ::llvm::StringRef name = ::llvm::sys::path::filename(path);
+        if (!name.startswith(kObjectKeyPrefix) || !name.endswith(".o")) {
+            continue;
+        }
+        ::llvm::sys::fs::file_status status;
+        if (::llvm::sys::fs::status(path, status)) {
+            continue;
+        }
+        total += status.getSize();
+        if (path != keep) {
+            files.push_back(
+                {path, status.getSize(), status.getLastModificationTime()});
+        }
+    }
+    if (total <= capacity_) {
+        return;
+    }
+    std::sort(files.begin(), files.end(),
+              [](const ObjectFile& l, const ObjectFile& r) {
+                  return l.last_use < r.last_use;
+              });
+    for (auto& file : files) {
+        if (total <= capacity_) {
+            break;
+        }
+        // another process may have removed it already
+        if (!::llvm::sys::fs::remove(file.path)) {
+            DLOG(INFO) << "Remove jit object " << file.path;
+        }
+        total -= file.size;
+    }
+}
+
+std::string JitObjectCache::ObjectPath(const std::string& key) const {
+    ::llvm::SmallString<128> path(dir_);
+    ::llvm::sys::path::append(path, key + ".o");
+    return path.str().str();
+}
+
+}  // namespace vm
+}  // namespace hybridse
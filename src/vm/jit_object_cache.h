@@ -0,0 +1,88 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_VM_JIT_OBJECT_CACHE_H_
+#define SRC_VM_JIT_OBJECT_CACHE_H_
+
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "vm/engine_context.h"
+
+namespace hybridse {
+namespace vm {
+
+/**
+ * Object code cache persisted in a local directory, shared by processes
+ * on the same host. A module takes part in caching only when its module
+ * identifier is a key built by `ModuleKey`, compiled object of the module
+ * is stored as `<dir>/<key>.o` and loaded by later jit instead of running
+ * llvm optimization and machine code generation again.
+ *
+ * The object is read once by `Load` before optimization is skipped, and
+ * jit is served that very buffer, so an object file removed or replaced
+ * meanwhile can't make jit compile and persist an unoptimized module.
+ * Objects beyond `capacity` bytes are removed, least recently used first.
+ */
+class JitObjectCache : public ::llvm::ObjectCache {
+ public:
+    JitObjectCache(const std::string& dir, uint64_t capacity)
+        : dir_(dir), capacity_(capacity) {}
+    ~JitObjectCache() {}
+
+    /**
+     * Build cache key of sql module `m` before optimization. Besides the
+     * module ir, which already depends on sql and table schemas, the key
+     * covers engine mode, jit options, llvm version and host target.
+     */
+    static std::string ModuleKey(const ::llvm::Module& m,
+                                 const std::string& sql,
+                                 const std::string& db, EngineMode mode,
+                                 const JitOptions& jit_options);
+
+    // Read persisted object of `key` for the module compiled next, return
+    // false if it isn't persisted or can't be read
+    bool Load(const std::string& key);
+
+    void notifyObjectCompiled(const ::llvm::Module* m,
+                              ::llvm::MemoryBufferRef obj) override;
+
+    std::unique_ptr<::llvm::MemoryBuffer> getObject(
+        const ::llvm::Module* m) override;
+
+    const std::string& dir() const { return dir_; }
+
+ private:
+    bool GetObjectPath(const ::llvm::Module* m, std::string* path) const;
+    std::string ObjectPath(const std::string& key) const;
+    // Remove least recently used objects except `keep` until the cached
+    // objects fit in capacity
+    void Trim(const std::string& keep);
+
+    const std::string dir_;
+    const uint64_t capacity_;
+    std::mutex mu_;
+    // objects read by `Load` and not taken by jit yet
+    std::map<std::string, std::unique_ptr<::llvm::MemoryBuffer>> loaded_;
+};
+
+}  // namespace vm
+}  // namespace hybridse
+#endif  // SRC_VM_JIT_OBJECT_CACHE_H_
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 #include "vm/jit_runtime.h"
+#include <stdlib.h>
 
 namespace hybridse {
 namespace vm {
@@ -44,5 +45,42 @@ void JitRuntime::ReleaseRunStep() {
     allocated_obj_pool_.clear();
 }
 
+int8_t* JitRuntime::AllocRow(size_t bytes) {
+    if (nullptr == row_arena_) {
+        int8_t* buf = reinterpret_cast<int8_t*>(malloc(bytes));
+        if (nullptr != buf) {
+            malloc_rows_.push_back(buf);
+        }
+        return buf;
+    }
+    // keep every row buffer 8 bytes aligned
+    return reinterpret_cast<int8_t*>(row_arena_->Alloc((bytes + 7) & ~7));
+}
+
+base::RefCountedSlice JitRuntime::CreateRowSlice(int8_t* buf, size_t size) {
+    // the latest allocated buffer is most likely wrapped first
+    for (size_t i = malloc_rows_.size(); i > 0; i--) {
+        if (malloc_rows_[i - 1] == buf) {
+            malloc_rows_[i - 1] = malloc_rows_.back();
+            malloc_rows_.pop_back();
+            return base::RefCountedSlice::CreateManaged(buf, size);
+        }
+    }
+    return base::RefCountedSlice::Create(buf, size);
+}
+
+base::ByteMemoryPool* JitRuntime::SetRowArena(base::ByteMemoryPool* arena) {
+    base::ByteMemoryPool* prev = row_arena_;
+    row_arena_ = arena;
+    return prev;
+}
+
+int8_t* AllocRowBuf(int32_t bytes) {
+    if (bytes < 0) {
+        return nullptr;
+    }
+    return JitRuntime::get()->AllocRow(bytes);
+}
+
 }  // namespace vm
 }  // namespace hybridse
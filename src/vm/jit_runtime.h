@@ -17,8 +17,10 @@
 #define SRC_VM_JIT_RUNTIME_H_
 
 #include <list>
+#include <vector>
 
 #include "base/fe_object.h"
+#include "base/fe_slice.h"
 #include "base/mem_pool.h"
 
 namespace hybridse {
@@ -26,7 +28,7 @@ namespace vm {
 
 class JitRuntime {
  public:
-    JitRuntime() {}
+    JitRuntime() : row_arena_(nullptr) {}
 
     /**
      * Get TLS JIT runtime instance.
@@ -56,13 +58,58 @@ class JitRuntime {
      */
     void ReleaseRunStep();
 
+    /**
+     * Allocate buffer of an output row. The buffer comes from current row
+     * arena if there is one and lives until the arena is released,
+     * otherwise it is malloc'd and owned by the slice from `CreateRowSlice`.
+     * Every buffer must be wrapped by `CreateRowSlice` afterwards.
+     */
+    int8_t* AllocRow(size_t bytes);
+
+    /**
+     * Wrap a buffer returned by `AllocRow()` into slice, must be called on
+     * the same thread. Whether the slice frees the buffer is recorded when
+     * it is allocated, so the row arena may change in between.
+     */
+    base::RefCountedSlice CreateRowSlice(int8_t* buf, size_t size);
+
+    /**
+     * Set arena of output rows on current thread, null to allocate rows
+     * with malloc. Return the previous one.
+     */
+    base::ByteMemoryPool* SetRowArena(base::ByteMemoryPool* arena);
+    base::ByteMemoryPool* row_arena() const { return row_arena_; }
+
  private:
     base::ByteMemoryPool mem_pool_;
+    base::ByteMemoryPool* row_arena_;
+    // malloc'd row buffers not wrapped by `CreateRowSlice` yet, usually at
+    // most a few since rows are wrapped right after they are encoded
+    std::vector<int8_t*> malloc_rows_;
     std::list<base::FeBaseObject*> allocated_obj_pool_;
 
     static thread_local JitRuntime tls_runtime_inst_;
 };
 
+/**
+ * Install row arena on current thread within scope, previous arena is
+ * restored on exit.
+ */
+class RowArenaScope {
+ public:
+    explicit RowArenaScope(base::ByteMemoryPool* arena)
+        : prev_(JitRuntime::get()->SetRowArena(arena)) {}
+    ~RowArenaScope() { JitRuntime::get()->SetRowArena(prev_); }
+
+ private:
+    base::ByteMemoryPool* prev_;
+};
+
+/**
+ * Output row allocator called by codegen encoder
+ */
+int8_t* AllocRowBuf(int32_t bytes);
+
 }  // namespace vm
 }  // namespace hybridse
 #endif  // SRC_VM_JIT_RUNTIME_H_
@@ -39,6 +39,7 @@
 #include "udf/default_udf_library.h"
 #include "udf/udf.h"
 #include "vm/jit.h"
+#include "vm/jit_runtime.h"
 
 namespace hybridse {
 namespace vm {
@@ -76,14 +77,14 @@ HybridSeJitWrapper* HybridSeJitWrapper::Create(const JitOptions& jit_options) {
         return new HybridSeMcJitWrapper(jit_options);
 #else
         LOG(WARNING) << "McJit support is not enabled";
-        return new HybridSeLlvmJitWrapper();
+        return new HybridSeLlvmJitWrapper(jit_options);
 #endif
     } else {
         if (jit_options.is_enable_vtune() || jit_options.is_enable_perf() ||
             jit_options.is_enable_gdb()) {
             LOG(WARNING) << "LLJIT do not support jit events";
         }
-        return new HybridSeLlvmJitWrapper();
+        return new HybridSeLlvmJitWrapper(jit_options);
     }
 }
 
@@ -207,6 +208,9 @@ void InitBuiltinJitSymbols(HybridSeJitWrapper* jit) {
     jit->AddExternalFunction(
         "hybridse_memery_pool_alloc",
         reinterpret_cast<void*>(&udf::v1::AllocManagedStringBuf));
+    jit->AddExternalFunction(
+        "hybridse_alloc_row",
+        reinterpret_cast<void*>(&hybridse::vm::AllocRowBuf));
 
     jit->AddExternalFunction(
         "fmod", reinterpret_cast<void*>(
@@ -39,6 +39,10 @@ class HybridSeJitWrapper {
     HybridSeJitWrapper(const HybridSeJitWrapper&) = delete;
 
     virtual bool Init() = 0;
+    // Read persisted object of module `key`, which adding the module then
+    // uses instead of compiling. Return false if there is none, and the
+    // module must be optimized
+    virtual bool LoadCachedObject(const std::string& key) { return false; }
     virtual bool OptModule(::llvm::Module* module) = 0;
 
     virtual bool AddModule(std::unique_ptr<llvm::Module> module,
@@ -15,10 +15,13 @@
  */
 
 #include "vm/jit_wrapper.h"
+#include <unistd.h>
+#include "boost/filesystem.hpp"
 #include "codec/fe_row_codec.h"
 #include "gtest/gtest.h"
 #include "udf/udf.h"
 #include "vm/engine.h"
+#include "vm/jit_object_cache.h"
 #include "vm/simple_catalog.h"
 #include "vm/sql_compiler.h"
 
@@ -116,6 +119,96 @@ TEST_F(JitWrapperTest, test_mcjit) {
 }
 #endif
 
+void CheckProjectFn(const int8_t *fn, const Schema &schema) {
+    ASSERT_TRUE(fn != nullptr);
+    int8_t buf[1024];
+    codec::RowBuilder row_builder(schema);
+    row_builder.SetBuffer(buf, 1024);
+    row_builder.AppendDouble(3.14);
+    row_builder.AppendInt64(42);
+
+    hybridse::codec::Row row(base::RefCountedSlice::Create(buf, 1024));
+    hybridse::codec::Row output = CoreAPI::RowProject(fn, row);
+    codec::RowView row_view(schema, output.buf(), output.size());
+    double c1;
+    int64_t c2;
+    ASSERT_EQ(row_view.GetDouble(0, &c1), 0);
+    ASSERT_EQ(row_view.GetInt64(1, &c2), 0);
+    ASSERT_EQ(c1, 3.14);
+    ASSERT_EQ(c2, 42);
+}
+
+TEST_F(JitWrapperTest, test_object_cache) {
+    std::string cache_dir =
+        "/tmp/hybridse_jit_object_cache_test_" + std::to_string(getpid());
+    boost::filesystem::remove_all(cache_dir);
+    EngineOptions options;
+    options.jit_options().set_object_cache_dir(cache_dir);
+    auto catalog = GetTestCatalog();
+    auto schema = catalog->GetTable("db", "t1")->GetSchema();
+    std::string sql = "select col_1, col_2 from t1;";
+
+    // first compile persists object
+    auto info = Compile(sql, options, catalog);
+    ASSERT_TRUE(info != nullptr);
+    CheckProjectFn(
+        info->get_sql_context().physical_plan->GetFnInfos()[0]->fn_ptr(),
+        *schema);
+    size_t object_cnt = 0;
+    for (boost::filesystem::directory_iterator iter(cache_dir), end;
+         iter != end; ++iter) {
+        ASSERT_EQ(".o", iter->path().extension().string());
+        object_cnt++;
+    }
+    ASSERT_EQ(1u, object_cnt);
+
+    // second compile loads persisted object
+    auto cached_info = Compile(sql, options, catalog);
+    ASSERT_TRUE(cached_info != nullptr);
+    CheckProjectFn(
+        cached_info->get_sql_context().physical_plan->GetFnInfos()[0]->fn_ptr(),
+        *schema);
+
+    // object read by Load is served even if the file is removed after
+    std::string key = boost::filesystem::directory_iterator(cache_dir)
+                          ->path()
+                          .stem()
+                          .string();
+    JitObjectCache cache(cache_dir, 1ull << 30);
+    ASSERT_TRUE(cache.Load(key));
+    boost::filesystem::remove_all(cache_dir);
+    ASSERT_FALSE(cache.Load(key));
+    ::llvm::LLVMContext llvm_ctx;
+    ::llvm::Module module(key, llvm_ctx);
+    ASSERT_TRUE(cache.getObject(&module) != nullptr);
+    ASSERT_TRUE(cache.getObject(&module) == nullptr);
+    boost::filesystem::remove_all(cache_dir);
+}
+
+TEST_F(JitWrapperTest, test_object_cache_capacity) {
+    std::string cache_dir = "/tmp/hybridse_jit_object_cache_capacity_test_" +
+                            std::to_string(getpid());
+    boost::filesystem::remove_all(cache_dir);
+    EngineOptions options;
+    options.jit_options().set_object_cache_dir(cache_dir);
+    // any object exceeds capacity, only the latest one is kept
+    options.jit_options().set_object_cache_capacity(1);
+    auto catalog = GetTestCatalog();
+    std::vector<std::string> sqls = {"select col_1 from t1;",
+                                     "select col_2 from t1;",
+                                     "select col_1, col_2 from t1;"};
+    for (auto& sql : sqls) {
+        ASSERT_TRUE(Compile(sql, options, catalog) != nullptr);
+        size_t object_cnt = 0;
+        for (boost::filesystem::directory_iterator iter(cache_dir), end;
+             iter != end; ++iter) {
+            object_cnt++;
+        }
+        ASSERT_EQ(1u, object_cnt);
+    }
+    boost::filesystem::remove_all(cache_dir);
+}
+
 TEST_F(JitWrapperTest, test_window) {
     EngineOptions options;
     options.set_keep_ir(true);
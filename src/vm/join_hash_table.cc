@@ -0,0 +1,139 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vm/join_hash_table.h"
+#include "glog/logging.h"
+
+namespace hybridse {
+namespace vm {
+
+const int64_t JoinHashTable::kEnd;
+const size_t JoinHashTable::kPartitionRows;
+const uint32_t JoinHashTable::kMaxRadixBits;
+const uint32_t JoinHashTable::kNil;
+
+void JoinHashTable::Reserve(size_t cnt) {
+    rows_.reserve(cnt);
+    hashes_.reserve(cnt);
+    key_offsets_.reserve(cnt + 1);
+}
+
+bool JoinHashTable::Add(const codec::BinaryKey& key, const Row& row) {
+    if (is_built_) {
+        LOG(WARNING) << "fail to add row into join hash table: table is built";
+        return false;
+    }
+    if (rows_.size() >= kNil) {
+        LOG(WARNING) << "fail to add row into join hash table: too many rows";
+        return false;
+    }
+    if (key_offsets_.empty()) {
+        key_offsets_.push_back(0);
+    }
+    rows_.push_back(row);
+    hashes_.push_back(key.hash());
+    key_data_.append(key.data(), key.size());
+    key_offsets_.push_back(key_data_.size());
+    return true;
+}
+
+void JoinHashTable::Build() {
+    if (is_built_) {
+        return;
+    }
+    is_built_ = true;
+    size_t cnt = rows_.size();
+    radix_bits_ = 0;
+    while ((cnt >> radix_bits_) > kPartitionRows &&
+           radix_bits_ < kMaxRadixBits) {
+        radix_bits_++;
+    }
+    size_t partition_cnt = GetPartitionCount();
+
+    // scatter entries to partitions, stable within a partition
+    std::vector<size_t> cursor(partition_cnt + 1, 0);
+    for (size_t i = 0; i < cnt; ++i) {
+        cursor[PartitionOf(hashes_[i]) + 1]++;
+    }
+    for (size_t p = 0; p < partition_cnt; ++p) {
+        cursor[p + 1] += cursor[p];
+    }
+    std::vector<size_t> partition_begin(cursor);
+    std::vector<uint64_t> hashes(cnt);
+    row_idxs_.resize(cnt);
+    for (size_t i = 0; i < cnt; ++i) {
+        size_t entry = cursor[PartitionOf(hashes_[i])]++;
+        hashes[entry] = hashes_[i];
+        row_idxs_[entry] = static_cast<uint32_t>(i);
+    }
+    hashes_.swap(hashes);
+
+    // chain every partition into a power of two bucket array
+    bucket_begin_.assign(partition_cnt + 1, 0);
+    for (size_t p = 0; p < partition_cnt; ++p) {
+        size_t rows = partition_begin[p + 1] - partition_begin[p];
+        size_t buckets = 1;
+        while (buckets < rows * 2) {
+            buckets <<= 1;
+        }
+        bucket_begin_[p + 1] = bucket_begin_[p] + buckets;
+    }
+    heads_.assign(bucket_begin_[partition_cnt], kNil);
+    next_.assign(cnt, kNil);
+    for (size_t p = 0; p < partition_cnt; ++p) {
+        uint32_t* heads = heads_.data() + bucket_begin_[p];
+        uint64_t mask = bucket_begin_[p + 1] - bucket_begin_[p] - 1;
+        // insert backward so that chains keep insertion order
+        for (size_t entry = partition_begin[p + 1]; entry > partition_begin[p];
+             --entry) {
+            uint32_t& head = heads[hashes_[entry - 1] & mask];
+            next_[entry - 1] = head;
+            head = static_cast<uint32_t>(entry - 1);
+        }
+    }
+    DLOG(INFO) << "build join hash table: rows " << cnt << ", partitions "
+               << partition_cnt;
+}
+
+int64_t JoinHashTable::Seek(const codec::BinaryKey& key) const {
+    if (!is_built_ || rows_.empty()) {
+        return kEnd;
+    }
+    size_t p = PartitionOf(key.hash());
+    uint64_t mask = bucket_begin_[p + 1] - bucket_begin_[p] - 1;
+    return Walk(heads_[bucket_begin_[p] + (key.hash() & mask)], key);
+}
+
+int64_t JoinHashTable::Next(int64_t entry, const codec::BinaryKey& key) const {
+    if (entry < 0 || entry >= static_cast<int64_t>(next_.size())) {
+        return kEnd;
+    }
+    return Walk(next_[entry], key);
+}
+
+int64_t JoinHashTable::Walk(uint32_t entry,
+                            const codec::BinaryKey& key) const {
+    while (kNil != entry) {
+        if (Match(entry, key)) {
+            return entry;
+        }
+        entry = next_[entry];
+    }
+    return kEnd;
+}
+
+}  // namespace vm
+}  // namespace hybridse
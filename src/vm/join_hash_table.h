@@ -0,0 +1,101 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_VM_JOIN_HASH_TABLE_H_
+#define SRC_VM_JOIN_HASH_TABLE_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "codec/binary_key.h"
+#include "codec/row.h"
+
+namespace hybridse {
+namespace vm {
+
+using codec::Row;
+
+/**
+ * Build side of hash join. Rows are added with sealed binary keys, then
+ * `Build` radix partitions them by the high bits of key hash and chains
+ * every partition into its own bucket array. Partitions are sized to stay
+ * in cache, so bucket heads are written without cache misses while
+ * building. Rows of the same key are visited in the order they are added.
+ */
+class JoinHashTable {
+ public:
+    static const int64_t kEnd = -1;
+
+    JoinHashTable() : radix_bits_(0), is_built_(false) {}
+    ~JoinHashTable() {}
+
+    void Reserve(size_t cnt);
+    // Add `row` with sealed `key`, fail after `Build`
+    bool Add(const codec::BinaryKey& key, const Row& row);
+    void Build();
+
+    // Return the first entry matching `key`, or `kEnd`
+    int64_t Seek(const codec::BinaryKey& key) const;
+    // Return the entry after `entry` matching `key`, or `kEnd`
+    int64_t Next(int64_t entry, const codec::BinaryKey& key) const;
+    inline const Row& GetRow(int64_t entry) const {
+        return rows_[row_idxs_[entry]];
+    }
+
+    inline size_t GetCount() const { return rows_.size(); }
+    inline size_t GetPartitionCount() const {
+        return static_cast<size_t>(1) << radix_bits_;
+    }
+
+ private:
+    // Rows of a partition, bucket array is twice as large
+    static const size_t kPartitionRows = 8192;
+    static const uint32_t kMaxRadixBits = 12;
+    static const uint32_t kNil = UINT32_MAX;
+
+    inline size_t PartitionOf(uint64_t hash) const {
+        return 0 == radix_bits_ ? 0 : hash >> (64 - radix_bits_);
+    }
+    inline bool Match(uint32_t entry, const codec::BinaryKey& key) const {
+        uint32_t idx = row_idxs_[entry];
+        return hashes_[entry] == key.hash() &&
+               key_offsets_[idx + 1] - key_offsets_[idx] == key.size() &&
+               0 == memcmp(key_data_.data() + key_offsets_[idx], key.data(),
+                           key.size());
+    }
+    int64_t Walk(uint32_t entry, const codec::BinaryKey& key) const;
+
+    std::vector<Row> rows_;
+    // Key bytes of row `i` are [key_offsets_[i], key_offsets_[i + 1])
+    std::string key_data_;
+    std::vector<size_t> key_offsets_;
+    // Hash of entries, in insertion order before build and partition
+    // order after it
+    std::vector<uint64_t> hashes_;
+    // Row index of entries in partition order
+    std::vector<uint32_t> row_idxs_;
+    std::vector<uint32_t> next_;
+    std::vector<uint32_t> heads_;
+    // Buckets of partition `p` are [bucket_begin_[p], bucket_begin_[p + 1])
+    std::vector<size_t> bucket_begin_;
+    uint32_t radix_bits_;
+    bool is_built_;
+};
+
+}  // namespace vm
+}  // namespace hybridse
+#endif  // SRC_VM_JOIN_HASH_TABLE_H_
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vm/join_hash_table.h"
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace hybridse {
+namespace vm {
+
+class JoinHashTableTest : public ::testing::Test {};
+
+static codec::BinaryKey MakeKey(int64_t k) {
+    codec::BinaryKey key;
+    key.AppendInt64(k);
+    key.Seal();
+    return key;
+}
+
+static std::vector<std::string> Collect(const JoinHashTable& table,
+                                        const codec::BinaryKey& key) {
+    std::vector<std::string> result;
+    for (int64_t entry = table.Seek(key); entry != JoinHashTable::kEnd;
+         entry = table.Next(entry, key)) {
+        const Row& row = table.GetRow(entry);
+        result.push_back(
+            std::string(reinterpret_cast<const char*>(row.buf()), row.size()));
+    }
+    return result;
+}
+
+TEST_F(JoinHashTableTest, EmptyTest) {
+    JoinHashTable table;
+    ASSERT_EQ(JoinHashTable::kEnd, table.Seek(MakeKey(1)));
+    table.Build();
+    ASSERT_EQ(0u, table.GetCount());
+    ASSERT_EQ(JoinHashTable::kEnd, table.Seek(MakeKey(1)));
+    ASSERT_EQ(JoinHashTable::kEnd, table.Next(0, MakeKey(1)));
+}
+
+TEST_F(JoinHashTableTest, SeekTest) {
+    JoinHashTable table;
+    // every key owns 3 rows, enough rows for several partitions
+    const int64_t key_cnt = 20000;
+    // rows refer to buffers without copy
+    std::vector<std::string> bufs;
+    bufs.reserve(key_cnt * 3 + 1);
+    table.Reserve(key_cnt * 3);
+    for (int round = 0; round < 3; ++round) {
+        for (int64_t k = 0; k < key_cnt; ++k) {
+            bufs.push_back(std::to_string(k) + "_" + std::to_string(round));
+            ASSERT_TRUE(table.Add(MakeKey(k), Row(bufs.back())));
+        }
+    }
+    table.Build();
+    ASSERT_EQ(static_cast<size_t>(key_cnt * 3), table.GetCount());
+    ASSERT_LT(1u, table.GetPartitionCount());
+    for (int64_t k = 0; k < key_cnt; ++k) {
+        std::vector<std::string> expect = {std::to_string(k) + "_0",
+                                           std::to_string(k) + "_1",
+                                           std::to_string(k) + "_2"};
+        ASSERT_EQ(expect, Collect(table, MakeKey(k)));
+    }
+    ASSERT_TRUE(Collect(table, MakeKey(-1)).empty());
+    ASSERT_TRUE(Collect(table, MakeKey(key_cnt)).empty());
+
+    // keys of the same bytes but different types never match
+    codec::BinaryKey str_key;
+    str_key.AppendString("0");
+    str_key.Seal();
+    ASSERT_TRUE(Collect(table, str_key).empty());
+
+    bufs.push_back("late");
+    ASSERT_FALSE(table.Add(MakeKey(0), Row(bufs.back())));
+    ASSERT_EQ(static_cast<size_t>(key_cnt * 3), table.GetCount());
+}
+
+}  // namespace vm
+}  // namespace hybridse
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -16,6 +16,7 @@
 
 #include "vm/mem_catalog.h"
 #include <algorithm>
+#include <utility>
 namespace hybridse {
 namespace vm {
 MemTimeTableIterator::MemTimeTableIterator(const MemTimeTable* table,
@@ -194,6 +195,19 @@ bool MemPartitionHandler::AddRow(const std::string& key, uint64_t ts,
     }
     return true;
 }
+bool MemPartitionHandler::AddRow(const codec::BinaryKey& key, uint64_t ts,
+                                 const Row& row) {
+    auto iter = binary_index_.find(key);
+    if (iter != binary_index_.cend()) {
+        iter->second->push_back(std::make_pair(ts, row));
+        return true;
+    }
+    // std::map nodes are stable, so the segment can be indexed by pointer
+    auto& segment = partitions_[key.ToString()];
+    segment.push_back(std::make_pair(ts, row));
+    binary_index_.insert(std::make_pair(key, &segment));
+    return true;
+}
 std::unique_ptr<WindowIterator> MemPartitionHandler::GetWindowIterator() {
     return std::unique_ptr<WindowIterator>(
         new MemWindowIterator(&partitions_, schema_));
@@ -282,6 +296,14 @@ bool MemTableHandler::SetRow(const size_t idx, const Row& row) {
     table_[idx] = row;
     return true;
 }
+Row MemTableHandler::TakeRow(uint64_t pos) {
+    if (pos >= table_.size()) {
+        return Row();
+    }
+    Row row;
+    std::swap(row, table_[pos]);
+    return row;
+}
 void MemTableHandler::Reverse() {
     std::reverse(table_.begin(), table_.end());
     order_type_ = kAscOrder == order_type_
@@ -83,6 +83,12 @@ TEST_F(MemCataLogTest, mem_table_handler_test) {
     for (auto row : rows) {
         table_handler.AddRow(row);
     }
+    // taken row is no longer referenced by table
+    Row row = table_handler.TakeRow(0);
+    ASSERT_EQ(0, row.compare(rows[0]));
+    ASSERT_EQ(0, table_handler.At(0).size());
+    ASSERT_EQ(rows.size(), table_handler.GetCount());
+    ASSERT_EQ(0, table_handler.TakeRow(rows.size()).size());
 }
 
 Row project(const Row& row) {
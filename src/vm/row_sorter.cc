@@ -0,0 +1,541 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vm/row_sorter.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <mutex>  // NOLINT
+#include <utility>
+#include "glog/logging.h"
+
+namespace hybridse {
+namespace vm {
+
+template <typename T>
+static int CompareValue(const RowView& view, const int8_t* l,
+                        const int8_t* r, uint32_t idx, type::Type type) {
+    T lv = 0;
+    T rv = 0;
+    view.GetValue(l, idx, type, &lv);
+    view.GetValue(r, idx, type, &rv);
+    return lv < rv ? -1 : (rv < lv ? 1 : 0);
+}
+
+static bool WriteSlice(FILE* file, const int8_t* buf, uint32_t size) {
+    if (1 != fwrite(&size, sizeof(size), 1, file)) {
+        return false;
+    }
+    return 0 == size || size == fwrite(buf, 1, size, file);
+}
+
+/**
+ * Buffered reader of file bytes in [offset, size) by position, so that
+ * several iterators read one run at the same time.
+ */
+class SortRunReader {
+ public:
+    SortRunReader(int fd, uint64_t offset, uint64_t size)
+        : fd_(fd),
+          size_(size),
+          offset_(offset),
+          buf_(std::min(static_cast<uint64_t>(kBufferSize),
+                        size > offset ? size - offset : 0)),
+          pos_(0),
+          end_(0) {}
+
+    bool Read(void* data, size_t size) {
+        char* out = reinterpret_cast<char*>(data);
+        while (size > 0) {
+            if (pos_ == end_ && !Fill()) {
+                return false;
+            }
+            size_t len = std::min(size, end_ - pos_);
+            memcpy(out, buf_.data() + pos_, len);
+            pos_ += len;
+            out += len;
+            size -= len;
+        }
+        return true;
+    }
+    bool Eof() const { return pos_ == end_ && offset_ >= size_; }
+
+ private:
+    static const size_t kBufferSize = 64 * 1024;
+
+    bool Fill() {
+        if (offset_ >= size_ || buf_.empty()) {
+            return false;
+        }
+        size_t len = std::min(static_cast<uint64_t>(buf_.size()),
+                              size_ - offset_);
+        ssize_t read_len = pread(fd_, buf_.data(), len, offset_);
+        if (read_len <= 0) {
+            return false;
+        }
+        offset_ += read_len;
+        pos_ = 0;
+        end_ = read_len;
+        return true;
+    }
+
+    int fd_;
+    uint64_t size_;
+    uint64_t offset_;
+    std::vector<char> buf_;
+    size_t pos_;
+    size_t end_;
+};
+
+static bool ReadSlice(SortRunReader* reader,
+                      base::RefCountedSlice* slice) {
+    uint32_t size = 0;
+    if (!reader->Read(&size, sizeof(size))) {
+        return false;
+    }
+    if (0 == size) {
+        *slice = base::RefCountedSlice();
+        return true;
+    }
+    int8_t* buf = reinterpret_cast<int8_t*>(malloc(size));
+    if (!reader->Read(buf, size)) {
+        free(buf);
+        return false;
+    }
+    *slice = base::RefCountedSlice::CreateManaged(buf, size);
+    return true;
+}
+
+static bool WriteRow(FILE* file, const Row& row) {
+    uint32_t slice_cnt = static_cast<uint32_t>(row.GetRowPtrCnt());
+    if (1 != fwrite(&slice_cnt, sizeof(slice_cnt), 1, file)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < slice_cnt; ++i) {
+        if (!WriteSlice(file, row.buf(i), row.size(i))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool ReadRow(SortRunReader* reader, Row* row) {
+    uint32_t slice_cnt = 0;
+    if (!reader->Read(&slice_cnt, sizeof(slice_cnt)) || 0 == slice_cnt) {
+        return false;
+    }
+    base::RefCountedSlice slice;
+    if (!ReadSlice(reader, &slice)) {
+        return false;
+    }
+    *row = Row(slice);
+    for (uint32_t i = 1; i < slice_cnt; ++i) {
+        if (!ReadSlice(reader, &slice)) {
+            return false;
+        }
+        row->Append(slice);
+    }
+    return true;
+}
+
+// Entry layout: seq, key slice, slice count, row slices
+bool RowSorter::WriteEntry(FILE* file, const Entry& entry) {
+    return 1 == fwrite(&entry.seq, sizeof(entry.seq), 1, file) &&
+           WriteSlice(file, entry.key.buf(), entry.key.size()) &&
+           WriteRow(file, entry.row);
+}
+
+bool RowSorter::ReadEntry(SortRunReader* reader, Entry* entry) {
+    base::RefCountedSlice key;
+    if (!reader->Read(&entry->seq, sizeof(entry->seq)) ||
+        !ReadSlice(reader, &key)) {
+        return false;
+    }
+    entry->key = Row(key);
+    return ReadRow(reader, &entry->row);
+}
+
+RowSorter::RowSorter(const Schema& key_schema, bool is_asc,
+                     int32_t limit_cnt, uint64_t memory_limit,
+                     const std::string& spill_dir)
+    : key_schema_(key_schema),
+      key_view_(key_schema_),
+      is_asc_(is_asc),
+      limit_cnt_(limit_cnt),
+      memory_limit_(memory_limit),
+      spill_dir_(spill_dir),
+      seq_(0),
+      entries_(),
+      memory_used_(0),
+      runs_(),
+      spill_row_cnt_(0) {}
+
+RowSorter::~RowSorter() {
+    for (auto& run : runs_) {
+        if (nullptr != run.file) {
+            fclose(run.file);
+        }
+    }
+}
+
+int RowSorter::CompareKey(const Row& l, const Row& r) const {
+    const int8_t* lbuf = l.buf();
+    const int8_t* rbuf = r.buf();
+    for (int32_t i = 0; i < key_schema_.size(); ++i) {
+        uint32_t idx = static_cast<uint32_t>(i);
+        bool l_null = nullptr == lbuf || key_view_.IsNULL(lbuf, idx);
+        bool r_null = nullptr == rbuf || key_view_.IsNULL(rbuf, idx);
+        if (l_null || r_null) {
+            if (l_null != r_null) {
+                return l_null ? -1 : 1;
+            }
+            continue;
+        }
+        type::Type type = key_schema_.Get(i).type();
+        int cmp = 0;
+        switch (type) {
+            case type::kBool:
+                cmp = CompareValue<bool>(key_view_, lbuf, rbuf, idx, type);
+                break;
+            case type::kInt16:
+                cmp = CompareValue<int16_t>(key_view_, lbuf, rbuf, idx, type);
+                break;
+            case type::kInt32:
+            case type::kDate:
+                cmp = CompareValue<int32_t>(key_view_, lbuf, rbuf, idx, type);
+                break;
+            case type::kInt64:
+            case type::kTimestamp:
+                cmp = CompareValue<int64_t>(key_view_, lbuf, rbuf, idx, type);
+                break;
+            case type::kFloat:
+                cmp = CompareValue<float>(key_view_, lbuf, rbuf, idx, type);
+                break;
+            case type::kDouble:
+                cmp = CompareValue<double>(key_view_, lbuf, rbuf, idx, type);
+                break;
+            case type::kVarchar: {
+                const char* lstr = nullptr;
+                const char* rstr = nullptr;
+                uint32_t lsize = 0;
+                uint32_t rsize = 0;
+                key_view_.GetValue(lbuf, idx, &lstr, &lsize);
+                key_view_.GetValue(rbuf, idx, &rstr, &rsize);
+                cmp = memcmp(lstr, rstr, std::min(lsize, rsize));
+                if (0 == cmp) {
+                    cmp = lsize < rsize ? -1 : (rsize < lsize ? 1 : 0);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+        if (0 != cmp) {
+            return cmp;
+        }
+    }
+    return 0;
+}
+
+size_t RowSorter::EntrySize(const Entry& entry) {
+    size_t size = sizeof(Entry) + entry.key.size();
+    for (int32_t i = 0; i < entry.row.GetRowPtrCnt(); ++i) {
+        size += entry.row.size(i);
+    }
+    return size;
+}
+
+bool RowSorter::Add(const Row& key, const Row& row) {
+    Entry entry = {key, row, seq_++};
+    if (limit_cnt_ > 0) {
+        // max heap of the first rows, the last one of them on top
+        auto less = [this](const Entry& l, const Entry& r) {
+            return Less(l, r);
+        };
+        if (entries_.size() < static_cast<size_t>(limit_cnt_)) {
+            entries_.push_back(entry);
+            std::push_heap(entries_.begin(), entries_.end(), less);
+        } else if (Less(entry, entries_.front())) {
+            std::pop_heap(entries_.begin(), entries_.end(), less);
+            entries_.back() = entry;
+            std::push_heap(entries_.begin(), entries_.end(), less);
+        }
+        return true;
+    }
+    memory_used_ += EntrySize(entry);
+    entries_.push_back(entry);
+    if (memory_limit_ > 0 && memory_used_ > memory_limit_) {
+        return Spill();
+    }
+    return true;
+}
+
+// Create a temporary file under `dir`, which is removed once closed
+static FILE* CreateSpillFile(const std::string& dir) {
+    std::string path = dir + "/hybridse_sort_XXXXXX";
+    std::vector<char> tmpl(path.begin(), path.end());
+    tmpl.push_back('\0');
+    int fd = mkstemp(tmpl.data());
+    if (fd < 0) {
+        LOG(WARNING) << "fail to create sort spill file under " << dir;
+        return nullptr;
+    }
+    unlink(tmpl.data());
+    FILE* file = fdopen(fd, "w+b");
+    if (nullptr == file) {
+        close(fd);
+        LOG(WARNING) << "fail to open sort spill file";
+        return nullptr;
+    }
+    return file;
+}
+
+bool RowSorter::Spill() {
+    std::sort(entries_.begin(), entries_.end(),
+              [this](const Entry& l, const Entry& r) { return Less(l, r); });
+    FILE* file = CreateSpillFile(spill_dir_);
+    if (nullptr == file) {
+        return false;
+    }
+    runs_.push_back({file, 0});
+    for (auto& entry : entries_) {
+        if (!WriteEntry(file, entry)) {
+            LOG(WARNING) << "fail to write sort spill file";
+            return false;
+        }
+    }
+    if (0 != fflush(file)) {
+        LOG(WARNING) << "fail to flush sort spill file";
+        return false;
+    }
+    runs_.back().size = ftell(file);
+    spill_row_cnt_ += entries_.size();
+    DLOG(INFO) << "spill " << entries_.size() << " sorted rows, "
+               << memory_used_ << " bytes";
+    // release spilled rows, and the capacity held for them
+    std::vector<Entry>().swap(entries_);
+    memory_used_ = 0;
+    return true;
+}
+
+/**
+ * K-way merge of spilled runs, every run read by its own reader. Rows are
+ * read when iterator seeks to first, the key of a row is its position.
+ */
+class RunMergeIterator : public RowIterator {
+ public:
+    explicit RunMergeIterator(std::shared_ptr<const RowSorter> sorter)
+        : RowIterator(),
+          sorter_(sorter),
+          readers_(),
+          entries_(sorter->runs_.size()),
+          heap_(),
+          pos_(0) {}
+    ~RunMergeIterator() {}
+
+    bool Valid() const override { return !heap_.empty(); }
+    void Next() override {
+        if (heap_.empty()) {
+            return;
+        }
+        RunGreater greater = {sorter_.get(), &entries_};
+        std::pop_heap(heap_.begin(), heap_.end(), greater);
+        if (ReadNext(heap_.back())) {
+            std::push_heap(heap_.begin(), heap_.end(), greater);
+        } else {
+            heap_.pop_back();
+        }
+        pos_++;
+    }
+    const uint64_t& GetKey() const override { return pos_; }
+    const Row& GetValue() override { return entries_[heap_.front()].row; }
+    void Seek(const uint64_t& key) override {
+        SeekToFirst();
+        while (Valid() && pos_ < key) {
+            Next();
+        }
+    }
+    void SeekToFirst() override {
+        readers_.clear();
+        heap_.clear();
+        pos_ = 0;
+        for (size_t i = 0; i < sorter_->runs_.size(); ++i) {
+            auto& run = sorter_->runs_[i];
+            readers_.emplace_back(fileno(run.file), 0, run.size);
+            if (ReadNext(i)) {
+                heap_.push_back(i);
+            }
+        }
+        std::make_heap(heap_.begin(), heap_.end(),
+                       RunGreater{sorter_.get(), &entries_});
+    }
+    bool IsSeekable() const override { return false; }
+
+ private:
+    // min heap of runs on their current rows
+    struct RunGreater {
+        const RowSorter* sorter;
+        const std::vector<RowSorter::Entry>* entries;
+        bool operator()(size_t l, size_t r) const {
+            return sorter->Less((*entries)[r], (*entries)[l]);
+        }
+    };
+    bool ReadNext(size_t run_idx) {
+        auto& reader = readers_[run_idx];
+        if (RowSorter::ReadEntry(&reader, &entries_[run_idx])) {
+            return true;
+        }
+        if (!reader.Eof()) {
+            LOG(WARNING) << "fail to read sort spill file";
+        }
+        entries_[run_idx] = RowSorter::Entry();
+        return false;
+    }
+
+    std::shared_ptr<const RowSorter> sorter_;
+    std::vector<SortRunReader> readers_;
+    std::vector<RowSorter::Entry> entries_;
+    std::vector<size_t> heap_;
+    uint64_t pos_;
+};
+
+/**
+ * Sorted rows of spilled runs, merged by every iterator. Rows accessed by
+ * position are merged once into another file on first access, and read
+ * back by the offsets of rows in it.
+ */
+class SpilledTableHandler : public TableHandler {
+ public:
+    SpilledTableHandler(const Schema* schema,
+                        std::shared_ptr<const RowSorter> sorter)
+        : TableHandler(),
+          schema_(schema),
+          sorter_(sorter),
+          mu_(),
+          indexed_(false),
+          merged_(nullptr),
+          offsets_() {}
+    ~SpilledTableHandler() {
+        if (nullptr != merged_) {
+            fclose(merged_);
+        }
+    }
+
+    std::unique_ptr<RowIterator> GetIterator() override {
+        return std::unique_ptr<RowIterator>(new RunMergeIterator(sorter_));
+    }
+    base::ConstIterator<uint64_t, Row>* GetRawIterator() override {
+        return new RunMergeIterator(sorter_);
+    }
+    std::unique_ptr<WindowIterator> GetWindowIterator(
+        const std::string& idx_name) override {
+        return std::unique_ptr<WindowIterator>();
+    }
+    const Types& GetTypes() override { return types_; }
+    const IndexHint& GetIndex() override { return index_hint_; }
+    const Schema* GetSchema() override { return schema_; }
+    const std::string& GetName() override { return name_; }
+    const std::string& GetDatabase() override { return db_; }
+    const uint64_t GetCount() override { return sorter_->spill_row_cnt_; }
+    Row At(uint64_t pos) override {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            if (!indexed_) {
+                indexed_ = true;
+                if (!BuildIndex()) {
+                    LOG(WARNING) << "fail to index sorted rows";
+                    offsets_.clear();
+                }
+            }
+        }
+        if (pos + 1 >= offsets_.size()) {
+            return Row();
+        }
+        SortRunReader reader(fileno(merged_), offsets_[pos],
+                             offsets_[pos + 1]);
+        Row row;
+        if (!ReadRow(&reader, &row)) {
+            LOG(WARNING) << "fail to read sorted row at " << pos;
+            return Row();
+        }
+        return row;
+    }
+    const std::string GetHandlerTypeName() override {
+        return "SpilledTableHandler";
+    }
+
+ private:
+    // Merge runs into one file, offsets of rows in it are kept in order
+    // with the end offset last
+    bool BuildIndex() {
+        merged_ = CreateSpillFile(sorter_->spill_dir_);
+        if (nullptr == merged_) {
+            return false;
+        }
+        offsets_.reserve(sorter_->spill_row_cnt_ + 1);
+        offsets_.push_back(0);
+        RunMergeIterator iter(sorter_);
+        for (iter.SeekToFirst(); iter.Valid(); iter.Next()) {
+            if (!WriteRow(merged_, iter.GetValue())) {
+                return false;
+            }
+            offsets_.push_back(ftell(merged_));
+        }
+        return 0 == fflush(merged_);
+    }
+
+    const Schema* schema_;
+    std::shared_ptr<const RowSorter> sorter_;
+    Types types_;
+    IndexHint index_hint_;
+    std::string name_;
+    std::string db_;
+    std::mutex mu_;
+    bool indexed_;
+    FILE* merged_;
+    std::vector<uint64_t> offsets_;
+};
+
+std::shared_ptr<TableHandler> RowSorter::Finish(
+    std::shared_ptr<RowSorter> sorter, const Schema* schema) {
+    auto& entries = sorter->entries_;
+    if (!sorter->runs_.empty()) {
+        if (!entries.empty() && !sorter->Spill()) {
+            return std::shared_ptr<TableHandler>();
+        }
+        return std::make_shared<SpilledTableHandler>(schema, sorter);
+    }
+    RowSorter* self = sorter.get();
+    auto less = [self](const Entry& l, const Entry& r) {
+        return self->Less(l, r);
+    };
+    if (sorter->limit_cnt_ > 0) {
+        std::sort_heap(entries.begin(), entries.end(), less);
+    } else {
+        std::sort(entries.begin(), entries.end(), less);
+    }
+    auto output = std::make_shared<MemTableHandler>(schema);
+    output->Reserve(entries.size());
+    for (auto& entry : entries) {
+        output->AddRow(entry.row);
+    }
+    entries.clear();
+    return output;
+}
+
+}  // namespace vm
+}  // namespace hybridse
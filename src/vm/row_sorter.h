@@ -0,0 +1,121 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_VM_ROW_SORTER_H_
+#define SRC_VM_ROW_SORTER_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "codec/fe_row_codec.h"
+#include "vm/mem_catalog.h"
+
+namespace hybridse {
+namespace vm {
+
+using codec::Row;
+using codec::RowView;
+
+class SortRunReader;
+
+/**
+ * Sort rows of ORDER BY. Every row comes with its key row, the order
+ * expressions projected by compiled sort function, and rows are compared
+ * column by column on typed key values with null first. Rows of equal keys
+ * keep their input order.
+ *
+ * With a positive `limit_cnt`, only the first rows are kept in a bounded
+ * heap. Otherwise rows are sorted in memory, and once they take more than
+ * `memory_limit` bytes, sorted runs are spilled into unlinked temporary
+ * files under `spill_dir`, and rows in memory are released. Spilled runs
+ * are merged lazily while the output is iterated, so that sorted rows are
+ * never all in memory at once. A zero `memory_limit` never spills.
+ *
+ * Spilling only saves memory of rows the sorter holds alone, rows still
+ * referenced by the input stay in memory. SortRunner takes rows out of
+ * input tables built only for it.
+ */
+class RowSorter {
+ public:
+    RowSorter(const Schema& key_schema, bool is_asc, int32_t limit_cnt,
+              uint64_t memory_limit, const std::string& spill_dir);
+    ~RowSorter();
+
+    // Add `row` with its order `key`, fail if rows can't be spilled
+    bool Add(const Row& key, const Row& row);
+
+    /**
+     * Sort all rows added into `sorter` into a table of `schema`. Rows
+     * sorted in memory are output in a MemTableHandler. Once runs are
+     * spilled, every iterator of the output table merges run files on its
+     * own, and the table shares `sorter`. Rows accessed by position are
+     * merged once into an indexed file. Return null on failure.
+     */
+    static std::shared_ptr<TableHandler> Finish(
+        std::shared_ptr<RowSorter> sorter, const Schema* schema);
+
+    // Three-way comparison of key rows, order direction not applied
+    int CompareKey(const Row& l, const Row& r) const;
+
+    size_t GetSpillCount() const { return runs_.size(); }
+
+ private:
+    friend class RunMergeIterator;
+    friend class SpilledTableHandler;
+
+    struct Entry {
+        Row key;
+        Row row;
+        uint64_t seq;
+    };
+    // Sorted run in an unlinked file, read back by position
+    struct Run {
+        FILE* file;
+        uint64_t size;
+    };
+
+    // Order of entries, ties are broken by input sequence
+    inline bool Less(const Entry& l, const Entry& r) const {
+        int cmp = CompareKey(l.key, r.key);
+        if (0 != cmp) {
+            return is_asc_ ? cmp < 0 : cmp > 0;
+        }
+        return l.seq < r.seq;
+    }
+    static size_t EntrySize(const Entry& entry);
+    static bool WriteEntry(FILE* file, const Entry& entry);
+    static bool ReadEntry(SortRunReader* reader, Entry* entry);
+    bool Spill();
+
+    const Schema key_schema_;
+    const RowView key_view_;
+    const bool is_asc_;
+    const int32_t limit_cnt_;
+    const uint64_t memory_limit_;
+    const std::string spill_dir_;
+    uint64_t seq_;
+    // in-memory rows, kept as a max heap when limit is given
+    std::vector<Entry> entries_;
+    uint64_t memory_used_;
+    std::vector<Run> runs_;
+    uint64_t spill_row_cnt_;
+};
+
+}  // namespace vm
+}  // namespace hybridse
+#endif  // SRC_VM_ROW_SORTER_H_
@@ -0,0 +1,238 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vm/row_sorter.h"
+#include <stdlib.h>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace hybridse {
+namespace vm {
+
+class RowSorterTest : public ::testing::Test {
+ public:
+    RowSorterTest() {
+        AddColumn(&key_schema_, "k0", type::kInt32);
+        AddColumn(&key_schema_, "k1", type::kVarchar);
+        AddColumn(&id_schema_, "id", type::kInt64);
+        // keys with duplicates and nulls, ids in input order
+        srand(2021);
+        for (int64_t id = 0; id < 2000; ++id) {
+            int32_t k0 = rand() % 8;  // NOLINT
+            bool k0_null = 0 == rand() % 10;  // NOLINT
+            std::string k1(rand() % 3, 'a' + rand() % 3);  // NOLINT
+            Row key = BuildKey(k0, k0_null, k1);
+            Row row = key;
+            row.Append(BuildId(id));
+            keys_.push_back(key);
+            rows_.push_back(row);
+        }
+    }
+    ~RowSorterTest() {}
+
+    static void AddColumn(Schema* schema, const std::string& name,
+                          type::Type type) {
+        auto col = schema->Add();
+        col->set_name(name);
+        col->set_type(type);
+    }
+
+    Row BuildKey(int32_t k0, bool k0_null, const std::string& k1) {
+        codec::RowBuilder builder(key_schema_);
+        uint32_t size = builder.CalTotalLength(k1.size());
+        int8_t* buf = reinterpret_cast<int8_t*>(malloc(size));
+        builder.SetBuffer(buf, size);
+        if (k0_null) {
+            builder.AppendNULL();
+        } else {
+            builder.AppendInt32(k0);
+        }
+        builder.AppendString(k1.c_str(), k1.size());
+        return Row(base::RefCountedSlice::CreateManaged(buf, size));
+    }
+
+    base::RefCountedSlice BuildId(int64_t id) {
+        codec::RowBuilder builder(id_schema_);
+        uint32_t size = builder.CalTotalLength(0);
+        int8_t* buf = reinterpret_cast<int8_t*>(malloc(size));
+        builder.SetBuffer(buf, size);
+        builder.AppendInt64(id);
+        return base::RefCountedSlice::CreateManaged(buf, size);
+    }
+
+    std::vector<int64_t> Sort(bool is_asc, int32_t limit_cnt,
+                              uint64_t memory_limit, size_t* spill_cnt) {
+        auto sorter = std::make_shared<RowSorter>(
+            key_schema_, is_asc, limit_cnt, memory_limit, "/tmp");
+        for (size_t i = 0; i < rows_.size(); ++i) {
+            EXPECT_TRUE(sorter->Add(keys_[i], rows_[i]));
+        }
+        auto output = RowSorter::Finish(sorter, &key_schema_);
+        EXPECT_TRUE(output != nullptr);
+        *spill_cnt = sorter->GetSpillCount();
+        auto iter = output->GetIterator();
+        iter->SeekToFirst();
+        std::vector<int64_t> ids;
+        while (iter->Valid()) {
+            ids.push_back(GetId(*sorter, iter->GetValue()));
+            iter->Next();
+        }
+        EXPECT_EQ(ids.size(), output->GetCount());
+        return ids;
+    }
+
+    // Id of sorted row, which must come with its key
+    int64_t GetId(const RowSorter& sorter, const Row& row) {
+        EXPECT_EQ(2, row.GetRowPtrCnt());
+        codec::RowView id_view(id_schema_);
+        int64_t id = -1;
+        id_view.GetValue(row.buf(1), 0, type::kInt64, &id);
+        EXPECT_EQ(0, sorter.CompareKey(keys_[id], Row(row.GetSlice(0))));
+        return id;
+    }
+
+    std::vector<int64_t> Expect(bool is_asc, int32_t limit_cnt) {
+        RowSorter sorter(key_schema_, true, 0, 0, "");
+        std::vector<int64_t> ids;
+        for (size_t i = 0; i < rows_.size(); ++i) {
+            ids.push_back(i);
+        }
+        std::stable_sort(ids.begin(), ids.end(), [&](int64_t l, int64_t r) {
+            int cmp = sorter.CompareKey(keys_[l], keys_[r]);
+            return is_asc ? cmp < 0 : cmp > 0;
+        });
+        if (limit_cnt > 0) {
+            ids.resize(limit_cnt);
+        }
+        return ids;
+    }
+
+    Schema key_schema_;
+    Schema id_schema_;
+    std::vector<Row> keys_;
+    std::vector<Row> rows_;
+};
+
+TEST_F(RowSorterTest, CompareKeyTest) {
+    RowSorter sorter(key_schema_, true, 0, 0, "");
+    ASSERT_EQ(0, sorter.CompareKey(BuildKey(1, false, "ab"),
+                                   BuildKey(1, false, "ab")));
+    ASSERT_GT(0, sorter.CompareKey(BuildKey(1, false, "ab"),
+                                   BuildKey(2, false, "a")));
+    ASSERT_LT(0, sorter.CompareKey(BuildKey(-1, false, "b"),
+                                   BuildKey(-1, false, "ab")));
+    ASSERT_GT(0, sorter.CompareKey(BuildKey(1, false, "a"),
+                                   BuildKey(1, false, "ab")));
+    // null first
+    ASSERT_GT(0, sorter.CompareKey(BuildKey(0, true, "b"),
+                                   BuildKey(-100, false, "a")));
+    ASSERT_EQ(0, sorter.CompareKey(BuildKey(0, true, "a"),
+                                   BuildKey(1, true, "a")));
+}
+
+TEST_F(RowSorterTest, SortTest) {
+    size_t spill_cnt = 0;
+    ASSERT_EQ(Expect(true, 0), Sort(true, 0, 0, &spill_cnt));
+    ASSERT_EQ(0u, spill_cnt);
+    ASSERT_EQ(Expect(false, 0), Sort(false, 0, 0, &spill_cnt));
+    ASSERT_EQ(0u, spill_cnt);
+}
+
+TEST_F(RowSorterTest, TopNTest) {
+    size_t spill_cnt = 0;
+    ASSERT_EQ(Expect(true, 17), Sort(true, 17, 0, &spill_cnt));
+    ASSERT_EQ(Expect(false, 1), Sort(false, 1, 0, &spill_cnt));
+    // limit over row count keeps all rows, never spill with limit
+    ASSERT_EQ(Expect(false, 0), Sort(false, 5000, 1024, &spill_cnt));
+    ASSERT_EQ(0u, spill_cnt);
+}
+
+TEST_F(RowSorterTest, SpillTest) {
+    size_t spill_cnt = 0;
+    ASSERT_EQ(Expect(true, 0), Sort(true, 0, 8192, &spill_cnt));
+    ASSERT_LT(1u, spill_cnt);
+    ASSERT_EQ(Expect(false, 0), Sort(false, 0, 8192, &spill_cnt));
+    ASSERT_LT(1u, spill_cnt);
+}
+
+TEST_F(RowSorterTest, SpillFailTest) {
+    RowSorter sorter(key_schema_, true, 0, 1, "/not_exist_sort_dir");
+    ASSERT_FALSE(sorter.Add(keys_[0], rows_[0]));
+}
+
+TEST_F(RowSorterTest, SpillIteratorTest) {
+    auto sorter = std::make_shared<RowSorter>(key_schema_, true, 0, 8192,
+                                              "/tmp");
+    for (size_t i = 0; i < rows_.size(); ++i) {
+        ASSERT_TRUE(sorter->Add(keys_[i], rows_[i]));
+    }
+    auto output = RowSorter::Finish(sorter, &key_schema_);
+    ASSERT_TRUE(output != nullptr);
+    ASSERT_LT(1u, sorter->GetSpillCount());
+    ASSERT_EQ(rows_.size(), output->GetCount());
+
+    // iterators merge runs on their own
+    std::vector<int64_t> expect = Expect(true, 0);
+    auto iter = output->GetIterator();
+    auto other = output->GetIterator();
+    ASSERT_FALSE(iter->Valid());
+    iter->SeekToFirst();
+    other->SeekToFirst();
+    for (size_t i = 0; i < expect.size(); ++i) {
+        ASSERT_TRUE(iter->Valid());
+        ASSERT_EQ(expect[i], GetId(*sorter, iter->GetValue()));
+        iter->Next();
+        if (i % 2 == 1) {
+            ASSERT_EQ(expect[i / 2], GetId(*sorter, other->GetValue()));
+            other->Next();
+        }
+    }
+    ASSERT_FALSE(iter->Valid());
+    ASSERT_EQ(expect[100], GetId(*sorter, output->At(100)));
+    ASSERT_EQ(0, output->At(rows_.size()).size());
+}
+
+TEST_F(RowSorterTest, SpillAtTest) {
+    auto sorter = std::make_shared<RowSorter>(key_schema_, false, 0, 8192,
+                                              "/tmp");
+    for (size_t i = 0; i < rows_.size(); ++i) {
+        ASSERT_TRUE(sorter->Add(keys_[i], rows_[i]));
+    }
+    auto output = RowSorter::Finish(sorter, &key_schema_);
+    ASSERT_TRUE(output != nullptr);
+    ASSERT_LT(1u, sorter->GetSpillCount());
+
+    // rows by position are read from merged file in any order
+    std::vector<int64_t> expect = Expect(false, 0);
+    for (size_t i = expect.size(); i > 0; --i) {
+        ASSERT_EQ(expect[i - 1], GetId(*sorter, output->At(i - 1)));
+    }
+    for (size_t i = 0; i < expect.size(); i += 7) {
+        ASSERT_EQ(expect[i], GetId(*sorter, output->At(i)));
+    }
+    ASSERT_EQ(0, output->At(expect.size()).size());
+}
+
+}  // namespace vm
+}  // namespace hybridse
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -15,6 +15,8 @@
  */
 
 #include "vm/runner.h"
+#include <algorithm>
+#include <future>  // NOLINT
 #include <memory>
 #include <string>
 #include <utility>
@@ -25,12 +27,15 @@
 #include "vm/core_api.h"
 #include "vm/jit_runtime.h"
 #include "vm/mem_catalog.h"
+#include "vm/row_sorter.h"
 
 namespace hybridse {
 namespace vm {
 #define MAX_DEBUG_BATCH_SiZE 5
 #define MAX_DEBUG_LINES_CNT 20
 #define MAX_DEBUG_COLUMN_MAX 20
+// Rows of request batch run by one task at least
+#define MIN_BATCH_REQUEST_TASK_SIZE 16
 
 // Build Runner for each physical node
 // return cluster task of given runner
@@ -44,6 +49,8 @@ namespace vm {
 // TableProjectRunner --> inherit task
 // WindowAggRunner --> LocalTask , Unsupport in distribute database
 // GroupAggRunner --> LocalTask, Unsupport in distribute database
+// HashAggRunner --> inherit task of group input, Unsupport in distribute
+// database
 //
 // RowProjectRunner --> inherit task
 // ConstProjectRunner --> local task
@@ -58,6 +65,7 @@ namespace vm {
 //      --> kJoinTypeLast->RequestJoinRunner
 //              --> complete route_info of right cluster task
 //              --> build proxy runner if need
+//      --> kJoinTypeLeft/kJoinTypeInner->HashJoinRunner
 //      --> kJoinTypeConcat
 //              --> build proxy runner if need
 // kPhysicalOpPostRequestUnion
@@ -161,6 +169,33 @@ ClusterTask RunnerBuilder::Build(PhysicalOpNode* node, Status& status) {
             return RegisterTask(node, CommonTask(runner));
         }
         case kPhysicalOpProject: {
+            auto op = dynamic_cast<const PhysicalProjectNode*>(node);
+            if (kGroupAggregation == op->project_type_ &&
+                !support_cluster_optimized_ &&
+                kPhysicalOpGroupBy == node->GetProducer(0)->GetOpType()) {
+                // aggregate un-indexed group input in a single pass instead
+                // of grouping it into a partition first
+                auto group_op =
+                    dynamic_cast<PhysicalGroupNode*>(node->GetProducer(0));
+                auto plan =
+                    IncrementalAggPlan::Build(op->project().fn_info(), false);
+                if (group_op->Valid() && plan) {
+                    auto group_input_task =  // NOLINT
+                        Build(group_op->GetProducer(0), status);
+                    if (!group_input_task.IsValid()) {
+                        status.msg = "fail to build input runner";
+                        status.code = common::kOpGenError;
+                        LOG(WARNING) << status;
+                        return fail;
+                    }
+                    HashAggRunner* runner = nullptr;
+                    CreateRunner<HashAggRunner>(
+                        &runner, id_++, node->schemas_ctx(), op->GetLimitCnt(),
+                        group_op->group(), plan);
+                    return RegisterTask(
+                        node, UnaryInheritTask(group_input_task, runner));
+                }
+            }
             auto cluster_task =  // NOLINT
                 Build(node->producers().at(0), status);
             if (!cluster_task.IsValid()) {
@@ -170,7 +205,6 @@ ClusterTask RunnerBuilder::Build(PhysicalOpNode* node, Status& status) {
                 return fail;
             }
             auto input = cluster_task.GetRoot();
-            auto op = dynamic_cast<const PhysicalProjectNode*>(node);
             switch (op->project_type_) {
                 case kTableProject: {
                     if (support_cluster_optimized_) {
@@ -231,6 +265,7 @@ ClusterTask RunnerBuilder::Build(PhysicalOpNode* node, Status& status) {
                         op->window_, op->project().fn_info(),
                         op->instance_not_in_window(),
                         op->exclude_current_time(), op->need_append_input());
+                    runner->set_thread_pool(batch_thread_pool_);
                     size_t input_slices =
                         input->output_schemas()->GetSchemaSourceSize();
                     if (!op->window_unions_.Empty()) {
@@ -426,6 +461,27 @@ ClusterTask RunnerBuilder::Build(PhysicalOpNode* node, Status& status) {
                                                 Key(), kLeftBias));
                     }
                 }
+                case node::kJoinTypeLeft:
+                case node::kJoinTypeInner: {
+                    if (support_cluster_optimized_) {
+                        status.msg = "fail to build cluster with " +
+                                     node::JoinTypeName(
+                                         op->join().join_type()) +
+                                     " join node";
+                        status.code = common::kOpGenError;
+                        LOG(WARNING) << status;
+                        return fail;
+                    }
+                    HashJoinRunner* runner = nullptr;
+                    CreateRunner<HashJoinRunner>(
+                        &runner, id_++, node->schemas_ctx(), op->GetLimitCnt(),
+                        op->join_,
+                        left->output_schemas()->GetSchemaSourceSize(),
+                        right->output_schemas()->GetSchemaSourceSize());
+                    return RegisterTask(
+                        node, BinaryInherit(left_task, right_task, runner,
+                                            Key(), kLeftBias));
+                }
                 case node::kJoinTypeConcat: {
                     ConcatRunner* runner = nullptr;
                     CreateRunner<ConcatRunner>(
@@ -497,6 +553,86 @@ ClusterTask RunnerBuilder::Build(PhysicalOpNode* node, Status& status) {
                                       op->GetLimitCnt());
             return RegisterTask(node, UnaryInheritTask(cluster_task, runner));
         }
+        case kPhysicalOpDistinct: {
+            if (support_cluster_optimized_) {
+                status.msg = "fail to build cluster with distinct node";
+                status.code = common::kOpGenError;
+                LOG(WARNING) << status;
+                return fail;
+            }
+            auto cluster_task = Build(node->producers().at(0), status);
+            if (!cluster_task.IsValid()) {
+                status.msg = "fail to build input runner";
+                status.code = common::kOpGenError;
+                LOG(WARNING) << status;
+                return fail;
+            }
+            DistinctRunner* runner = nullptr;
+            CreateRunner<DistinctRunner>(&runner, id_++, node->schemas_ctx(),
+                                         node->GetLimitCnt());
+            return RegisterTask(node, UnaryInheritTask(cluster_task, runner));
+        }
+        case kPhysicalOpUnion: {
+            if (support_cluster_optimized_) {
+                status.msg = "fail to build cluster with union node";
+                status.code = common::kOpGenError;
+                LOG(WARNING) << status;
+                return fail;
+            }
+            auto left_task = Build(node->producers().at(0), status);
+            if (!left_task.IsValid()) {
+                status.msg = "fail to build left input runner";
+                status.code = common::kOpGenError;
+                LOG(WARNING) << status;
+                return fail;
+            }
+            auto right_task = Build(node->producers().at(1), status);
+            if (!right_task.IsValid()) {
+                status.msg = "fail to build right input runner";
+                status.code = common::kOpGenError;
+                LOG(WARNING) << status;
+                return fail;
+            }
+            auto op = dynamic_cast<const PhysicalUnionNode*>(node);
+            UnionRunner* runner = nullptr;
+            CreateRunner<UnionRunner>(&runner, id_++, node->schemas_ctx(),
+                                      op->GetLimitCnt(), op->is_all_);
+            return RegisterTask(node, BinaryInherit(left_task, right_task,
+                                                    runner, Key(), kNoBias));
+        }
+        case kPhysicalOpSortBy: {
+            if (support_cluster_optimized_) {
+                status.msg = "fail to build cluster with sort node";
+                status.code = common::kOpGenError;
+                LOG(WARNING) << status;
+                return fail;
+            }
+            auto cluster_task = Build(node->producers().at(0), status);
+            if (!cluster_task.IsValid()) {
+                status.msg = "fail to build input runner";
+                status.code = common::kOpGenError;
+                LOG(WARNING) << status;
+                return fail;
+            }
+            auto op = dynamic_cast<PhysicalSortNode*>(node);
+            if (!op->Valid()) {
+                // keep limit pushed down into the sort node
+                if (op->GetLimitCnt() == 0) {
+                    return RegisterTask(node, cluster_task);
+                }
+                LimitRunner* runner = nullptr;
+                CreateRunner<LimitRunner>(&runner, id_++, node->schemas_ctx(),
+                                          op->GetLimitCnt());
+                return RegisterTask(node,
+                                    UnaryInheritTask(cluster_task, runner));
+            }
+            SortRunner* runner = nullptr;
+            CreateRunner<SortRunner>(&runner, id_++, node->schemas_ctx(),
+                                     op->GetLimitCnt(), op->sort());
+            runner->set_spill_options(batch_sort_memory_limit_,
+                                      batch_sort_spill_dir_);
+            return RegisterTask(node, UnaryInheritTask(cluster_task, runner));
+        }
         case kPhysicalOpRename: {
             return Build(node->producers().at(0), status);
         }
@@ -732,6 +868,97 @@ ClusterTask RunnerBuilder::BuildClusterTaskForBinaryRunner(
         return ClusterTask::TaskMergeToLeft(runner, new_left, new_right);
     }
 }
+// Whether `runner` builds a new table on every run, which is read by its
+// only consumer, neither cached nor shared with other runners
+static bool OutputsOwnTable(Runner* runner) {
+    if (nullptr == runner || runner->need_cache() ||
+        runner->need_batch_cache()) {
+        return false;
+    }
+    switch (runner->type_) {
+        case kRunnerTableProject:
+        case kRunnerWindowAgg:
+        case kRunnerGroupAgg:
+        case kRunnerHashAgg:
+            return true;
+        default:
+            return false;
+    }
+}
+void RunnerBuilder::EnableLazyRunners(Runner* root) {
+    // Runner and whether its output is scanned at most once per execution.
+    // Output of root is scanned by session, inputs run by generators are
+    // not visited and stay materialized.
+    std::vector<std::pair<Runner*, bool>> stack = {{root, true}};
+    std::set<Runner*> visited;
+    // RunnerScheduler runs inputs of runners reading several inputs as
+    // parallel units on the batch pool
+    bool schedule_units =
+        batch_thread_pool_ && batch_thread_pool_->thread_num() > 1;
+    std::vector<Runner*> inputs;
+    while (!stack.empty()) {
+        Runner* runner = stack.back().first;
+        bool scan_once = stack.back().second;
+        stack.pop_back();
+        if (nullptr == runner || !visited.insert(runner).second) {
+            continue;
+        }
+        bool input_scan_once = false;
+        switch (runner->type_) {
+            case kRunnerTableProject: {
+                if (scan_once && !runner->need_cache()) {
+                    dynamic_cast<TableProjectRunner*>(runner)->EnableLazy();
+                }
+                input_scan_once = true;
+                break;
+            }
+            case kRunnerLimit: {
+                if (scan_once && !runner->need_cache()) {
+                    dynamic_cast<LimitRunner*>(runner)->EnableLazy();
+                }
+                input_scan_once = true;
+                break;
+            }
+            case kRunnerConcat: {
+                // concat table syncs both inputs in one scan on first access
+                input_scan_once = true;
+                break;
+            }
+            case kRunnerOrder: {
+                // sorter takes rows in one scan, spilled rows are released
+                // if input does not hold them
+                auto sort_runner = dynamic_cast<SortRunner*>(runner);
+                input_scan_once = sort_runner->SortsInOneScan();
+                auto& producers = runner->GetProducers();
+                if (input_scan_once && 1u == producers.size() &&
+                    OutputsOwnTable(producers[0])) {
+                    sort_runner->EnableReleaseInput();
+                }
+                break;
+            }
+            case kRunnerFilter:
+            case kRunnerSimpleProject:
+            case kRunnerSelectSlice: {
+                // wrapper scans input whenever its output is scanned
+                input_scan_once =
+                    scan_once && !runner->need_cache() && runner->is_lazy();
+                break;
+            }
+            default:
+                break;
+        }
+        inputs.clear();
+        runner->GetInputs(&inputs);
+        if (schedule_units && inputs.size() > 1) {
+            // keep units materialized, or their work would be moved from
+            // parallel units to the consumer
+            input_scan_once = false;
+        }
+        for (auto producer : runner->GetProducers()) {
+            stack.push_back(std::make_pair(producer, input_scan_once));
+        }
+    }
+}
 ClusterTask RunnerBuilder::BuildProxyRunnerForClusterTask(
     const ClusterTask& task) {
     if (!task.IsCompletedClusterTask()) {
@@ -892,11 +1119,11 @@ Row Runner::WindowProject(const int8_t* fn, const uint64_t row_key,
         window->PopFrontData();
     }
     if (append_slices > 0) {
-        return Row(base::RefCountedSlice::CreateManaged(
+        return Row(JitRuntime::get()->CreateRowSlice(
                        out_buf, RowView::GetSize(out_buf)),
                    append_slices, row);
     } else {
-        return Row(base::RefCountedSlice::CreateManaged(
+        return Row(JitRuntime::get()->CreateRowSlice(
             out_buf, RowView::GetSize(out_buf)));
     }
 }
@@ -985,7 +1212,12 @@ std::shared_ptr<DataHandlerList> Runner::BatchRequestRun(RunnerContext& ctx) {
         batch_inputs[idx - 1] = producers_[idx - 1]->BatchRequestRun(ctx);
     }
 
-    for (size_t idx = 0; idx < ctx.GetRequestSize(); idx++) {
+    // common runner computes the first row only
+    bool run_parallel =
+        !need_batch_cache_ && BatchRequestRunParallel(ctx, batch_inputs,
+                                                      outputs.get());
+    for (size_t idx = 0; !run_parallel && idx < ctx.GetRequestSize();
+         idx++) {
         inputs.clear();
         for (size_t producer_idx = 0; producer_idx < producers_.size();
              producer_idx++) {
@@ -1028,13 +1260,89 @@ std::shared_ptr<DataHandlerList> Runner::BatchRequestRun(RunnerContext& ctx) {
     }
     return outputs;
 }
-std::shared_ptr<DataHandler> Runner::RunWithCache(RunnerContext& ctx) {
-    if (need_cache_) {
-        auto cached = ctx.GetCache(id_);
-        if (cached != nullptr) {
-            DLOG(INFO) << "RUNNER ID " << id_ << " HIT CACHE!";
-            return cached;
+// Runners whose `Run` keeps no state across calls, so that rows of a batch
+// can be run concurrently
+static bool IsStatelessRunner(const RunnerType type) {
+    switch (type) {
+        case kRunnerConstProject:
+        case kRunnerTableProject:
+        case kRunnerRowProject:
+        case kRunnerSimpleProject:
+        case kRunnerSelectSlice:
+        case kRunnerAgg:
+        case kRunnerRequestUnion:
+        case kRunnerRequestLastJoin:
+            return true;
+        default:
+            return false;
+    }
+}
+bool Runner::BatchRequestRunParallel(
+    RunnerContext& ctx,
+    const std::vector<std::shared_ptr<DataHandlerList>>& batch_inputs,
+    DataHandlerVector* outputs) {
+    auto cluster_job = ctx.cluster_job();
+    auto thread_pool =
+        nullptr == cluster_job ? nullptr : cluster_job->thread_pool();
+    size_t request_size = ctx.GetRequestSize();
+    if (!IsStatelessRunner(type_) || !thread_pool ||
+        thread_pool->thread_num() <= 1 || thread_pool->InWorker() ||
+        request_size < 2 * MIN_BATCH_REQUEST_TASK_SIZE) {
+        return false;
+    }
+    // Inputs run by generators inside `Run`, e.g. union tables of request
+    // window, are computed here once and kept in cache of context even if
+    // not cached otherwise, so that workers only read the cache
+    std::vector<Runner*> runner_inputs;
+    GetInputs(&runner_inputs);
+    for (auto input : runner_inputs) {
+        if (std::find(producers_.begin(), producers_.end(), input) !=
+            producers_.end()) {
+            continue;
+        }
+        auto output = input->RunWithCache(ctx);
+        if (!output) {
+            return false;
         }
+        ctx.SetCache(input->id_, output);
+    }
+
+    size_t task_cnt =
+        std::min(request_size / MIN_BATCH_REQUEST_TASK_SIZE,
+                 thread_pool->thread_num() * 4);
+    std::vector<std::shared_ptr<DataHandler>> results(request_size);
+    std::vector<std::future<void>> futures;
+    for (size_t task_idx = 0; task_idx < task_cnt; task_idx++) {
+        size_t begin = request_size * task_idx / task_cnt;
+        size_t end = request_size * (task_idx + 1) / task_cnt;
+        base::ByteMemoryPool* arena = ctx.NewWorkerArena();
+        futures.push_back(thread_pool->Submit([&, begin, end, arena]() {
+            RowArenaScope arena_scope(arena);
+            std::vector<std::shared_ptr<DataHandler>> inputs(
+                batch_inputs.size());
+            for (size_t idx = begin; idx < end; idx++) {
+                for (size_t i = 0; i < batch_inputs.size(); i++) {
+                    inputs[i] = batch_inputs[i]->Get(idx);
+                }
+                results[idx] = Run(ctx, inputs);
+            }
+        }));
+    }
+    for (auto& future : futures) {
+        future.get();
+    }
+    for (auto& res : results) {
+        outputs->Add(res);
+    }
+    return true;
+}
+std::shared_ptr<DataHandler> Runner::RunWithCache(RunnerContext& ctx) {
+    // output of runner without cache may be computed ahead by
+    // `RunnerScheduler`
+    auto cached = ctx.GetCache(id_);
+    if (cached != nullptr) {
+        DLOG(INFO) << "RUNNER ID " << id_ << " HIT CACHE!";
+        return cached;
     }
     std::vector<std::shared_ptr<DataHandler>> inputs(producers_.size());
     for (size_t idx = producers_.size(); idx > 0; idx--) {
@@ -1150,7 +1458,145 @@ std::shared_ptr<DataHandler> SortRunner::Run(
         LOG(WARNING) << "input is empty";
         return fail_ptr;
     }
-    return sort_gen_.Sort(input);
+    const OrderGenerator& order_gen = sort_gen_.order_gen();
+    if (!sort_gen_.Valid() || !order_gen.Valid() ||
+        kTableHandler != input->GetHanlderType()) {
+        return sort_gen_.Sort(input);
+    }
+    auto table = std::dynamic_pointer_cast<TableHandler>(input);
+    auto iter = table->GetIterator();
+    if (!iter) {
+        return std::shared_ptr<MemTableHandler>(
+            new MemTableHandler(table->GetSchema()));
+    }
+    // sort on all order keys, keep only the first rows if limit is given
+    auto sorter = std::make_shared<RowSorter>(order_gen.fn_schema_,
+                                              sort_gen_.is_asc(), limit_cnt_,
+                                              memory_limit_, spill_dir_);
+    auto mem_table = release_input_ && memory_limit_ > 0
+                         ? std::dynamic_pointer_cast<MemTableHandler>(table)
+                         : std::shared_ptr<MemTableHandler>();
+    if (mem_table) {
+        // rows are only referenced by sorter once taken out of input
+        uint64_t cnt = mem_table->GetCount();
+        for (uint64_t pos = 0; pos < cnt; ++pos) {
+            Row row = mem_table->TakeRow(pos);
+            if (!sorter->Add(order_gen.GenKeyRow(row), row)) {
+                LOG(WARNING) << "fail to sort table: fail to add row";
+                return fail_ptr;
+            }
+        }
+    } else {
+        iter->SeekToFirst();
+        while (iter->Valid()) {
+            const Row& row = iter->GetValue();
+            if (!sorter->Add(order_gen.GenKeyRow(row), row)) {
+                LOG(WARNING) << "fail to sort table: fail to add row";
+                return fail_ptr;
+            }
+            iter->Next();
+        }
+    }
+    auto output_table = RowSorter::Finish(sorter, table->GetSchema());
+    if (!output_table) {
+        LOG(WARNING) << "fail to sort table: fail to spill sorted rows";
+        return fail_ptr;
+    }
+    return output_table;
+}
+
+// Keep the first `limit_cnt` rows of `table`, all rows if not limited
+static std::shared_ptr<TableHandler> LimitTable(
+    std::shared_ptr<TableHandler> table, int32_t limit_cnt) {
+    if (limit_cnt <= 0) {
+        return table;
+    }
+    auto output_table = std::shared_ptr<MemTableHandler>(
+        new MemTableHandler(table->GetSchema()));
+    auto iter = table->GetIterator();
+    if (!iter) {
+        return output_table;
+    }
+    iter->SeekToFirst();
+    int32_t cnt = 0;
+    while (cnt++ < limit_cnt && iter->Valid()) {
+        output_table->AddRow(iter->GetValue());
+        iter->Next();
+    }
+    return output_table;
+}
+
+std::shared_ptr<DataHandler> DistinctRunner::Run(
+    RunnerContext& ctx,
+    const std::vector<std::shared_ptr<DataHandler>>& inputs) {
+    auto fail_ptr = std::shared_ptr<DataHandler>();
+    if (inputs.size() < 1u) {
+        LOG(WARNING) << "inputs size < 1";
+        return fail_ptr;
+    }
+    auto input = inputs[0];
+    if (!input) {
+        LOG(WARNING) << "fail to run distinct: input is empty or null";
+        return fail_ptr;
+    }
+    switch (input->GetHanlderType()) {
+        case kTableHandler: {
+            return LimitTable(distinct_gen_.Distinct(
+                                  std::dynamic_pointer_cast<TableHandler>(input)),
+                              limit_cnt_);
+        }
+        case kRowHandler: {
+            return input;
+        }
+        default: {
+            LOG(WARNING) << "fail to run distinct when input is partition";
+            return fail_ptr;
+        }
+    }
+}
+
+std::shared_ptr<DataHandler> UnionRunner::Run(
+    RunnerContext& ctx,
+    const std::vector<std::shared_ptr<DataHandler>>& inputs) {
+    auto fail_ptr = std::shared_ptr<DataHandler>();
+    if (inputs.size() < 2u) {
+        LOG(WARNING) << "inputs size < 2";
+        return fail_ptr;
+    }
+    std::vector<std::shared_ptr<TableHandler>> tables;
+    for (auto& input : inputs) {
+        if (!input) {
+            LOG(WARNING) << "fail to run union: input is empty or null";
+            return fail_ptr;
+        }
+        switch (input->GetHanlderType()) {
+            case kTableHandler: {
+                tables.push_back(std::dynamic_pointer_cast<TableHandler>(input));
+                break;
+            }
+            case kRowHandler: {
+                auto table = std::shared_ptr<MemTableHandler>(
+                    new MemTableHandler(input->GetSchema()));
+                auto& row =
+                    std::dynamic_pointer_cast<RowHandler>(input)->GetValue();
+                if (!row.empty()) {
+                    table->AddRow(row);
+                }
+                tables.push_back(table);
+                break;
+            }
+            default: {
+                LOG(WARNING) << "fail to run union when input is partition";
+                return fail_ptr;
+            }
+        }
+    }
+    std::shared_ptr<TableHandler> output =
+        std::make_shared<TableConcatWrapper>(tables);
+    if (!is_all_) {
+        output = distinct_gen_.Distinct(output);
+    }
+    return LimitTable(output, limit_cnt_);
 }
 
 std::shared_ptr<DataHandler> ConstProjectRunner::Run(
@@ -1175,6 +1621,14 @@ std::shared_ptr<DataHandler> TableProjectRunner::Run(
     if (kTableHandler != input->GetHanlderType()) {
         return std::shared_ptr<DataHandler>();
     }
+    if (is_lazy_) {
+        auto table = std::dynamic_pointer_cast<TableHandler>(input);
+        if (limit_cnt_ > 0) {
+            table = std::make_shared<TableLimitWrapper>(table, limit_cnt_);
+        }
+        return std::make_shared<TableBlockProjectWrapper>(table,
+                                                          &project_gen_.fun_);
+    }
     auto output_table = std::shared_ptr<MemTableHandler>(new MemTableHandler());
     auto iter = std::dynamic_pointer_cast<TableHandler>(input)->GetIterator();
     if (!iter) {
@@ -1183,12 +1637,25 @@ std::shared_ptr<DataHandler> TableProjectRunner::Run(
     }
     iter->SeekToFirst();
     int32_t cnt = 0;
+    std::vector<Row> rows;
+    std::vector<Row> outputs;
+    rows.reserve(kRowBlockSize);
     while (iter->Valid()) {
-        if (limit_cnt_ > 0 && cnt++ >= limit_cnt_) {
+        rows.clear();
+        while (iter->Valid() && rows.size() < kRowBlockSize &&
+               (limit_cnt_ <= 0 || cnt < limit_cnt_)) {
+            rows.push_back(iter->GetValue());
+            iter->Next();
+            cnt++;
+        }
+        if (rows.empty()) {
             break;
         }
-        output_table->AddRow(project_gen_.Gen(iter->GetValue()));
-        iter->Next();
+        outputs.resize(rows.size());
+        project_gen_.GenBlock(rows.data(), rows.size(), outputs.data());
+        for (auto& row : outputs) {
+            output_table->AddRow(row);
+        }
     }
     return output_table;
 }
@@ -1322,6 +1789,20 @@ std::shared_ptr<DataHandler> WindowAggRunner::Run(
     // Prepare Join Tables
     auto join_right_tables = windows_join_gen_.RunInputs(ctx);
 
+    // Fan keys out to workers. Limit counts rows across keys so it is only
+    // applied on caller thread. Join right tables are shared by all keys,
+    // so window joins also stay on caller thread.
+    if (thread_pool_ && thread_pool_->thread_num() > 1 && limit_cnt_ <= 0 &&
+        !windows_join_gen_.Valid() && !thread_pool_->InWorker()) {
+        std::vector<std::string> keys;
+        while (instance_partition_iter->Valid()) {
+            keys.push_back(instance_partition_iter->GetKey().ToString());
+            instance_partition_iter->Next();
+        }
+        return RunWindowAggParallel(instance_partition, union_partitions,
+                                    join_right_tables, keys);
+    }
+
     // Compute output
     std::shared_ptr<MemTableHandler> output_table =
         std::shared_ptr<MemTableHandler>(new MemTableHandler());
@@ -1334,6 +1815,49 @@ std::shared_ptr<DataHandler> WindowAggRunner::Run(
     return output_table;
 }
 
+std::shared_ptr<MemTableHandler> WindowAggRunner::RunWindowAggParallel(
+    std::shared_ptr<PartitionHandler> instance_partition,
+    const std::vector<std::shared_ptr<PartitionHandler>>& union_partitions,
+    const std::vector<std::shared_ptr<DataHandler>>& join_right_tables,
+    const std::vector<std::string>& keys) {
+    // Several tasks per worker so that stealing can balance skewed keys
+    size_t task_cnt = std::min(keys.size(), thread_pool_->thread_num() * 4);
+    std::vector<std::shared_ptr<MemTableHandler>> task_outputs(task_cnt);
+    std::vector<std::future<void>> futures;
+    for (size_t task_idx = 0; task_idx < task_cnt; task_idx++) {
+        size_t begin = keys.size() * task_idx / task_cnt;
+        size_t end = keys.size() * (task_idx + 1) / task_cnt;
+        auto output = std::make_shared<MemTableHandler>();
+        task_outputs[task_idx] = output;
+        // JitRuntime is thread local, so every worker allocates from its own
+        // arena while projecting rows. Rows of different keys may share
+        // slices, such as last join outputs, which are copied and released
+        // on several workers under atomic reference counts.
+        futures.push_back(thread_pool_->Submit([&, begin, end, output]() {
+            for (size_t i = begin; i < end; i++) {
+                RunWindowAggOnKey(instance_partition, union_partitions,
+                                  join_right_tables, keys[i], output);
+            }
+        }));
+    }
+    for (auto& future : futures) {
+        future.get();
+    }
+
+    auto output_table = std::make_shared<MemTableHandler>();
+    size_t total = 0;
+    for (auto& output : task_outputs) {
+        total += output->GetCount();
+    }
+    output_table->Reserve(total);
+    for (auto& output : task_outputs) {
+        for (uint64_t i = 0; i < output->GetCount(); i++) {
+            output_table->AddRow(output->At(i));
+        }
+    }
+    return output_table;
+}
+
 // Run Window Aggeregation on given key
 void WindowAggRunner::RunWindowAggOnKey(
     std::shared_ptr<PartitionHandler> instance_partition,
@@ -1394,6 +1918,12 @@ void WindowAggRunner::RunWindowAggOnKey(
     HistoryWindow window(instance_window_gen_.range_gen_.window_range_);
     window.set_instance_not_in_window(instance_not_in_window_);
     window.set_exclude_current_time(exclude_current_time_);
+    std::unique_ptr<IncrementalWindowAgg> incremental_agg;
+    if (incremental_plan_) {
+        incremental_agg.reset(
+            new IncrementalWindowAgg(incremental_plan_.get()));
+        incremental_agg->Reset(&window);
+    }
 
     while (instance_segment_iter->Valid()) {
         if (limit_cnt_ > 0 && cnt >= limit_cnt_) {
@@ -1407,9 +1937,8 @@ void WindowAggRunner::RunWindowAggOnKey(
             if (windows_join_gen_.Valid()) {
                 row = windows_join_gen_.Join(row, join_right_tables);
             }
-            window_project_gen_.Gen(
-                union_segment_iters[min_union_pos]->GetKey(), row, false,
-                append_slices_, &window);
+            WindowProject(union_segment_iters[min_union_pos]->GetKey(), row,
+                          false, &window, incremental_agg.get());
 
             // Update Iterator Status
             union_segment_iters[min_union_pos]->Next();
@@ -1427,12 +1956,12 @@ void WindowAggRunner::RunWindowAggOnKey(
             Row row = instance_row;
             row = windows_join_gen_.Join(instance_row, join_right_tables);
             output_table->AddRow(
-                window_project_gen_.Gen(instance_segment_iter->GetKey(), row,
-                                        true, append_slices_, &window));
+                WindowProject(instance_segment_iter->GetKey(), row, true,
+                              &window, incremental_agg.get()));
         } else {
-            output_table->AddRow(window_project_gen_.Gen(
-                instance_segment_iter->GetKey(), instance_row, true,
-                append_slices_, &window));
+            output_table->AddRow(
+                WindowProject(instance_segment_iter->GetKey(), instance_row,
+                              true, &window, incremental_agg.get()));
         }
 
         cnt++;
@@ -1440,6 +1969,33 @@ void WindowAggRunner::RunWindowAggOnKey(
     }
 }
 
+Row WindowAggRunner::WindowProject(const uint64_t key, const Row& row,
+                                   const bool is_instance, Window* window,
+                                   IncrementalWindowAgg* incremental_agg) {
+    if (nullptr == incremental_agg) {
+        return window_project_gen_.Gen(key, row, is_instance, append_slices_,
+                                       window);
+    }
+    if (row.empty()) {
+        return row;
+    }
+    if (!window->BufferData(key, row)) {
+        LOG(WARNING) << "fail to buffer data";
+        return Row();
+    }
+    if (!is_instance) {
+        return Row();
+    }
+    Row out = incremental_agg->Output(row);
+    if (window->instance_not_in_window()) {
+        window->PopFrontData();
+    }
+    if (append_slices_ > 0) {
+        return Row(out.GetSlice(0), append_slices_, row);
+    }
+    return out;
+}
+
 std::shared_ptr<DataHandler> RequestLastJoinRunner::Run(
     RunnerContext& ctx,
     const std::vector<std::shared_ptr<DataHandler>>& inputs) {  // NOLINT
@@ -1559,13 +2115,84 @@ std::shared_ptr<DataHandler> LastJoinRunner::Run(
     }
 }
 
-std::shared_ptr<PartitionHandler> PartitionGenerator::Partition(
-    std::shared_ptr<DataHandler> input) {
-    switch (input->GetHanlderType()) {
-        case kPartitionHandler: {
-            return Partition(
-                std::dynamic_pointer_cast<PartitionHandler>(input));
-        }
+std::shared_ptr<DataHandler> HashJoinRunner::Run(
+    RunnerContext& ctx,
+    const std::vector<std::shared_ptr<DataHandler>>& inputs) {
+    auto fail_ptr = std::shared_ptr<DataHandler>();
+    if (inputs.size() < 2) {
+        LOG(WARNING) << "inputs size < 2";
+        return fail_ptr;
+    }
+    auto left = inputs[0];
+    auto right = inputs[1];
+    if (!left || !right) {
+        LOG(WARNING) << "fail to run hash join: left|right input is empty";
+        return fail_ptr;
+    }
+    auto right_segment_key = JoinGenerator::GetSegmentKeyType(right);
+    if (JoinGenerator::kNoSegmentKey == right_segment_key &&
+        join_gen_.left_key_gen_.Valid() !=
+            join_gen_.right_group_gen_.Valid()) {
+        LOG(WARNING) << "fail to run hash join: left and right keys mismatch";
+        return fail_ptr;
+    }
+    JoinHashTable table;
+    if (!join_gen_.BuildHashTable(right, &table)) {
+        return fail_ptr;
+    }
+    bool keep_unmatched = node::kJoinTypeLeft == join_type_;
+    switch (left->GetHanlderType()) {
+        case kTableHandler: {
+            auto left_table = std::dynamic_pointer_cast<TableHandler>(left);
+            auto output_table =
+                std::shared_ptr<MemTimeTableHandler>(new MemTimeTableHandler());
+            output_table->SetOrderType(left_table->GetOrderType());
+            if (!join_gen_.TableHashJoin(left_table, table, right_segment_key,
+                                         keep_unmatched, limit_cnt_,
+                                         output_table)) {
+                return fail_ptr;
+            }
+            return output_table;
+        }
+        case kPartitionHandler: {
+            auto left_partition =
+                std::dynamic_pointer_cast<PartitionHandler>(left);
+            auto output_partition =
+                std::shared_ptr<MemPartitionHandler>(new MemPartitionHandler());
+            output_partition->SetOrderType(left_partition->GetOrderType());
+            if (!join_gen_.PartitionHashJoin(left_partition, table,
+                                             right_segment_key,
+                                             keep_unmatched,
+                                             output_partition)) {
+                return fail_ptr;
+            }
+            return output_partition;
+        }
+        case kRowHandler: {
+            auto left_table = std::make_shared<MemTableHandler>();
+            left_table->AddRow(
+                std::dynamic_pointer_cast<RowHandler>(left)->GetValue());
+            auto output_table =
+                std::shared_ptr<MemTimeTableHandler>(new MemTimeTableHandler());
+            if (!join_gen_.TableHashJoin(left_table, table, right_segment_key,
+                                         keep_unmatched, limit_cnt_,
+                                         output_table)) {
+                return fail_ptr;
+            }
+            return output_table;
+        }
+        default:
+            return fail_ptr;
+    }
+}
+
+std::shared_ptr<PartitionHandler> PartitionGenerator::Partition(
+    std::shared_ptr<DataHandler> input) {
+    switch (input->GetHanlderType()) {
+        case kPartitionHandler: {
+            return Partition(
+                std::dynamic_pointer_cast<PartitionHandler>(input));
+        }
         case kTableHandler: {
             return Partition(std::dynamic_pointer_cast<TableHandler>(input));
         }
@@ -1593,18 +2220,24 @@ std::shared_ptr<PartitionHandler> PartitionGenerator::Partition(
     }
     iter->SeekToFirst();
     output_partitions->SetOrderType(table->GetOrderType());
+    codec::BinaryKey keys;
     while (iter->Valid()) {
         auto segment_iter = iter->GetValue();
         if (!segment_iter) {
             iter->Next();
             continue;
         }
-        auto segment_key = iter->GetKey().ToString();
+        // segment key is shared by all rows of segment, encode it once
+        auto segment_key = iter->GetKey();
+        keys.Clear();
+        keys.AppendString(reinterpret_cast<const char*>(segment_key.buf()),
+                          segment_key.size());
+        size_t prefix_size = keys.size();
         segment_iter->SeekToFirst();
         while (segment_iter->Valid()) {
-            std::string keys = key_gen_.Gen(segment_iter->GetValue());
-            output_partitions->AddRow(segment_key + "|" + keys,
-                                      segment_iter->GetKey(),
+            keys.Truncate(prefix_size);
+            key_gen_.GenBinary(segment_iter->GetValue(), &keys);
+            output_partitions->AddRow(keys, segment_iter->GetKey(),
                                       segment_iter->GetValue());
             segment_iter->Next();
         }
@@ -1634,8 +2267,10 @@ std::shared_ptr<PartitionHandler> PartitionGenerator::Partition(
         return fail_ptr;
     }
     iter->SeekToFirst();
+    codec::BinaryKey keys;
     while (iter->Valid()) {
-        std::string keys = key_gen_.Gen(iter->GetValue());
+        keys.Clear();
+        key_gen_.GenBinary(iter->GetValue(), &keys);
         output_partitions->AddRow(keys, iter->GetKey(), iter->GetValue());
         iter->Next();
     }
@@ -1685,6 +2320,8 @@ std::shared_ptr<PartitionHandler> SortGenerator::Sort(
         LOG(WARNING) << "Sort partition fail: partition is Empty";
         return std::shared_ptr<PartitionHandler>();
     }
+    std::vector<Row> rows;
+    std::vector<int64_t> keys(kRowBlockSize);
     iter->SeekToFirst();
     while (iter->Valid()) {
         auto segment_iter = iter->GetValue();
@@ -1696,11 +2333,24 @@ std::shared_ptr<PartitionHandler> SortGenerator::Sort(
         auto key = iter->GetKey().ToString();
         segment_iter->SeekToFirst();
         while (segment_iter->Valid()) {
-            int64_t ts = order_gen_.Gen(segment_iter->GetValue());
-            output->AddRow(key, static_cast<uint64_t>(ts),
-                           segment_iter->GetValue());
-            segment_iter->Next();
+            if (!order_gen_.Valid()) {
+                output->AddRow(key, segment_iter->GetKey(),
+                               segment_iter->GetValue());
+                segment_iter->Next();
+                continue;
+            }
+            // generate order keys block by block
+            rows.clear();
+            while (segment_iter->Valid() && rows.size() < kRowBlockSize) {
+                rows.push_back(segment_iter->GetValue());
+                segment_iter->Next();
+            }
+            order_gen_.GenBlock(rows.data(), rows.size(), keys.data());
+            for (size_t i = 0; i < rows.size(); ++i) {
+                output->AddRow(key, static_cast<uint64_t>(keys[i]), rows[i]);
+            }
         }
+        iter->Next();
     }
     if (order_gen_.Valid()) {
         output->Sort(is_asc);
@@ -1729,14 +2379,27 @@ std::shared_ptr<TableHandler> SortGenerator::Sort(
         return std::shared_ptr<TableHandler>();
     }
     iter->SeekToFirst();
-    while (iter->Valid()) {
-        if (order_gen_.Valid()) {
-            int64_t key = order_gen_.Gen(iter->GetValue());
-            output_table->AddRow(static_cast<uint64_t>(key), iter->GetValue());
-        } else {
+    if (order_gen_.Valid()) {
+        // generate order keys block by block
+        std::vector<Row> rows;
+        std::vector<int64_t> keys(kRowBlockSize);
+        rows.reserve(kRowBlockSize);
+        while (iter->Valid()) {
+            rows.clear();
+            while (iter->Valid() && rows.size() < kRowBlockSize) {
+                rows.push_back(iter->GetValue());
+                iter->Next();
+            }
+            order_gen_.GenBlock(rows.data(), rows.size(), keys.data());
+            for (size_t i = 0; i < rows.size(); ++i) {
+                output_table->AddRow(static_cast<uint64_t>(keys[i]), rows[i]);
+            }
+        }
+    } else {
+        while (iter->Valid()) {
             output_table->AddRow(iter->GetKey(), iter->GetValue());
+            iter->Next();
         }
-        iter->Next();
     }
 
     if (order_gen_.Valid()) {
@@ -1830,15 +2493,16 @@ Row JoinGenerator::RowLastJoinTable(const Row& left_row,
                    right_iter->GetValue());
     }
 
-    std::string left_key_str = "";
+    codec::BinaryKey left_key;
     if (left_key_gen_.Valid()) {
-        left_key_str = left_key_gen_.Gen(left_row);
+        left_key_gen_.GenBinary(left_row, &left_key);
     }
+    codec::BinaryKey right_key;
     while (right_iter->Valid()) {
         if (right_group_gen_.Valid()) {
-            auto right_key_str =
-                right_group_gen_.GetKey(right_iter->GetValue());
-            if (left_key_gen_.Valid() && left_key_str != right_key_str) {
+            right_key.Clear();
+            right_group_gen_.GetKey(right_iter->GetValue(), &right_key);
+            if (left_key_gen_.Valid() && left_key != right_key) {
                 right_iter->Next();
                 continue;
             }
@@ -1895,15 +2559,7 @@ bool JoinGenerator::TableJoin(std::shared_ptr<TableHandler> left,
     left_iter->SeekToFirst();
     while (left_iter->Valid()) {
         const Row& left_row = left_iter->GetValue();
-        std::string key_str =
-            index_key_gen_.Valid() ? index_key_gen_.Gen(left_row) : "";
-        if (left_key_gen_.Valid()) {
-            key_str = key_str.empty()
-                          ? left_key_gen_.Gen(left_row)
-                          : key_str + "|" + left_key_gen_.Gen(left_row);
-        }
-        DLOG(INFO) << "key_str " << key_str;
-        auto right_table = right->GetSegment(key_str);
+        auto right_table = RightSegment(left_row, right);
         output->AddRow(left_iter->GetKey(),
                        Runner::RowLastJoinTable(
                            left_slices_, left_row, right_slices_, right_table,
@@ -1973,11 +2629,7 @@ bool JoinGenerator::PartitionJoin(std::shared_ptr<PartitionHandler> left,
         left_iter->SeekToFirst();
         while (left_iter->Valid()) {
             const Row& left_row = left_iter->GetValue();
-            const std::string& key_str =
-                index_key_gen_.Valid() ? index_key_gen_.Gen(left_row) + "|" +
-                                             left_key_gen_.Gen(left_row)
-                                       : left_key_gen_.Gen(left_row);
-            auto right_table = right->GetSegment(key_str);
+            auto right_table = RightSegment(left_row, right);
             auto left_key_str = std::string(
                 reinterpret_cast<const char*>(left_key.buf()), left_key.size());
             output->AddRow(left_key_str, left_iter->GetKey(),
@@ -1990,6 +2642,262 @@ bool JoinGenerator::PartitionJoin(std::shared_ptr<PartitionHandler> left,
     }
     return true;
 }
+std::shared_ptr<TableHandler> JoinGenerator::RightSegment(
+    const Row& left_row, std::shared_ptr<PartitionHandler> right) {
+    if (!right_group_gen_.Valid()) {
+        // right partition comes from storage index, lookup with string key
+        std::string key_str = RightSegmentKey(left_row);
+        DLOG(INFO) << "key_str " << key_str;
+        return right->GetSegment(key_str);
+    }
+    // right partition is grouped by right_group_gen_, build the same binary
+    // key as PartitionGenerator::Partition does
+    codec::BinaryKey key;
+    if (index_key_gen_.Valid()) {
+        key.AppendString(index_key_gen_.Gen(left_row));
+    }
+    if (left_key_gen_.Valid()) {
+        left_key_gen_.GenBinary(left_row, &key);
+    } else {
+        key.Seal();
+    }
+    return right->GetSegment(key.ToString());
+}
+std::string JoinGenerator::RightSegmentKey(const Row& left_row) {
+    std::string key_str =
+        index_key_gen_.Valid() ? index_key_gen_.Gen(left_row) : "";
+    if (left_key_gen_.Valid()) {
+        key_str = key_str.empty()
+                      ? left_key_gen_.Gen(left_row)
+                      : key_str + "|" + left_key_gen_.Gen(left_row);
+    }
+    return key_str;
+}
+
+JoinGenerator::SegmentKeyType JoinGenerator::GetSegmentKeyType(
+    std::shared_ptr<DataHandler> right) {
+    if (!right || kPartitionHandler != right->GetHanlderType()) {
+        return kNoSegmentKey;
+    }
+    return std::dynamic_pointer_cast<PartitionHandler>(right)->IsBinaryKey()
+               ? kBinarySegmentKey
+               : kStringSegmentKey;
+}
+
+bool JoinGenerator::AppendSegmentKey(const Row& left_row, SegmentKeyType type,
+                                     bool with_left_key,
+                                     codec::BinaryKey* key) {
+    if (kBinarySegmentKey != type) {
+        if (with_left_key) {
+            key->AppendString(RightSegmentKey(left_row));
+        } else {
+            key->AppendString(
+                index_key_gen_.Valid() ? index_key_gen_.Gen(left_row) : "");
+        }
+        return true;
+    }
+    // encode segment key the same way as PartitionGenerator::Partition
+    codec::BinaryKey segment_key;
+    bool not_null = true;
+    if (index_key_gen_.Valid()) {
+        not_null = index_key_gen_.GenBinary(left_row, &segment_key);
+    }
+    if (with_left_key && left_key_gen_.Valid()) {
+        not_null = left_key_gen_.GenBinary(left_row, &segment_key) && not_null;
+    }
+    key->AppendString(segment_key.data(), segment_key.size());
+    return not_null;
+}
+
+bool JoinGenerator::BuildHashTable(std::shared_ptr<DataHandler> right,
+                                   JoinHashTable* table) {
+    if (!right) {
+        LOG(WARNING) << "fail to build join hash table: right input is empty";
+        return false;
+    }
+    codec::BinaryKey key;
+    switch (right->GetHanlderType()) {
+        case kRowHandler: {
+            const Row& row =
+                std::dynamic_pointer_cast<RowHandler>(right)->GetValue();
+            if (!right_group_gen_.Valid()) {
+                key.Seal();
+                table->Add(key, row);
+            } else if (right_group_gen_.GetKey(row, &key)) {
+                table->Add(key, row);
+            }
+            break;
+        }
+        case kTableHandler: {
+            auto iter =
+                std::dynamic_pointer_cast<TableHandler>(right)->GetIterator();
+            if (!iter) {
+                break;
+            }
+            iter->SeekToFirst();
+            while (iter->Valid()) {
+                key.Clear();
+                // rows with null key never match
+                if (!right_group_gen_.Valid()) {
+                    key.Seal();
+                    table->Add(key, iter->GetValue());
+                } else if (right_group_gen_.GetKey(iter->GetValue(), &key)) {
+                    table->Add(key, iter->GetValue());
+                }
+                iter->Next();
+            }
+            break;
+        }
+        case kPartitionHandler: {
+            auto iter = std::dynamic_pointer_cast<PartitionHandler>(right)
+                            ->GetWindowIterator();
+            if (!iter) {
+                break;
+            }
+            iter->SeekToFirst();
+            while (iter->Valid()) {
+                auto segment_iter = iter->GetValue();
+                if (!segment_iter) {
+                    iter->Next();
+                    continue;
+                }
+                auto segment_key = iter->GetKey();
+                key.Clear();
+                key.AppendString(
+                    reinterpret_cast<const char*>(segment_key.buf()),
+                    segment_key.size());
+                size_t prefix_size = key.size();
+                segment_iter->SeekToFirst();
+                while (segment_iter->Valid()) {
+                    key.Truncate(prefix_size);
+                    if (!right_group_gen_.Valid()) {
+                        key.Seal();
+                        table->Add(key, segment_iter->GetValue());
+                    } else if (right_group_gen_.GetKey(
+                                   segment_iter->GetValue(), &key)) {
+                        table->Add(key, segment_iter->GetValue());
+                    }
+                    segment_iter->Next();
+                }
+                iter->Next();
+            }
+            break;
+        }
+        default: {
+            LOG(WARNING) << "fail to build join hash table: invalid right "
+                            "input type";
+            return false;
+        }
+    }
+    table->Build();
+    return true;
+}
+
+void JoinGenerator::HashJoinRow(const Row& left_row,
+                                const JoinHashTable& right,
+                                SegmentKeyType right_segment_key,
+                                bool keep_unmatched, codec::BinaryKey* key,
+                                std::vector<Row>* output) {
+    // probe key is built the same way as BuildHashTable builds right key
+    key->Clear();
+    bool not_null = true;
+    if (kNoSegmentKey != right_segment_key && !right_group_gen_.Valid()) {
+        not_null = AppendSegmentKey(left_row, right_segment_key, true, key);
+        key->Seal();
+    } else {
+        if (kNoSegmentKey != right_segment_key) {
+            not_null =
+                AppendSegmentKey(left_row, right_segment_key, false, key);
+        }
+        if (left_key_gen_.Valid()) {
+            not_null = left_key_gen_.GenBinary(left_row, key) && not_null;
+        } else {
+            key->Seal();
+        }
+    }
+    size_t output_size = output->size();
+    if (not_null) {
+        for (int64_t entry = right.Seek(*key); entry != JoinHashTable::kEnd;
+             entry = right.Next(entry, *key)) {
+            Row joined_row(left_slices_, left_row, right_slices_,
+                           right.GetRow(entry));
+            if (condition_gen_.Valid() && !condition_gen_.Gen(joined_row)) {
+                continue;
+            }
+            output->push_back(joined_row);
+        }
+    }
+    if (keep_unmatched && output->size() == output_size) {
+        output->push_back(Row(left_slices_, left_row, right_slices_, Row()));
+    }
+}
+
+bool JoinGenerator::TableHashJoin(std::shared_ptr<TableHandler> left,
+                                  const JoinHashTable& right,
+                                  SegmentKeyType right_segment_key,
+                                  bool keep_unmatched, int32_t limit_cnt,
+                                  std::shared_ptr<MemTimeTableHandler> output) {
+    auto left_iter = left->GetIterator();
+    if (!left_iter) {
+        LOG(WARNING) << "fail to run hash join: left input empty";
+        return false;
+    }
+    codec::BinaryKey key;
+    std::vector<Row> joined_rows;
+    size_t cnt = 0;
+    left_iter->SeekToFirst();
+    while (left_iter->Valid()) {
+        joined_rows.clear();
+        HashJoinRow(left_iter->GetValue(), right, right_segment_key,
+                    keep_unmatched, &key, &joined_rows);
+        for (auto& joined_row : joined_rows) {
+            if (limit_cnt > 0 && cnt >= static_cast<size_t>(limit_cnt)) {
+                return true;
+            }
+            output->AddRow(left_iter->GetKey(), joined_row);
+            cnt++;
+        }
+        left_iter->Next();
+    }
+    return true;
+}
+
+bool JoinGenerator::PartitionHashJoin(
+    std::shared_ptr<PartitionHandler> left, const JoinHashTable& right,
+    SegmentKeyType right_segment_key, bool keep_unmatched,
+    std::shared_ptr<MemPartitionHandler> output) {
+    auto left_window_iter = left->GetWindowIterator();
+    if (!left_window_iter) {
+        LOG(WARNING) << "fail to run hash join: left input empty";
+        return false;
+    }
+    codec::BinaryKey key;
+    std::vector<Row> joined_rows;
+    left_window_iter->SeekToFirst();
+    while (left_window_iter->Valid()) {
+        auto left_iter = left_window_iter->GetValue();
+        if (!left_iter) {
+            left_window_iter->Next();
+            continue;
+        }
+        auto left_key = left_window_iter->GetKey();
+        auto key_str = std::string(
+            reinterpret_cast<const char*>(left_key.buf()), left_key.size());
+        left_iter->SeekToFirst();
+        while (left_iter->Valid()) {
+            joined_rows.clear();
+            HashJoinRow(left_iter->GetValue(), right, right_segment_key,
+                        keep_unmatched, &key, &joined_rows);
+            for (auto& joined_row : joined_rows) {
+                output->AddRow(key_str, left_iter->GetKey(), joined_row);
+            }
+            left_iter->Next();
+        }
+        left_window_iter->Next();
+    }
+    return true;
+}
+
 const Row Runner::RowLastJoinTable(size_t left_slices, const Row& left_row,
                                    size_t right_slices,
                                    std::shared_ptr<TableHandler> right_table,
@@ -2260,6 +3168,66 @@ bool Runner::ExtractRows(std::shared_ptr<DataHandlerList> handlers,
     }
     return true;
 }
+void Runner::RowProjectBlock(const int8_t* block_fn, const Row* rows,
+                             size_t cnt, Row* outputs) {
+    auto udf = reinterpret_cast<int32_t (*)(const int8_t**, int32_t,
+                                            int8_t**)>(
+        const_cast<int8_t*>(block_fn));
+    // compact non-empty rows, block function reads them by Row pointer
+    std::vector<const int8_t*> row_ptrs;
+    std::vector<size_t> positions;
+    row_ptrs.reserve(cnt);
+    positions.reserve(cnt);
+    for (size_t i = 0; i < cnt; i++) {
+        outputs[i] = Row();
+        if (!rows[i].empty()) {
+            row_ptrs.push_back(reinterpret_cast<const int8_t*>(&rows[i]));
+            positions.push_back(i);
+        }
+    }
+    std::vector<int8_t*> bufs(row_ptrs.size(), nullptr);
+
+    JitRuntime::get()->InitRunStep();
+    size_t done = 0;
+    while (done < row_ptrs.size()) {
+        done += udf(&row_ptrs[done], row_ptrs.size() - done, &bufs[done]);
+        if (done < row_ptrs.size()) {
+            LOG(WARNING) << "fail to run udf on row " << positions[done];
+            bufs[done] = nullptr;
+            done++;
+        }
+    }
+    JitRuntime::get()->ReleaseRunStep();
+
+    for (size_t i = 0; i < bufs.size(); i++) {
+        if (nullptr != bufs[i]) {
+            outputs[positions[i]] = Row(JitRuntime::get()->CreateRowSlice(
+                bufs[i], codec::RowView::GetSize(bufs[i])));
+        }
+    }
+}
+
+Row Runner::DetachRow(const Row& row) {
+    if (row.empty()) {
+        return row;
+    }
+    Row output;
+    for (int32_t i = 0; i < row.GetRowPtrCnt(); i++) {
+        base::RefCountedSlice slice = row.GetSlice(i);
+        if (!slice.managed() && nullptr != slice.buf()) {
+            int8_t* buf = reinterpret_cast<int8_t*>(malloc(slice.size()));
+            memcpy(buf, slice.buf(), slice.size());
+            slice = base::RefCountedSlice::CreateManaged(buf, slice.size());
+        }
+        if (0 == i) {
+            output = Row(slice);
+        } else {
+            output.Append(slice);
+        }
+    }
+    return output;
+}
+
 bool Runner::ExtractRow(std::shared_ptr<DataHandler> handler, Row* out_row) {
     switch (handler->GetHanlderType()) {
         case kTableHandler: {
@@ -2371,6 +3339,11 @@ std::shared_ptr<DataHandler> LimitRunner::Run(
     }
     switch (input->GetHanlderType()) {
         case kTableHandler: {
+            if (is_lazy_) {
+                return std::make_shared<TableLimitWrapper>(
+                    std::dynamic_pointer_cast<TableHandler>(input),
+                    limit_cnt_ < 0 ? 0 : limit_cnt_);
+            }
             auto iter =
                 std::dynamic_pointer_cast<TableHandler>(input)->GetIterator();
             if (!iter) {
@@ -2470,6 +3443,40 @@ std::shared_ptr<DataHandler> GroupAggRunner::Run(
     }
     return output_table;
 }
+std::shared_ptr<DataHandler> HashAggRunner::Run(
+    RunnerContext& ctx,
+    const std::vector<std::shared_ptr<DataHandler>>& inputs) {
+    auto fail_ptr = std::shared_ptr<DataHandler>();
+    if (inputs.size() < 1u) {
+        LOG(WARNING) << "inputs size < 1";
+        return fail_ptr;
+    }
+    auto input = inputs[0];
+    if (!input) {
+        LOG(WARNING) << "hash aggregation fail: input is null";
+        return fail_ptr;
+    }
+    if (kTableHandler != input->GetHanlderType()) {
+        LOG(WARNING) << "hash aggregation fail: input isn't table";
+        return fail_ptr;
+    }
+    auto iter = std::dynamic_pointer_cast<TableHandler>(input)->GetIterator();
+    if (!iter) {
+        LOG(WARNING) << "hash aggregation fail: input iterator is null";
+        return fail_ptr;
+    }
+    HashGroupAgg agg(plan_.get());
+    codec::BinaryKey key;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+        // null group keys are grouped together as partition does
+        key.Clear();
+        group_.GenBinary(iter->GetValue(), &key);
+        agg.Update(key, iter->GetValue());
+    }
+    auto output_table = std::shared_ptr<MemTableHandler>(new MemTableHandler());
+    agg.Output(limit_cnt_, output_table.get());
+    return output_table;
+}
 std::shared_ptr<DataHandler> RequestUnionRunner::Run(
     RunnerContext& ctx,
     const std::vector<std::shared_ptr<DataHandler>>& inputs) {
@@ -2524,79 +3531,175 @@ std::shared_ptr<TableHandler> RequestUnionRunner::RequestUnionWindow(
         max_size = window_range.max_size_;
     }
     uint64_t request_key = ts_gen > 0 ? static_cast<uint64_t>(ts_gen) : 0;
+    return std::make_shared<RequestUnionWindowHandler>(
+        request, request_key, union_segments, window_range, start, end,
+        rows_start_preceding, max_size, output_request_row);
+}
 
-    auto window_table =
-        std::shared_ptr<MemTimeTableHandler>(new MemTimeTableHandler());
+/**
+ * Merge rows of union segments by key descending, every segment from its
+ * first row in window and limited to its pinned row count.
+ */
+class RequestUnionWindowIterator : public RowIterator {
+ public:
+    explicit RequestUnionWindowIterator(const RequestUnionWindowHandler* window)
+        : window_(window),
+          iters_(window->union_segments_.size()),
+          status_(window->union_segments_.size()),
+          taken_(window->union_segments_.size()),
+          pos_(-1),
+          request_pending_(false) {
+        for (size_t i = 0; i < iters_.size(); i++) {
+            if (window_->union_segments_[i] &&
+                window_->segment_cnts_[i] > 0) {
+                iters_[i] = window_->union_segments_[i]->GetIterator();
+            }
+        }
+        SeekToFirst();
+    }
+    ~RequestUnionWindowIterator() {}
+    bool Valid() const override { return request_pending_ || -1 != pos_; }
+    void Next() override {
+        if (request_pending_) {
+            request_pending_ = false;
+            return;
+        }
+        if (-1 == pos_) {
+            return;
+        }
+        iters_[pos_]->Next();
+        taken_[pos_]++;
+        if (taken_[pos_] >= window_->segment_cnts_[pos_] ||
+            !iters_[pos_]->Valid()) {
+            status_[pos_].MarkInValid();
+        } else {
+            status_[pos_].set_key(iters_[pos_]->GetKey());
+        }
+        pos_ = IteratorStatus::PickIteratorWithMaximizeKey(&status_);
+    }
+    const uint64_t& GetKey() const override {
+        return request_pending_ ? window_->request_key_ : status_[pos_].key_;
+    }
+    const Row& GetValue() override {
+        return request_pending_ ? window_->request_ : iters_[pos_]->GetValue();
+    }
+    void Seek(const uint64_t& key) override {
+        SeekToFirst();
+        while (Valid() && GetKey() > key) {
+            Next();
+        }
+    }
+    void SeekToFirst() override {
+        for (size_t i = 0; i < iters_.size(); i++) {
+            status_[i] = IteratorStatus();
+            taken_[i] = 0;
+            if (!iters_[i]) {
+                continue;
+            }
+            iters_[i]->Seek(window_->segment_keys_[i]);
+            if (iters_[i]->Valid()) {
+                status_[i] = IteratorStatus(iters_[i]->GetKey());
+            }
+        }
+        pos_ = status_.empty()
+                   ? -1
+                   : IteratorStatus::PickIteratorWithMaximizeKey(&status_);
+        request_pending_ = window_->output_request_row_;
+    }
+    bool IsSeekable() const override { return true; }
 
-    size_t unions_cnt = union_segments.size();
-    // Prepare Union Segment Iterators
-    std::vector<std::unique_ptr<RowIterator>> union_segment_iters(unions_cnt);
-    std::vector<IteratorStatus> union_segment_status(unions_cnt);
+ private:
+    const RequestUnionWindowHandler* window_;
+    std::vector<std::unique_ptr<RowIterator>> iters_;
+    std::vector<IteratorStatus> status_;
+    // rows of every segment iterated
+    std::vector<uint64_t> taken_;
+    int32_t pos_;
+    bool request_pending_;
+};
 
-    for (size_t i = 0; i < unions_cnt; i++) {
-        if (!union_segments[i]) {
-            union_segment_status[i] = IteratorStatus();
+void RequestUnionWindowHandler::PinSegments() {
+    size_t segment_cnt = union_segments_.size();
+    std::vector<std::unique_ptr<RowIterator>> iters(segment_cnt);
+    std::vector<IteratorStatus> status(segment_cnt);
+    segment_keys_.assign(segment_cnt, 0);
+    segment_cnts_.assign(segment_cnt, 0);
+    for (size_t i = 0; i < segment_cnt; i++) {
+        if (union_segments_[i]) {
+            iters[i] = union_segments_[i]->GetIterator();
+        }
+        if (!iters[i]) {
             continue;
         }
-        union_segment_iters[i] = union_segments[i]->GetIterator();
-        if (!union_segment_iters[i]) {
-            union_segment_status[i] = IteratorStatus();
-            continue;
+        iters[i]->Seek(end_);
+        if (iters[i]->Valid()) {
+            status[i] = IteratorStatus(iters[i]->GetKey());
         }
-        union_segment_iters[i]->Seek(end);
-        if (!union_segment_iters[i]->Valid()) {
-            union_segment_status[i] = IteratorStatus();
-            continue;
-        }
-        uint64_t ts = union_segment_iters[i]->GetKey();
-        union_segment_status[i] = IteratorStatus(ts);
     }
-    int32_t max_union_pos = 0 == unions_cnt
-                                ? -1
-                                : IteratorStatus::PickIteratorWithMaximizeKey(
-                                      &union_segment_status);
+    // request row takes a row of rows preceding and max size
     uint64_t cnt = 0;
-    auto range_status = window_range.GetWindowPositionStatus(
-        cnt > rows_start_preceding, window_range.end_offset_ < 0,
-        request_key < start);
-    if (output_request_row) {
-        window_table->AddRow(request_key, request);
-    }
+    auto range_status = window_range_.GetWindowPositionStatus(
+        cnt > rows_preceding_, window_range_.end_offset_ < 0,
+        request_key_ < start_);
     if (WindowRange::kInWindow == range_status) {
         cnt++;
     }
-
-    while (-1 != max_union_pos) {
-        if (max_size > 0 && cnt >= max_size) {
+    count_ = output_request_row_ ? 1 : 0;
+    // merge rows by key descending, skip rows before window and stop at the
+    // first row out of window
+    int32_t pos = -1;
+    if (!status.empty()) {
+        pos = IteratorStatus::PickIteratorWithMaximizeKey(&status);
+    }
+    while (-1 != pos) {
+        if (max_size_ > 0 && cnt >= max_size_) {
             break;
         }
-        auto range_status = window_range.GetWindowPositionStatus(
-            cnt > rows_start_preceding,
-            union_segment_status[max_union_pos].key_ > end,
-            union_segment_status[max_union_pos].key_ < start);
+        range_status = window_range_.GetWindowPositionStatus(
+            cnt > rows_preceding_, status[pos].key_ > end_,
+            status[pos].key_ < start_);
         if (WindowRange::kExceedWindow == range_status) {
             break;
         }
         if (WindowRange::kInWindow == range_status) {
-            window_table->AddRow(
-                union_segment_status[max_union_pos].key_,
-                union_segment_iters[max_union_pos]->GetValue());
+            if (0 == segment_cnts_[pos]) {
+                segment_keys_[pos] = status[pos].key_;
+            }
+            segment_cnts_[pos]++;
             cnt++;
+            count_++;
         }
-        // Update Iterator Status
-        union_segment_iters[max_union_pos]->Next();
-        if (!union_segment_iters[max_union_pos]->Valid()) {
-            union_segment_status[max_union_pos].MarkInValid();
+        iters[pos]->Next();
+        if (!iters[pos]->Valid()) {
+            status[pos].MarkInValid();
         } else {
-            union_segment_status[max_union_pos].set_key(
-                union_segment_iters[max_union_pos]->GetKey());
+            status[pos].set_key(iters[pos]->GetKey());
         }
-        // Pick new mininum union pos
-        max_union_pos =
-            IteratorStatus::PickIteratorWithMaximizeKey(&union_segment_status);
+        pos = IteratorStatus::PickIteratorWithMaximizeKey(&status);
+    }
+}
+
+RowIterator* RequestUnionWindowHandler::GetRawIterator() {
+    return new RequestUnionWindowIterator(this);
+}
+
+const uint64_t RequestUnionWindowHandler::GetCount() { return count_; }
+
+Row RequestUnionWindowHandler::At(uint64_t pos) {
+    if (!rows_ready_) {
+        MaterializeRows();
     }
-    DLOG(INFO) << "REQUEST UNION cnt = " << window_table->GetCount();
-    return window_table;
+    return pos < rows_.size() ? rows_[pos] : Row();
+}
+
+void RequestUnionWindowHandler::MaterializeRows() {
+    rows_.reserve(count_);
+    RequestUnionWindowIterator iter(this);
+    while (iter.Valid()) {
+        rows_.push_back(iter.GetValue());
+        iter.Next();
+    }
+    rows_ready_ = true;
 }
 
 std::shared_ptr<DataHandler> PostRequestUnionRunner::Run(
@@ -2994,6 +4097,20 @@ std::shared_ptr<TableHandler> ProxyRequestRunner::RunWithRowsInput(
         LOG(WARNING) << "table handler is null";
         return fail_ptr;
     }
+    auto sub_query = [&](std::shared_ptr<Tablet> tablet,
+                         const std::vector<Row>& sub_rows) {
+        if (ctx.sp_name().empty()) {
+            return tablet->SubQuery(
+                task_id_, table_handler->GetDatabase(), cluster_job->sql(),
+                cluster_job->common_column_indices(), sub_rows,
+                request_is_common, false, ctx.is_debug());
+        } else {
+            return tablet->SubQuery(
+                task_id_, table_handler->GetDatabase(), ctx.sp_name(),
+                cluster_job->common_column_indices(), sub_rows,
+                request_is_common, true, ctx.is_debug());
+        }
+    };
     // collect pk list from rows
     std::shared_ptr<Tablet> tablet = std::shared_ptr<Tablet>();
     KeyGenerator generator(task.GetIndexKey().fn_info());
@@ -3005,25 +4122,79 @@ std::shared_ptr<TableHandler> ProxyRequestRunner::RunWithRowsInput(
         for (auto& index_row : index_rows) {
             pks.push_back(generator.Gen(index_row));
         }
-        tablet = table_handler->GetTablet(task.index(), pks);
+        std::vector<std::shared_ptr<Tablet>> tablets;
+        std::vector<size_t> row_tablets;
+        bool grouped = GroupByTablet(table_handler, task.index(), pks,
+                                     &tablets, &row_tablets);
+        if (grouped && tablets.size() > 1) {
+            // scatter rows to tablets owning their keys, all sub queries
+            // are issued before any result is read
+            std::vector<std::vector<Row>> tablet_rows(tablets.size());
+            std::vector<std::pair<size_t, uint64_t>> positions;
+            positions.reserve(rows.size());
+            for (size_t i = 0; i < rows.size(); i++) {
+                size_t tablet_idx = row_tablets[i];
+                positions.push_back(
+                    std::make_pair(tablet_idx, tablet_rows[tablet_idx].size()));
+                tablet_rows[tablet_idx].push_back(rows[i]);
+            }
+            std::vector<std::shared_ptr<TableHandler>> tables;
+            for (size_t i = 0; i < tablets.size(); i++) {
+                auto table = sub_query(tablets[i], tablet_rows[i]);
+                if (!table) {
+                    LOG(WARNING) << "fail to run proxy runner with rows: "
+                                    "subquery on tablet "
+                                 << tablets[i]->GetName() << " is null";
+                    return fail_ptr;
+                }
+                tables.push_back(table);
+            }
+            return std::make_shared<TableGatherWrapper>(tables, positions);
+        }
+        // keys of a single tablet are already resolved
+        tablet = grouped && 1u == tablets.size()
+                     ? tablets[0]
+                     : table_handler->GetTablet(task.index(), pks);
     }
     if (!tablet) {
         LOG(WARNING)
             << "fail to run proxy runner with rows: subquery tablet is null";
         return fail_ptr;
     }
-    if (ctx.sp_name().empty()) {
-        return tablet->SubQuery(task_id_, table_handler->GetDatabase(),
-                                cluster_job->sql(),
-                                ctx.cluster_job()->common_column_indices(),
-                                rows, request_is_common, false, ctx.is_debug());
-    } else {
-        return tablet->SubQuery(task_id_, table_handler->GetDatabase(),
-                                ctx.sp_name(),
-                                ctx.cluster_job()->common_column_indices(),
-                                rows, request_is_common, true, ctx.is_debug());
+    return sub_query(tablet, rows);
+}
+
+bool ProxyRequestRunner::GroupByTablet(
+    std::shared_ptr<TableHandler> table_handler, const std::string& index,
+    const std::vector<std::string>& pks,
+    std::vector<std::shared_ptr<Tablet>>* tablets,
+    std::vector<size_t>* row_tablets) {
+    // rows of the same pk go to the same tablet
+    std::unordered_map<std::string, size_t> pk_tablets;
+    row_tablets->reserve(pks.size());
+    for (auto& pk : pks) {
+        auto iter = pk_tablets.find(pk);
+        if (iter != pk_tablets.end()) {
+            row_tablets->push_back(iter->second);
+            continue;
+        }
+        auto tablet = table_handler->GetTablet(index, pk);
+        if (!tablet) {
+            return false;
+        }
+        // tablets of a batch are few, search them one by one
+        size_t tablet_idx = 0;
+        while (tablet_idx < tablets->size() &&
+               (*tablets)[tablet_idx] != tablet) {
+            tablet_idx++;
+        }
+        if (tablet_idx == tablets->size()) {
+            tablets->push_back(tablet);
+        }
+        pk_tablets.insert(std::make_pair(pk, tablet_idx));
+        row_tablets->push_back(tablet_idx);
     }
-    return fail_ptr;
+    return true;
 }
 
 /**
@@ -3130,18 +4301,148 @@ const std::string KeyGenerator::Gen(const Row& row) {
     return keys;
 }
 
+bool KeyGenerator::GenBinary(const Row& row, codec::BinaryKey* key) {
+    if (row.size() == 0) {
+        for (size_t i = 0; i < idxs_.size(); i++) {
+            key->AppendNull();
+        }
+        key->Seal();
+        return idxs_.empty();
+    }
+    Row key_row = CoreAPI::RowProject(fn_, row, true);
+    const int8_t* buf = key_row.buf();
+    bool not_null = true;
+    for (auto pos : idxs_) {
+        if (row_view_.IsNULL(buf, pos)) {
+            key->AppendNull();
+            not_null = false;
+            continue;
+        }
+        ::hybridse::type::Type type = fn_schema_.Get(pos).type();
+        switch (type) {
+            case ::hybridse::type::kVarchar: {
+                const char* str = nullptr;
+                uint32_t size = 0;
+                if (row_view_.GetValue(buf, pos, &str, &size) == 0) {
+                    key->AppendString(str, size);
+                } else {
+                    key->AppendNull();
+                    not_null = false;
+                }
+                break;
+            }
+            case hybridse::type::kBool: {
+                bool v = false;
+                row_view_.GetValue(buf, pos, type, reinterpret_cast<void*>(&v));
+                key->AppendBool(v);
+                break;
+            }
+            // integers of any width share one 8-byte form, and so do
+            // floating point numbers, so that keys of int and bigint
+            // columns or literals match as their string keys did
+            case hybridse::type::kInt16: {
+                int16_t v = 0;
+                row_view_.GetValue(buf, pos, type, reinterpret_cast<void*>(&v));
+                key->AppendInt64(v);
+                break;
+            }
+            case hybridse::type::kInt32:
+            case hybridse::type::kDate: {
+                int32_t v = 0;
+                row_view_.GetValue(buf, pos, type, reinterpret_cast<void*>(&v));
+                key->AppendInt64(v);
+                break;
+            }
+            case hybridse::type::kInt64:
+            case hybridse::type::kTimestamp: {
+                int64_t v = 0;
+                row_view_.GetValue(buf, pos, type, reinterpret_cast<void*>(&v));
+                key->AppendInt64(v);
+                break;
+            }
+            case hybridse::type::kFloat: {
+                float v = 0;
+                row_view_.GetValue(buf, pos, type, reinterpret_cast<void*>(&v));
+                key->AppendDouble(v);
+                break;
+            }
+            case hybridse::type::kDouble: {
+                double v = 0;
+                row_view_.GetValue(buf, pos, type, reinterpret_cast<void*>(&v));
+                key->AppendDouble(v);
+                break;
+            }
+            default: {
+                key->AppendNull();
+                not_null = false;
+                break;
+            }
+        }
+    }
+    key->Seal();
+    return not_null;
+}
+
 const int64_t OrderGenerator::Gen(const Row& row) {
     Row order_row = CoreAPI::RowProject(fn_, row, true);
     return Runner::GetColumnInt64(order_row.buf(), &row_view_, idxs_[0],
                                   fn_schema_.Get(idxs_[0]).type());
 }
 
+const Row OrderGenerator::GenKeyRow(const Row& row) const {
+    return CoreAPI::RowProject(fn_, row, true);
+}
+
+void OrderGenerator::GenBlock(const Row* rows, size_t cnt, int64_t* keys) {
+    std::vector<Row> order_rows(cnt);
+    std::vector<const int8_t*> bufs(cnt);
+    for (size_t i = 0; i < cnt; ++i) {
+        order_rows[i] = CoreAPI::RowProject(fn_, rows[i], true);
+        bufs[i] = order_rows[i].buf();
+    }
+    if (!layout_.GatherInt64(bufs.data(), cnt, idxs_[0], -1, keys)) {
+        std::fill(keys, keys + cnt, -1);
+    }
+}
+
 const bool ConditionGenerator::Gen(const Row& row) const {
     return CoreAPI::ComputeCondition(fn_, row, &row_view_, idxs_[0]);
 }
+void ConditionGenerator::GenBlock(const Row* rows, size_t cnt,
+                                  std::vector<uint32_t>* sel) const {
+    if (nullptr == block_fn_) {
+        for (size_t i = 0; i < cnt; i++) {
+            if (Gen(rows[i])) {
+                sel->push_back(i);
+            }
+        }
+        return;
+    }
+    std::vector<Row> cond_rows(cnt);
+    Runner::RowProjectBlock(block_fn_, rows, cnt, cond_rows.data());
+    auto type = fn_schema_.Get(idxs_[0]).type();
+    for (size_t i = 0; i < cnt; i++) {
+        if (!cond_rows[i].empty() &&
+            Runner::GetColumnBool(cond_rows[i].buf(), &row_view_, idxs_[0],
+                                  type)) {
+            sel->push_back(i);
+        }
+    }
+}
 const Row ProjectGenerator::Gen(const Row& row) {
     return CoreAPI::RowProject(fn_, row, false);
 }
+void ProjectGenerator::GenBlock(const Row* rows, size_t cnt, Row* outputs) {
+    fun_(rows, cnt, outputs);
+}
+void RowProjectFun::operator()(const Row* rows, size_t cnt,
+                               Row* outputs) const {
+    if (nullptr == block_fn_) {
+        ProjectFun::operator()(rows, cnt, outputs);
+        return;
+    }
+    Runner::RowProjectBlock(block_fn_, rows, cnt, outputs);
+}
 
 const Row ConstProjectGenerator::Gen() {
     return CoreAPI::RowConstProject(fn_, false);
@@ -3179,8 +4480,7 @@ Row Runner::GroupbyProject(const int8_t* fn, TableHandler* table) {
         LOG(WARNING) << "fail to run udf " << ret;
         return Row();
     }
-    return Row(
-        base::RefCountedSlice::CreateManaged(buf, RowView::GetSize(buf)));
+    return Row(JitRuntime::get()->CreateRowSlice(buf, RowView::GetSize(buf)));
 }
 
 const Row WindowProjectGenerator::Gen(const uint64_t key, const Row row,
@@ -3336,6 +4636,71 @@ std::shared_ptr<TableHandler> IndexSeekGenerator::SegmentOfKey(
     }
 }
 
+void FilterGenerator::operator()(const Row* rows, size_t cnt,
+                                 std::vector<uint32_t>* sel) const {
+    if (!condition_gen_.Valid()) {
+        PredicateFun::operator()(rows, cnt, sel);
+        return;
+    }
+    condition_gen_.GenBlock(rows, cnt, sel);
+}
+DistinctGenerator::DistinctGenerator(const SchemasContext* schemas_ctx)
+    : layouts_() {
+    for (size_t i = 0; i < schemas_ctx->GetSchemaSourceSize(); ++i) {
+        layouts_.emplace_back(*schemas_ctx->GetSchema(i));
+    }
+}
+
+std::shared_ptr<TableHandler> DistinctGenerator::Distinct(
+    std::shared_ptr<TableHandler> table) const {
+    if (!table) {
+        return std::shared_ptr<TableHandler>();
+    }
+    return std::make_shared<TableDistinctWrapper>(table, this);
+}
+
+void DistinctGenerator::operator()(const Row& row, std::string* key) const {
+    for (int32_t i = 0; i < row.GetRowPtrCnt(); ++i) {
+        const int8_t* buf = row.buf(i);
+        uint32_t size = nullptr == buf ? 0 : static_cast<uint32_t>(row.size(i));
+        key->append(reinterpret_cast<const char*>(&size), sizeof(size));
+        if (0 == size) {
+            continue;
+        }
+        size_t start = key->size();
+        key->append(reinterpret_cast<const char*>(buf), size);
+        if (static_cast<size_t>(i) >= layouts_.size()) {
+            continue;
+        }
+        // values of null fields are undefined, zero them out
+        const codec::RowLayout& layout = layouts_[i];
+        uint32_t bitmap_size = codec::BitMapSize(layout.GetColumnCnt());
+        const int8_t* bitmap = buf + codec::HEADER_LENGTH;
+        if (size < codec::HEADER_LENGTH + bitmap_size ||
+            std::all_of(bitmap, bitmap + bitmap_size,
+                        [](int8_t bits) { return 0 == bits; })) {
+            continue;
+        }
+        const auto& type_size_map = codec::GetTypeSizeMap();
+        char* copy = &(*key)[start];
+        for (uint32_t idx = 0; idx < layout.GetColumnCnt(); ++idx) {
+            if (!codec::RowLayout::IsNULL(buf, idx)) {
+                continue;
+            }
+            // string fields of null values are encoded as empty
+            auto iter = type_size_map.find(layout.GetType(idx));
+            if (type::kVarchar == layout.GetType(idx) ||
+                iter == type_size_map.end()) {
+                continue;
+            }
+            uint32_t width = iter->second;
+            if (layout.GetOffset(idx) + width <= size) {
+                memset(copy + layout.GetOffset(idx), 0, width);
+            }
+        }
+    }
+}
+
 std::shared_ptr<TableHandler> FilterGenerator::Filter(
     std::shared_ptr<PartitionHandler> table) {
     return Filter(index_seek_gen_.SegmnetOfConstKey(table));
@@ -3356,33 +4721,137 @@ std::shared_ptr<TableHandler> FilterGenerator::Filter(
 
 std::shared_ptr<DataHandlerList> RunnerContext::GetBatchCache(
     int64_t id) const {
-    auto iter = batch_cache_.find(id);
-    if (iter == batch_cache_.end()) {
+    if (id < 0 || id >= static_cast<int64_t>(batch_cache_.size())) {
         return std::shared_ptr<DataHandlerList>();
-    } else {
-        return iter->second;
     }
+    return batch_cache_[id];
 }
 
 void RunnerContext::SetBatchCache(int64_t id,
                                   std::shared_ptr<DataHandlerList> data) {
+    if (id < 0) {
+        return;
+    }
+    if (id >= static_cast<int64_t>(batch_cache_.size())) {
+        batch_cache_.resize(id + 1);
+    }
     batch_cache_[id] = data;
 }
 
 std::shared_ptr<DataHandler> RunnerContext::GetCache(int64_t id) const {
-    auto iter = cache_.find(id);
-    if (iter == cache_.end()) {
+    if (id < 0 || id >= static_cast<int64_t>(cache_.size())) {
         return std::shared_ptr<DataHandler>();
-    } else {
-        return iter->second;
     }
+    return cache_[id];
 }
 
 void RunnerContext::SetCache(int64_t id,
                              const std::shared_ptr<DataHandler> data) {
+    if (id < 0) {
+        return;
+    }
+    // job built without runner number grows on demand
+    if (id >= static_cast<int64_t>(cache_.size())) {
+        cache_.resize(id + 1);
+    }
     cache_[id] = data;
 }
 
+void RunnerContext::InitCache() {
+    size_t runner_num =
+        nullptr == cluster_job_ ? 0 : cluster_job_->runner_num();
+    if (cache_.size() < runner_num) {
+        cache_.resize(runner_num);
+    }
+    if (batch_cache_.size() < runner_num) {
+        batch_cache_.resize(runner_num);
+    }
+}
+
+void RunnerContext::Reset(hybridse::vm::ClusterJob* cluster_job,
+                          const std::string& sp_name, const bool is_debug) {
+    cluster_job_ = cluster_job;
+    sp_name_ = sp_name;
+    is_debug_ = is_debug;
+    InitCache();
+}
+
+base::ByteMemoryPool* RunnerContext::NewWorkerArena() {
+    std::lock_guard<std::mutex> lock(worker_arena_mu_);
+    if (worker_arena_cnt_ == worker_arenas_.size()) {
+        worker_arenas_.emplace_back(new base::ByteMemoryPool());
+    }
+    return worker_arenas_[worker_arena_cnt_++].get();
+}
+
+void RunnerContext::Clear() {
+    cluster_job_ = nullptr;
+    request_ = Row();
+    requests_.clear();
+    std::fill(cache_.begin(), cache_.end(), nullptr);
+    std::fill(batch_cache_.begin(), batch_cache_.end(), nullptr);
+    if (row_arena_) {
+        row_arena_->Reset();
+    }
+    for (size_t i = 0; i < worker_arena_cnt_; i++) {
+        worker_arenas_[i]->Reset();
+    }
+    worker_arena_cnt_ = 0;
+}
+
+std::vector<std::unique_ptr<RunnerContext>>& RunnerContextPool::FreeList() {
+    static thread_local std::vector<std::unique_ptr<RunnerContext>> list;
+    return list;
+}
+
+void RunnerContextPool::Releaser::operator()(RunnerContext* ctx) const {
+    if (nullptr == ctx) {
+        return;
+    }
+    ctx->Clear();
+    auto& list = FreeList();
+    if (list.size() < kMaxIdleSize) {
+        list.emplace_back(ctx);
+    } else {
+        delete ctx;
+    }
+}
+
+RunnerContextPool::Handle RunnerContextPool::Take(
+    hybridse::vm::ClusterJob* cluster_job, const std::string& sp_name,
+    const bool is_debug) {
+    auto& list = FreeList();
+    if (list.empty()) {
+        return Handle(new RunnerContext(cluster_job, Row(), sp_name, is_debug));
+    }
+    Handle ctx(list.back().release());
+    list.pop_back();
+    ctx->Reset(cluster_job, sp_name, is_debug);
+    return ctx;
+}
+
+RunnerContextPool::Handle RunnerContextPool::Get(
+    hybridse::vm::ClusterJob* cluster_job, const bool is_debug) {
+    return Take(cluster_job, "", is_debug);
+}
+
+RunnerContextPool::Handle RunnerContextPool::Get(
+    hybridse::vm::ClusterJob* cluster_job, const hybridse::codec::Row& request,
+    const std::string& sp_name, const bool is_debug) {
+    auto ctx = Take(cluster_job, sp_name, is_debug);
+    ctx->SetRequest(request);
+    return ctx;
+}
+
+RunnerContextPool::Handle RunnerContextPool::Get(
+    hybridse::vm::ClusterJob* cluster_job,
+    const std::vector<Row>& request_batch, const std::string& sp_name,
+    const bool is_debug) {
+    auto ctx = Take(cluster_job, sp_name, is_debug);
+    ctx->SetRequests(request_batch);
+    return ctx;
+}
+
 void RunnerContext::SetRequest(const hybridse::codec::Row& request) {
     request_ = request;
 }
@@ -19,17 +19,24 @@
 
 #include <map>
 #include <memory>
+#include <mutex>  // NOLINT
 #include <set>
 #include <string>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 #include "base/fe_status.h"
+#include "base/mem_pool.h"
+#include "base/thread_pool.h"
+#include "codec/binary_key.h"
 #include "codec/fe_row_codec.h"
+#include "codec/row_layout.h"
 #include "node/node_manager.h"
 #include "vm/catalog.h"
 #include "vm/catalog_wrapper.h"
 #include "vm/core_api.h"
+#include "vm/incremental_agg.h"
+#include "vm/join_hash_table.h"
 #include "vm/mem_catalog.h"
 #include "vm/physical_op.h"
 namespace hybridse {
@@ -66,20 +73,26 @@ class FnGenerator {
 
 class RowProjectFun : public ProjectFun {
  public:
-    explicit RowProjectFun(const int8_t* fn) : ProjectFun(), fn_(fn) {}
+    explicit RowProjectFun(const int8_t* fn, const int8_t* block_fn = nullptr)
+        : ProjectFun(), fn_(fn), block_fn_(block_fn) {}
     ~RowProjectFun() {}
     Row operator()(const Row& row) const override {
         return CoreAPI::RowProject(fn_, row, false);
     }
+    void operator()(const Row* rows, size_t cnt,
+                    Row* outputs) const override;
     const int8_t* fn_;
+    const int8_t* block_fn_;
 };
 
 class ProjectGenerator : public FnGenerator {
  public:
     explicit ProjectGenerator(const FnInfo& info)
-        : FnGenerator(info), fun_(info.fn_ptr()) {}
+        : FnGenerator(info), fun_(info.fn_ptr(), info.block_fn_ptr()) {}
     virtual ~ProjectGenerator() {}
     const Row Gen(const Row& row);
+    // Project `cnt` rows into `outputs`
+    void GenBlock(const Row* rows, size_t cnt, Row* outputs);
     RowProjectFun fun_;
 };
 
@@ -108,20 +121,38 @@ class KeyGenerator : public FnGenerator {
  public:
     explicit KeyGenerator(const FnInfo& info) : FnGenerator(info) {}
     virtual ~KeyGenerator() {}
+    // String form of key, required by storage segment lookup
     const std::string Gen(const Row& row);
     const std::string GenConst();
+    // Append fixed-width binary form of key to `key` and seal it, used by
+    // in-memory partition, group and join. Integers, dates and timestamps
+    // are appended as int64 and floats as double. Return false if any key
+    // value is null.
+    bool GenBinary(const Row& row, codec::BinaryKey* key);
 };
 class OrderGenerator : public FnGenerator {
  public:
-    explicit OrderGenerator(const FnInfo& info) : FnGenerator(info) {}
+    explicit OrderGenerator(const FnInfo& info)
+        : FnGenerator(info), layout_(fn_schema_) {}
     virtual ~OrderGenerator() {}
     const int64_t Gen(const Row& row);
+    // Project all order expressions of `row` into a key row of `fn_schema_`
+    const Row GenKeyRow(const Row& row) const;
+    // Generate order keys of `cnt` rows into `keys`, key column of the
+    // projected rows is gathered in one pass
+    void GenBlock(const Row* rows, size_t cnt, int64_t* keys);
+    const codec::RowLayout layout_;
 };
 class ConditionGenerator : public FnGenerator {
  public:
-    explicit ConditionGenerator(const FnInfo& info) : FnGenerator(info) {}
+    explicit ConditionGenerator(const FnInfo& info)
+        : FnGenerator(info), block_fn_(info.block_fn_ptr()) {}
     virtual ~ConditionGenerator() {}
     const bool Gen(const Row& row) const;
+    // Append position of rows satisfying condition to `sel`
+    void GenBlock(const Row* rows, size_t cnt,
+                  std::vector<uint32_t>* sel) const;
+    const int8_t* block_fn_;
 };
 class RangeGenerator {
  public:
@@ -166,7 +197,7 @@ class FilterKeyGenerator {
     virtual ~FilterKeyGenerator() {}
     const bool Valid() const { return filter_key_.Valid(); }
     std::shared_ptr<TableHandler> Filter(std::shared_ptr<TableHandler> table,
-                                         const std::string& request_keys) {
+                                         const codec::BinaryKey& request_keys) {
         if (!filter_key_.Valid()) {
             return table;
         }
@@ -176,8 +207,10 @@ class FilterKeyGenerator {
         auto iter = table->GetIterator();
         if (iter) {
             iter->SeekToFirst();
+            codec::BinaryKey keys;
             while (iter->Valid()) {
-                std::string keys = filter_key_.Gen(iter->GetValue());
+                keys.Clear();
+                filter_key_.GenBinary(iter->GetValue(), &keys);
                 if (request_keys == keys) {
                     mem_table->AddRow(iter->GetKey(), iter->GetValue());
                 }
@@ -186,8 +219,10 @@ class FilterKeyGenerator {
         }
         return mem_table;
     }
-    const std::string GetKey(const Row& row) {
-        return filter_key_.Valid() ? filter_key_.Gen(row) : "";
+    void GetKey(const Row& row, codec::BinaryKey* key) {
+        if (filter_key_.Valid()) {
+            filter_key_.GenBinary(row, key);
+        }
     }
     KeyGenerator filter_key_;
 };
@@ -206,6 +241,9 @@ class PartitionGenerator {
     std::shared_ptr<PartitionHandler> Partition(
         std::shared_ptr<TableHandler> table);
     const std::string GetKey(const Row& row) { return key_gen_.Gen(row); }
+    bool GetKey(const Row& row, codec::BinaryKey* key) {
+        return key_gen_.GenBinary(row, key);
+    }
 
  private:
     KeyGenerator key_gen_;
@@ -219,6 +257,7 @@ class SortGenerator {
     virtual ~SortGenerator() {}
 
     const bool Valid() const { return is_valid_; }
+    const bool is_asc() const { return is_asc_; }
 
     std::shared_ptr<DataHandler> Sort(std::shared_ptr<DataHandler> input,
                                       const bool reverse = false);
@@ -268,11 +307,28 @@ class FilterGenerator : public PredicateFun {
         }
         return condition_gen_.Gen(row);
     }
+    void operator()(const Row* rows, size_t cnt,
+                    std::vector<uint32_t>* sel) const override;
 
  private:
     ConditionGenerator condition_gen_;
     IndexSeekGenerator index_seek_gen_;
 };
+class DistinctGenerator : public RowKeyFun {
+ public:
+    explicit DistinctGenerator(const SchemasContext* schemas_ctx);
+    virtual ~DistinctGenerator() {}
+    // Drop duplicated rows of `table` lazily while it is iterated
+    std::shared_ptr<TableHandler> Distinct(
+        std::shared_ptr<TableHandler> table) const;
+    // Copy encoded slices of `row` into `key`, with fixed-size fields of
+    // null values zeroed, so that rows of equal values get equal keys
+    void operator()(const Row& row, std::string* key) const override;
+
+ private:
+    // layouts of row slices
+    std::vector<codec::RowLayout> layouts_;
+};
 class WindowGenerator {
  public:
     explicit WindowGenerator(const WindowOp& window)
@@ -304,7 +360,8 @@ class RequestWindowGenertor {
         auto segment = index_seek_gen_.SegmentOfKey(row, input);
 
         if (filter_gen_.Valid()) {
-            auto filter_key = filter_gen_.GetKey(row);
+            codec::BinaryKey filter_key;
+            filter_gen_.GetKey(row, &filter_key);
             segment = filter_gen_.Filter(segment, filter_key);
         }
         if (sort_gen_.Valid()) {
@@ -332,17 +389,21 @@ enum RunnerType {
     kRunnerSimpleProject,
     kRunnerSelectSlice,
     kRunnerGroupAgg,
+    kRunnerHashAgg,
     kRunnerAgg,
     kRunnerWindowAgg,
     kRunnerRequestUnion,
     kRunnerPostRequestUnion,
     kRunnerIndexSeek,
     kRunnerLastJoin,
+    kRunnerHashJoin,
     kRunnerConcat,
     kRunnerRequestRunProxy,
     kRunnerRequestLastJoin,
     kRunnerBatchRequestRunProxy,
     kRunnerLimit,
+    kRunnerDistinct,
+    kRunnerUnion,
     kRunnerUnknow,
 };
 inline const std::string RunnerTypeName(const RunnerType& type) {
@@ -357,6 +418,8 @@ inline const std::string RunnerTypeName(const RunnerType& type) {
             return "GROUP_AND_SORT";
         case kRunnerFilter:
             return "FILTER";
+        case kRunnerOrder:
+            return "ORDER_BY";
         case kRunnerConstProject:
             return "CONST_PROJECT";
         case kRunnerTableProject:
@@ -369,6 +432,8 @@ inline const std::string RunnerTypeName(const RunnerType& type) {
             return "SELECT_SLICE";
         case kRunnerGroupAgg:
             return "GROUP_AGG_PROJECT";
+        case kRunnerHashAgg:
+            return "HASH_AGG_PROJECT";
         case kRunnerAgg:
             return "AGG_PROJECT";
         case kRunnerWindowAgg:
@@ -381,12 +446,18 @@ inline const std::string RunnerTypeName(const RunnerType& type) {
             return "INDEX_SEEK";
         case kRunnerLastJoin:
             return "LASTJOIN";
+        case kRunnerHashJoin:
+            return "HASHJOIN";
         case kRunnerConcat:
             return "CONCAT";
         case kRunnerRequestLastJoin:
             return "REQUEST_LASTJOIN";
         case kRunnerLimit:
             return "LIMIT";
+        case kRunnerDistinct:
+            return "DISTINCT";
+        case kRunnerUnion:
+            return "UNION";
         case kRunnerRequestRunProxy:
             return "REQUEST_RUN_PROXY";
         case kRunnerBatchRequestRunProxy:
@@ -436,6 +507,11 @@ class Runner : public node::NodeBase<Runner> {
         return true;
     }
     const std::vector<Runner*>& GetProducers() const { return producers_; }
+    // Append runners whose outputs this runner reads, producers and inputs
+    // run by its generators, to `inputs`
+    virtual void GetInputs(std::vector<Runner*>* inputs) const {
+        inputs->insert(inputs->end(), producers_.begin(), producers_.end());
+    }
     virtual void PrintRunnerInfo(std::ostream& output,
                                  const std::string& tab) const {
         output << tab << "[" << id_ << "]" << RunnerTypeName(type_);
@@ -469,6 +545,7 @@ class Runner : public node::NodeBase<Runner> {
     void DisableCache() { need_cache_ = false; }
     void EnableBatchCache() { need_batch_cache_ = true; }
     void DisableBatchCache() { need_batch_cache_ = false; }
+    const bool is_lazy() const { return is_lazy_; }
 
     const int32_t id_;
     const RunnerType type_;
@@ -489,6 +566,10 @@ class Runner : public node::NodeBase<Runner> {
                              const Row row, const bool is_instance,
                              size_t append_slices, Window* window);
     static Row GroupbyProject(const int8_t* fn, TableHandler* table);
+    // Run block function `block_fn` on `cnt` rows within one run step,
+    // output of empty or failed rows is empty
+    static void RowProjectBlock(const int8_t* block_fn, const Row* rows,
+                                size_t cnt, Row* outputs);
     static const Row RowLastJoinTable(size_t left_slices, const Row& left_row,
                                       size_t right_slices,
                                       std::shared_ptr<TableHandler> right_table,
@@ -510,6 +591,9 @@ class Runner : public node::NodeBase<Runner> {
                            Row* out_row);  // NOLINT
     static bool ExtractRows(std::shared_ptr<DataHandler> handler,
                             std::vector<Row>& out_rows);  // NOLINT
+    // Copy slices not owned by `row` into malloc'd buffers, so that it
+    // outlives row arena of the execution
+    static Row DetachRow(const Row& row);
     const vm::SchemasContext* output_schemas() const { return output_schemas_; }
 
     void set_output_schemas(const vm::SchemasContext* schemas) {
@@ -534,6 +618,15 @@ class Runner : public node::NodeBase<Runner> {
         }
     }
 
+    // Run request rows in chunks on thread pool of cluster job, outputs are
+    // kept in request order. Return false if rows should be run one by one
+    // on caller thread instead, e.g. runner type isn't known to be
+    // stateless.
+    bool BatchRequestRunParallel(
+        RunnerContext& ctx,  // NOLINT
+        const std::vector<std::shared_ptr<DataHandlerList>>& batch_inputs,
+        DataHandlerVector* outputs);
+
     bool need_cache_;
     bool need_batch_cache_;
     std::vector<Runner*> producers_;
@@ -639,6 +732,30 @@ class JoinGenerator {
     Row RowLastJoin(const Row& left_row, std::shared_ptr<DataHandler> right);
     Row RowLastJoinDropLeftSlices(const Row& left_row,
                                   std::shared_ptr<DataHandler> right);
+
+    // Encoding of segment keys of the right input of hash join
+    enum SegmentKeyType {
+        kNoSegmentKey,      // right is a table or row
+        kStringSegmentKey,  // right is a partition of storage index
+        kBinarySegmentKey   // right is an in-memory partition
+    };
+    static SegmentKeyType GetSegmentKeyType(std::shared_ptr<DataHandler> right);
+
+    // Build hash table of right rows keyed by `right_group_gen_`. Segment
+    // key is prepended when right is a partition of index.
+    bool BuildHashTable(std::shared_ptr<DataHandler> right,
+                        JoinHashTable* table);
+    // Equi-join every left row with all matching right rows, unmatched left
+    // rows are kept with null right side if `keep_unmatched` (LEFT JOIN)
+    bool TableHashJoin(std::shared_ptr<TableHandler> left,
+                       const JoinHashTable& right,
+                       SegmentKeyType right_segment_key, bool keep_unmatched,
+                       int32_t limit_cnt,
+                       std::shared_ptr<MemTimeTableHandler> output);  // NOLINT
+    bool PartitionHashJoin(
+        std::shared_ptr<PartitionHandler> left, const JoinHashTable& right,
+        SegmentKeyType right_segment_key, bool keep_unmatched,
+        std::shared_ptr<MemPartitionHandler> output);  // NOLINT
     ConditionGenerator condition_gen_;
     KeyGenerator left_key_gen_;
     PartitionGenerator right_group_gen_;
@@ -651,6 +768,20 @@ class JoinGenerator {
         std::shared_ptr<PartitionHandler> partition);  // NOLINT
     Row RowLastJoinTable(const Row& left_row,
                          std::shared_ptr<TableHandler> table);  // NOLINT
+    std::shared_ptr<TableHandler> RightSegment(
+        const Row& left_row,
+        std::shared_ptr<PartitionHandler> right);  // NOLINT
+    // String key of right segment of `left_row`, by index key and left key
+    std::string RightSegmentKey(const Row& left_row);
+    // Append segment key of `left_row` encoded as right segment keys are,
+    // left key is included if `with_left_key`. Return false if key has null
+    bool AppendSegmentKey(const Row& left_row, SegmentKeyType type,
+                          bool with_left_key, codec::BinaryKey* key);
+    // Probe `right` with key of `left_row`, append joined rows to `output`
+    void HashJoinRow(const Row& left_row, const JoinHashTable& right,
+                     SegmentKeyType right_segment_key, bool keep_unmatched,
+                     codec::BinaryKey* key,
+                     std::vector<Row>* output);  // NOLINT
 
     size_t left_slices_;
     size_t right_slices_;
@@ -728,13 +859,36 @@ class SortRunner : public Runner {
  public:
     SortRunner(const int32_t id, const SchemasContext* schema,
                const int32_t limit_cnt, const Sort& sort)
-        : Runner(id, kRunnerOrder, schema, limit_cnt), sort_gen_(sort) {}
+        : Runner(id, kRunnerOrder, schema, limit_cnt),
+          sort_gen_(sort),
+          memory_limit_(0),
+          spill_dir_(),
+          release_input_(false) {}
     ~SortRunner() {}
     std::shared_ptr<DataHandler> Run(
         RunnerContext& ctx,  // NOLINT
         const std::vector<std::shared_ptr<DataHandler>>& inputs)
         override;  // NOLINT
+    // Spill sorted runs under `spill_dir` once rows take more than
+    // `memory_limit` bytes, zero to sort in memory only
+    void set_spill_options(uint64_t memory_limit,
+                           const std::string& spill_dir) {
+        memory_limit_ = memory_limit;
+        spill_dir_ = spill_dir;
+    }
+    // Whether table input is sorted by RowSorter in one scan
+    bool SortsInOneScan() const {
+        return sort_gen_.Valid() && sort_gen_.order_gen().Valid();
+    }
+    // Input table is built for this runner only, its rows are taken out
+    // while sorting so that spilled rows are released
+    void EnableReleaseInput() { release_input_ = true; }
     SortGenerator sort_gen_;
+
+ private:
+    uint64_t memory_limit_;
+    std::string spill_dir_;
+    bool release_input_;
 };
 class ConstProjectRunner : public Runner {
  public:
@@ -757,6 +911,8 @@ class TableProjectRunner : public Runner {
         : Runner(id, kRunnerTableProject, schema, limit_cnt),
           project_gen_(fn_info) {}
     ~TableProjectRunner() {}
+    // Project rows block by block while consumer iterates output
+    void EnableLazy() { is_lazy_ = true; }
 
     std::shared_ptr<DataHandler> Run(
         RunnerContext& ctx,  // NOLINT
@@ -840,6 +996,24 @@ class GroupAggRunner : public Runner {
     KeyGenerator group_;
     AggGenerator agg_gen_;
 };
+// GROUP BY aggregation over table in a single pass, groups are not
+// materialized into partition
+class HashAggRunner : public Runner {
+ public:
+    HashAggRunner(const int32_t id, const SchemasContext* schema,
+                  const int32_t limit_cnt, const Key& group,
+                  std::shared_ptr<IncrementalAggPlan> plan)
+        : Runner(id, kRunnerHashAgg, schema, limit_cnt),
+          group_(group.fn_info()),
+          plan_(plan) {}
+    ~HashAggRunner() {}
+    std::shared_ptr<DataHandler> Run(
+        RunnerContext& ctx,  // NOLINT
+        const std::vector<std::shared_ptr<DataHandler>>& inputs)
+        override;  // NOLINT
+    KeyGenerator group_;
+    std::shared_ptr<IncrementalAggPlan> plan_;
+};
 class AggRunner : public Runner {
  public:
     AggRunner(const int32_t id, const SchemasContext* schema,
@@ -867,7 +1041,8 @@ class WindowAggRunner : public Runner {
           instance_window_gen_(window_op),
           windows_union_gen_(),
           windows_join_gen_(),
-          window_project_gen_(fn_info) {}
+          window_project_gen_(fn_info),
+          incremental_plan_(IncrementalAggPlan::Build(fn_info)) {}
     ~WindowAggRunner() {}
     void AddWindowJoin(const Join& join, size_t left_slices, Runner* runner) {
         windows_join_gen_.AddWindowJoin(join, left_slices, runner);
@@ -875,15 +1050,40 @@ class WindowAggRunner : public Runner {
     void AddWindowUnion(const WindowOp& window, Runner* runner) {
         windows_union_gen_.AddWindowUnion(window, runner);
     }
+    // Compute partition keys on `thread_pool` instead of caller thread
+    void set_thread_pool(std::shared_ptr<base::ThreadPool> thread_pool) {
+        thread_pool_ = thread_pool;
+    }
+    void GetInputs(std::vector<Runner*>* inputs) const override {
+        Runner::GetInputs(inputs);
+        inputs->insert(inputs->end(),
+                       windows_union_gen_.input_runners_.begin(),
+                       windows_union_gen_.input_runners_.end());
+        inputs->insert(inputs->end(), windows_join_gen_.input_runners_.begin(),
+                       windows_join_gen_.input_runners_.end());
+    }
     std::shared_ptr<DataHandler> Run(
         RunnerContext& ctx,  // NOLINT
         const std::vector<std::shared_ptr<DataHandler>>& inputs)
         override;  // NOLINT
+    // Run window aggregation of every key in `keys` on thread pool, each
+    // task outputs into its own table and tables are merged in key order
+    std::shared_ptr<MemTableHandler> RunWindowAggParallel(
+        std::shared_ptr<PartitionHandler> instance_partition,
+        const std::vector<std::shared_ptr<PartitionHandler>>&
+            union_partitions,
+        const std::vector<std::shared_ptr<DataHandler>>& joins,
+        const std::vector<std::string>& keys);
     void RunWindowAggOnKey(
         std::shared_ptr<PartitionHandler> instance_partition,
         std::vector<std::shared_ptr<PartitionHandler>> union_partitions,
         std::vector<std::shared_ptr<DataHandler>> joins, const std::string& key,
         std::shared_ptr<MemTableHandler> output_table);
+    // Buffer row into window and project output row if it is an instance,
+    // using incremental states when `incremental_agg` is given
+    Row WindowProject(const uint64_t key, const Row& row,
+                      const bool is_instance, Window* window,
+                      IncrementalWindowAgg* incremental_agg);
 
     const bool instance_not_in_window_;
     const bool exclude_current_time_;
@@ -893,6 +1093,85 @@ class WindowAggRunner : public Runner {
     WindowUnionGenerator windows_union_gen_;
     WindowJoinGenerator windows_join_gen_;
     WindowProjectGenerator window_project_gen_;
+    // null if window project can't be evaluated incrementally
+    std::shared_ptr<IncrementalAggPlan> incremental_plan_;
+    // null if partition keys are computed on caller thread
+    std::shared_ptr<base::ThreadPool> thread_pool_;
+};
+
+/**
+ * Window of a request row unioned with rows of its segments. It is a view
+ * over the segments: rows are merged by key descending and bounded by
+ * [start, end], `rows_preceding` and `max_size` once when the window is
+ * built, which pins the first key and row count of every segment in the
+ * window. Iterators merge only the pinned rows, so no row of the window is
+ * copied, and every scan sees the same rows even if segments are appended
+ * meanwhile. Rows are collected by the first `At` for positional access.
+ */
+class RequestUnionWindowHandler : public TableHandler {
+ public:
+    RequestUnionWindowHandler(
+        const Row& request, uint64_t request_key,
+        const std::vector<std::shared_ptr<TableHandler>>& union_segments,
+        const WindowRange& window_range, uint64_t start, uint64_t end,
+        uint64_t rows_preceding, uint64_t max_size, bool output_request_row)
+        : TableHandler(),
+          request_(request),
+          request_key_(request_key),
+          union_segments_(union_segments),
+          window_range_(window_range),
+          start_(start),
+          end_(end),
+          rows_preceding_(rows_preceding),
+          max_size_(max_size),
+          output_request_row_(output_request_row),
+          name_(""),
+          db_(""),
+          types_(),
+          index_hint_() {
+        PinSegments();
+    }
+    ~RequestUnionWindowHandler() {}
+
+    std::unique_ptr<RowIterator> GetIterator() override {
+        return std::unique_ptr<RowIterator>(GetRawIterator());
+    }
+    RowIterator* GetRawIterator() override;
+    const uint64_t GetCount() override;
+    Row At(uint64_t pos) override;
+    const Types& GetTypes() override { return types_; }
+    const IndexHint& GetIndex() override { return index_hint_; }
+    std::unique_ptr<WindowIterator> GetWindowIterator(
+        const std::string&) override {
+        return std::unique_ptr<WindowIterator>();
+    }
+    const Schema* GetSchema() override { return nullptr; }
+    const std::string& GetName() override { return name_; }
+    const std::string& GetDatabase() override { return db_; }
+
+ private:
+    friend class RequestUnionWindowIterator;
+    void PinSegments();
+    void MaterializeRows();
+    const Row request_;
+    const uint64_t request_key_;
+    const std::vector<std::shared_ptr<TableHandler>> union_segments_;
+    const WindowRange window_range_;
+    const uint64_t start_;
+    const uint64_t end_;
+    const uint64_t rows_preceding_;
+    const uint64_t max_size_;
+    const bool output_request_row_;
+    const std::string name_;
+    const std::string db_;
+    const Types types_;
+    const IndexHint index_hint_;
+    // key of the first row and count of rows of every segment in window
+    std::vector<uint64_t> segment_keys_;
+    std::vector<uint64_t> segment_cnts_;
+    uint64_t count_ = 0;
+    bool rows_ready_ = false;
+    std::vector<Row> rows_;
 };
 
 class RequestUnionRunner : public Runner {
@@ -917,6 +1196,12 @@ class RequestUnionRunner : public Runner {
     void AddWindowUnion(const RequestWindowOp& window, Runner* runner) {
         windows_union_gen_.AddWindowUnion(window, runner);
     }
+    void GetInputs(std::vector<Runner*>* inputs) const override {
+        Runner::GetInputs(inputs);
+        inputs->insert(inputs->end(),
+                       windows_union_gen_.input_runners_.begin(),
+                       windows_union_gen_.input_runners_.end());
+    }
     RequestWindowUnionGenerator windows_union_gen_;
     RangeGenerator range_gen_;
     bool exclude_current_time_;
@@ -953,6 +1238,31 @@ class LastJoinRunner : public Runner {
 
     JoinGenerator join_gen_;
 };
+class HashJoinRunner : public Runner {
+ public:
+    HashJoinRunner(const int32_t id, const SchemasContext* schema,
+                   const int32_t limit_cnt, const Join& join,
+                   size_t left_slices, size_t right_slices)
+        : Runner(id, kRunnerHashJoin, schema, limit_cnt),
+          join_gen_(join, left_slices, right_slices),
+          join_type_(join.join_type()) {}
+    ~HashJoinRunner() {}
+    std::shared_ptr<DataHandler> Run(
+        RunnerContext& ctx,  // NOLINT
+        const std::vector<std::shared_ptr<DataHandler>>& inputs)
+        override;  // NOLINT
+    virtual void PrintRunnerInfo(std::ostream& output,
+                                 const std::string& tab) const {
+        output << tab << "[" << id_ << "]" << RunnerTypeName(type_) << "("
+               << node::JoinTypeName(join_type_) << ")";
+        if (is_lazy_) {
+            output << " lazy";
+        }
+    }
+
+    JoinGenerator join_gen_;
+    const node::JoinType join_type_;
+};
 class RequestLastJoinRunner : public Runner {
  public:
     RequestLastJoinRunner(const int32_t id, const SchemasContext* schema,
@@ -998,11 +1308,42 @@ class LimitRunner : public Runner {
     LimitRunner(int32_t id, const SchemasContext* schema, int32_t limit_cnt)
         : Runner(id, kRunnerLimit, schema, limit_cnt) {}
     ~LimitRunner() {}
+    // Pull rows from input while consumer iterates output
+    void EnableLazy() { is_lazy_ = true; }
     std::shared_ptr<DataHandler> Run(
         RunnerContext& ctx,                                        // NOLINT
         const std::vector<std::shared_ptr<DataHandler>>& inputs);  // NOLINT
 };
 
+class DistinctRunner : public Runner {
+ public:
+    DistinctRunner(const int32_t id, const SchemasContext* schema,
+                   const int32_t limit_cnt)
+        : Runner(id, kRunnerDistinct, schema, limit_cnt),
+          distinct_gen_(schema) {}
+    ~DistinctRunner() {}
+    std::shared_ptr<DataHandler> Run(
+        RunnerContext& ctx,  // NOLINT
+        const std::vector<std::shared_ptr<DataHandler>>& inputs)
+        override;  // NOLINT
+    DistinctGenerator distinct_gen_;
+};
+class UnionRunner : public Runner {
+ public:
+    UnionRunner(const int32_t id, const SchemasContext* schema,
+                const int32_t limit_cnt, bool is_all)
+        : Runner(id, kRunnerUnion, schema, limit_cnt),
+          is_all_(is_all),
+          distinct_gen_(schema) {}
+    ~UnionRunner() {}
+    std::shared_ptr<DataHandler> Run(
+        RunnerContext& ctx,  // NOLINT
+        const std::vector<std::shared_ptr<DataHandler>>& inputs)
+        override;  // NOLINT
+    const bool is_all_;
+    DistinctGenerator distinct_gen_;
+};
+
 class ProxyRequestRunner : public Runner {
  public:
     ProxyRequestRunner(int32_t id, uint32_t task_id,
@@ -1025,6 +1366,12 @@ class ProxyRequestRunner : public Runner {
         const std::vector<std::shared_ptr<DataHandler>>& inputs) override;
     std::shared_ptr<DataHandlerList> BatchRequestRun(
         RunnerContext& ctx) override;  // NOLINT
+    void GetInputs(std::vector<Runner*>* inputs) const override {
+        Runner::GetInputs(inputs);
+        if (nullptr != index_input_) {
+            inputs->push_back(index_input_);
+        }
+    }
     virtual void PrintRunnerInfo(std::ostream& output,
                                  const std::string& tab) const {
         output << tab << "[" << id_ << "]" << RunnerTypeName(type_)
@@ -1059,6 +1406,14 @@ class ProxyRequestRunner : public Runner {
     }
 
     const int32_t task_id() const { return task_id_; }
+    // Find tablet of each pk, distinct tablets are appended to `tablets` and
+    // position of tablet of every pk to `row_tablets`. Return false if some
+    // pk has no tablet.
+    static bool GroupByTablet(std::shared_ptr<TableHandler> table_handler,
+                              const std::string& index,
+                              const std::vector<std::string>& pks,
+                              std::vector<std::shared_ptr<Tablet>>* tablets,
+                              std::vector<size_t>* row_tablets);
 
  private:
     std::shared_ptr<DataHandlerList> RunBatchInput(
@@ -1248,13 +1603,20 @@ class ClusterTask {
 class ClusterJob {
  public:
     ClusterJob()
-        : tasks_(), main_task_id_(-1), sql_(""), common_column_indices_() {}
+        : tasks_(),
+          main_task_id_(-1),
+          sql_(""),
+          common_column_indices_(),
+          runner_num_(0),
+          thread_pool_() {}
     explicit ClusterJob(const std::string& sql,
                         const std::set<size_t>& common_column_indices)
         : tasks_(),
           main_task_id_(-1),
           sql_(sql),
-          common_column_indices_(common_column_indices) {}
+          common_column_indices_(common_column_indices),
+          runner_num_(0),
+          thread_pool_() {}
     ClusterTask GetTask(int32_t id) {
         if (id < 0 || id >= static_cast<int32_t>(tasks_.size())) {
             LOG(WARNING) << "fail get task: task " << id << " not exist";
@@ -1283,8 +1645,23 @@ class ClusterJob {
     }
 
     void AddMainTask(const ClusterTask& task) { main_task_id_ = AddTask(task); }
-    void Reset() { tasks_.clear(); }
+    void Reset() {
+        tasks_.clear();
+        runner_num_ = 0;
+        thread_pool_.reset();
+    }
     const size_t GetTaskSize() const { return tasks_.size(); }
+    // Runner ids of the job are dense in [0, runner_num)
+    const size_t runner_num() const { return runner_num_; }
+    void set_runner_num(size_t runner_num) { runner_num_ = runner_num; }
+    // Pool running independent runners of the job in parallel, null if
+    // runners are run on caller thread
+    const std::shared_ptr<base::ThreadPool>& thread_pool() const {
+        return thread_pool_;
+    }
+    void set_thread_pool(std::shared_ptr<base::ThreadPool> thread_pool) {
+        thread_pool_ = thread_pool;
+    }
     const bool IsValid() const { return !tasks_.empty(); }
     const int32_t main_task_id() const { return main_task_id_; }
     const std::string& sql() const { return sql_; }
@@ -1313,6 +1690,8 @@ class ClusterJob {
     int32_t main_task_id_;
     std::string sql_;
     std::set<size_t> common_column_indices_;
+    size_t runner_num_;
+    std::shared_ptr<base::ThreadPool> thread_pool_;
 };
 class RunnerBuilder {
     enum TaskBiasType { kLeftBias, kRightBias, kNoBias };
@@ -1330,6 +1709,16 @@ class RunnerBuilder {
           proxy_runner_map_(),
           batch_common_node_set_(batch_common_node_set) {}
     virtual ~RunnerBuilder() {}
+    // Worker pool shared by batch mode runners, null to run on caller thread
+    void set_batch_thread_pool(std::shared_ptr<base::ThreadPool> pool) {
+        batch_thread_pool_ = pool;
+    }
+    // Memory budget and spill directory of batch mode ORDER BY
+    void set_batch_sort_options(uint64_t memory_limit,
+                                const std::string& spill_dir) {
+        batch_sort_memory_limit_ = memory_limit;
+        batch_sort_spill_dir_ = spill_dir;
+    }
     ClusterTask RegisterTask(PhysicalOpNode* node, ClusterTask task) {
         task_map_[node] = task;
         if (batch_common_node_set_.find(node->node_id()) !=
@@ -1352,6 +1741,7 @@ class RunnerBuilder {
 
         if (task.IsCompletedClusterTask()) {
             auto proxy_task = BuildProxyRunnerForClusterTask(task);
+            cluster_job_.set_runner_num(id_);
             if (!proxy_task.IsValid()) {
                 status.code = common::kOpGenError;
                 status.msg = "Fail to build proxy cluster task";
@@ -1367,6 +1757,11 @@ class RunnerBuilder {
             LOG(WARNING) << status;
             return cluster_job_;
         } else {
+            if (!support_cluster_optimized_) {
+                EnableLazyRunners(task.GetRoot());
+            }
+            cluster_job_.set_runner_num(id_);
+            cluster_job_.set_thread_pool(batch_thread_pool_);
             cluster_job_.AddMainTask(task);
         }
         return cluster_job_;
@@ -1391,6 +1786,12 @@ class RunnerBuilder {
     std::unordered_map<hybridse::vm::Runner*, ::hybridse::vm::Runner*>
         proxy_runner_map_;
     std::set<size_t> batch_common_node_set_;
+    std::shared_ptr<base::ThreadPool> batch_thread_pool_;
+    uint64_t batch_sort_memory_limit_ = 0;
+    std::string batch_sort_spill_dir_;
+    // Turn runners materializing outputs scanned only once into lazy ones,
+    // so that rows stream from producers to pipeline breakers
+    void EnableLazyRunners(Runner* root);
     ClusterTask BinaryInherit(const ClusterTask& left, const ClusterTask& right,
                               Runner* runner, const Key& index_key,
                               const TaskBiasType bias = kNoBias);
@@ -1421,7 +1822,10 @@ class RunnerContext {
           request_(),
           requests_(),
           is_debug_(is_debug),
-          batch_cache_() {}
+          cache_(),
+          batch_cache_() {
+        InitCache();
+    }
     explicit RunnerContext(hybridse::vm::ClusterJob* cluster_job,
                            const hybridse::codec::Row& request,
                            const std::string& sp_name = "",
@@ -1431,7 +1835,10 @@ class RunnerContext {
           request_(request),
           requests_(),
           is_debug_(is_debug),
-          batch_cache_() {}
+          cache_(),
+          batch_cache_() {
+        InitCache();
+    }
     explicit RunnerContext(hybridse::vm::ClusterJob* cluster_job,
                            const std::vector<Row>& request_batch,
                            const std::string& sp_name = "",
@@ -1441,7 +1848,10 @@ class RunnerContext {
           request_(),
           requests_(request_batch),
           is_debug_(is_debug),
-          batch_cache_() {}
+          cache_(),
+          batch_cache_() {
+        InitCache();
+    }
 
     const size_t GetRequestSize() const { return requests_.size(); }
     const hybridse::codec::Row& GetRequest() const { return request_; }
@@ -1456,20 +1866,80 @@ class RunnerContext {
     const std::string& sp_name() { return sp_name_; }
     std::shared_ptr<DataHandler> GetCache(int64_t id) const;
     void SetCache(int64_t id, std::shared_ptr<DataHandler> data);
-    void ClearCache() { cache_.clear(); }
+    void ClearCache() {
+        std::fill(cache_.begin(), cache_.end(), nullptr);
+    }
     std::shared_ptr<DataHandlerList> GetBatchCache(int64_t id) const;
     void SetBatchCache(int64_t id, std::shared_ptr<DataHandlerList> data);
+    // Arena of rows produced in this execution, released in bulk with the
+    // context. Rows escaping to caller should be copied by
+    // `Runner::DetachRow`.
+    base::ByteMemoryPool* row_arena() {
+        if (!row_arena_) {
+            row_arena_.reset(new base::ByteMemoryPool());
+        }
+        return row_arena_.get();
+    }
+    // Another arena of rows for a worker thread, since `row_arena` is not
+    // thread safe. Released with the context as well.
+    base::ByteMemoryPool* NewWorkerArena();
 
  private:
+    friend class RunnerContextPool;
+    // Size cache slots to runner number of cluster job
+    void InitCache();
+    // Rebind to another execution, used by `RunnerContextPool`
+    void Reset(hybridse::vm::ClusterJob* cluster_job,
+               const std::string& sp_name, const bool is_debug);
+    // Drop data of last execution, cache slots are kept for reuse
+    void Clear();
+
     hybridse::vm::ClusterJob* cluster_job_;
-    const std::string sp_name_;
+    std::string sp_name_;
     hybridse::codec::Row request_;
     std::vector<hybridse::codec::Row> requests_;
-    size_t idx_;
-    const bool is_debug_;
-    // TODO(chenjing): optimize
-    std::map<int64_t, std::shared_ptr<DataHandler>> cache_;
-    std::map<int64_t, std::shared_ptr<DataHandlerList>> batch_cache_;
+    bool is_debug_;
+    // Indexed by runner id
+    std::vector<std::shared_ptr<DataHandler>> cache_;
+    std::vector<std::shared_ptr<DataHandlerList>> batch_cache_;
+    std::unique_ptr<base::ByteMemoryPool> row_arena_;
+    std::mutex worker_arena_mu_;
+    std::vector<std::unique_ptr<base::ByteMemoryPool>> worker_arenas_;
+    // Number of worker arenas handed out in current execution
+    size_t worker_arena_cnt_ = 0;
+};
+
+/**
+ * Thread-local free list of `RunnerContext`. Contexts go back to the pool
+ * of current thread when the returned handle is destroyed, so that request
+ * path does not allocate cache slots and context again.
+ */
+class RunnerContextPool {
+ public:
+    struct Releaser {
+        void operator()(RunnerContext* ctx) const;
+    };
+    typedef std::unique_ptr<RunnerContext, Releaser> Handle;
+
+    static Handle Get(hybridse::vm::ClusterJob* cluster_job,
+                      const bool is_debug = false);
+    static Handle Get(hybridse::vm::ClusterJob* cluster_job,
+                      const hybridse::codec::Row& request,
+                      const std::string& sp_name = "",
+                      const bool is_debug = false);
+    static Handle Get(hybridse::vm::ClusterJob* cluster_job,
+                      const std::vector<Row>& request_batch,
+                      const std::string& sp_name = "",
+                      const bool is_debug = false);
+
+    // Number of idle contexts of current thread
+    static size_t IdleSize() { return FreeList().size(); }
+
+ private:
+    static const size_t kMaxIdleSize = 4;
+    static std::vector<std::unique_ptr<RunnerContext>>& FreeList();
+    static Handle Take(hybridse::vm::ClusterJob* cluster_job,
+                       const std::string& sp_name, const bool is_debug);
 };
 }  // namespace vm
 }  // namespace hybridse
@@ -0,0 +1,181 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vm/runner_scheduler.h"
+#include <condition_variable>  // NOLINT
+#include <mutex>               // NOLINT
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+namespace hybridse {
+namespace vm {
+
+typedef std::unordered_map<Runner*, std::vector<Runner*>> RunnerInputsMap;
+
+// Collect runners under `runner` in post order, inputs first
+static void CollectRunners(Runner* runner, RunnerInputsMap* inputs_map,
+                           std::vector<Runner*>* order) {
+    if (inputs_map->find(runner) != inputs_map->end()) {
+        return;
+    }
+    std::vector<Runner*> inputs;
+    runner->GetInputs(&inputs);
+    (*inputs_map)[runner] = inputs;
+    for (auto input : inputs) {
+        if (nullptr != input) {
+            CollectRunners(input, inputs_map, order);
+        }
+    }
+    order->push_back(runner);
+}
+
+bool RunnerScheduler::BuildUnits(Runner* root, size_t runner_num,
+                                 std::vector<Unit>* units) {
+    RunnerInputsMap inputs_map;
+    std::vector<Runner*> order;
+    CollectRunners(root, &inputs_map, &order);
+
+    std::unordered_set<Runner*> unit_runners;
+    unit_runners.insert(root);
+    bool has_branch = false;
+    for (auto runner : order) {
+        if (runner->need_cache()) {
+            unit_runners.insert(runner);
+        }
+        const auto& inputs = inputs_map[runner];
+        if (inputs.size() > 1) {
+            has_branch = true;
+            for (auto input : inputs) {
+                if (nullptr != input) {
+                    unit_runners.insert(input);
+                }
+            }
+        }
+    }
+    if (!has_branch) {
+        return false;
+    }
+
+    std::unordered_map<Runner*, size_t> unit_idxs;
+    units->clear();
+    for (auto runner : order) {
+        if (unit_runners.find(runner) == unit_runners.end()) {
+            continue;
+        }
+        if (runner->id_ < 0 || static_cast<size_t>(runner->id_) >= runner_num) {
+            return false;
+        }
+        unit_idxs[runner] = units->size();
+        units->push_back(Unit{runner, {}, 0});
+    }
+    // a unit waits for the nearest units below it, runners in between run
+    // inline
+    for (size_t idx = 0; idx < units->size(); idx++) {
+        Runner* runner = (*units)[idx].runner;
+        std::unordered_set<Runner*> visited;
+        std::vector<Runner*> stack(inputs_map[runner]);
+        while (!stack.empty()) {
+            Runner* input = stack.back();
+            stack.pop_back();
+            if (nullptr == input || !visited.insert(input).second) {
+                continue;
+            }
+            auto iter = unit_idxs.find(input);
+            if (iter != unit_idxs.end()) {
+                (*units)[iter->second].consumers.push_back(idx);
+                (*units)[idx].input_cnt++;
+                continue;
+            }
+            const auto& inputs = inputs_map[input];
+            stack.insert(stack.end(), inputs.begin(), inputs.end());
+        }
+    }
+    return true;
+}
+
+// State of one scheduled run shared by caller and unit tasks
+struct UnitSchedule {
+    RunnerContext* ctx;
+    std::shared_ptr<base::ThreadPool> thread_pool;
+    std::vector<RunnerScheduler::Unit> units;
+    std::mutex mu;
+    std::condition_variable cv;
+    // units other than root not done yet
+    size_t remain_cnt;
+};
+
+static void SubmitUnit(std::shared_ptr<UnitSchedule> schedule, size_t idx);
+
+static void RunUnit(std::shared_ptr<UnitSchedule> schedule, size_t idx) {
+    const RunnerScheduler::Unit& unit = schedule->units[idx];
+    auto output = unit.runner->RunWithCache(*schedule->ctx);
+    schedule->ctx->SetCache(unit.runner->id_, output);
+    std::vector<size_t> ready;
+    {
+        std::lock_guard<std::mutex> lock(schedule->mu);
+        for (size_t consumer : unit.consumers) {
+            if (0 == --schedule->units[consumer].input_cnt &&
+                consumer + 1 != schedule->units.size()) {
+                ready.push_back(consumer);
+            }
+        }
+        if (0 == --schedule->remain_cnt) {
+            schedule->cv.notify_all();
+        }
+    }
+    for (size_t consumer : ready) {
+        SubmitUnit(schedule, consumer);
+    }
+}
+
+static void SubmitUnit(std::shared_ptr<UnitSchedule> schedule, size_t idx) {
+    schedule->thread_pool->Submit([schedule, idx]() { RunUnit(schedule, idx); });
+}
+
+std::shared_ptr<DataHandler> RunnerScheduler::RunWithCache(
+    Runner* root, RunnerContext& ctx) {
+    // workers of the pool must not wait for tasks of it
+    if (nullptr == root || !thread_pool_ || thread_pool_->thread_num() <= 1 ||
+        thread_pool_->InWorker() || nullptr == ctx.cluster_job()) {
+        return root->RunWithCache(ctx);
+    }
+    auto schedule = std::make_shared<UnitSchedule>();
+    if (!BuildUnits(root, ctx.cluster_job()->runner_num(),
+                    &schedule->units)) {
+        return root->RunWithCache(ctx);
+    }
+    schedule->ctx = &ctx;
+    schedule->thread_pool = thread_pool_;
+    schedule->remain_cnt = schedule->units.size() - 1;
+    if (schedule->remain_cnt > 0) {
+        std::vector<size_t> ready;
+        for (size_t idx = 0; idx + 1 < schedule->units.size(); idx++) {
+            if (0 == schedule->units[idx].input_cnt) {
+                ready.push_back(idx);
+            }
+        }
+        for (size_t idx : ready) {
+            SubmitUnit(schedule, idx);
+        }
+        std::unique_lock<std::mutex> lock(schedule->mu);
+        schedule->cv.wait(lock, [&]() { return 0 == schedule->remain_cnt; });
+    }
+    return root->RunWithCache(ctx);
+}
+
+}  // namespace vm
+}  // namespace hybridse
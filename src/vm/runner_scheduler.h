@@ -0,0 +1,74 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_VM_RUNNER_SCHEDULER_H_
+#define SRC_VM_RUNNER_SCHEDULER_H_
+
+#include <memory>
+#include <vector>
+#include "base/thread_pool.h"
+#include "vm/runner.h"
+
+namespace hybridse {
+namespace vm {
+
+/**
+ * Run runner DAG of a batch job with independent branches in parallel.
+ *
+ * The DAG is cut into units: the root, every cached runner, which is
+ * shared by several consumers, and every input of a runner reading more
+ * than one input, such as the window projects under a concat join. A unit
+ * is run by `RunWithCache` of its runner on the thread pool once all units
+ * below it are done, and its output is put into the context cache, so that
+ * runners above pick it up instead of running it again. Runners between
+ * units belong to the unit above them and run inline.
+ *
+ * Jobs without branches, or without a thread pool, run on caller thread.
+ */
+class RunnerScheduler {
+ public:
+    struct Unit {
+        Runner* runner;
+        // units waiting for output of this one
+        std::vector<size_t> consumers;
+        // number of units this one waits for
+        size_t input_cnt;
+    };
+
+    explicit RunnerScheduler(std::shared_ptr<base::ThreadPool> thread_pool)
+        : thread_pool_(thread_pool) {}
+    ~RunnerScheduler() {}
+
+    // Output of `root`, the same as `root->RunWithCache(ctx)`
+    std::shared_ptr<DataHandler> RunWithCache(Runner* root,
+                                              RunnerContext& ctx);  // NOLINT
+
+    /**
+     * Cut DAG under `root` into units in topological order, root last.
+     * Return false if the DAG has no branch to run in parallel, or a runner
+     * id is out of [0, runner_num) so that context cache may grow while
+     * units run.
+     */
+    static bool BuildUnits(Runner* root, size_t runner_num,
+                           std::vector<Unit>* units);
+
+ private:
+    std::shared_ptr<base::ThreadPool> thread_pool_;
+};
+
+}  // namespace vm
+}  // namespace hybridse
+#endif  // SRC_VM_RUNNER_SCHEDULER_H_
@@ -0,0 +1,154 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vm/runner_scheduler.h"
+#include <chrono>  // NOLINT
+#include <memory>
+#include <mutex>  // NOLINT
+#include <set>
+#include <thread>  // NOLINT
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace hybridse {
+namespace vm {
+
+// Output `value_` rows plus rows of all inputs, recording runs and threads
+class CountRunner : public Runner {
+ public:
+    CountRunner(int32_t id, size_t value, int64_t sleep_ms)
+        : Runner(id), value_(value), sleep_ms_(sleep_ms), run_cnt_(0) {}
+    std::shared_ptr<DataHandler> Run(
+        RunnerContext& ctx,
+        const std::vector<std::shared_ptr<DataHandler>>& inputs) override {
+        std::this_thread::sleep_for(std::chrono::milliseconds(sleep_ms_));
+        auto output = std::make_shared<MemTableHandler>();
+        for (size_t i = 0; i < value_; i++) {
+            output->AddRow(Row());
+        }
+        for (auto& input : inputs) {
+            auto table = std::dynamic_pointer_cast<TableHandler>(input);
+            for (uint64_t i = 0; i < table->GetCount(); i++) {
+                output->AddRow(Row());
+            }
+        }
+        std::lock_guard<std::mutex> lock(mu_);
+        run_cnt_++;
+        threads_.insert(std::this_thread::get_id());
+        return output;
+    }
+    size_t run_cnt() const { return run_cnt_; }
+    static std::set<std::thread::id> threads() {
+        std::lock_guard<std::mutex> lock(mu_);
+        return threads_;
+    }
+    static void ClearThreads() {
+        std::lock_guard<std::mutex> lock(mu_);
+        threads_.clear();
+    }
+
+ private:
+    size_t value_;
+    int64_t sleep_ms_;
+    size_t run_cnt_;
+    static std::mutex mu_;
+    static std::set<std::thread::id> threads_;
+};
+std::mutex CountRunner::mu_;
+std::set<std::thread::id> CountRunner::threads_;
+
+class RunnerSchedulerTest : public ::testing::Test {
+ public:
+    // root(concat(a, b), c), where a, b and c read the shared data runner
+    void SetUp() override {
+        data_.reset(new CountRunner(0, 1, 0));
+        data_->EnableCache();
+        for (int32_t i = 0; i < 3; i++) {
+            branches_.emplace_back(new CountRunner(1 + i, 10 * (i + 1), 50));
+            branches_[i]->AddProducer(data_.get());
+        }
+        concat_.reset(new CountRunner(4, 0, 0));
+        concat_->AddProducer(branches_[0].get());
+        concat_->AddProducer(branches_[1].get());
+        root_.reset(new CountRunner(5, 0, 0));
+        root_->AddProducer(concat_.get());
+        root_->AddProducer(branches_[2].get());
+        job_.set_runner_num(6);
+        CountRunner::ClearThreads();
+    }
+
+    size_t RunCnt(const std::unique_ptr<CountRunner>& runner) {
+        return runner->run_cnt();
+    }
+
+    std::unique_ptr<CountRunner> data_;
+    std::vector<std::unique_ptr<CountRunner>> branches_;
+    std::unique_ptr<CountRunner> concat_;
+    std::unique_ptr<CountRunner> root_;
+    ClusterJob job_;
+};
+
+TEST_F(RunnerSchedulerTest, BuildUnitsTest) {
+    std::vector<RunnerScheduler::Unit> units;
+    ASSERT_TRUE(RunnerScheduler::BuildUnits(root_.get(), 6, &units));
+    ASSERT_EQ(6u, units.size());
+    ASSERT_EQ(root_.get(), units.back().runner);
+    ASSERT_EQ(2u, units.back().input_cnt);
+    for (auto& unit : units) {
+        if (unit.runner == data_.get()) {
+            ASSERT_EQ(0u, unit.input_cnt);
+            ASSERT_EQ(3u, unit.consumers.size());
+        }
+    }
+    // ids out of runner number
+    ASSERT_FALSE(RunnerScheduler::BuildUnits(root_.get(), 5, &units));
+    // no branch in a chain
+    ASSERT_FALSE(RunnerScheduler::BuildUnits(branches_[0].get(), 6, &units));
+}
+
+TEST_F(RunnerSchedulerTest, RunWithCacheTest) {
+    auto pool = std::make_shared<base::ThreadPool>(4);
+    RunnerContext ctx(&job_);
+    RunnerScheduler scheduler(pool);
+    auto output = std::dynamic_pointer_cast<TableHandler>(
+        scheduler.RunWithCache(root_.get(), ctx));
+    ASSERT_TRUE(output != nullptr);
+    ASSERT_EQ(63u, output->GetCount());
+    // every runner runs once, branches run on workers
+    ASSERT_EQ(1u, RunCnt(data_));
+    for (auto& branch : branches_) {
+        ASSERT_EQ(1u, RunCnt(branch));
+    }
+    ASSERT_EQ(1u, RunCnt(concat_));
+    ASSERT_EQ(1u, RunCnt(root_));
+    ASSERT_LT(1u, CountRunner::threads().size());
+
+    // the same output on caller thread
+    RunnerContext serial_ctx(&job_);
+    output = std::dynamic_pointer_cast<TableHandler>(
+        RunnerScheduler(nullptr).RunWithCache(root_.get(), serial_ctx));
+    ASSERT_EQ(63u, output->GetCount());
+    ASSERT_EQ(2u, RunCnt(data_));
+    ASSERT_EQ(2u, RunCnt(root_));
+}
+
+}  // namespace vm
+}  // namespace hybridse
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -14,8 +14,14 @@
  * limitations under the License.
  */
 
+#include <atomic>
 #include <memory>
+#include <mutex>  // NOLINT
+#include <set>
+#include <string>
+#include <thread>  // NOLINT
 #include <utility>
+#include <vector>
 #include "boost/algorithm/string.hpp"
 #include "case/sql_case.h"
 #include "gtest/gtest.h"
@@ -34,6 +40,7 @@
 #include "llvm/Transforms/Scalar/GVN.h"
 #include "parser/parser.h"
 #include "plan/planner.h"
+#include "vm/jit_runtime.h"
 #include "vm/sql_compiler.h"
 #include "vm/test_base.h"
 
@@ -292,6 +299,18 @@ TEST_F(RunnerTest, KeyGeneratorTest) {
     ASSERT_EQ("3|55", group_runner->partition_gen_.GetKey(rows[2]));
     ASSERT_EQ("4|55", group_runner->partition_gen_.GetKey(rows[3]));
     ASSERT_EQ("5|55", group_runner->partition_gen_.GetKey(rows[4]));
+
+    std::vector<codec::BinaryKey> keys(rows.size());
+    for (size_t i = 0; i < rows.size(); i++) {
+        group_runner->partition_gen_.GetKey(rows[i], &keys[i]);
+    }
+    codec::BinaryKey same_key;
+    group_runner->partition_gen_.GetKey(rows[0], &same_key);
+    ASSERT_EQ(keys[0], same_key);
+    ASSERT_EQ(keys[0].hash(), same_key.hash());
+    for (size_t i = 1; i < keys.size(); i++) {
+        ASSERT_NE(keys[i - 1], keys[i]);
+    }
 }
 
 TEST_F(RunnerTest, RunnerPrintDataTest) {
@@ -421,6 +440,831 @@ TEST_F(RunnerTest, RunnerPrintDataMemTimeTableTest) {
         LOG(INFO) << oss.str();
     }
 }
+
+TEST_F(RunnerTest, RowArenaTest) {
+    // Without arena, row buffer is owned by slice
+    int8_t* buf = JitRuntime::get()->AllocRow(16);
+    ASSERT_TRUE(JitRuntime::get()->CreateRowSlice(buf, 16).managed());
+
+    Row detached;
+    {
+        ClusterJob job;
+        RunnerContext ctx(&job);
+        RowArenaScope arena_scope(ctx.row_arena());
+        ASSERT_EQ(ctx.row_arena(), JitRuntime::get()->row_arena());
+        int8_t* arena_buf = JitRuntime::get()->AllocRow(5);
+        memcpy(arena_buf, "hello", 5);
+        auto slice = JitRuntime::get()->CreateRowSlice(arena_buf, 5);
+        ASSERT_FALSE(slice.managed());
+        // next buffer is still 8 bytes aligned
+        ASSERT_EQ(0u, reinterpret_cast<uintptr_t>(
+                          JitRuntime::get()->AllocRow(8)) %
+                          8);
+
+        std::string right = "world";
+        Row row(slice);
+        row.Append(base::RefCountedSlice::Create(right.data(), right.size()));
+        detached = Runner::DetachRow(row);
+        ASSERT_TRUE(detached.GetSlice(0).managed());
+        ASSERT_TRUE(detached.GetSlice(1).managed());
+        ASSERT_NE(row.buf(0), detached.buf(0));
+
+        // ownership follows allocation, not the arena on wrapping
+        int8_t* malloc_buf = nullptr;
+        {
+            RowArenaScope no_arena_scope(nullptr);
+            malloc_buf = JitRuntime::get()->AllocRow(16);
+        }
+        ASSERT_TRUE(
+            JitRuntime::get()->CreateRowSlice(malloc_buf, 16).managed());
+        arena_buf = JitRuntime::get()->AllocRow(16);
+        {
+            RowArenaScope no_arena_scope(nullptr);
+            ASSERT_FALSE(
+                JitRuntime::get()->CreateRowSlice(arena_buf, 16).managed());
+        }
+    }
+    ASSERT_EQ(nullptr, JitRuntime::get()->row_arena());
+    ASSERT_EQ(2, detached.GetRowPtrCnt());
+    ASSERT_EQ("hello", std::string(reinterpret_cast<char*>(detached.buf(0)),
+                                   detached.size(0)));
+    ASSERT_EQ("world", std::string(reinterpret_cast<char*>(detached.buf(1)),
+                                   detached.size(1)));
+}
+
+// keep rows with even value, count block calls
+class EvenPredicate : public PredicateFun {
+ public:
+    explicit EvenPredicate(const Schema* schema)
+        : row_view_(*schema), block_cnt_(0) {}
+    int32_t Value(const Row& row) const {
+        int32_t value = 0;
+        row_view_.GetValue(row.buf(), 0, type::kInt32, &value);
+        return value;
+    }
+    bool operator()(const Row& row) const override {
+        return Value(row) % 2 == 0;
+    }
+    void operator()(const Row* rows, size_t cnt,
+                    std::vector<uint32_t>* sel) const override {
+        block_cnt_++;
+        PredicateFun::operator()(rows, cnt, sel);
+    }
+    const codec::RowView row_view_;
+    mutable size_t block_cnt_;
+};
+
+TEST_F(RunnerTest, RunnerContextPoolTest) {
+    ClusterJob job;
+    job.set_runner_num(4);
+    auto table = std::make_shared<MemTableHandler>();
+    size_t idle = RunnerContextPool::IdleSize();
+    RunnerContext* reused = nullptr;
+    {
+        auto ctx = RunnerContextPool::Get(&job, Row(), "sp", true);
+        reused = ctx.get();
+        ASSERT_EQ(&job, ctx->cluster_job());
+        ASSERT_EQ("sp", ctx->sp_name());
+        ASSERT_TRUE(ctx->is_debug());
+        ASSERT_EQ(nullptr, ctx->GetCache(3));
+        ctx->SetCache(3, table);
+        ASSERT_EQ(table, ctx->GetCache(3));
+        // ids out of runner number still work
+        ASSERT_EQ(nullptr, ctx->GetCache(6));
+        ctx->SetCache(6, table);
+        ASSERT_EQ(table, ctx->GetCache(6));
+        ASSERT_EQ(nullptr, ctx->GetCache(-1));
+    }
+    ASSERT_EQ(idle + 1, RunnerContextPool::IdleSize());
+    ASSERT_EQ(1, table.use_count());
+    {
+        std::vector<Row> requests(2);
+        auto ctx = RunnerContextPool::Get(&job, requests);
+        // context of last execution is reused with cache cleared
+        ASSERT_EQ(reused, ctx.get());
+        ASSERT_EQ(idle, RunnerContextPool::IdleSize());
+        ASSERT_EQ(2u, ctx->GetRequestSize());
+        ASSERT_EQ("", ctx->sp_name());
+        ASSERT_FALSE(ctx->is_debug());
+        ASSERT_EQ(nullptr, ctx->GetCache(3));
+        ASSERT_EQ(nullptr, ctx->GetCache(6));
+    }
+}
+
+TEST_F(RunnerTest, BlockFilterTest) {
+    Schema schema;
+    auto column = schema.Add();
+    column->set_name("col1");
+    column->set_type(type::kInt32);
+    auto table = std::make_shared<MemTableHandler>(&schema);
+    codec::RowBuilder builder(schema);
+    for (int32_t i = 0; i < 3000; i++) {
+        uint32_t size = builder.CalTotalLength(0);
+        int8_t* buf = reinterpret_cast<int8_t*>(malloc(size));
+        builder.SetBuffer(buf, size);
+        builder.AppendInt32(i);
+        table->AddRow(Row(base::RefCountedSlice::CreateManaged(buf, size)));
+    }
+
+    EvenPredicate predicate(&schema);
+    TableFilterWrapper filter_table(table, &predicate);
+    auto iter = filter_table.GetIterator();
+    iter->SeekToFirst();
+    int32_t expect = 0;
+    while (iter->Valid()) {
+        ASSERT_EQ(expect, predicate.Value(iter->GetValue()));
+        expect += 2;
+        iter->Next();
+    }
+    ASSERT_EQ(3000, expect);
+    // blocks of 16, 32, ... 1024 rows, then every 1024 rows
+    ASSERT_LT(predicate.block_cnt_, 20u);
+
+    // consumer of a few rows only filters the first small block, on seeking
+    predicate.block_cnt_ = 0;
+    iter = filter_table.GetIterator();
+    ASSERT_EQ(0u, predicate.block_cnt_);
+    iter->SeekToFirst();
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ(0, predicate.Value(iter->GetValue()));
+    ASSERT_EQ(1u, predicate.block_cnt_);
+
+    ASSERT_EQ(1500u, filter_table.GetCount());
+    ASSERT_EQ(20, predicate.Value(filter_table.At(10)));
+}
+
+// double int32 value of rows, count projected rows and block calls
+class DoubleProject : public ProjectFun {
+ public:
+    explicit DoubleProject(const Schema* schema)
+        : builder_(*schema), row_view_(*schema), row_cnt_(0), block_cnt_(0) {}
+    int32_t Value(const Row& row) const {
+        int32_t value = 0;
+        row_view_.GetValue(row.buf(), 0, type::kInt32, &value);
+        return value;
+    }
+    Row operator()(const Row& row) const override {
+        row_cnt_++;
+        uint32_t size = builder_.CalTotalLength(0);
+        int8_t* buf = reinterpret_cast<int8_t*>(malloc(size));
+        builder_.SetBuffer(buf, size);
+        builder_.AppendInt32(Value(row) * 2);
+        return Row(base::RefCountedSlice::CreateManaged(buf, size));
+    }
+    void operator()(const Row* rows, size_t cnt,
+                    Row* outputs) const override {
+        block_cnt_++;
+        ProjectFun::operator()(rows, cnt, outputs);
+    }
+    mutable codec::RowBuilder builder_;
+    const codec::RowView row_view_;
+    mutable size_t row_cnt_;
+    mutable size_t block_cnt_;
+};
+
+TEST_F(RunnerTest, LazyProjectLimitTest) {
+    Schema schema;
+    auto column = schema.Add();
+    column->set_name("col1");
+    column->set_type(type::kInt32);
+    auto table = std::make_shared<MemTableHandler>(&schema);
+    codec::RowBuilder builder(schema);
+    for (int32_t i = 0; i < 3000; i++) {
+        uint32_t size = builder.CalTotalLength(0);
+        int8_t* buf = reinterpret_cast<int8_t*>(malloc(size));
+        builder.SetBuffer(buf, size);
+        builder.AppendInt32(i);
+        table->AddRow(Row(base::RefCountedSlice::CreateManaged(buf, size)));
+    }
+
+    DoubleProject project(&schema);
+    auto project_table =
+        std::make_shared<TableBlockProjectWrapper>(table, &project);
+    auto iter = project_table->GetIterator();
+    iter->SeekToFirst();
+    int32_t expect = 0;
+    while (iter->Valid()) {
+        ASSERT_EQ(expect * 2, project.Value(iter->GetValue()));
+        expect++;
+        iter->Next();
+    }
+    ASSERT_EQ(3000, expect);
+    ASSERT_LT(project.block_cnt_, 20u);
+
+    // limit pulls only the first small block of projected rows
+    project.row_cnt_ = 0;
+    LimitRunner limit(0, nullptr, 10);
+    limit.EnableLazy();
+    RunnerContext ctx(nullptr);
+    auto output = std::dynamic_pointer_cast<TableHandler>(
+        limit.Run(ctx, {project_table}));
+    ASSERT_TRUE(output != nullptr);
+    ASSERT_EQ(0u, project.row_cnt_);
+    ASSERT_EQ(10u, output->GetCount());
+    iter = output->GetIterator();
+    iter->SeekToFirst();
+    for (int32_t i = 0; i < 10; i++) {
+        ASSERT_TRUE(iter->Valid());
+        ASSERT_EQ(i * 2, project.Value(iter->GetValue()));
+        iter->Next();
+    }
+    ASSERT_FALSE(iter->Valid());
+    // count and scan both project the first block once, on seeking
+    ASSERT_LE(project.row_cnt_, 16u * 2);
+
+    // project after limit
+    project.row_cnt_ = 0;
+    TableBlockProjectWrapper limit_project(
+        std::make_shared<TableLimitWrapper>(table, 5), &project);
+    ASSERT_EQ(5u, limit_project.GetCount());
+    iter = limit_project.GetIterator();
+    iter->SeekToFirst();
+    size_t cnt = 0;
+    for (; iter->Valid(); iter->Next()) {
+        cnt++;
+    }
+    ASSERT_EQ(5u, cnt);
+    ASSERT_LE(project.row_cnt_, 5u * 4);
+}
+
+// Tablet answering sub query with its input rows
+class EchoTablet : public Tablet {
+ public:
+    explicit EchoTablet(const std::string& name) : name_(name) {}
+    const std::string& GetName() const override { return name_; }
+    std::shared_ptr<RowHandler> SubQuery(uint32_t task_id,
+                                         const std::string& db,
+                                         const std::string& sql,
+                                         const Row& row,
+                                         const bool is_procedure,
+                                         const bool is_debug) override {
+        return std::make_shared<MemRowHandler>(row);
+    }
+    std::shared_ptr<TableHandler> SubQuery(
+        uint32_t task_id, const std::string& db, const std::string& sql,
+        const std::set<size_t>& common_column_indices,
+        const std::vector<Row>& in_rows, const bool request_is_common,
+        const bool is_procedure, const bool is_debug) override {
+        auto table = std::make_shared<MemTableHandler>();
+        for (auto& row : in_rows) {
+            table->AddRow(row);
+        }
+        query_rows_.push_back(in_rows.size());
+        return table;
+    }
+    std::string name_;
+    // row count of every sub query
+    std::vector<size_t> query_rows_;
+};
+
+// Table sharded to tablets by the first char of pk, pk "x" has no tablet
+class ShardedTableHandler : public MemTableHandler {
+ public:
+    explicit ShardedTableHandler(size_t shard_cnt) {
+        for (size_t i = 0; i < shard_cnt; i++) {
+            tablets_.push_back(
+                std::make_shared<EchoTablet>("tablet" + std::to_string(i)));
+        }
+    }
+    std::shared_ptr<Tablet> GetTablet(const std::string& index_name,
+                                      const std::string& pk) override {
+        if (pk.empty() || "x" == pk) {
+            return std::shared_ptr<Tablet>();
+        }
+        return tablets_[pk[0] % tablets_.size()];
+    }
+    std::vector<std::shared_ptr<EchoTablet>> tablets_;
+};
+
+TEST_F(RunnerTest, ScatterGatherTest) {
+    auto table = std::make_shared<ShardedTableHandler>(2);
+    std::vector<std::string> pks = {"a", "b", "a", "c", "d", "b"};
+    std::vector<std::shared_ptr<Tablet>> tablets;
+    std::vector<size_t> row_tablets;
+    ASSERT_TRUE(ProxyRequestRunner::GroupByTablet(table, "index", pks,
+                                                  &tablets, &row_tablets));
+    // "a" and "c" are in tablet1, "b" and "d" in tablet0
+    ASSERT_EQ(2u, tablets.size());
+    ASSERT_EQ(table->tablets_[1], tablets[0]);
+    ASSERT_EQ(table->tablets_[0], tablets[1]);
+    ASSERT_EQ(std::vector<size_t>({0, 1, 0, 0, 1, 1}), row_tablets);
+
+    tablets.clear();
+    row_tablets.clear();
+    pks.push_back("x");
+    ASSERT_FALSE(ProxyRequestRunner::GroupByTablet(table, "index", pks,
+                                                   &tablets, &row_tablets));
+
+    // rows of sub queries are gathered in request order
+    std::vector<std::string> values = {"r0", "r1", "r2", "r3", "r4"};
+    std::vector<std::shared_ptr<TableHandler>> tables = {
+        std::make_shared<MemTableHandler>(),
+        std::make_shared<MemTableHandler>()};
+    std::vector<std::pair<size_t, uint64_t>> positions;
+    for (size_t i = 0; i < values.size(); i++) {
+        auto sub_table =
+            std::dynamic_pointer_cast<MemTableHandler>(tables[i % 2]);
+        positions.push_back(std::make_pair(i % 2, sub_table->GetCount()));
+        sub_table->AddRow(Row(values[i]));
+    }
+    auto gather_table = std::make_shared<TableGatherWrapper>(tables, positions);
+    ASSERT_TRUE(gather_table->GetStatus().isOK());
+    ASSERT_EQ(values.size(), gather_table->GetCount());
+    for (size_t i = 0; i < values.size(); i++) {
+        AysncRowHandler row_handler(i, gather_table);
+        const Row& row = row_handler.GetValue();
+        ASSERT_EQ(values[i], std::string(reinterpret_cast<char*>(row.buf()),
+                                         row.size()));
+    }
+    auto iter = gather_table->GetIterator();
+    iter->SeekToFirst();
+    for (size_t i = 0; i < values.size(); i++, iter->Next()) {
+        ASSERT_TRUE(iter->Valid());
+        ASSERT_EQ(i, iter->GetKey());
+        ASSERT_EQ(values[i],
+                  std::string(reinterpret_cast<char*>(iter->GetValue().buf()),
+                              iter->GetValue().size()));
+    }
+    ASSERT_FALSE(iter->Valid());
+}
+
+// Key function of rows with a single string column, the key row is a copy
+// of the row
+static int32_t CopyRowKeyFn(const int64_t, const int8_t* row_ptr,
+                            const int8_t*, int8_t** out) {
+    auto row = reinterpret_cast<const Row*>(row_ptr);
+    *out = AllocRowBuf(row->size());
+    memcpy(*out, row->buf(), row->size());
+    return 0;
+}
+
+TEST_F(RunnerTest, ProxyScatterGatherTest) {
+    Schema schema;
+    auto column = schema.Add();
+    column->set_name("pk");
+    column->set_type(type::kVarchar);
+    codec::RowBuilder builder(schema);
+    std::vector<std::string> pks = {"a", "b", "a", "c", "d", "b"};
+    std::vector<Row> requests;
+    for (auto& pk : pks) {
+        uint32_t size = builder.CalTotalLength(pk.size());
+        int8_t* buf = reinterpret_cast<int8_t*>(malloc(size));
+        builder.SetBuffer(buf, size);
+        builder.AppendString(pk.c_str(), pk.size());
+        requests.push_back(
+            Row(base::RefCountedSlice::CreateManaged(buf, size)));
+    }
+
+    auto table = std::make_shared<ShardedTableHandler>(2);
+    RequestRunner request(0, nullptr);
+    Key index_key;
+    index_key.mutable_fn_info()->AddOutputColumn(*column);
+    index_key.mutable_fn_info()->SetFnPtr(
+        reinterpret_cast<const int8_t*>(&CopyRowKeyFn));
+    ClusterTask task(&request, table, "index");
+    task.SetIndexKey(index_key);
+    ClusterJob job("select pk from t1;", {});
+    int32_t task_id = job.AddTask(task);
+    ProxyRequestRunner proxy(1, task_id, nullptr);
+    proxy.AddProducer(&request);
+
+    // rows are scattered to tablets of their keys, and gathered in order
+    RunnerContext ctx(&job, requests);
+    auto outputs = proxy.BatchRequestRun(ctx);
+    ASSERT_TRUE(outputs != nullptr);
+    ASSERT_EQ(requests.size(), outputs->GetSize());
+    for (size_t i = 0; i < requests.size(); i++) {
+        auto row_handler =
+            std::dynamic_pointer_cast<RowHandler>(outputs->Get(i));
+        ASSERT_TRUE(row_handler != nullptr);
+        ASSERT_EQ(0, requests[i].compare(row_handler->GetValue()));
+    }
+    // "a" and "c" are in tablet1, "b" and "d" in tablet0
+    ASSERT_EQ(std::vector<size_t>({3}), table->tablets_[0]->query_rows_);
+    ASSERT_EQ(std::vector<size_t>({3}), table->tablets_[1]->query_rows_);
+
+    // keys on a single tablet are sent in one sub query
+    std::vector<Row> single_requests = {requests[0], requests[3]};
+    RunnerContext single_ctx(&job, single_requests);
+    outputs = proxy.BatchRequestRun(single_ctx);
+    ASSERT_TRUE(outputs != nullptr);
+    ASSERT_EQ(2u, outputs->GetSize());
+    for (size_t i = 0; i < single_requests.size(); i++) {
+        auto row_handler =
+            std::dynamic_pointer_cast<RowHandler>(outputs->Get(i));
+        ASSERT_EQ(0, single_requests[i].compare(row_handler->GetValue()));
+    }
+    ASSERT_EQ(std::vector<size_t>({3, 2}), table->tablets_[1]->query_rows_);
+}
+
+TEST_F(RunnerTest, DistinctUnionTest) {
+    Schema schema;
+    auto column = schema.Add();
+    column->set_name("col1");
+    column->set_type(type::kInt32);
+    column = schema.Add();
+    column->set_name("col2");
+    column->set_type(type::kInt64);
+    SchemasContext schemas_ctx;
+    schemas_ctx.BuildTrivial({&schema});
+    codec::RowBuilder builder(schema);
+    codec::RowView row_view(schema);
+    // null col2 of rows are filled with different garbage values
+    auto build_table = [&](int32_t begin, int32_t end) {
+        auto table = std::make_shared<MemTableHandler>(&schema);
+        for (int32_t i = begin; i < end; i++) {
+            uint32_t size = builder.CalTotalLength(0);
+            int8_t* buf = reinterpret_cast<int8_t*>(malloc(size));
+            memset(buf, i & 0xFF, size);
+            builder.SetBuffer(buf, size);
+            builder.AppendInt32(i % 10);
+            builder.AppendNULL();
+            table->AddRow(Row(base::RefCountedSlice::CreateManaged(buf, size)));
+        }
+        return table;
+    };
+    auto left = build_table(0, 30);
+    auto right = build_table(25, 50);
+    std::vector<std::shared_ptr<TableHandler>> tables = {left, right};
+
+    // union all iterates rows of both tables in place
+    TableConcatWrapper concat_table(tables);
+    ASSERT_EQ(55u, concat_table.GetCount());
+    auto iter = concat_table.GetIterator();
+    iter->SeekToFirst();
+    for (int32_t i = 0; i < 30; i++) {
+        ASSERT_TRUE(iter->Valid());
+        ASSERT_EQ(left->At(i).buf(), iter->GetValue().buf());
+        iter->Next();
+    }
+    for (int32_t i = 25; i < 50; i++) {
+        ASSERT_TRUE(iter->Valid());
+        int32_t value = -1;
+        row_view.GetValue(iter->GetValue().buf(), 0, type::kInt32, &value);
+        ASSERT_EQ(i % 10, value);
+        iter->Next();
+    }
+    ASSERT_FALSE(iter->Valid());
+
+    // union keeps the first row of every distinct value
+    DistinctGenerator distinct_gen(&schemas_ctx);
+    auto distinct_table =
+        distinct_gen.Distinct(std::make_shared<TableConcatWrapper>(tables));
+    for (int round = 0; round < 2; round++) {
+        auto iter = distinct_table->GetIterator();
+        ASSERT_FALSE(iter->Valid());
+        iter->SeekToFirst();
+        for (int32_t i = 0; i < 10; i++) {
+            ASSERT_TRUE(iter->Valid());
+            ASSERT_EQ(left->At(i).buf(), iter->GetValue().buf());
+            iter->Next();
+        }
+        ASSERT_FALSE(iter->Valid());
+    }
+    ASSERT_EQ(10u, distinct_table->GetCount());
+    ASSERT_EQ(left->At(3).buf(), distinct_table->At(3).buf());
+}
+
+TEST_F(RunnerTest, HashJoinBinaryKeyPartitionTest) {
+    std::string sqlstr =
+        "select t1.col0, t2.col6 from t1 left join t2 on t1.col1 = t2.col1;";
+    hybridse::type::TableDef table_def;
+    BuildTableDef(table_def);
+    table_def.set_name("t1");
+    hybridse::type::TableDef table_def2;
+    BuildTableDef(table_def2);
+    table_def2.set_name("t2");
+    ::hybridse::type::IndexDef* index = table_def2.add_indexes();
+    index->set_name("index1");
+    index->add_first_keys("col1");
+    index->set_second_key("col5");
+    hybridse::type::Database db;
+    db.set_name("db");
+    AddTable(db, table_def);
+    AddTable(db, table_def2);
+    auto catalog = BuildSimpleCatalog(db);
+
+    SqlCompiler sql_compiler(catalog);
+    SqlContext sql_context;
+    sql_context.sql = sqlstr;
+    sql_context.db = "db";
+    sql_context.engine_mode = kBatchMode;
+    sql_context.is_performance_sensitive = false;
+    base::Status compile_status;
+    ASSERT_TRUE(sql_compiler.Compile(sql_context, compile_status));
+    ASSERT_TRUE(sql_compiler.BuildClusterJob(sql_context, compile_status));
+    auto join_runner = dynamic_cast<HashJoinRunner*>(GetFirstRunnerOfType(
+        sql_context.cluster_job.GetTask(0).GetRoot(), kRunnerHashJoin));
+    ASSERT_TRUE(join_runner != nullptr);
+    ASSERT_TRUE(join_runner->join_gen_.index_key_gen_.Valid());
+
+    std::vector<Row> rows;
+    hybridse::type::TableDef temp_table;
+    BuildRows(temp_table, rows);
+    auto left = std::make_shared<MemTableHandler>(&table_def.columns());
+    for (auto& row : rows) {
+        left->AddRow(row);
+    }
+    // right partition is keyed by binary int32 col1 as a group partition
+    // is, which is widened to int64, the first 3 rows have col1 1, 2 and 3
+    auto right = std::make_shared<MemPartitionHandler>(&table_def2.columns());
+    for (int32_t i = 0; i < 3; i++) {
+        codec::BinaryKey key;
+        key.AppendInt64(i + 1);
+        key.Seal();
+        right->AddRow(key, i, rows[i]);
+    }
+    ASSERT_TRUE(right->IsBinaryKey());
+
+    RunnerContext ctx(nullptr);
+    auto output = std::dynamic_pointer_cast<TableHandler>(
+        join_runner->Run(ctx, {left, right}));
+    ASSERT_TRUE(output != nullptr);
+    ASSERT_EQ(rows.size(), output->GetCount());
+    auto iter = output->GetIterator();
+    iter->SeekToFirst();
+    for (size_t i = 0; i < rows.size(); i++) {
+        ASSERT_TRUE(iter->Valid());
+        const Row& joined = iter->GetValue();
+        ASSERT_EQ(rows[i].buf(), joined.buf(0));
+        if (i < 3) {
+            ASSERT_EQ(rows[i].buf(), joined.buf(1));
+        } else {
+            ASSERT_EQ(0, joined.size(1));
+        }
+        iter->Next();
+    }
+    ASSERT_FALSE(iter->Valid());
+}
+
+TEST_F(RunnerTest, HashJoinMixedIntKeyTest) {
+    // int col1 of t1 joins bigint col5 of t2
+    std::string sqlstr =
+        "select t1.col0, t2.col6 from t1 left join t2 on t1.col1 = t2.col5;";
+    hybridse::type::TableDef table_def;
+    BuildTableDef(table_def);
+    table_def.set_name("t1");
+    hybridse::type::TableDef table_def2;
+    BuildTableDef(table_def2);
+    table_def2.set_name("t2");
+    hybridse::type::Database db;
+    db.set_name("db");
+    AddTable(db, table_def);
+    AddTable(db, table_def2);
+    auto catalog = BuildSimpleCatalog(db);
+
+    SqlCompiler sql_compiler(catalog);
+    SqlContext sql_context;
+    sql_context.sql = sqlstr;
+    sql_context.db = "db";
+    sql_context.engine_mode = kBatchMode;
+    sql_context.is_performance_sensitive = false;
+    base::Status compile_status;
+    ASSERT_TRUE(sql_compiler.Compile(sql_context, compile_status))
+        << compile_status;
+    ASSERT_TRUE(sql_compiler.BuildClusterJob(sql_context, compile_status));
+    auto join_runner = dynamic_cast<HashJoinRunner*>(GetFirstRunnerOfType(
+        sql_context.cluster_job.GetTask(0).GetRoot(), kRunnerHashJoin));
+    ASSERT_TRUE(join_runner != nullptr);
+
+    std::vector<Row> rows;
+    hybridse::type::TableDef temp_table;
+    BuildRows(temp_table, rows);
+    auto left = std::make_shared<MemTableHandler>(&table_def.columns());
+    auto right = std::make_shared<MemTableHandler>(&table_def2.columns());
+    for (auto& row : rows) {
+        left->AddRow(row);
+        right->AddRow(row);
+    }
+    codec::RowView view(table_def.columns());
+    auto col1 = [&view](const int8_t* buf) {
+        view.Reset(buf);
+        return static_cast<int64_t>(view.GetInt32Unsafe(1));
+    };
+    auto col5 = [&view](const int8_t* buf) {
+        view.Reset(buf);
+        return view.GetInt64Unsafe(5);
+    };
+    size_t expect_cnt = 0;
+    size_t expect_matched = 0;
+    for (auto& left_row : rows) {
+        size_t matches = 0;
+        for (auto& right_row : rows) {
+            if (col1(left_row.buf()) == col5(right_row.buf())) {
+                matches++;
+            }
+        }
+        expect_cnt += matches > 0 ? matches : 1;
+        expect_matched += matches;
+    }
+    ASSERT_GT(expect_matched, 0u);
+
+    RunnerContext ctx(nullptr);
+    auto output = std::dynamic_pointer_cast<TableHandler>(
+        join_runner->Run(ctx, {left, right}));
+    ASSERT_TRUE(output != nullptr);
+    ASSERT_EQ(expect_cnt, output->GetCount());
+    size_t matched = 0;
+    auto iter = output->GetIterator();
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+        const Row& joined = iter->GetValue();
+        if (0 == joined.size(1)) {
+            continue;
+        }
+        ASSERT_EQ(col1(joined.buf(0)), col5(joined.buf(1)));
+        matched++;
+    }
+    ASSERT_EQ(expect_matched, matched);
+}
+
+// Copy request row into row arena of current thread, reading table of
+// `hidden_` as windows union inputs do
+class EchoRunner : public Runner {
+ public:
+    EchoRunner(int32_t id, RunnerType type, std::vector<Runner*> hidden)
+        : Runner(id, type, nullptr), hidden_(hidden) {}
+    void GetInputs(std::vector<Runner*>* inputs) const override {
+        Runner::GetInputs(inputs);
+        inputs->insert(inputs->end(), hidden_.begin(), hidden_.end());
+    }
+    std::shared_ptr<DataHandler> Run(
+        RunnerContext& ctx,
+        const std::vector<std::shared_ptr<DataHandler>>& inputs) override {
+        for (auto runner : hidden_) {
+            if (!runner->RunWithCache(ctx)) {
+                return std::shared_ptr<DataHandler>();
+            }
+        }
+        Row request = std::dynamic_pointer_cast<RowHandler>(inputs[0])
+                          ->GetValue();
+        int8_t* buf = JitRuntime::get()->AllocRow(request.size());
+        memcpy(buf, request.buf(), request.size());
+        std::lock_guard<std::mutex> lock(mu_);
+        threads_.insert(std::this_thread::get_id());
+        return std::make_shared<MemRowHandler>(
+            Row(JitRuntime::get()->CreateRowSlice(buf, request.size())));
+    }
+    size_t thread_cnt() {
+        std::lock_guard<std::mutex> lock(mu_);
+        return threads_.size();
+    }
+
+ private:
+    std::vector<Runner*> hidden_;
+    std::mutex mu_;
+    std::set<std::thread::id> threads_;
+};
+
+// Output an empty table, counting runs
+class TableRunner : public Runner {
+ public:
+    explicit TableRunner(int32_t id) : Runner(id), run_cnt_(0) {}
+    std::shared_ptr<DataHandler> Run(
+        RunnerContext& ctx,
+        const std::vector<std::shared_ptr<DataHandler>>& inputs) override {
+        run_cnt_++;
+        return std::make_shared<MemTableHandler>();
+    }
+    std::atomic<size_t> run_cnt_;
+};
+
+TEST_F(RunnerTest, BatchRequestRunParallelTest) {
+    ClusterJob job;
+    job.set_runner_num(3);
+    job.set_thread_pool(std::make_shared<base::ThreadPool>(4));
+    TableRunner table(0);
+    table.EnableCache();
+    RequestRunner request(1, nullptr);
+    // echo windows of request as request union runner does
+    TableRunner uncached_table(3);
+    EchoRunner echo(2, kRunnerRequestUnion, {&table, &uncached_table});
+    echo.AddProducer(&request);
+
+    std::vector<std::string> values;
+    std::vector<Row> requests;
+    for (int32_t i = 0; i < 1000; i++) {
+        values.push_back(std::to_string(i));
+    }
+    for (auto& value : values) {
+        requests.push_back(Row(value));
+    }
+    for (size_t round = 0; round < 2; round++) {
+        auto ctx = RunnerContextPool::Get(&job, requests);
+        RowArenaScope arena_scope(ctx->row_arena());
+        auto outputs = echo.BatchRequestRun(*ctx);
+        ASSERT_TRUE(outputs != nullptr);
+        std::vector<Row> rows;
+        ASSERT_TRUE(Runner::ExtractRows(outputs, rows));
+        ASSERT_EQ(requests.size(), rows.size());
+        for (size_t i = 0; i < rows.size(); i++) {
+            // rows are kept in request order, allocated from arenas
+            ASSERT_FALSE(rows[i].GetSlice(0).managed());
+            ASSERT_EQ(std::to_string(i),
+                      std::string(reinterpret_cast<char*>(rows[i].buf()),
+                                  rows[i].size()));
+        }
+        // table inputs are computed once, whether cached or not
+        ASSERT_EQ(round + 1, table.run_cnt_.load());
+        ASSERT_EQ(round + 1, uncached_table.run_cnt_.load());
+    }
+    ASSERT_LT(1u, echo.thread_cnt());
+
+    // runner not known to be stateless runs on caller thread
+    EchoRunner unknown(4, kRunnerUnknow, {&table});
+    unknown.AddProducer(&request);
+    auto unknown_ctx = RunnerContextPool::Get(&job, requests);
+    ASSERT_EQ(requests.size(),
+              unknown.BatchRequestRun(*unknown_ctx)->GetSize());
+    ASSERT_EQ(1u, unknown.thread_cnt());
+
+    // small batch runs on caller thread
+    requests.resize(2);
+    auto ctx = RunnerContextPool::Get(&job, requests);
+    auto outputs = echo.BatchRequestRun(*ctx);
+    ASSERT_EQ(2u, outputs->GetSize());
+    ASSERT_EQ(4u, table.run_cnt_.load());
+}
+
+TEST_F(RunnerTest, BatchRequestWindowParallelTest) {
+    std::string sqlstr =
+        "select col1, col5, sum(col2) over w as w_sum, count(col6) over w as "
+        "w_cnt from t1 window w as (partition by col1 order by col5 rows "
+        "between 10 preceding and current row);";
+    hybridse::type::TableDef table_def;
+    BuildTableDef(table_def);
+    table_def.set_name("t1");
+    ::hybridse::type::IndexDef* index = table_def.add_indexes();
+    index->set_name("index1");
+    index->add_first_keys("col1");
+    index->set_second_key("col5");
+    hybridse::type::Database db;
+    db.set_name("db");
+    AddTable(db, table_def);
+    auto catalog = BuildSimpleCatalog(db);
+
+    codec::RowBuilder builder(table_def.columns());
+    auto build_row = [&](int32_t i) {
+        std::string str = "str" + std::to_string(i);
+        uint32_t size = builder.CalTotalLength(1 + str.size());
+        int8_t* buf = reinterpret_cast<int8_t*>(malloc(size));
+        builder.SetBuffer(buf, size);
+        builder.AppendString("0", 1);
+        builder.AppendInt32(i % 7);
+        builder.AppendInt16(i % 100);
+        builder.AppendFloat(i * 0.5f);
+        builder.AppendDouble(i * 1.5);
+        builder.AppendInt64(1590738989000L + i);
+        builder.AppendString(str.data(), str.size());
+        return Row(base::RefCountedSlice::CreateManaged(buf, size));
+    };
+    std::vector<Row> table_rows;
+    std::vector<Row> requests;
+    for (int32_t i = 0; i < 500; i++) {
+        table_rows.push_back(build_row(i));
+    }
+    for (int32_t i = 500; i < 1000; i++) {
+        requests.push_back(build_row(i));
+    }
+    ASSERT_TRUE(catalog->InsertRows("db", "t1", table_rows));
+
+    SqlCompiler sql_compiler(catalog);
+    SqlContext sql_context;
+    sql_context.sql = sqlstr;
+    sql_context.db = "db";
+    sql_context.engine_mode = kBatchRequestMode;
+    sql_context.is_performance_sensitive = false;
+    sql_context.batch_thread_pool = std::make_shared<base::ThreadPool>(4);
+    base::Status compile_status;
+    ASSERT_TRUE(sql_compiler.Compile(sql_context, compile_status));
+    ASSERT_TRUE(sql_compiler.BuildClusterJob(sql_context, compile_status));
+    auto& job = sql_context.cluster_job;
+    ASSERT_TRUE(job.thread_pool() != nullptr);
+    auto root = job.GetTask(0).GetRoot();
+    ASSERT_TRUE(nullptr != GetFirstRunnerOfType(root, kRunnerRequestUnion));
+
+    auto run_batch = [&](std::vector<std::string>* outputs) {
+        auto ctx = RunnerContextPool::Get(&job, requests);
+        RowArenaScope arena_scope(ctx->row_arena());
+        std::vector<Row> rows;
+        ASSERT_TRUE(Runner::ExtractRows(root->BatchRequestRun(*ctx), rows));
+        for (auto& row : rows) {
+            std::string output;
+            for (int32_t i = 0; i < row.GetRowPtrCnt(); i++) {
+                output.append(reinterpret_cast<char*>(row.buf(i)),
+                              row.size(i));
+            }
+            outputs->push_back(output);
+        }
+    };
+    // rows run in parallel on the pool match rows run one by one
+    std::vector<std::string> parallel_rows;
+    run_batch(&parallel_rows);
+    job.set_thread_pool(nullptr);
+    std::vector<std::string> serial_rows;
+    run_batch(&serial_rows);
+    ASSERT_EQ(requests.size(), serial_rows.size());
+    ASSERT_EQ(serial_rows, parallel_rows);
+}
 }  // namespace vm
 }  // namespace hybridse
 
@@ -31,6 +31,8 @@
 #include "parser/parser.h"
 #include "plan/planner.h"
 #include "udf/default_udf_library.h"
+#include "udf/udf_bitcode.h"
+#include "vm/jit_object_cache.h"
 #include "vm/runner.h"
 #include "vm/transform.h"
 
@@ -114,6 +116,10 @@ bool SqlCompiler::Compile(SqlContext& ctx, Status& status) {  // NOLINT
         m->print(::llvm::errs(), NULL, true, true);
         return false;
     }
+    // builtin udfs are worth inlining only by full optimization pipeline
+    if (ctx.jit_options.opt_level() >= 2) {
+        udf::LinkUdfBitcode(*ctx.udf_library, m.get());
+    }
     // ::llvm::errs() << *(m.get());
     auto jit = std::shared_ptr<HybridSeJitWrapper>(
         HybridSeJitWrapper::Create(ctx.jit_options));
@@ -125,7 +131,18 @@ bool SqlCompiler::Compile(SqlContext& ctx, Status& status) {  // NOLINT
     }
     InitBuiltinJitSymbols(jit.get());
     ctx.udf_library->InitJITSymbols(jit.get());
-    if (!jit->OptModule(m.get())) {
+    bool object_cached = false;
+    const std::string& object_cache_dir = ctx.jit_options.object_cache_dir();
+    if (!object_cache_dir.empty()) {
+        // key the module so that jit compiles it through object cache,
+        // cached object is read now and used instead of optimizing the
+        // module
+        std::string key = JitObjectCache::ModuleKey(
+            *m, ctx.sql, ctx.db, ctx.engine_mode, ctx.jit_options);
+        m->setModuleIdentifier(key);
+        object_cached = jit->LoadCachedObject(key);
+    }
+    if ((!object_cached || keep_ir_) && !jit->OptModule(m.get())) {
         LOG(WARNING) << "fail to opt ir module for sql " << ctx.sql;
         return false;
     }
@@ -293,6 +310,14 @@ bool SqlCompiler::BuildClusterJob(SqlContext& ctx, Status& status) {  // NOLINT
                                  ctx.is_cluster_optimized && is_request_mode,
                                  ctx.batch_request_info.common_column_indices,
                                  ctx.batch_request_info.common_node_set);
+    if (vm::kBatchMode == ctx.engine_mode ||
+        vm::kBatchRequestMode == ctx.engine_mode) {
+        runner_builder.set_batch_thread_pool(ctx.batch_thread_pool);
+    }
+    if (vm::kBatchMode == ctx.engine_mode) {
+        runner_builder.set_batch_sort_options(ctx.batch_sort_memory_limit,
+                                              ctx.batch_sort_spill_dir);
+    }
     ctx.cluster_job = runner_builder.BuildClusterJob(ctx.physical_plan, status);
     return status.isOK();
 }
@@ -403,6 +428,15 @@ bool SqlCompiler::ResolvePlanFnAddress(vm::PhysicalOpNode* node,
                 }
                 const_cast<FnInfo*>(info_ptr)->SetFnPtr(addr);
             }
+            if (!info_ptr->block_fn_name().empty()) {
+                auto addr = jit->FindFunction(info_ptr->block_fn_name());
+                if (addr == nullptr) {
+                    LOG(WARNING) << "Fail to find jit function "
+                                 << info_ptr->block_fn_name() << " for node\n"
+                                 << *node;
+                }
+                const_cast<FnInfo*>(info_ptr)->SetBlockFnPtr(addr);
+            }
         }
     }
     return true;
@@ -17,6 +17,7 @@
 #ifndef SRC_VM_SQL_COMPILER_H_
 #define SRC_VM_SQL_COMPILER_H_
 
+#include <atomic>
 #include <memory>
 #include <set>
 #include <string>
@@ -45,6 +46,11 @@ struct SqlContext {
     bool is_batch_request_optimized = false;
     bool enable_expr_optimize = false;
     bool enable_batch_window_parallelization = false;
+    // worker pool of batch mode runners, null to run on caller thread
+    std::shared_ptr<base::ThreadPool> batch_thread_pool;
+    // memory budget and spill directory of batch mode ORDER BY
+    uint64_t batch_sort_memory_limit = 0;
+    std::string batch_sort_spill_dir;
 
     // the sql content
     std::string sql;
@@ -131,8 +137,15 @@ class SqlCompileInfo : public CompileInfo {
         return dynamic_cast<SqlCompileInfo*>(node);
     }
 
+    // Count a fetch of this compile result from engine cache, return the
+    // count including this one
+    uint64_t IncreaseHitCount() {
+        return hit_cnt_.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
  private:
     hybridse::vm::SqlContext sql_ctx;
+    std::atomic<uint64_t> hit_cnt_{0};
 };
 
 class SqlCompiler {
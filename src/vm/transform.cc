@@ -326,6 +326,24 @@ Status BatchModeTransformer::InitFnInfo(PhysicalOpNode* node,
                      "th native function \"", fn_info->fn_name(),
                      "\" failed at node:\n", node->GetTreeString());
     }
+
+    // table project and filter scan whole tables, run them block by block
+    if (IsBlockFnEnabled()) {
+        const FnInfo* block_fn_info = nullptr;
+        if (kPhysicalOpProject == node->GetOpType()) {
+            auto project_op = dynamic_cast<PhysicalProjectNode*>(node);
+            if (kTableProject == project_op->project_type_) {
+                block_fn_info = &project_op->project().fn_info();
+            }
+        } else if (kPhysicalOpFilter == node->GetOpType()) {
+            auto filter_op = dynamic_cast<PhysicalFilterNode*>(node);
+            block_fn_info = &filter_op->filter().condition_.fn_info();
+        }
+        if (block_fn_info != nullptr && !block_fn_info->fn_name().empty()) {
+            CHECK_STATUS(InstantiateLLVMBlockFunction(
+                const_cast<FnInfo*>(block_fn_info)));
+        }
+    }
     return Status::OK();
 }
 
@@ -948,6 +966,17 @@ Status BatchModeTransformer::InstantiateLLVMFunction(const FnInfo& fn_info) {
                          *fn_info.fn_schema());
 }
 
+Status BatchModeTransformer::InstantiateLLVMBlockFunction(FnInfo* fn_info) {
+    CHECK_TRUE(fn_info->IsValid(), kCodegenError);
+    std::string block_fn_name = fn_info->fn_name() + "_block";
+    codegen::CodeGenContext codegen_ctx(module_, fn_info->schemas_ctx(),
+                                        node_manager_);
+    codegen::RowFnLetIRBuilder builder(&codegen_ctx);
+    CHECK_STATUS(builder.BuildBlock(block_fn_name, fn_info->fn_name()));
+    fn_info->SetBlockFnName(block_fn_name);
+    return Status::OK();
+}
+
 bool BatchModeTransformer::AddDefaultPasses() {
     AddPass(PhysicalPlanPassType::kPassColumnProjectsOptimized);
     AddPass(PhysicalPlanPassType::kPassFilterOptimized);
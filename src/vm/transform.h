@@ -212,6 +212,15 @@ class BatchModeTransformer {
      */
     Status InstantiateLLVMFunction(const FnInfo& fn_info);
 
+    /**
+     * Instantiate block function of `fn_info` running its function on a
+     * block of rows.
+     */
+    Status InstantiateLLVMBlockFunction(FnInfo* fn_info);
+
+    // Return true to generate block functions for table scans
+    virtual bool IsBlockFnEnabled() const { return true; }
+
     Status GenWindowJoinList(PhysicalWindowAggrerationNode* window_agg_op,
                              PhysicalOpNode* in);
     Status GenWindowUnionList(WindowUnionList* window_union_list,
@@ -271,6 +280,8 @@ class RequestModeTransformer : public BatchModeTransformer {
 
  protected:
     void ApplyPasses(PhysicalOpNode* node, PhysicalOpNode** output) override;
+    // request mode computes one row at a time
+    bool IsBlockFnEnabled() const override { return false; }
     virtual Status TransformProjectOp(node::ProjectListNode* node,
                                       PhysicalOpNode* depend, bool append_input,
                                       PhysicalOpNode** output);
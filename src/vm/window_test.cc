@@ -1546,6 +1546,81 @@ TEST_F(RequestUnionWindowTest, RequestRowsMergeRowsRangeWindowTest) {
             window_range, keys, current_key, exp_keys, exclude_current_time));
     }
 }
+
+TEST_F(RequestUnionWindowTest, RequestUnionWindowViewTest) {
+    // rows of two segments, every row owns its buffer
+    std::vector<std::string> bufs = {"r10", "r8", "r6", "r9", "r7", "req"};
+    auto segment1 = std::make_shared<MemTimeTableHandler>();
+    segment1->AddRow(10L, Row(bufs[0]));
+    segment1->AddRow(8L, Row(bufs[1]));
+    segment1->AddRow(6L, Row(bufs[2]));
+    auto segment2 = std::make_shared<MemTimeTableHandler>();
+    segment2->AddRow(9L, Row(bufs[3]));
+    segment2->AddRow(7L, Row(bufs[4]));
+
+    auto window = RequestUnionRunner::RequestUnionWindow(
+        Row(bufs[5]),
+        std::vector<std::shared_ptr<TableHandler>>({segment1, segment2}), 9L,
+        WindowRange::CreateRowsRangeWindow(-2, 0), true, false);
+    std::vector<uint64_t> exp_keys({9L, 9L, 8L, 7L});
+    std::vector<const int8_t*> exp_bufs(
+        {Row(bufs[5]).buf(), segment2->At(0).buf(), segment1->At(1).buf(),
+         segment2->At(1).buf()});
+    // window is iterated again and again over rows of segments, no copy
+    for (int round = 0; round < 2; round++) {
+        auto iter = window->GetIterator();
+        iter->SeekToFirst();
+        for (size_t i = 0; i < exp_keys.size(); i++) {
+            ASSERT_TRUE(iter->Valid());
+            ASSERT_EQ(exp_keys[i], iter->GetKey());
+            ASSERT_EQ(exp_bufs[i], iter->GetValue().buf());
+            iter->Next();
+        }
+        ASSERT_FALSE(iter->Valid());
+    }
+    ASSERT_EQ(4u, window->GetCount());
+    // rows are collected once for positional access
+    for (size_t i = exp_bufs.size(); i > 0; i--) {
+        ASSERT_EQ(exp_bufs[i - 1], window->At(i - 1).buf());
+    }
+    ASSERT_TRUE(window->At(exp_bufs.size()).empty());
+    ASSERT_EQ(4u, window->GetCount());
+
+    auto iter = window->GetIterator();
+    iter->Seek(8L);
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ(8L, iter->GetKey());
+}
+
+TEST_F(RequestUnionWindowTest, RequestUnionWindowSnapshotTest) {
+    std::vector<std::string> bufs = {"r10", "r8", "r9", "r7", "r5", "req"};
+    auto segment1 = std::make_shared<MemTimeTableHandler>();
+    segment1->AddRow(10L, Row(bufs[0]));
+    segment1->AddRow(8L, Row(bufs[1]));
+    auto segment2 = std::make_shared<MemTimeTableHandler>();
+    segment2->AddRow(9L, Row(bufs[2]));
+    segment2->AddRow(7L, Row(bufs[3]));
+
+    auto window = RequestUnionRunner::RequestUnionWindow(
+        Row(bufs[5]),
+        std::vector<std::shared_ptr<TableHandler>>({segment1, segment2}), 9L,
+        WindowRange::CreateRowsRangeWindow(-10, 0), true, false);
+    ASSERT_EQ(4u, window->GetCount());
+
+    // rows appended into segment after window is built are not in window
+    segment2->AddRow(5L, Row(bufs[4]));
+    std::vector<uint64_t> exp_keys({9L, 9L, 8L, 7L});
+    auto iter = window->GetIterator();
+    iter->SeekToFirst();
+    for (size_t i = 0; i < exp_keys.size(); i++) {
+        ASSERT_TRUE(iter->Valid());
+        ASSERT_EQ(exp_keys[i], iter->GetKey());
+        iter->Next();
+    }
+    ASSERT_FALSE(iter->Valid());
+    ASSERT_EQ(4u, window->GetCount());
+    ASSERT_TRUE(window->At(4).empty());
+}
 }  // namespace vm
 }  // namespace hybridse
 int main(int argc, char** argv) {